@@ -0,0 +1,33 @@
+#include <benchmark/benchmark.h>
+
+#include "../Source/Crc32c.h"
+
+#include <vector>
+
+// Checksum of one block of bytes with each implementation; a 4096-frame block of
+// 64 channels is 512 KB
+static void BM_Crc32c(benchmark::State& state) {
+    const auto implementation = Crc32c::Implementation(state.range(0));
+    const size_t bytes = size_t(state.range(1));
+    state.SetLabel(Crc32c::getName(implementation));
+    if (!Crc32c::isSupported(implementation)) {
+        state.SkipWithError("not supported on this CPU");
+        return;
+    }
+
+    std::vector<uint8> data(bytes);
+    for (size_t i = 0; i < bytes; i++) {
+        data[i] = uint8(i * 7);
+    }
+
+    uint32 crc = 0;
+    for (auto _ : state) {
+        crc = Crc32c::update(implementation, 0, data.data(), bytes);
+        benchmark::DoNotOptimize(crc);
+    }
+
+    state.SetBytesProcessed(state.iterations() * int64_t(bytes));
+}
+
+BENCHMARK(BM_Crc32c)
+    ->ArgsProduct({ { Crc32c::TABLE, Crc32c::SSE42 }, { 4096, 512 << 10, 12 << 20 } });
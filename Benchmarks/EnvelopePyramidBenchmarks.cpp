@@ -0,0 +1,31 @@
+#include <benchmark/benchmark.h>
+
+#include "../Source/EnvelopePyramid.h"
+
+#include <vector>
+
+// One 4096-frame block per call, as the engine's InterleavedBlockFile hands them over.
+// No file is opened, so this is the cost added to the write path.
+static void BM_EnvelopePyramid_AddFrames(benchmark::State& state) {
+    const int channels = int(state.range(0));
+    const bool rms = state.range(1) != 0;
+    const int frames = 4096;
+    state.SetLabel(rms ? "min/max/rms" : "min/max");
+
+    std::vector<int16> block(size_t(channels) * frames);
+    for (size_t i = 0; i < block.size(); i++) {
+        block[i] = int16(i * 13);
+    }
+
+    EnvelopePyramid pyramid(channels, rms);
+    for (auto _ : state) {
+        pyramid.addFrames(block.data(), frames);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * int64_t(block.size() * sizeof(int16)));
+}
+
+BENCHMARK(BM_EnvelopePyramid_AddFrames)
+    ->ArgsProduct({ { 16, 64, 384, 1536 }, { 0, 1 } })
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,76 @@
+#include <benchmark/benchmark.h>
+
+#include "../Source/EventColumnBuffer.h"
+#include "../Source/EventPacketView.h"
+
+#include <cstring>
+#include <vector>
+
+static const uint8 kTTLType = 3;
+static const uint8 kTextType = 5;
+
+// A serialized TTL event, as written by Event::serialize
+static std::vector<uint8> MakeTTLPacket(int64 sampleNumber) {
+    std::vector<uint8> packet(EventPacketView::TTL_SIZE, 0);
+    packet[1] = kTTLType;
+    const double timestamp = sampleNumber / 30000.0;
+    memcpy(packet.data() + 8, &sampleNumber, sizeof(int64));
+    memcpy(packet.data() + 16, &timestamp, sizeof(double));
+    packet[24] = 3;
+    packet[25] = sampleNumber & 1;
+    const uint64 word = uint64(packet[25]) << 3;
+    memcpy(packet.data() + 26, &word, sizeof(uint64));
+    return packet;
+}
+
+// The in-place decode alone; BM_DeserializeTTL in RecordEngineBenchmarks.cpp compares it with
+// Event::deserialize on packets serialized by the GUI, which needs an EventChannel
+static void BM_DecodeTTL(benchmark::State& state) {
+    std::vector<std::vector<uint8>> packets;
+    for (int i = 0; i < 1024; i++) {
+        packets.push_back(MakeTTLPacket(i * 7));
+    }
+
+    EventPacketView view;
+    size_t next = 0;
+    for (auto _ : state) {
+        const auto& packet = packets[next++ & 1023];
+        benchmark::DoNotOptimize(view.decode(packet.data(), packet.size(), kTTLType, kTextType, 0));
+        benchmark::DoNotOptimize(view.sampleNumber);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecodeTTL);
+
+// Decoding a burst of TTL events into the columns the record engine buffers per channel
+static void BM_BufferTTLColumns(benchmark::State& state) {
+    const int capacity = int(state.range(0));
+
+    std::vector<std::vector<uint8>> packets;
+    for (int i = 0; i < capacity; i++) {
+        packets.push_back(MakeTTLPacket(i * 7));
+    }
+
+    EventColumnBuffer columns(capacity);
+    const int data = columns.addColumn(sizeof(int16));
+    const int samples = columns.addColumn(sizeof(int64));
+    const int timestamps = columns.addColumn(sizeof(double));
+    const int words = columns.addColumn(sizeof(uint64));
+
+    EventPacketView view;
+    for (auto _ : state) {
+        for (const auto& packet : packets) {
+            view.decode(packet.data(), packet.size(), kTTLType, kTextType, 0);
+            const int16 ttl = view.state ? int16(view.line + 1) : int16(-(view.line + 1));
+            columns.setValue(data, &ttl);
+            columns.setValue(samples, &view.sampleNumber);
+            columns.setValue(timestamps, &view.timestamp);
+            columns.setValue(words, &view.word);
+            columns.commitRecord();
+        }
+        benchmark::DoNotOptimize(columns.getColumnData(samples));
+        columns.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * capacity);
+}
+BENCHMARK(BM_BufferTTLColumns)->Arg(256)->Arg(4096);
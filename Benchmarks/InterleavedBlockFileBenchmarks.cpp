@@ -0,0 +1,151 @@
+#include <benchmark/benchmark.h>
+
+#include "../Source/BlockChecksumWriter.h"
+#include "../Source/InterleavedBlockFile.h"
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Data written per iteration; each iteration creates, fills and closes one file
+static const int64_t kBytesPerFile = 64 << 20;
+
+// Data written by the sustained runs, well past what a short run leaves in the page cache
+static const int64_t kSustainedBytesPerFile = int64_t(8) << 30;
+
+static const char* SinkName(BlockFileSink::Type type) {
+    switch (type) {
+        case BlockFileSink::DIRECT: return "direct";
+        case BlockFileSink::MAPPED: return "mapped";
+        default: return "buffered";
+    }
+}
+
+// Pages of the file, and how many of them are in the page cache, from mincore over a mapping of it
+static bool ResidentPages(const std::filesystem::path& path, int64_t& resident, int64_t& total) {
+#ifdef _WIN32
+    return false;
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    const size_t size = size_t(std::filesystem::file_size(path));
+    const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+    bool ok = false;
+    void* data = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (data != MAP_FAILED) {
+        std::vector<unsigned char> pages((size + pageSize - 1) / pageSize);
+        if (mincore(data, size, pages.data()) == 0) {
+            resident = 0;
+            for (unsigned char page : pages) {
+                resident += page & 1;
+            }
+            total = int64_t(pages.size());
+            ok = true;
+        }
+        munmap(data, size);
+    }
+    ::close(fd);
+    return ok;
+#endif
+}
+
+// Channel-major blocks of a stream, written with writeChannels (whole-stream) or one
+// writeChannel call per channel, optionally with a CRC32C of every block
+// The page cache residency of the last file written is reported as resident_pages
+static void WriteFile(benchmark::State& state, bool wholeStream, bool checksums = false, int64_t bytesPerFile = kBytesPerFile) {
+    const auto sinkType = BlockFileSink::Type(state.range(0));
+    const int channels = int(state.range(1));
+    const int blockSamples = int(state.range(2));
+    state.SetLabel(SinkName(sinkType));
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "persyst_block_file_benchmark.dat";
+    const std::filesystem::path crcPath = std::filesystem::temp_directory_path() / "persyst_block_file_benchmark.crc";
+    const int blocks = int(std::max<int64_t>(1, bytesPerFile / (int64_t(channels) * blockSamples * sizeof(int16))));
+
+    std::vector<int16> block(size_t(channels) * blockSamples);
+    for (size_t i = 0; i < block.size(); i++) {
+        block[i] = int16(i * 13);
+    }
+
+    for (auto _ : state) {
+        std::filesystem::remove(path);
+        BlockChecksumWriter checksumWriter(channels);
+        {
+            InterleavedBlockFile file(channels, 4096, sinkType);
+            if (!file.openFile(String(path.string()))) {
+                state.SkipWithError("could not open the file");
+                break;
+            }
+            if (checksums) {
+                checksumWriter.openFile(String(crcPath.string()));
+                file.addListener(&checksumWriter);
+            }
+            for (int b = 0; b < blocks; b++) {
+                const uint64 start = uint64(b) * blockSamples;
+                if (wholeStream) {
+                    file.writeChannels(start, block.data(), blockSamples, blockSamples);
+                } else {
+                    for (int ch = 0; ch < channels; ch++) {
+                        file.writeChannel(start, ch, block.data() + size_t(ch) * blockSamples, blockSamples);
+                    }
+                }
+            }
+        }
+    }
+    int64_t resident = 0;
+    int64_t total = 0;
+    if (ResidentPages(path, resident, total)) {
+        state.counters["resident_pages"] = double(resident);
+        state.counters["resident_fraction"] = double(resident) / double(total);
+    }
+    std::filesystem::remove(path);
+    std::filesystem::remove(crcPath);
+
+    state.SetBytesProcessed(state.iterations() * blocks * int64_t(block.size() * sizeof(int16)));
+}
+
+static void BM_WriteChannels(benchmark::State& state) {
+    WriteFile(state, true);
+}
+
+static void BM_WriteChannel(benchmark::State& state) {
+    WriteFile(state, false);
+}
+
+// Same as BM_WriteChannels, to compare against the cost of the block checksums
+static void BM_WriteChannels_Checksums(benchmark::State& state) {
+    WriteFile(state, true, true);
+}
+
+// One long file per sink, to see the throughput once the page cache stops absorbing the
+// writes, and how much of the file each sink leaves behind in it
+static void BM_WriteChannels_Sustained(benchmark::State& state) {
+    WriteFile(state, true, false, kSustainedBytesPerFile);
+}
+
+static void SinkShapes(benchmark::internal::Benchmark* b) {
+    for (int sink : { BlockFileSink::BUFFERED, BlockFileSink::DIRECT, BlockFileSink::MAPPED }) {
+        for (int channels : { 16, 64, 384, 1536 }) {
+            b->Args({ sink, channels, 1024 });
+        }
+    }
+}
+
+BENCHMARK(BM_WriteChannels)->Apply(SinkShapes)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_WriteChannel)->Apply(SinkShapes)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_WriteChannels_Checksums)->Apply(SinkShapes)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_WriteChannels_Sustained)
+    ->Args({ BlockFileSink::BUFFERED, 384, 1024 })
+    ->Args({ BlockFileSink::DIRECT, 384, 1024 })
+    ->Args({ BlockFileSink::MAPPED, 384, 1024 })
+    ->Iterations(1)
+    ->Unit(benchmark::kSecond)
+    ->UseRealTime();
@@ -0,0 +1,58 @@
+#include <benchmark/benchmark.h>
+
+#include "../Source/PersystReader.h"
+
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <vector>
+
+static const int kChannels = 384;
+static const int kSamples = 30000;
+
+// One second of a Neuropixels-sized stream, written once for all reader benchmarks
+static File WriteRecording() {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "persyst_reader_benchmark";
+    std::filesystem::create_directories(dir);
+
+    if (!std::filesystem::exists(dir / "recording.lay")) {
+        std::vector<int16_t> data(size_t(kChannels) * kSamples);
+        for (size_t i = 0; i < data.size(); i++) {
+            data[i] = int16_t(i * 31);
+        }
+        std::ofstream(dir / "recording.dat", std::ios::binary)
+            .write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(int16_t));
+        std::ofstream(dir / "recording.lay") << "[FileInfo]\nFile=recording.dat\nFileType=Interleaved\nSamplingRate=30000\n"
+                                             << "HeaderLength=0\nCalibration=0.195\nWaveformCount=" << kChannels << "\nDataType=0\n"
+                                             << "[SampleTimes]\n0=0\n";
+    }
+    return File(String((dir / "recording.lay").string()));
+}
+
+// Reads range(0) channels, spread across the probe, over the whole recording
+static void BM_ReadChannels(benchmark::State& state) {
+    const int numChannels = int(state.range(0));
+
+    PersystReader reader;
+    if (!reader.open(WriteRecording())) {
+        state.SkipWithError("could not open the recording");
+        return;
+    }
+
+    std::vector<int> channels(numChannels);
+    for (int c = 0; c < numChannels; c++) {
+        channels[c] = c * (kChannels / numChannels);
+    }
+    std::vector<std::vector<float>> output(numChannels, std::vector<float>(kSamples));
+    std::vector<float*> dest(numChannels);
+    for (int c = 0; c < numChannels; c++) {
+        dest[c] = output[c].data();
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(reader.readChannels(channels.data(), numChannels, 0, kSamples, dest.data()));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(numChannels) * kSamples);
+}
+BENCHMARK(BM_ReadChannels)->Arg(1)->Arg(16)->Arg(384)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,281 @@
+#include <benchmark/benchmark.h>
+
+#include <Processors/RecordNode/RecordNode.h>
+#include <Processors/PluginManager/OpenEphysPlugin.h>
+#include "../Source/PersystRecordEngine.h"
+#include "../Source/EventPacketView.h"
+#include <ModelProcessors.h>
+#include <ModelApplication.h>
+#include <TestFixtures.h>
+
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/*
+    End-to-end benchmarks of the record engine, driven through a Record Node like
+    Tests/PersystRecordEngineTests.cpp. Every iteration records one second of data
+    (or a burst of events) from startAcquisition to stopAcquisition, so the times
+    include openFiles, the Record Node's write thread and closeFiles.
+*/
+
+static const float kSampleRate = 30000.0f;
+
+class RecordingHarness {
+public:
+    RecordingHarness(int num_channels, int num_streams, std::function<void(RecordEngineManager*)> configure = nullptr) :
+        streams(num_streams) {
+        tester = std::make_unique<ProcessorTester>(FakeSourceNodeParams{
+            num_channels,
+            kSampleRate,
+            0.195f,
+            num_streams
+        });
+
+        parent_recording_dir = std::filesystem::temp_directory_path() / "persyst_record_engine_benchmarks";
+        if (std::filesystem::exists(parent_recording_dir)) {
+            std::filesystem::remove_all(parent_recording_dir);
+        }
+        std::filesystem::create_directory(parent_recording_dir);
+
+        tester->setRecordingParentDirectory(parent_recording_dir.string());
+        processor = tester->Create<RecordNode>(Plugin::Processor::RECORD_NODE);
+        std::unique_ptr<RecordEngineManager> record_engine_manager = std::unique_ptr<RecordEngineManager>(PersystRecordEngine::getEngineManager());
+        if (configure) {
+            configure(record_engine_manager.get());
+        }
+        processor->overrideRecordEngine(record_engine_manager.get());
+    }
+
+    ~RecordingHarness() {
+        std::error_code ec;
+        std::filesystem::remove_all(parent_recording_dir, ec);
+    }
+
+    void Start() {
+        tester->startAcquisition(true, streams > 1);
+    }
+
+    void Stop() {
+        tester->stopAcquisition();
+    }
+
+    // Recordings are not deleted between iterations inside Start/Stop, only between benchmarks
+    void ClearRecordings() {
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(parent_recording_dir, ec)) {
+            std::filesystem::remove_all(entry.path(), ec);
+        }
+    }
+
+    std::unique_ptr<ProcessorTester> tester;
+    RecordNode* processor;
+    std::filesystem::path parent_recording_dir;
+    int streams;
+};
+
+static AudioBuffer<float> CreateSignal(int num_channels, int num_samples) {
+    AudioBuffer<float> buffer(num_channels, num_samples);
+    for (int chidx = 0; chidx < num_channels; chidx++) {
+        for (int sample_idx = 0; sample_idx < num_samples; sample_idx++) {
+            // In microvolts; a few hundred uV like spiking data
+            buffer.setSample(chidx, sample_idx, 300.0f * std::sin(0.01f * (sample_idx + 37 * chidx)));
+        }
+    }
+    return buffer;
+}
+
+// Engine options compared by BM_WriteContinuousData_Modes
+enum WriteMode {
+    kDefault = 0,
+    kWholeStream,
+    kAsync,
+    kAsyncDirect,
+    kAsyncMapped
+};
+
+static std::function<void(RecordEngineManager*)> ConfigureMode(int mode) {
+    return [mode](RecordEngineManager* manager) {
+        manager->getParameter(1).boolParam.value = mode == kWholeStream;
+        manager->getParameter(2).boolParam.value = mode >= kAsync;
+        // One writer thread per stream, up to the parameter's range
+        manager->getParameter(10).intParam.value = 8;
+        if (mode == kAsyncDirect) {
+            manager->getParameter(4).intParam.value = 1;
+        } else if (mode == kAsyncMapped) {
+            manager->getParameter(4).intParam.value = 2;
+        }
+    };
+}
+
+static const char* ModeName(int mode) {
+    switch (mode) {
+        case kWholeStream: return "whole-stream";
+        case kAsync: return "async";
+        case kAsyncDirect: return "async+direct";
+        case kAsyncMapped: return "async+mapped";
+        default: return "default";
+    }
+}
+
+// range(0) channels per stream, range(1) samples per block, range(2) streams, range(3) WriteMode
+static void BM_WriteContinuousData(benchmark::State& state) {
+    const int channels = int(state.range(0));
+    const int block_size = int(state.range(1));
+    const int streams = int(state.range(2));
+    const int mode = int(state.range(3));
+    state.SetLabel(ModeName(mode));
+
+    RecordingHarness harness(channels, streams, ConfigureMode(mode));
+    auto buffer = CreateSignal(channels * streams, block_size);
+    const int blocks = int(std::ceil(kSampleRate / block_size));
+
+    for (auto _ : state) {
+        harness.Start();
+        for (int b = 0; b < blocks; b++) {
+            harness.tester->ProcessBlock(harness.processor, buffer);
+        }
+        harness.Stop();
+
+        state.PauseTiming();
+        harness.ClearRecordings();
+        state.ResumeTiming();
+    }
+
+    const int64_t samples = int64_t(blocks) * block_size * channels * streams;
+    state.SetItemsProcessed(state.iterations() * samples);
+    state.SetBytesProcessed(state.iterations() * samples * int64_t(sizeof(int16)));
+    state.counters["realtime_factor"] = benchmark::Counter(
+        double(state.iterations()) * blocks * block_size / kSampleRate, benchmark::Counter::kIsRate);
+}
+
+// Every shape from 16 to 1536 channels per stream, 256 to 8192 samples per block and 1 to 8
+// streams, up to 3072 channels in total (eight Neuropixels probes)
+static void ContinuousShapes(benchmark::internal::Benchmark* b) {
+    for (int channels : { 16, 64, 384, 1536 }) {
+        for (int block_size : { 256, 1024, 4096, 8192 }) {
+            for (int streams : { 1, 2, 4, 8 }) {
+                if (channels * streams <= 3072) {
+                    b->Args({ channels, block_size, streams, kDefault });
+                }
+            }
+        }
+    }
+}
+
+static void ModeShapes(benchmark::internal::Benchmark* b) {
+    for (int mode = kDefault; mode <= kAsyncMapped; mode++) {
+        b->Args({ 384, 1024, 1, mode });
+        b->Args({ 384, 1024, 4, mode });
+        b->Args({ 1536, 1024, 2, mode });
+    }
+}
+
+BENCHMARK(BM_WriteContinuousData)->Apply(ContinuousShapes)->Unit(benchmark::kMillisecond)->UseRealTime();
+static void BM_WriteContinuousData_Modes(benchmark::State& state) {
+    BM_WriteContinuousData(state);
+}
+BENCHMARK(BM_WriteContinuousData_Modes)->Apply(ModeShapes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// range(0) TTL events per recording, one per 16-sample block, toggling a line each time
+static void BM_WriteEvent(benchmark::State& state) {
+    const int events = int(state.range(0));
+    const int block_size = 16;
+
+    RecordingHarness harness(16, 1);
+    harness.processor->setRecordEvents(true);
+    harness.processor->updateSettings();
+
+    auto stream_id = harness.processor->getDataStreams()[0]->getStreamId();
+    auto event_channels = harness.tester->GetSourceNodeDataStream(stream_id)->getEventChannels();
+    if (event_channels.size() == 0) {
+        state.SkipWithError("the source node has no event channel");
+        return;
+    }
+
+    auto buffer = CreateSignal(16, block_size);
+
+    for (auto _ : state) {
+        harness.Start();
+        for (int e = 0; e < events; e++) {
+            TTLEventPtr event_ptr = TTLEvent::createTTLEvent(event_channels[0], int64(e) * block_size, uint8(e % 8), (e & 1) == 0);
+            harness.tester->ProcessBlock(harness.processor, buffer, event_ptr.get());
+        }
+        harness.Stop();
+
+        state.PauseTiming();
+        harness.ClearRecordings();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * events);
+}
+BENCHMARK(BM_WriteEvent)->Arg(1000)->Arg(20000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Reading TTL packets serialized by the GUI the way writeEventPacket does without its fast
+// path, through Event::deserialize, or with it (range(0) = 1), through EventPacketView.
+// Compare with BM_DecodeTTL in EventBenchmarks.cpp
+static void BM_DeserializeTTL(benchmark::State& state) {
+    const bool fastPath = state.range(0) != 0;
+    state.SetLabel(fastPath ? "EventPacketView" : "Event::deserialize");
+
+    RecordingHarness harness(16, 1);
+    auto stream_id = harness.processor->getDataStreams()[0]->getStreamId();
+    auto event_channels = harness.tester->GetSourceNodeDataStream(stream_id)->getEventChannels();
+    if (event_channels.size() == 0) {
+        state.SkipWithError("the source node has no event channel");
+        return;
+    }
+    const EventChannel* channel = event_channels[0];
+
+    std::vector<EventPacket> packets;
+    std::vector<uint8> buffer(EventPacketView::TTL_SIZE);
+    for (int i = 0; i < 1024; i++) {
+        TTLEventPtr event_ptr = TTLEvent::createTTLEvent(channel, int64(i) * 7, uint8(3), (i & 1) != 0);
+        event_ptr->serialize(buffer.data(), buffer.size());
+        packets.emplace_back(buffer.data(), int(buffer.size()));
+    }
+
+    EventPacketView view;
+    size_t next = 0;
+    for (auto _ : state) {
+        const EventPacket& packet = packets[next++ & 1023];
+        if (fastPath) {
+            benchmark::DoNotOptimize(view.decode(packet.getRawData(), packet.getRawDataSize(),
+                                                 uint8(EventChannel::TTL), uint8(EventChannel::TEXT), channel->getDataSize()));
+            benchmark::DoNotOptimize(view.sampleNumber);
+        } else {
+            EventPtr event = Event::deserialize(packet, channel);
+            benchmark::DoNotOptimize(event->getSampleNumber());
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DeserializeTTL)->Arg(0)->Arg(1);
+
+// openFiles/closeFiles with a single short block in between; range(2) enables the async writer
+static void BM_OpenCloseFiles(benchmark::State& state) {
+    const int channels = int(state.range(0));
+    const int streams = int(state.range(1));
+    const int mode = state.range(2) ? kAsync : kDefault;
+    state.SetLabel(ModeName(mode));
+
+    RecordingHarness harness(channels, streams, ConfigureMode(mode));
+    auto buffer = CreateSignal(channels * streams, 64);
+
+    for (auto _ : state) {
+        harness.Start();
+        harness.tester->ProcessBlock(harness.processor, buffer);
+        harness.Stop();
+
+        state.PauseTiming();
+        harness.ClearRecordings();
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_OpenCloseFiles)
+    ->ArgsProduct({ { 16, 384 }, { 1, 8 }, { 0, 1 } })
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
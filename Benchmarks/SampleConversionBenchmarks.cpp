@@ -0,0 +1,151 @@
+#include <benchmark/benchmark.h>
+
+#include "../Source/SampleConversion.h"
+
+#include <vector>
+
+// One block of the record engine's default size
+static const int kBlockSamples = 4096;
+
+static void BM_FloatToInt16(benchmark::State& state) {
+    const auto set = SampleConversion::InstructionSet(state.range(0));
+    if (!SampleConversion::isSupported(set)) {
+        state.SkipWithError("instruction set not supported on this CPU");
+        return;
+    }
+    state.SetLabel(SampleConversion::getName(set));
+
+    std::vector<float> input(kBlockSamples);
+    for (int i = 0; i < kBlockSamples; i++) {
+        input[i] = (i % 2000 - 1000) * 3.7f;
+    }
+    std::vector<int16> output(kBlockSamples);
+
+    for (auto _ : state) {
+        SampleConversion::floatToInt16(set, input.data(), output.data(), 1 / (float(0x7fff) * 0.195f), kBlockSamples);
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kBlockSamples);
+    state.SetBytesProcessed(state.iterations() * kBlockSamples * int64_t(sizeof(float)));
+}
+BENCHMARK(BM_FloatToInt16)->DenseRange(SampleConversion::SCALAR, SampleConversion::AVX512);
+
+static void BM_FloatToInt16_ClipStats(benchmark::State& state) {
+    const auto set = SampleConversion::InstructionSet(state.range(0));
+    if (!SampleConversion::isSupported(set)) {
+        state.SkipWithError("instruction set not supported on this CPU");
+        return;
+    }
+    state.SetLabel(SampleConversion::getName(set));
+
+    std::vector<float> input(kBlockSamples);
+    for (int i = 0; i < kBlockSamples; i++) {
+        input[i] = (i % 2000 - 1000) * 3.7f;
+    }
+    std::vector<int16> output(kBlockSamples);
+    SampleConversion::ClipStats stats;
+
+    for (auto _ : state) {
+        SampleConversion::floatToInt16(set, input.data(), output.data(), 1 / (float(0x7fff) * 0.195f), kBlockSamples, stats);
+        benchmark::DoNotOptimize(output.data());
+        benchmark::DoNotOptimize(stats);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kBlockSamples);
+    state.SetBytesProcessed(state.iterations() * kBlockSamples * int64_t(sizeof(float)));
+}
+BENCHMARK(BM_FloatToInt16_ClipStats)->DenseRange(SampleConversion::SCALAR, SampleConversion::AVX512);
+
+static void BM_Int16ToFloat(benchmark::State& state) {
+    const auto set = SampleConversion::InstructionSet(state.range(0));
+    if (!SampleConversion::isSupported(set)) {
+        state.SkipWithError("instruction set not supported on this CPU");
+        return;
+    }
+    state.SetLabel(SampleConversion::getName(set));
+
+    std::vector<int16> input(kBlockSamples);
+    for (int i = 0; i < kBlockSamples; i++) {
+        input[i] = int16(i * 37);
+    }
+    std::vector<float> output(kBlockSamples);
+
+    for (auto _ : state) {
+        SampleConversion::int16ToFloat(set, input.data(), output.data(), 0.195f, kBlockSamples);
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kBlockSamples);
+    state.SetBytesProcessed(state.iterations() * kBlockSamples * int64_t(sizeof(int16)));
+}
+BENCHMARK(BM_Int16ToFloat)->DenseRange(SampleConversion::SCALAR, SampleConversion::AVX512);
+
+// Whole-stream interleave of one block, as done by InterleavedBlockFile::writeChannels
+static void BM_Interleave(benchmark::State& state) {
+    const int channels = int(state.range(0));
+    const int samples = int(state.range(1));
+
+    std::vector<int16> input(size_t(channels) * samples);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = int16(i);
+    }
+    std::vector<int16> output(input.size());
+
+    for (auto _ : state) {
+        SampleConversion::interleave(input.data(), samples, output.data(), channels, samples);
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(input.size()));
+    state.SetBytesProcessed(state.iterations() * int64_t(input.size() * sizeof(int16)));
+}
+BENCHMARK(BM_Interleave)->ArgsProduct({ { 16, 64, 384, 1536 }, { 256, 1024, 4096 } });
+
+// Kernels compiled for a stream width against the generic ones, at the widths that have them
+static void BM_ChannelKernels_Interleave(benchmark::State& state) {
+    const int channels = int(state.range(0));
+    const bool fixed = state.range(1) != 0;
+    const auto kernels = fixed ? SampleConversion::getChannelKernels(channels) : SampleConversion::getGenericChannelKernels();
+    state.SetLabel(fixed ? "fixed" : "generic");
+
+    std::vector<int16> input(size_t(channels) * kBlockSamples);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = int16(i);
+    }
+    std::vector<int16> output(input.size());
+
+    for (auto _ : state) {
+        kernels.interleave(input.data(), kBlockSamples, output.data(), channels, kBlockSamples);
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(input.size()));
+    state.SetBytesProcessed(state.iterations() * int64_t(input.size() * sizeof(int16)));
+}
+BENCHMARK(BM_ChannelKernels_Interleave)->ArgsProduct({ { 8, 16, 32, 64, 128, 384 }, { 0, 1 } });
+
+// One channel of a block into its interleaved slots, as done by InterleavedBlockFile::writeChannel
+static void BM_ChannelKernels_Scatter(benchmark::State& state) {
+    const int channels = int(state.range(0));
+    const bool fixed = state.range(1) != 0;
+    const auto kernels = fixed ? SampleConversion::getChannelKernels(channels) : SampleConversion::getGenericChannelKernels();
+    state.SetLabel(fixed ? "fixed" : "generic");
+
+    std::vector<int16> input(kBlockSamples);
+    for (int i = 0; i < kBlockSamples; i++) {
+        input[i] = int16(i);
+    }
+    std::vector<int16> output(size_t(channels) * kBlockSamples);
+
+    for (auto _ : state) {
+        for (int c = 0; c < channels; c++) {
+            kernels.scatter(input.data(), output.data() + c, channels, kBlockSamples);
+        }
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(output.size()));
+    state.SetBytesProcessed(state.iterations() * int64_t(output.size() * sizeof(int16)));
+}
+BENCHMARK(BM_ChannelKernels_Scatter)->ArgsProduct({ { 8, 16, 32, 64, 128, 384 }, { 0, 1 } });
@@ -0,0 +1,33 @@
+#include <benchmark/benchmark.h>
+
+#include "../Source/SampleTimesWriter.h"
+
+#include <filesystem>
+#include <memory>
+
+// Rows of a recording with one [SampleTimes] row per 1024-sample block at 30 kHz and a
+// slowly drifting clock. range(0) enables compression.
+static void BM_SampleTimesAdd(benchmark::State& state) {
+    const bool compress = state.range(0) != 0;
+    state.SetLabel(compress ? "compressed" : "every row");
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "persyst_sample_times_benchmark.lay";
+    std::filesystem::remove(path);
+
+    auto writer = std::make_unique<SampleTimesWriter>(new SyncableFileStream(File(String(path.string()))));
+    if (compress) {
+        writer->setCompression(30000, 100e-6, 60);
+    }
+
+    int64 sample = 0;
+    for (auto _ : state) {
+        writer->add(sample, sample / 30000.0 * (1 + 1e-7));
+        sample += 1024;
+    }
+    writer.reset();
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["file_bytes"] = double(std::filesystem::file_size(path));
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_SampleTimesAdd)->Arg(0)->Arg(1);
@@ -0,0 +1,208 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "AsyncRecordWriter.h"
+
+/* Upper bound on records taken from one ring before moving on to the next */
+#define MAX_RECORDS_PER_PASS 256
+
+AsyncRecordWriter::AsyncRecordWriter(Consumer& consumer, int numRings, size_t ringCapacity, int numWorkers, int firstCore) :
+    m_consumer(consumer),
+    m_stalls(new std::atomic<int64>[numRings])
+{
+    for (int i = 0; i < numRings; i++)
+    {
+        m_rings.add(new SpscRing(ringCapacity));
+        m_stalls[i] = 0;
+    }
+
+    /* More workers than rings would only idle */
+    numWorkers = jlimit(1, jmax(1, numRings), numWorkers);
+
+    for (int i = 0; i < numWorkers; i++)
+    {
+        Worker* worker = m_workers.add(new Worker(*this, i));
+        if (firstCore >= 0 && firstCore + i < 32)
+            worker->setAffinityMask(uint32(1) << (firstCore + i));
+    }
+}
+
+AsyncRecordWriter::~AsyncRecordWriter()
+{
+    stop();
+}
+
+uint8* AsyncRecordWriter::reserve(int ring, size_t size)
+{
+    SpscRing* r = m_rings[ring];
+    uint8* record = r->beginWrite(size);
+
+    if (record == nullptr)
+    {
+        /* The disk isn't keeping up; wait for the writer thread rather than drop data */
+        m_stalls[ring]++;
+        m_workers[ring % m_workers.size()]->notify();
+
+        while ((record = r->beginWrite(size)) == nullptr)
+            Thread::sleep(1);
+    }
+
+    return record;
+}
+
+void AsyncRecordWriter::pushContinuousData(int ring, int writeChannel, int realChannel, const float* dataBuffer, const double* ftsBuffer, int size)
+{
+    /* Split blocks that would not fit in the ring; each piece carries its own first timestamp */
+    const int maxSamples = int((m_rings[ring]->getMaxRecordSize() - sizeof(RecordHeader)) / sizeof(float));
+
+    for (int offset = 0; offset < size; offset += maxSamples)
+    {
+        const int count = jmin(maxSamples, size - offset);
+        uint8* record = reserve(ring, sizeof(RecordHeader) + count * sizeof(float));
+
+        RecordHeader* header = reinterpret_cast<RecordHeader*>(record);
+        header->type = CONTINUOUS;
+        header->channel = writeChannel;
+        header->realChannel = realChannel;
+        header->size = count;
+        header->timestamp = ftsBuffer[offset];
+        memcpy(record + sizeof(RecordHeader), dataBuffer + offset, count * sizeof(float));
+
+        m_rings[ring]->endWrite();
+    }
+}
+
+void AsyncRecordWriter::pushEvent(int ring, int eventChannel, const EventPacket& event)
+{
+    const int size = event.getRawDataSize();
+
+    if (sizeof(RecordHeader) + size > m_rings[ring]->getMaxRecordSize())
+    {
+        std::cerr << "[Persyst] Event of " << size << " bytes does not fit in the writer ring, dropping it" << std::endl;
+        return;
+    }
+
+    uint8* record = reserve(ring, sizeof(RecordHeader) + size);
+
+    RecordHeader* header = reinterpret_cast<RecordHeader*>(record);
+    header->type = EVENT;
+    header->channel = eventChannel;
+    header->realChannel = -1;
+    header->size = size;
+    header->timestamp = 0;
+    memcpy(record + sizeof(RecordHeader), event.getRawData(), size);
+
+    m_rings[ring]->endWrite();
+}
+
+void AsyncRecordWriter::start()
+{
+    for (auto worker : m_workers)
+        worker->startThread();
+}
+
+void AsyncRecordWriter::stop()
+{
+    for (auto worker : m_workers)
+        worker->signalThreadShouldExit();
+    for (auto worker : m_workers)
+        worker->stopThread(-1);
+
+    /* The workers have exited, so this thread can safely take over as the consumer */
+    bool wroteAny = true;
+    while (wroteAny)
+    {
+        wroteAny = false;
+        for (int i = 0; i < m_rings.size(); i++)
+            wroteAny |= drainRing(i);
+    }
+}
+
+AsyncRecordWriter::RingStats AsyncRecordWriter::getStats(int ring) const
+{
+    RingStats stats;
+    stats.capacity = m_rings[ring]->getCapacity();
+    stats.usedBytes = m_rings[ring]->getUsedBytes();
+    stats.highWaterMark = m_rings[ring]->getHighWaterMark();
+    stats.stalls = m_stalls[ring].load();
+    return stats;
+}
+
+AsyncRecordWriter::Worker::Worker(AsyncRecordWriter& owner, int index) :
+    Thread("Persyst Writer " + String(index)),
+    m_owner(owner),
+    m_index(index)
+{
+}
+
+void AsyncRecordWriter::Worker::run()
+{
+    const int numWorkers = m_owner.m_workers.size();
+
+    while (!threadShouldExit())
+    {
+        bool wroteAny = false;
+
+        for (int i = m_index; i < m_owner.m_rings.size(); i += numWorkers)
+            wroteAny |= m_owner.drainRing(i);
+
+        if (!wroteAny)
+            wait(1);
+    }
+}
+
+bool AsyncRecordWriter::drainRing(int ring)
+{
+    SpscRing* r = m_rings[ring];
+    size_t size;
+    int records = 0;
+
+    while (records < MAX_RECORDS_PER_PASS)
+    {
+        const uint8* record = r->beginRead(size);
+        if (record == nullptr)
+            break;
+
+        const RecordHeader* header = reinterpret_cast<const RecordHeader*>(record);
+        const uint8* payload = record + sizeof(RecordHeader);
+
+        if (header->type == CONTINUOUS)
+        {
+            m_consumer.writeContinuousBlock(header->channel,
+                                            header->realChannel,
+                                            reinterpret_cast<const float*>(payload),
+                                            header->timestamp,
+                                            header->size);
+        }
+        else
+        {
+            EventPacket packet(payload, header->size);
+            m_consumer.writeEventPacket(header->channel, packet);
+        }
+
+        r->endRead();
+        records++;
+    }
+
+    return records > 0;
+}
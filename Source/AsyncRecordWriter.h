@@ -0,0 +1,136 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef ASYNCRECORDWRITER_H_DEFINED
+#define ASYNCRECORDWRITER_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include "SpscRing.h"
+
+/**
+    Moves conversion and file I/O off the Record Node's write thread.
+
+    The write thread only copies continuous blocks and event packets into one
+    preallocated SpscRing per stream. A pool of worker threads drains the rings and
+    hands each record back to the Consumer, which does the actual conversion and
+    writes. Ring i always belongs to worker i % numWorkers, so records of one stream
+    are handled in order by a single thread, while different streams are written in
+    parallel. The Consumer must therefore keep the state of each ring separate.
+
+    If a ring is full the producer waits for room rather than dropping data; those
+    waits are counted as stalls.
+*/
+class TESTABLE AsyncRecordWriter
+{
+public:
+
+    /** Receives the queued records on the writer thread */
+    class Consumer
+    {
+    public:
+        virtual ~Consumer() {}
+
+        virtual void writeContinuousBlock(int writeChannel,
+                                          int realChannel,
+                                          const float* dataBuffer,
+                                          double firstTimestamp,
+                                          int size) = 0;
+
+        virtual void writeEventPacket(int eventChannel, const EventPacket& event) = 0;
+    };
+
+    struct RingStats
+    {
+        size_t capacity;
+        size_t usedBytes;
+        size_t highWaterMark;
+        int64 stalls;
+    };
+
+    /** Constructor. Allocates numRings rings of ringCapacity bytes each, drained by up to
+        numWorkers threads. If firstCore is not negative, worker i is pinned to core firstCore + i. */
+    AsyncRecordWriter(Consumer& consumer, int numRings, size_t ringCapacity, int numWorkers = 1, int firstCore = -1);
+
+    /** Destructor. Drains whatever is still queued. */
+    ~AsyncRecordWriter();
+
+    /** Producer: queues a block of continuous data */
+    void pushContinuousData(int ring, int writeChannel, int realChannel, const float* dataBuffer, const double* ftsBuffer, int size);
+
+    /** Producer: queues an event packet */
+    void pushEvent(int ring, int eventChannel, const EventPacket& event);
+
+    /** Starts the worker threads */
+    void start();
+
+    /** Writes everything still queued, then stops the worker threads */
+    void stop();
+
+    int getNumRings() const { return m_rings.size(); }
+
+    int getNumWorkers() const { return m_workers.size(); }
+
+    RingStats getStats(int ring) const;
+
+private:
+
+    class Worker : public Thread
+    {
+    public:
+        Worker(AsyncRecordWriter& owner, int index);
+
+        void run() override;
+
+    private:
+        AsyncRecordWriter& m_owner;
+        const int m_index;
+    };
+
+    struct RecordHeader
+    {
+        int32 type;
+        int32 channel;
+        int32 realChannel;
+        int32 size;
+        double timestamp;
+    };
+
+    enum RecordType
+    {
+        CONTINUOUS = 0,
+        EVENT
+    };
+
+    uint8* reserve(int ring, size_t size);
+    bool drainRing(int ring);
+
+    Consumer& m_consumer;
+    OwnedArray<SpscRing> m_rings;
+    OwnedArray<Worker> m_workers;
+    std::unique_ptr<std::atomic<int64>[]> m_stalls;
+
+    JUCE_DECLARE_NON_COPYABLE(AsyncRecordWriter);
+};
+
+#endif
@@ -0,0 +1,102 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "BackpressureMonitor.h"
+
+BackpressureMonitor::BackpressureMonitor(double incomingBytesPerSecond,
+                                         double queuedBytesPerWrittenByte,
+                                         double windowSeconds,
+                                         int windowsToWarn,
+                                         double warningIntervalSeconds) :
+    m_incomingBytesPerSecond(incomingBytesPerSecond),
+    m_queuedBytesPerWrittenByte(queuedBytesPerWrittenByte),
+    m_windowSeconds(windowSeconds),
+    m_windowsToWarn(jmax(1, windowsToWarn)),
+    m_warningInterval(warningIntervalSeconds)
+{
+    m_status.incomingBytesPerSecond = incomingBytesPerSecond;
+    m_status.writtenBytesPerSecond = 0;
+    m_status.queuedBytes = 0;
+    m_status.capacityBytes = 0;
+    m_status.secondsToOverflow = -1;
+    m_status.fallingBehind = false;
+}
+
+BackpressureMonitor::Event BackpressureMonitor::update(double now, int64 bytesWritten, int64 queuedBytes, int64 capacityBytes)
+{
+    if (m_windowStart < 0)
+    {
+        m_windowStart = now;
+        m_windowBytes = bytesWritten;
+        return NONE;
+    }
+
+    const double elapsed = now - m_windowStart;
+    if (elapsed < m_windowSeconds)
+        return NONE;
+
+    const double written = double(bytesWritten - m_windowBytes) / elapsed;
+    m_windowStart = now;
+    m_windowBytes = bytesWritten;
+
+    const double deficit = m_incomingBytesPerSecond - written;
+    const bool slow = deficit > m_incomingBytesPerSecond * TOLERANCE;
+    m_slowWindows = slow ? m_slowWindows + 1 : 0;
+
+    Status status;
+    status.incomingBytesPerSecond = m_incomingBytesPerSecond;
+    status.writtenBytesPerSecond = written;
+    status.queuedBytes = queuedBytes;
+    status.capacityBytes = capacityBytes;
+    status.secondsToOverflow = (slow && capacityBytes > 0)
+        ? double(jmax(int64(0), capacityBytes - queuedBytes)) / (deficit * m_queuedBytesPerWrittenByte)
+        : -1.0;
+
+    Event event = NONE;
+    if (m_slowWindows >= m_windowsToWarn)
+    {
+        if (!m_fallingBehind.load(std::memory_order_relaxed) || now - m_lastWarning >= m_warningInterval)
+        {
+            m_lastWarning = now;
+            event = WARNING;
+        }
+        m_fallingBehind.store(true, std::memory_order_relaxed);
+    }
+    else if (!slow && m_fallingBehind.load(std::memory_order_relaxed))
+    {
+        m_fallingBehind.store(false, std::memory_order_relaxed);
+        event = RECOVERED;
+    }
+    status.fallingBehind = m_fallingBehind.load(std::memory_order_relaxed);
+
+    const ScopedLock lock(m_statusLock);
+    m_status = status;
+    return event;
+}
+
+BackpressureMonitor::Status BackpressureMonitor::getStatus() const
+{
+    const ScopedLock lock(m_statusLock);
+    return m_status;
+}
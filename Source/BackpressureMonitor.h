@@ -0,0 +1,104 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef BACKPRESSUREMONITOR_H_DEFINED
+#define BACKPRESSUREMONITOR_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include <atomic>
+
+/**
+    Watches whether a stream's data is written as fast as it arrives.
+
+    The incoming rate is known up front from the sample rate and channel count. Once per
+    window the monitor measures how many bytes were actually written, and a stream whose
+    writes fall short of the incoming rate for several windows in a row is reported as
+    falling behind, together with the time left until its writer buffer is full.
+
+    update() is called from the thread that feeds the stream; getStatus() and
+    isFallingBehind() may be called from any thread.
+*/
+class TESTABLE BackpressureMonitor
+{
+public:
+
+    struct Status
+    {
+        double incomingBytesPerSecond;
+        double writtenBytesPerSecond;
+        int64 queuedBytes;
+        int64 capacityBytes;
+        /* Projected time until the buffer is full, or -1 if it is not filling up or there is no buffer */
+        double secondsToOverflow;
+        bool fallingBehind;
+    };
+
+    enum Event
+    {
+        NONE = 0,
+        WARNING,   // the stream fell behind, or is still behind after warningInterval
+        RECOVERED  // the writes caught up again
+    };
+
+    /** Constructor. queuedBytesPerWrittenByte converts the written data rate into the rate the
+        buffer fills at, e.g. 2 when float samples are queued and int16 samples are written. */
+    BackpressureMonitor(double incomingBytesPerSecond,
+                        double queuedBytesPerWrittenByte = 1.0,
+                        double windowSeconds = 1.0,
+                        int windowsToWarn = 3,
+                        double warningIntervalSeconds = 10.0);
+
+    /** Reports the total bytes written so far and the current buffer fill at time now (seconds).
+        Only evaluates once a window has passed; returns what changed, if anything. */
+    Event update(double now, int64 bytesWritten, int64 queuedBytes, int64 capacityBytes);
+
+    Status getStatus() const;
+
+    bool isFallingBehind() const { return m_fallingBehind.load(std::memory_order_relaxed); }
+
+    /** Writes slower than this fraction of the incoming rate count as falling behind */
+    static constexpr double TOLERANCE = 0.1;
+
+private:
+
+    const double m_incomingBytesPerSecond;
+    const double m_queuedBytesPerWrittenByte;
+    const double m_windowSeconds;
+    const int m_windowsToWarn;
+    const double m_warningInterval;
+
+    double m_windowStart{ -1.0 };
+    int64 m_windowBytes{ 0 };
+    int m_slowWindows{ 0 };
+    double m_lastWarning{ 0.0 };
+
+    std::atomic<bool> m_fallingBehind{ false };
+    Status m_status;
+    CriticalSection m_statusLock;
+
+    JUCE_DECLARE_NON_COPYABLE(BackpressureMonitor);
+};
+
+#endif
@@ -0,0 +1,399 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "BinaryRecordingConverter.h"
+#include "PersystLayFileFormat.h"
+#include "SampleConversion.h"
+#include "SampleTimesWriter.h"
+
+/* Frames re-quantised per pass. The gathered tile and its float copy stay in L1. */
+#define REQUANTISE_TILE_SAMPLES 256
+
+/* Returns the data of a mapped .npy file if it holds a 1-D array of the given dtype, e.g. "<f8" */
+static const void* findNpyData(const MemoryMappedFile& file, const char* dtype, int64& count)
+{
+    const char* bytes = static_cast<const char*>(file.getData());
+    const size_t size = file.getSize();
+
+    if (bytes == nullptr || size < 12 || std::memcmp(bytes, "\x93NUMPY", 6) != 0)
+        return nullptr;
+
+    /* Version 1 has a 16-bit header length, later versions a 32-bit one */
+    size_t headerStart, headerLength;
+    if (bytes[6] == 1)
+    {
+        headerStart = 10;
+        headerLength = size_t(uint8(bytes[8])) | size_t(uint8(bytes[9])) << 8;
+    }
+    else
+    {
+        headerStart = 12;
+        headerLength = size_t(uint8(bytes[8])) | size_t(uint8(bytes[9])) << 8
+                     | size_t(uint8(bytes[10])) << 16 | size_t(uint8(bytes[11])) << 24;
+    }
+
+    if (headerStart + headerLength > size)
+        return nullptr;
+
+    const std::string header(bytes + headerStart, headerLength);
+    if (header.find(std::string("'") + dtype + "'") == std::string::npos)
+        return nullptr;
+
+    count = int64(size - headerStart - headerLength) / 8;
+    return bytes + headerStart + headerLength;
+}
+
+static void requantiseChannel(int16* frames, int numChannels, int channel, int64 numSamples, float bitVolts, float gain)
+{
+    int16 gathered[REQUANTISE_TILE_SAMPLES];
+    float microvolts[REQUANTISE_TILE_SAMPLES];
+
+    for (int64 tileStart = 0; tileStart < numSamples; tileStart += REQUANTISE_TILE_SAMPLES)
+    {
+        const int tileSize = int(jmin(int64(REQUANTISE_TILE_SAMPLES), numSamples - tileStart));
+        int16* samples = frames + tileStart * numChannels + channel;
+
+        for (int i = 0; i < tileSize; i++)
+            gathered[i] = samples[i * numChannels];
+
+        SampleConversion::int16ToFloat(gathered, microvolts, bitVolts, tileSize);
+        SampleConversion::floatToInt16(microvolts, gathered, gain, tileSize);
+
+        for (int i = 0; i < tileSize; i++)
+            samples[i * numChannels] = gathered[i];
+    }
+}
+
+BinaryRecordingConverter::BinaryRecordingConverter(const File& sourceDirectory, const File& outputDirectory) :
+    m_sourceDirectory(sourceDirectory),
+    m_outputDirectory(outputDirectory)
+{
+}
+
+BinaryRecordingConverter::~BinaryRecordingConverter()
+{
+}
+
+bool BinaryRecordingConverter::readStructure()
+{
+    const File structureFile = m_sourceDirectory.getChildFile("structure.oebin");
+
+    var structure;
+    const Result result = JSON::parse(structureFile.loadFileAsString(), structure);
+    if (result.failed())
+    {
+        m_lastError = "Could not parse " + structureFile.getFullPathName() + ": " + result.getErrorMessage();
+        return false;
+    }
+
+    const Array<var>* continuous = structure["continuous"].getArray();
+    if (continuous == nullptr)
+    {
+        m_lastError = structureFile.getFullPathName() + " has no continuous streams";
+        return false;
+    }
+
+    for (const var& entry : *continuous)
+    {
+        Stream stream;
+        stream.folderName = entry["folder_name"].toString().trimCharactersAtEnd("/");
+        stream.sampleRate = entry["sample_rate"];
+        stream.numChannels = entry["num_channels"];
+
+        if (const Array<var>* channels = entry["channels"].getArray())
+        {
+            for (const var& channel : *channels)
+            {
+                stream.channelNames.add(channel["channel_name"].toString());
+                stream.bitVolts.add(float(double(channel["bit_volts"])));
+            }
+        }
+
+        if (stream.folderName.isEmpty() || stream.sampleRate <= 0 || stream.numChannels <= 0
+            || stream.bitVolts.size() != stream.numChannels)
+        {
+            m_lastError = "Invalid continuous stream " + stream.folderName + " in " + structureFile.getFullPathName();
+            return false;
+        }
+
+        m_streams.add(stream);
+    }
+
+    return true;
+}
+
+void BinaryRecordingConverter::addStream(const Stream& stream)
+{
+    m_streams.add(stream);
+}
+
+bool BinaryRecordingConverter::convert(const Options& options, ProgressCallback progress)
+{
+    m_conversions.clear();
+    m_jobs.clear();
+    m_totalBytes = 0;
+    m_nextJob = 0;
+    m_jobsDone = 0;
+    m_bytesDone = 0;
+    m_failed = false;
+    m_finished.reset();
+
+    for (const Stream& stream : m_streams)
+    {
+        Conversion* conversion = m_conversions.add(new Conversion());
+        conversion->info = stream;
+        conversion->sourceDirectory = m_sourceDirectory.getChildFile("continuous").getChildFile(stream.folderName);
+        conversion->outputDirectory = m_outputDirectory.getChildFile("continuous").getChildFile(stream.folderName);
+
+        if (!openConversion(conversion))
+            return false;
+
+        /* Split into jobs of whole frames */
+        const int64 frameSize = int64(stream.numChannels) * sizeof(int16);
+        const int64 samplesPerJob = jmax(int64(1), options.chunkSize / frameSize);
+
+        for (int64 first = 0; first < conversion->numSamples; first += samplesPerJob)
+            m_jobs.add({ m_conversions.size() - 1, first, jmin(samplesPerJob, conversion->numSamples - first) });
+
+        m_totalBytes += conversion->numSamples * frameSize;
+    }
+
+    OwnedArray<Worker> workers;
+    for (int i = 0; i < jmin(jmax(1, options.numThreads), m_jobs.size()); i++)
+        workers.add(new Worker(*this, i))->startThread();
+
+    /* The layout files are small; write them while the data is being converted.
+       writeLayout() reports failures through fail(), which also stops the workers */
+    for (const Conversion* conversion : m_conversions)
+    {
+        if (!writeLayout(conversion, options))
+            break;
+    }
+
+    while (m_jobsDone < m_jobs.size() && !m_failed)
+    {
+        if (progress)
+            progress(m_bytesDone, m_totalBytes);
+        m_finished.wait(250);
+    }
+
+    for (Worker* worker : workers)
+        worker->stopThread(-1);
+
+    /* Unmapping hands the converted data to the operating system */
+    for (Conversion* conversion : m_conversions)
+        conversion->output.reset();
+
+    if (progress)
+        progress(m_bytesDone, m_totalBytes);
+
+    return !m_failed;
+}
+
+bool BinaryRecordingConverter::openConversion(Conversion* conversion)
+{
+    const Stream& stream = conversion->info;
+
+    if (stream.numChannels <= 0 || stream.sampleRate <= 0 || stream.bitVolts.size() != stream.numChannels)
+    {
+        m_lastError = "Invalid continuous stream " + stream.folderName;
+        return false;
+    }
+
+    const File sourceFile = conversion->sourceDirectory.getChildFile("continuous.dat");
+    if (!sourceFile.existsAsFile())
+    {
+        m_lastError = sourceFile.getFullPathName() + " does not exist";
+        return false;
+    }
+
+    const int64 frameSize = int64(stream.numChannels) * sizeof(int16);
+    conversion->numSamples = sourceFile.getSize() / frameSize;
+
+    if (conversion->numSamples > 0)
+    {
+        conversion->data.reset(new MemoryMappedFile(sourceFile, MemoryMappedFile::readOnly));
+        if (conversion->data->getData() == nullptr)
+        {
+            m_lastError = "Could not map " + sourceFile.getFullPathName();
+            return false;
+        }
+    }
+
+    /* Like the record engine, the first channel's bitVolts becomes the calibration */
+    conversion->calibration = stream.bitVolts[0];
+    for (int ch = 0; ch < stream.numChannels; ch++)
+        if (stream.bitVolts[ch] != conversion->calibration)
+            conversion->requantisedChannels.add(ch);
+
+    /* Sized and mapped once here, so every worker writes its chunks into the same mapping */
+    const File dataFile = conversion->outputDirectory.getChildFile("recording.dat");
+    dataFile.deleteFile();
+    if (conversion->outputDirectory.createDirectory().failed())
+    {
+        m_lastError = "Could not create " + dataFile.getFullPathName();
+        return false;
+    }
+
+    {
+        SyncableFileStream out(dataFile);
+        if (!out.openedOk() || !out.setPosition(conversion->numSamples * frameSize) || !out.truncate())
+        {
+            m_lastError = "Could not create " + dataFile.getFullPathName();
+            return false;
+        }
+    }
+
+    if (conversion->numSamples > 0)
+    {
+        conversion->output.reset(new MemoryMappedFile(dataFile, MemoryMappedFile::readWrite));
+        if (conversion->output->getData() == nullptr || int64(conversion->output->getSize()) < conversion->numSamples * frameSize)
+        {
+            m_lastError = "Could not map " + dataFile.getFullPathName();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool BinaryRecordingConverter::writeLayout(const Conversion* conversion, const Options& options)
+{
+    const Stream& stream = conversion->info;
+
+    const File layoutFile = conversion->outputDirectory.getChildFile("recording.lay");
+    layoutFile.deleteFile();
+
+    PersystLayFileFormat layout = PersystLayFileFormat::create(layoutFile.getFullPathName(),
+                                                               int(stream.sampleRate),
+                                                               conversion->calibration,
+                                                               stream.numChannels);
+
+    ScopedPointer<SyncableFileStream> layoutFileStream = new SyncableFileStream(layoutFile);
+    if (!layoutFileStream->openedOk())
+    {
+        fail("Could not create " + layoutFile.getFullPathName());
+        return false;
+    }
+
+    layoutFileStream->writeText(layout.toString(), false, false, nullptr);
+    layoutFileStream->writeText("[ChannelMap]\n", false, false, nullptr);
+    //Persyst uses first index = 1
+    for (int ch = 0; ch < stream.numChannels; ch++)
+        layoutFileStream->writeText(stream.channelNames[ch] + String("=") + String(ch + 1) + String("\n"), false, false, nullptr);
+    layoutFileStream->writeText("[SampleTimes]\n", false, false, nullptr);
+
+    /* Timestamps in seconds from timestamps.npy, or else sample numbers, from
+       sample_numbers.npy or the timestamps.npy of older versions */
+    MemoryMappedFile timestampsFile(conversion->sourceDirectory.getChildFile("timestamps.npy"), MemoryMappedFile::readOnly);
+    MemoryMappedFile sampleNumbersFile(conversion->sourceDirectory.getChildFile("sample_numbers.npy"), MemoryMappedFile::readOnly);
+
+    int64 count = 0;
+    const double* timestamps = static_cast<const double*>(findNpyData(timestampsFile, "<f8", count));
+    if (count < conversion->numSamples)
+        timestamps = nullptr;
+
+    const int64* sampleNumbers = nullptr;
+    if (timestamps == nullptr)
+    {
+        sampleNumbers = static_cast<const int64*>(findNpyData(sampleNumbersFile, "<i8", count));
+        if (sampleNumbers == nullptr || count < conversion->numSamples)
+            sampleNumbers = static_cast<const int64*>(findNpyData(timestampsFile, "<i8", count));
+        if (count < conversion->numSamples)
+            sampleNumbers = nullptr;
+    }
+
+    if (timestamps == nullptr && sampleNumbers == nullptr && conversion->numSamples > 0)
+        std::cerr << "[Persyst] No timestamps for " << stream.folderName << ", using the nominal sample rate" << std::endl;
+
+    SampleTimesWriter sampleTimes(layoutFileStream.release());
+    if (options.compressSampleTimes)
+        sampleTimes.setCompression(stream.sampleRate, options.sampleTimesTolerance, options.sampleTimesKeyframeInterval);
+
+    for (int64 sample = 0; sample < conversion->numSamples; sample += options.sampleTimesInterval)
+    {
+        if (timestamps != nullptr)
+            sampleTimes.add(sample, timestamps[sample]);
+        else if (sampleNumbers != nullptr)
+            sampleTimes.add(sample, double(sampleNumbers[sample]) / stream.sampleRate);
+        else
+            sampleTimes.add(sample, double(sample) / stream.sampleRate);
+    }
+
+    sampleTimes.finish();
+    return true;
+}
+
+void BinaryRecordingConverter::fail(const String& message)
+{
+    {
+        const ScopedLock lock(m_errorLock);
+        if (!m_failed)
+            m_lastError = message;
+        m_failed = true;
+    }
+    m_finished.signal();
+}
+
+BinaryRecordingConverter::Worker::Worker(BinaryRecordingConverter& owner, int index) :
+    Thread("Persyst Converter " + String(index)),
+    m_owner(owner)
+{
+}
+
+void BinaryRecordingConverter::Worker::run()
+{
+    while (!threadShouldExit() && !m_owner.m_failed)
+    {
+        const int index = m_owner.m_nextJob++;
+        if (index >= m_owner.m_jobs.size())
+            break;
+
+        if (!convertJob(m_owner.m_jobs.getReference(index)))
+            break;
+
+        if (++m_owner.m_jobsDone == m_owner.m_jobs.size())
+            m_owner.m_finished.signal();
+    }
+}
+
+bool BinaryRecordingConverter::Worker::convertJob(const Job& job)
+{
+    const Conversion* conversion = m_owner.m_conversions[job.conversion];
+    const int numChannels = conversion->info.numChannels;
+    const size_t size = size_t(job.numSamples) * numChannels * sizeof(int16);
+
+    const int16* frames = static_cast<const int16*>(conversion->data->getData()) + job.firstSample * numChannels;
+    int16* output = static_cast<int16*>(conversion->output->getData()) + job.firstSample * numChannels;
+
+    std::memcpy(output, frames, size);
+
+    /* Re-quantised in place, in the output */
+    const float gain = 1 / (float(0x7fff) * conversion->calibration);
+    for (int ch : conversion->requantisedChannels)
+        requantiseChannel(output, numChannels, ch, job.numSamples, conversion->info.bitVolts[ch], gain);
+
+    m_owner.m_bytesDone += int64(size);
+    return true;
+}
@@ -0,0 +1,162 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef BINARYRECORDINGCONVERTER_H_DEFINED
+#define BINARYRECORDINGCONVERTER_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include <atomic>
+#include <functional>
+
+/**
+    Converts a recording in the Open Ephys Binary format (continuous.dat plus
+    timestamps.npy or sample_numbers.npy per stream) into Persyst recording.dat /
+    recording.lay pairs, one per stream, laid out like the record engine's output.
+
+    Both formats store interleaved int16 frames, so a stream whose channels all share
+    the bitVolts of its first channel, which becomes the Persyst calibration, is copied
+    straight from the memory-mapped source. Other channels are re-quantised to that
+    calibration with the same kernels the record engine uses.
+
+    Each data file is created at its final size and memory mapped, and split into chunks
+    that a pool of threads converts straight into the mapping in parallel, while the
+    calling thread writes the layout files.
+*/
+class TESTABLE BinaryRecordingConverter
+{
+public:
+
+    /** One continuous stream of the source recording */
+    struct Stream
+    {
+        String folderName;
+        double sampleRate{ 0 };
+        int numChannels{ 0 };
+        Array<String> channelNames;
+        Array<float> bitVolts;
+    };
+
+    struct Options
+    {
+        int numThreads{ 4 };
+
+        /* Bytes of source data converted per job */
+        int64 chunkSize{ 16 << 20 };
+
+        /* Samples between [SampleTimes] rows, before compression */
+        int sampleTimesInterval{ 4096 };
+
+        bool compressSampleTimes{ false };
+        double sampleTimesTolerance{ 100e-6 };
+        double sampleTimesKeyframeInterval{ 60 };
+    };
+
+    /** Called on the converting thread with the data bytes done so far and in total */
+    typedef std::function<void(int64 bytesDone, int64 bytesTotal)> ProgressCallback;
+
+    /** Constructor. sourceDirectory is the recording folder holding structure.oebin and continuous/. */
+    BinaryRecordingConverter(const File& sourceDirectory, const File& outputDirectory);
+
+    /** Destructor */
+    ~BinaryRecordingConverter();
+
+    /** Reads the continuous streams from structure.oebin. Returns false if it cannot be parsed. */
+    bool readStructure();
+
+    /** Adds a stream to convert, instead of or in addition to readStructure() */
+    void addStream(const Stream& stream);
+
+    int getNumStreams() const { return m_streams.size(); }
+
+    /** Converts every stream. Blocks until done; progress is reported about four times a second. */
+    bool convert(const Options& options, ProgressCallback progress = nullptr);
+
+    /** Total size of the source data files, known once convert() has mapped them */
+    int64 getTotalBytes() const { return m_totalBytes; }
+
+    String getLastError() const { return m_lastError; }
+
+private:
+
+    /** A stream being converted */
+    class Conversion
+    {
+    public:
+        Stream info;
+        File sourceDirectory;
+        File outputDirectory;
+        std::unique_ptr<MemoryMappedFile> data;
+        std::unique_ptr<MemoryMappedFile> output;
+        int64 numSamples{ 0 };
+
+        /* Persyst calibration, and the channels whose bitVolts differ from it */
+        float calibration{ 0 };
+        Array<int> requantisedChannels;
+    };
+
+    struct Job
+    {
+        int conversion;
+        int64 firstSample;
+        int64 numSamples;
+    };
+
+    class Worker : public Thread
+    {
+    public:
+        Worker(BinaryRecordingConverter& owner, int index);
+
+        void run() override;
+
+    private:
+        bool convertJob(const Job& job);
+
+        BinaryRecordingConverter& m_owner;
+    };
+
+    bool openConversion(Conversion* conversion);
+    bool writeLayout(const Conversion* conversion, const Options& options);
+    void fail(const String& message);
+
+    const File m_sourceDirectory;
+    const File m_outputDirectory;
+
+    Array<Stream> m_streams;
+    OwnedArray<Conversion> m_conversions;
+    Array<Job> m_jobs;
+    int64 m_totalBytes{ 0 };
+
+    std::atomic<int> m_nextJob{ 0 };
+    std::atomic<int> m_jobsDone{ 0 };
+    std::atomic<int64> m_bytesDone{ 0 };
+    std::atomic<bool> m_failed{ false };
+    WaitableEvent m_finished;
+    String m_lastError;
+    CriticalSection m_errorLock;
+
+    JUCE_DECLARE_NON_COPYABLE(BinaryRecordingConverter);
+};
+
+#endif
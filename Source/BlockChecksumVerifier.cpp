@@ -0,0 +1,176 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "BlockChecksumVerifier.h"
+#include "Crc32c.h"
+
+#include <algorithm>
+
+BlockChecksumVerifier::BlockChecksumVerifier()
+{
+}
+
+BlockChecksumVerifier::~BlockChecksumVerifier()
+{
+}
+
+bool BlockChecksumVerifier::open(const File& checksumFile)
+{
+    m_numEntries = 0;
+    m_entries.free();
+
+    MemoryMappedFile mapped(checksumFile, MemoryMappedFile::readOnly);
+    const char* data = static_cast<const char*>(mapped.getData());
+    const size_t size = mapped.getSize();
+
+    uint32 header[4];
+    if (data == nullptr || size < sizeof(header))
+    {
+        m_lastError = "Could not read " + checksumFile.getFullPathName();
+        return false;
+    }
+
+    memcpy(header, data, sizeof(header));
+    if (memcmp(data, "PCRC", 4) != 0 || header[1] != BlockChecksumWriter::VERSION || header[2] == 0)
+    {
+        m_lastError = checksumFile.getFullPathName() + " is not a block checksum file";
+        return false;
+    }
+
+    m_numChannels = int(header[2]);
+    m_headerLength = int(header[3]);
+
+    /* A trailing partial entry is what a crash in the middle of a write leaves */
+    m_numEntries = int64((size - sizeof(header)) / sizeof(Entry));
+    m_entries.malloc(size_t(jmax(int64(1), m_numEntries)));
+    memcpy(m_entries.getData(), data + sizeof(header), size_t(m_numEntries) * sizeof(Entry));
+
+    return true;
+}
+
+bool BlockChecksumVerifier::verify(const File& dataFile, int numThreads, Report& report, ProgressCallback progress)
+{
+    report = Report();
+
+    MemoryMappedFile mapped(dataFile, MemoryMappedFile::readOnly);
+    m_data = static_cast<const char*>(mapped.getData());
+    m_dataSize = int64(mapped.getSize());
+
+    if (m_data == nullptr && dataFile.getSize() > 0)
+    {
+        m_lastError = "Could not map " + dataFile.getFullPathName();
+        return false;
+    }
+
+    const int64 frameSize = int64(m_numChannels) * sizeof(int16);
+    int64 totalBytes = 0;
+    int64 checkedEnd = m_headerLength;
+    for (int64 i = 0; i < m_numEntries; i++)
+    {
+        totalBytes += int64(m_entries[i].numSamples) * frameSize;
+        checkedEnd = jmax(checkedEnd, m_headerLength + int64(m_entries[i].firstSample + m_entries[i].numSamples) * frameSize);
+    }
+
+    m_report = &report;
+    m_numJobs = int((m_numEntries + ENTRIES_PER_JOB - 1) / ENTRIES_PER_JOB);
+    m_nextJob = 0;
+    m_jobsDone = 0;
+    m_bytesDone = 0;
+    m_finished.reset();
+
+    OwnedArray<Worker> workers;
+    for (int i = 0; i < jmin(jmax(1, numThreads), m_numJobs); i++)
+        workers.add(new Worker(*this, i))->startThread();
+
+    while (m_jobsDone < m_numJobs)
+    {
+        if (progress)
+            progress(m_bytesDone, totalBytes);
+        m_finished.wait(250);
+    }
+
+    for (Worker* worker : workers)
+        worker->stopThread(-1);
+
+    if (progress)
+        progress(m_bytesDone, totalBytes);
+
+    std::sort(report.failures.begin(), report.failures.end(),
+              [](const Failure& a, const Failure& b) { return a.entry.firstSample < b.entry.firstSample; });
+
+    report.blocksChecked = m_numEntries;
+    report.bytesChecked = m_bytesDone;
+    report.uncheckedBytes = jmax(int64(0), m_dataSize - checkedEnd);
+
+    m_report = nullptr;
+    m_data = nullptr;
+    return true;
+}
+
+void BlockChecksumVerifier::checkEntry(const Entry& entry)
+{
+    const int64 frameSize = int64(m_numChannels) * sizeof(int16);
+    const int64 offset = m_headerLength + int64(entry.firstSample) * frameSize;
+    const int64 length = int64(entry.numSamples) * frameSize;
+
+    Failure failure{ entry, 0, false };
+    if (offset + length > m_dataSize)
+    {
+        failure.missing = true;
+    }
+    else
+    {
+        failure.actualCrc = Crc32c::update(0, m_data + offset, size_t(length));
+        m_bytesDone += length;
+        if (failure.actualCrc == entry.crc)
+            return;
+    }
+
+    const ScopedLock lock(m_reportLock);
+    m_report->failures.add(failure);
+}
+
+BlockChecksumVerifier::Worker::Worker(BlockChecksumVerifier& owner, int index) :
+    Thread("Persyst Verifier " + String(index)),
+    m_owner(owner)
+{
+}
+
+void BlockChecksumVerifier::Worker::run()
+{
+    while (!threadShouldExit())
+    {
+        const int job = m_owner.m_nextJob++;
+        if (job >= m_owner.m_numJobs)
+            break;
+
+        const int64 first = int64(job) * ENTRIES_PER_JOB;
+        const int64 last = jmin(first + ENTRIES_PER_JOB, m_owner.m_numEntries);
+        for (int64 i = first; i < last; i++)
+            m_owner.checkEntry(m_owner.m_entries[i]);
+
+        if (++m_owner.m_jobsDone == m_owner.m_numJobs)
+            m_owner.m_finished.signal();
+    }
+}
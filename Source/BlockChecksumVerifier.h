@@ -0,0 +1,132 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef BLOCKCHECKSUMVERIFIER_H_DEFINED
+#define BLOCKCHECKSUMVERIFIER_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include "BlockChecksumWriter.h"
+
+#include <atomic>
+#include <functional>
+
+/**
+    Checks a data file against the block checksums BlockChecksumWriter wrote for it.
+
+    The data file is memory mapped and its blocks are split between worker threads,
+    so a recording is read once, in parallel, at the speed of the disk.
+*/
+class TESTABLE BlockChecksumVerifier
+{
+public:
+
+    typedef BlockChecksumWriter::Entry Entry;
+
+    struct Failure
+    {
+        Entry entry;
+
+        /* CRC of the data found, or 0 if the block is missing from the data file */
+        uint32 actualCrc;
+        bool missing;
+    };
+
+    struct Report
+    {
+        int64 blocksChecked{ 0 };
+        int64 bytesChecked{ 0 };
+
+        /* Bytes after the last checksummed block, e.g. written after a crash */
+        int64 uncheckedBytes{ 0 };
+
+        /* Blocks that do not match, in file order */
+        Array<Failure> failures;
+
+        bool isOk() const { return failures.size() == 0; }
+    };
+
+    /** Called with the bytes checked so far and the total */
+    typedef std::function<void(int64, int64)> ProgressCallback;
+
+    /** Constructor */
+    BlockChecksumVerifier();
+
+    /** Destructor */
+    ~BlockChecksumVerifier();
+
+    /** Reads the checksums. Returns false if the file is not a checksum file. */
+    bool open(const File& checksumFile);
+
+    int getNumChannels() const { return m_numChannels; }
+
+    int64 getNumEntries() const { return m_numEntries; }
+
+    const Entry& getEntry(int64 index) const { return m_entries[index]; }
+
+    /** Checks every block of dataFile with numThreads threads. progress, if set, is called
+        from this thread a few times a second. Returns false if the data file cannot be read. */
+    bool verify(const File& dataFile, int numThreads, Report& report, ProgressCallback progress = nullptr);
+
+    String getLastError() const { return m_lastError; }
+
+    /* Blocks checked by a worker per job */
+    static const int ENTRIES_PER_JOB = 64;
+
+private:
+
+    class Worker : public Thread
+    {
+    public:
+        Worker(BlockChecksumVerifier& owner, int index);
+
+        void run() override;
+
+    private:
+        BlockChecksumVerifier& m_owner;
+    };
+
+    void checkEntry(const Entry& entry);
+
+    int m_numChannels{ 0 };
+    int m_headerLength{ 0 };
+    HeapBlock<Entry> m_entries;
+    int64 m_numEntries{ 0 };
+    String m_lastError;
+
+    /* State of the verify() in progress */
+    const char* m_data{ nullptr };
+    int64 m_dataSize{ 0 };
+    Report* m_report{ nullptr };
+    CriticalSection m_reportLock;
+    int m_numJobs{ 0 };
+    std::atomic<int> m_nextJob{ 0 };
+    std::atomic<int> m_jobsDone{ 0 };
+    std::atomic<int64> m_bytesDone{ 0 };
+    WaitableEvent m_finished;
+
+    JUCE_DECLARE_NON_COPYABLE(BlockChecksumVerifier);
+};
+
+#endif
@@ -0,0 +1,94 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "BlockChecksumWriter.h"
+#include "Crc32c.h"
+
+static_assert(sizeof(BlockChecksumWriter::Entry) == 16, "checksum entries are 16 bytes on disk");
+
+BlockChecksumWriter::BlockChecksumWriter(int numChannels) :
+    m_numChannels(numChannels)
+{
+    m_entries.malloc(ENTRIES_PER_WRITE);
+}
+
+BlockChecksumWriter::~BlockChecksumWriter()
+{
+    close();
+}
+
+bool BlockChecksumWriter::openFile(String filename)
+{
+    File(filename).deleteFile();
+
+    m_file = BlockFileSink::create(BlockFileSink::BUFFERED);
+    if (!m_file->open(filename))
+    {
+        m_file.reset();
+        return false;
+    }
+
+    uint32 header[4];
+    memcpy(header, "PCRC", 4);
+    header[1] = VERSION;
+    header[2] = uint32(m_numChannels);
+    header[3] = 0;
+
+    return m_file->write(header, sizeof(header));
+}
+
+void BlockChecksumWriter::blockWritten(uint64 firstSample, const int16* frames, int nFrames)
+{
+    Entry& entry = m_entries[m_numEntries++];
+    entry.firstSample = firstSample;
+    entry.numSamples = uint32(nFrames);
+    entry.crc = Crc32c::update(0, frames, size_t(nFrames) * m_numChannels * sizeof(int16));
+    m_numBlocks++;
+
+    if (m_numEntries == ENTRIES_PER_WRITE)
+        writeEntries();
+}
+
+bool BlockChecksumWriter::writeEntries()
+{
+    const int numEntries = m_numEntries;
+    m_numEntries = 0;
+
+    if (!m_file)
+        return false;
+
+    return m_file->write(m_entries.getData(), numEntries * sizeof(Entry));
+}
+
+void BlockChecksumWriter::close()
+{
+    if (!m_file)
+        return;
+
+    if (m_numEntries > 0)
+        writeEntries();
+
+    m_file->close();
+    m_file.reset();
+}
@@ -0,0 +1,94 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef BLOCKCHECKSUMWRITER_H_DEFINED
+#define BLOCKCHECKSUMWRITER_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include "BlockFileSink.h"
+#include "InterleavedBlockFile.h"
+
+/**
+    Writes a CRC32C of every block of an interleaved int16 data file, together with the
+    samples the block covers, to a sidecar file, so corruption found later can be located.
+
+    The file is a header,
+
+        char magic[4] = "PCRC", uint32 version, numChannels, headerLength
+
+    followed by one 16-byte entry per block in file order,
+
+        uint64 firstSample, uint32 numSamples, uint32 crc32c
+
+    where the block starts at byte headerLength + firstSample * numChannels * 2 of the data file.
+    Entries are collected in memory and written in batches.
+*/
+class TESTABLE BlockChecksumWriter : public InterleavedBlockFile::Listener
+{
+public:
+
+    struct Entry
+    {
+        uint64 firstSample;
+        uint32 numSamples;
+        uint32 crc;
+    };
+
+    /** Constructor */
+    explicit BlockChecksumWriter(int numChannels);
+
+    /** Destructor. Calls close(). */
+    ~BlockChecksumWriter();
+
+    /** Creates the file and writes its header */
+    bool openFile(String filename);
+
+    /** Checksums a block of nFrames interleaved frames */
+    void blockWritten(uint64 firstSample, const int16* frames, int nFrames) override;
+
+    /** Writes the entries still in memory and closes the file */
+    void close();
+
+    /** Blocks checksummed so far */
+    int64 getNumBlocks() const { return m_numBlocks; }
+
+    static const uint32 VERSION = 1;
+    static const int ENTRIES_PER_WRITE = 256;
+
+private:
+
+    bool writeEntries();
+
+    const int m_numChannels;
+    HeapBlock<Entry> m_entries;
+    int m_numEntries{ 0 };
+    int64 m_numBlocks{ 0 };
+
+    std::unique_ptr<BlockFileSink> m_file;
+
+    JUCE_DECLARE_NON_COPYABLE(BlockChecksumWriter);
+};
+
+#endif
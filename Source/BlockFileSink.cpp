@@ -0,0 +1,106 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "BlockFileSink.h"
+#include "DirectFileSink.h"
+#include "MappedFileSink.h"
+
+std::unique_ptr<BlockFileSink> BlockFileSink::create(Type type)
+{
+    if (!isAvailable(type))
+    {
+        std::cerr << "[Persyst] Requested continuous file backend is not available on this platform, using buffered writes" << std::endl;
+        type = BUFFERED;
+    }
+
+    switch (type)
+    {
+    case DIRECT:
+        return std::make_unique<DirectFileSink>();
+    case MAPPED:
+        return std::make_unique<MappedFileSink>();
+    default:
+        return std::make_unique<BufferedFileSink>();
+    }
+}
+
+bool BlockFileSink::isAvailable(Type type)
+{
+    switch (type)
+    {
+    case BUFFERED:
+        return true;
+    case DIRECT:
+        return DirectFileSink::isAvailable();
+    case MAPPED:
+        return MappedFileSink::isAvailable();
+    default:
+        return false;
+    }
+}
+
+bool BufferedFileSink::open(const String& path)
+{
+    File file(path);
+    Result res = file.create();
+
+    if (res.failed())
+    {
+        std::cerr << "Error creating file " << path << ":" << res.getErrorMessage() << std::endl;
+        return false;
+    }
+
+    /* Blocks are large, so bypass the stream's own buffering */
+    m_file = std::make_unique<SyncableFileStream>(file, 0);
+
+    if (!m_file->openedOk())
+    {
+        std::cerr << "Error opening file " << path << std::endl;
+        m_file.reset();
+        return false;
+    }
+
+    m_syncHandle = m_file->getSyncHandle();
+    return true;
+}
+
+bool BufferedFileSink::write(const void* data, size_t numBytes)
+{
+    return m_file->write(data, numBytes);
+}
+
+void BufferedFileSink::close()
+{
+    if (m_file)
+        m_file->sync();
+    m_file.reset();
+}
+
+uint64 BufferedFileSink::flush()
+{
+    if (!m_file)
+        return 0;
+
+    m_file->flush();
+    return uint64(m_file->getPosition());
+}
@@ -0,0 +1,98 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef BLOCKFILESINK_H_DEFINED
+#define BLOCKFILESINK_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include "SyncableFileStream.h"
+
+/**
+    Destination for the bytes of an InterleavedBlockFile.
+
+    Data arrives strictly sequentially, mostly in whole blocks. close() must leave
+    the file at exactly the number of bytes written.
+*/
+class TESTABLE BlockFileSink
+{
+public:
+
+    enum Type
+    {
+        BUFFERED = 0,   // Plain file writes, through the page cache
+        DIRECT,         // Linux only: O_DIRECT with batched io_uring (or pwrite) submissions
+        MAPPED          // Linux only: fallocate()d extents written through mmap
+    };
+
+    virtual ~BlockFileSink() {}
+
+    /** Creates the file (and any missing parent folders) */
+    virtual bool open(const String& path) = 0;
+
+    /** Appends numBytes to the file */
+    virtual bool write(const void* data, size_t numBytes) = 0;
+
+    /** Writes out anything still buffered and closes the file */
+    virtual void close() = 0;
+
+    /** Hands whatever can be written without waiting to the operating system, and returns how
+        many bytes at the start of the file now hold their final data. Used for checkpoints. */
+    virtual uint64 flush() = 0;
+
+    /** Handle through which another thread can sync the file, or nullptr if it isn't open.
+        It stays valid after close(). */
+    FileSyncHandle::Ptr getSyncHandle() const { return m_syncHandle; }
+
+    /** Creates a sink of the given type, falling back to BUFFERED where it isn't available */
+    static std::unique_ptr<BlockFileSink> create(Type type);
+
+    /** Returns true if sinks of this type can be created on this platform */
+    static bool isAvailable(Type type);
+
+protected:
+
+    FileSyncHandle::Ptr m_syncHandle;
+};
+
+/**
+    Plain buffered file sink, equivalent to the GUI's SequentialBlockFile.
+*/
+class TESTABLE BufferedFileSink : public BlockFileSink
+{
+public:
+
+    bool open(const String& path) override;
+
+    bool write(const void* data, size_t numBytes) override;
+
+    void close() override;
+
+    uint64 flush() override;
+
+private:
+
+    std::unique_ptr<SyncableFileStream> m_file;
+};
+
+#endif
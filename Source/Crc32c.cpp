@@ -0,0 +1,250 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "Crc32c.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PERSYST_CRC32C_HW 1
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PERSYST_TARGET(isa)
+#else
+#define PERSYST_TARGET(isa) __attribute__((target(isa)))
+#endif
+#else
+#define PERSYST_CRC32C_HW 0
+#endif
+
+/* Reflected Castagnoli polynomial */
+#define CRC32C_POLYNOMIAL 0x82f63b78u
+
+/* Bytes per lane of the three interleaved crc32 streams in the SSE4.2 kernel */
+#define CRC32C_LANE 4096
+
+namespace
+{
+    /* table[k][b] is the CRC of byte b followed by k zero bytes. shift[k][b] moves bits
+       8k..8k+7 of a CRC register set to b past CRC32C_LANE zero bytes. */
+    struct SlicingTables
+    {
+        uint32 table[8][256];
+        uint32 shift[4][256];
+
+        SlicingTables()
+        {
+            for (uint32 b = 0; b < 256; b++)
+            {
+                uint32 crc = b;
+                for (int bit = 0; bit < 8; bit++)
+                    crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLYNOMIAL : 0);
+                table[0][b] = crc;
+            }
+
+            for (uint32 b = 0; b < 256; b++)
+                for (int k = 1; k < 8; k++)
+                    table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xff];
+
+            /* Zero bytes act linearly on the register, so shifting each bit is enough */
+            uint32 shiftedBits[32];
+            for (int bit = 0; bit < 32; bit++)
+            {
+                uint32 crc = 1u << bit;
+                for (int i = 0; i < CRC32C_LANE; i++)
+                    crc = (crc >> 8) ^ table[0][crc & 0xff];
+                shiftedBits[bit] = crc;
+            }
+
+            for (int k = 0; k < 4; k++)
+            {
+                for (uint32 b = 0; b < 256; b++)
+                {
+                    uint32 crc = 0;
+                    for (int bit = 0; bit < 8; bit++)
+                        if (b & (1u << bit))
+                            crc ^= shiftedBits[8 * k + bit];
+                    shift[k][b] = crc;
+                }
+            }
+        }
+    };
+}
+
+static const SlicingTables& getTables()
+{
+    static const SlicingTables tables;
+    return tables;
+}
+
+static uint32 updateTable(uint32 crc, const uint8* data, size_t numBytes)
+{
+    const uint32 (&t)[8][256] = getTables().table;
+    crc = ~crc;
+
+    while (numBytes >= 8)
+    {
+        uint32 low, high;
+        memcpy(&low, data, 4);
+        memcpy(&high, data + 4, 4);
+        low ^= crc;
+
+        crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24]
+            ^ t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^ t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+
+        data += 8;
+        numBytes -= 8;
+    }
+
+    while (numBytes-- > 0)
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+
+    return ~crc;
+}
+
+#if PERSYST_CRC32C_HW
+
+static inline uint32 shiftLane(const uint32 (&shift)[4][256], uint32 crc)
+{
+    return shift[0][crc & 0xff] ^ shift[1][(crc >> 8) & 0xff] ^ shift[2][(crc >> 16) & 0xff] ^ shift[3][crc >> 24];
+}
+
+PERSYST_TARGET("sse4.2")
+static uint32 updateSse42(uint32 crc, const uint8* data, size_t numBytes)
+{
+    crc = ~crc;
+
+    while (numBytes > 0 && (reinterpret_cast<uintptr_t>(data) & 7) != 0)
+    {
+        crc = _mm_crc32_u8(crc, *data++);
+        numBytes--;
+    }
+
+    uint64 crc64 = crc;
+
+    /* crc32 has a latency of three cycles but a throughput of one, so run three lanes side by
+       side and merge them: the CRC of a, b, c is shift(shift(crc(a)) ^ crc(b)) ^ crc(c) */
+    if (numBytes >= 3 * CRC32C_LANE)
+    {
+        const uint32 (&shift)[4][256] = getTables().shift;
+
+        while (numBytes >= 3 * CRC32C_LANE)
+        {
+            uint64 crc1 = 0;
+            uint64 crc2 = 0;
+            for (int i = 0; i < CRC32C_LANE; i += 8)
+            {
+                uint64 value0, value1, value2;
+                memcpy(&value0, data + i, 8);
+                memcpy(&value1, data + CRC32C_LANE + i, 8);
+                memcpy(&value2, data + 2 * CRC32C_LANE + i, 8);
+                crc64 = _mm_crc32_u64(crc64, value0);
+                crc1 = _mm_crc32_u64(crc1, value1);
+                crc2 = _mm_crc32_u64(crc2, value2);
+            }
+
+            crc64 = shiftLane(shift, shiftLane(shift, uint32(crc64)) ^ uint32(crc1)) ^ uint32(crc2);
+            data += 3 * CRC32C_LANE;
+            numBytes -= 3 * CRC32C_LANE;
+        }
+    }
+
+    while (numBytes >= 8)
+    {
+        uint64 value;
+        memcpy(&value, data, 8);
+        crc64 = _mm_crc32_u64(crc64, value);
+        data += 8;
+        numBytes -= 8;
+    }
+    crc = uint32(crc64);
+
+    while (numBytes-- > 0)
+        crc = _mm_crc32_u8(crc, *data++);
+
+    return ~crc;
+}
+
+static bool cpuSupportsSse42()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+#endif
+
+uint32 Crc32c::update(uint32 crc, const void* data, size_t numBytes)
+{
+    static const Implementation implementation = getImplementation();
+    return update(implementation, crc, data, numBytes);
+}
+
+uint32 Crc32c::update(Implementation implementation, uint32 crc, const void* data, size_t numBytes)
+{
+    const uint8* bytes = static_cast<const uint8*>(data);
+
+#if PERSYST_CRC32C_HW
+    if (implementation == SSE42)
+        return updateSse42(crc, bytes, numBytes);
+#endif
+
+    return updateTable(crc, bytes, numBytes);
+}
+
+Crc32c::Implementation Crc32c::getImplementation()
+{
+    return isSupported(SSE42) ? SSE42 : TABLE;
+}
+
+bool Crc32c::isSupported(Implementation implementation)
+{
+    switch (implementation)
+    {
+    case TABLE:
+        return true;
+#if PERSYST_CRC32C_HW
+    case SSE42:
+        return cpuSupportsSse42();
+#endif
+    default:
+        return false;
+    }
+}
+
+const char* Crc32c::getName(Implementation implementation)
+{
+    switch (implementation)
+    {
+    case TABLE:
+        return "table";
+    case SSE42:
+        return "SSE4.2";
+    default:
+        return "unknown";
+    }
+}
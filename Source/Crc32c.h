@@ -0,0 +1,64 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef CRC32C_H_DEFINED
+#define CRC32C_H_DEFINED
+
+#include <RecordingLib.h>
+
+/**
+    CRC-32C (Castagnoli), the checksum of iSCSI, ext4 and SCTP.
+
+    Uses the SSE4.2 crc32 instruction where the CPU has it, on three interleaved lanes of
+    8 bytes at a time for long buffers, and a slicing-by-8 table otherwise. Both give
+    identical results.
+*/
+class TESTABLE Crc32c
+{
+public:
+
+    enum Implementation
+    {
+        TABLE = 0,
+        SSE42
+    };
+
+    /** Returns the CRC of the bytes covered by crc followed by numBytes more. Start from 0,
+        so update(update(0, a), b) is the CRC of a and b back to back. */
+    static uint32 update(uint32 crc, const void* data, size_t numBytes);
+
+    /** Uses a specific implementation, which must be supported by this CPU */
+    static uint32 update(Implementation implementation, uint32 crc, const void* data, size_t numBytes);
+
+    /** Returns the fastest implementation this CPU (and build) supports */
+    static Implementation getImplementation();
+
+    /** Returns true if the implementation can run on this CPU */
+    static bool isSupported(Implementation implementation);
+
+    /** Returns a human-readable name for an implementation */
+    static const char* getName(Implementation implementation);
+};
+
+#endif
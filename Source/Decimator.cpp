@@ -0,0 +1,183 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "Decimator.h"
+
+#include <cmath>
+
+/* Inputs filtered per pass; the history buffer holds the filter span plus one chunk */
+#define DECIMATOR_CHUNK 1024
+
+static float dotProduct(const float* a, const float* b, int n)
+{
+    /* Eight independent sums, so the loop vectorises without reassociating a single sum */
+    float sums[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        for (int k = 0; k < 8; k++)
+            sums[k] += a[i + k] * b[i + k];
+    }
+
+    float total = 0;
+    for (; i < n; i++)
+        total += a[i] * b[i];
+    for (int k = 0; k < 8; k++)
+        total += sums[k];
+
+    return total;
+}
+
+Decimator::Decimator(int factor, int halfLength) :
+    m_factor(jmax(2, factor)),
+    m_halfLength(jmax(1, halfLength)),
+    m_numTaps(2 * m_halfLength * m_factor + 1)
+{
+    m_taps.malloc(m_numTaps);
+
+    const double cutoff = 0.35 / m_factor;
+    const int centre = m_halfLength * m_factor;
+    double sum = 0;
+
+    for (int j = 0; j < m_numTaps; j++)
+    {
+        const int m = j - centre;
+        const double sinc = m == 0 ? 2 * cutoff : std::sin(2 * MathConstants<double>::pi * cutoff * m) / (MathConstants<double>::pi * m);
+        const double phase = 2 * MathConstants<double>::pi * j / (m_numTaps - 1);
+        const double window = 0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2 * phase);
+        const double tap = sinc * window;
+
+        m_taps[j] = float(tap);
+        sum += tap;
+    }
+
+    /* Unity gain at DC */
+    for (int j = 0; j < m_numTaps; j++)
+        m_taps[j] = float(m_taps[j] / sum);
+}
+
+int Decimator::getFactorFor(double sampleRate, double targetRate)
+{
+    if (sampleRate <= 0 || targetRate <= 0 || sampleRate / targetRate < 1.5)
+        return 0;
+
+    /* A whole output rate within 10% of the target, if there is one */
+    int best = 0;
+    double bestError = 0.1;
+    if (sampleRate == std::floor(sampleRate))
+    {
+        for (int factor = 2; sampleRate / factor >= targetRate * 0.9; factor++)
+        {
+            const double rate = sampleRate / factor;
+            const double error = std::abs(rate - targetRate) / targetRate;
+            if (rate == std::floor(rate) && error <= bestError)
+            {
+                best = factor;
+                bestError = error;
+            }
+        }
+    }
+
+    if (best == 0)
+        best = jmax(2, roundToInt(sampleRate / targetRate));
+
+    return best;
+}
+
+Decimator::Channel::Channel(const Decimator& filter) :
+    m_filter(filter)
+{
+    m_history.malloc(filter.m_numTaps - 1 + DECIMATOR_CHUNK);
+    reset();
+}
+
+void Decimator::Channel::reset()
+{
+    /* Inputs before the first one are zero */
+    m_history.clear(m_filter.m_numTaps - 1);
+    m_inputs = 0;
+    m_received = 0;
+    m_nextOutputInput = int64(m_filter.m_halfLength) * m_filter.m_factor;
+}
+
+int Decimator::Channel::process(const float* input, int numSamples, float* dest)
+{
+    m_received += numSamples;
+    return filter(input, numSamples, dest);
+}
+
+int Decimator::Channel::filter(const float* input, int numSamples, float* dest)
+{
+    const int historyLength = m_filter.m_numTaps - 1;
+    int outputs = 0;
+
+    while (numSamples > 0)
+    {
+        const int count = jmin(numSamples, DECIMATOR_CHUNK);
+        if (input != nullptr)
+            memcpy(m_history + historyLength, input, count * sizeof(float));
+        else
+            FloatVectorOperations::clear(m_history + historyLength, count);
+
+        /* m_history[0] holds input m_inputs - historyLength, so an output's span starts at its index - m_inputs */
+        const int64 end = m_inputs + count;
+        while (m_nextOutputInput < end)
+        {
+            const float* span = m_history + (m_nextOutputInput - m_inputs);
+            dest[outputs++] = dotProduct(m_filter.m_taps, span, m_filter.m_numTaps);
+            m_nextOutputInput += m_filter.m_factor;
+        }
+
+        memmove(m_history, m_history + count, historyLength * sizeof(float));
+        m_inputs = end;
+
+        if (input != nullptr)
+            input += count;
+        numSamples -= count;
+    }
+
+    return outputs;
+}
+
+int Decimator::Channel::getFlushOutputs() const
+{
+    const int64 factor = m_filter.m_factor;
+    const int64 total = (m_received + factor - 1) / factor;
+    const int64 produced = (m_nextOutputInput - int64(m_filter.m_halfLength) * factor) / factor;
+    return int(jmax(int64(0), total - produced));
+}
+
+int Decimator::Channel::flush(float* dest)
+{
+    const int remaining = getFlushOutputs();
+    if (remaining == 0)
+        return 0;
+
+    /* Zeros up to and including the input the last output is computed at */
+    const int64 lastOutputInput = m_nextOutputInput + int64(remaining - 1) * m_filter.m_factor;
+    const int outputs = filter(nullptr, int(lastOutputInput + 1 - m_inputs), dest);
+    jassert(outputs == remaining);
+    return outputs;
+}
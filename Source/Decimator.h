@@ -0,0 +1,110 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef DECIMATOR_H_DEFINED
+#define DECIMATOR_H_DEFINED
+
+#include <RecordingLib.h>
+
+/**
+    Anti-aliased decimation by an integer factor, one channel at a time.
+
+    The low-pass filter is a linear-phase, Blackman-windowed sinc of 2 * halfLength * factor + 1
+    taps with its -6 dB point at 0.35 of the output rate, shared by every channel. Only the
+    samples that are kept are computed (a polyphase decimator), each as one contiguous dot
+    product that the compiler vectorises.
+
+    The filter delay is compensated, so output sample k is centred on input sample k * factor,
+    and after flush() a channel has produced exactly ceil(inputs / factor) samples.
+*/
+class TESTABLE Decimator
+{
+public:
+
+    /** Constructor. Designs the filter for the given decimation factor (at least 2). */
+    explicit Decimator(int factor, int halfLength = 10);
+
+    int getFactor() const { return m_factor; }
+
+    int getNumTaps() const { return m_numTaps; }
+
+    const float* getTaps() const { return m_taps.getData(); }
+
+    /** Largest number of outputs process() can produce from numSamples inputs */
+    int getMaxOutputs(int numSamples) const { return numSamples / m_factor + 1; }
+
+    /** Largest number of outputs flush() can produce */
+    int getMaxFlushOutputs() const { return m_halfLength + 1; }
+
+    /** Picks the factor that brings sampleRate closest to targetRate, preferring factors that
+        give a whole output rate. Returns 0 if no factor of at least 2 gets near the target. */
+    static int getFactorFor(double sampleRate, double targetRate);
+
+    /** Filter state of one channel */
+    class Channel
+    {
+    public:
+        explicit Channel(const Decimator& filter);
+
+        /** Filters numSamples inputs and writes the outputs that became available to dest,
+            which must hold getMaxOutputs(numSamples) values. Returns the number written. */
+        int process(const float* input, int numSamples, float* dest);
+
+        /** Pushes zeros through the filter until the outputs of every input received so far are out.
+            dest must hold getFlushOutputs() values. Returns the number written. Call reset()
+            before processing more input. */
+        int flush(float* dest);
+
+        /** Outputs flush() still has to produce */
+        int getFlushOutputs() const;
+
+        /** Forgets all input, as if the channel had just been created */
+        void reset();
+
+    private:
+        /** Runs inputs through the filter; nullptr filters zeros */
+        int filter(const float* input, int numSamples, float* dest);
+
+        const Decimator& m_filter;
+
+        /* The last numTaps - 1 inputs, followed by room for a chunk of new ones */
+        HeapBlock<float> m_history;
+        int64 m_inputs;
+        int64 m_received;
+        int64 m_nextOutputInput;
+
+        JUCE_DECLARE_NON_COPYABLE(Channel);
+    };
+
+private:
+
+    const int m_factor;
+    const int m_halfLength;
+    const int m_numTaps;
+    HeapBlock<float> m_taps;
+
+    JUCE_DECLARE_NON_COPYABLE(Decimator);
+};
+
+#endif
@@ -0,0 +1,421 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "DirectFileSink.h"
+
+#define DIRECT_BUFFER_SIZE (1 << 20)
+#define DIRECT_NUM_BUFFERS 4
+#define DIRECT_ALIGNMENT 4096
+
+#if JUCE_LINUX
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef PERSYST_HAVE_LIBURING
+#include <liburing.h>
+struct DirectFileSink::Uring
+{
+    struct io_uring ring;
+};
+#else
+struct DirectFileSink::Uring
+{
+};
+#endif
+
+DirectFileSink::DirectFileSink() :
+    m_fd(-1),
+    m_direct(false),
+    m_failed(false),
+    m_currentBuffer(0),
+    m_bufferFill(0),
+    m_fileOffset(0),
+    m_bytesWritten(0),
+    m_releasedOffset(0)
+{
+    m_buffers.calloc(DIRECT_NUM_BUFFERS);
+    m_inFlight.calloc(DIRECT_NUM_BUFFERS);
+    m_submittedBytes.calloc(DIRECT_NUM_BUFFERS);
+    m_completedBytes.calloc(DIRECT_NUM_BUFFERS);
+    m_submittedOffsets.calloc(DIRECT_NUM_BUFFERS);
+}
+
+DirectFileSink::~DirectFileSink()
+{
+    close();
+}
+
+bool DirectFileSink::isAvailable()
+{
+    return true;
+}
+
+bool DirectFileSink::usesIoUring() const
+{
+    return m_uring != nullptr;
+}
+
+bool DirectFileSink::open(const String& path)
+{
+    /* Let JUCE create any missing parent folders */
+    Result res = File(path).create();
+    if (res.failed())
+    {
+        std::cerr << "Error creating file " << path << ":" << res.getErrorMessage() << std::endl;
+        return false;
+    }
+
+    m_fd = ::open(path.toRawUTF8(), O_WRONLY | O_TRUNC | O_DIRECT, 0644);
+    m_direct = (m_fd >= 0);
+
+    if (m_fd < 0)
+        m_fd = ::open(path.toRawUTF8(), O_WRONLY | O_TRUNC, 0644);
+
+    if (m_fd < 0)
+    {
+        std::cerr << "Error opening file " << path << ":" << strerror(errno) << std::endl;
+        return false;
+    }
+
+    if (!m_direct)
+        std::cerr << "[Persyst] " << path << " does not support O_DIRECT, using buffered writes" << std::endl;
+
+    m_syncHandle = FileSyncHandle::create(m_fd, path);
+
+    for (int i = 0; i < DIRECT_NUM_BUFFERS; i++)
+    {
+        if (posix_memalign(reinterpret_cast<void**>(&m_buffers[i]), DIRECT_ALIGNMENT, DIRECT_BUFFER_SIZE) != 0)
+        {
+            std::cerr << "[Persyst] Could not allocate aligned write buffers" << std::endl;
+            return false;
+        }
+    }
+
+#ifdef PERSYST_HAVE_LIBURING
+    m_uring = std::make_unique<Uring>();
+    if (io_uring_queue_init(DIRECT_NUM_BUFFERS, &m_uring->ring, 0) < 0)
+    {
+        /* io_uring can be missing or disabled by policy; pwrite works everywhere */
+        m_uring.reset();
+    }
+#endif
+
+    return true;
+}
+
+bool DirectFileSink::write(const void* data, size_t numBytes)
+{
+    if (m_fd < 0 || m_failed)
+        return false;
+
+    const uint8* source = static_cast<const uint8*>(data);
+
+    while (numBytes > 0)
+    {
+        if (m_bufferFill == 0 && !waitFor(m_currentBuffer))
+            return false;
+
+        size_t count = jmin(numBytes, size_t(DIRECT_BUFFER_SIZE) - m_bufferFill);
+        memcpy(m_buffers[m_currentBuffer] + m_bufferFill, source, count);
+
+        m_bufferFill += count;
+        m_bytesWritten += count;
+        source += count;
+        numBytes -= count;
+
+        if (m_bufferFill == DIRECT_BUFFER_SIZE)
+        {
+            if (!submit(m_currentBuffer, DIRECT_BUFFER_SIZE))
+                return false;
+
+            m_currentBuffer = (m_currentBuffer + 1) % DIRECT_NUM_BUFFERS;
+            m_bufferFill = 0;
+        }
+    }
+
+    return true;
+}
+
+void DirectFileSink::close()
+{
+    if (m_fd < 0)
+        return;
+
+    if (m_bufferFill > 0 && waitFor(m_currentBuffer))
+    {
+        /* O_DIRECT needs whole sectors; the padding is truncated away below */
+        size_t padded = m_direct ? ((m_bufferFill + DIRECT_ALIGNMENT - 1) & ~size_t(DIRECT_ALIGNMENT - 1)) : m_bufferFill;
+        memset(m_buffers[m_currentBuffer] + m_bufferFill, 0, padded - m_bufferFill);
+        submit(m_currentBuffer, padded);
+        m_bufferFill = 0;
+    }
+
+    for (int i = 0; i < DIRECT_NUM_BUFFERS; i++)
+        waitFor(i);
+
+    if (!m_direct && m_fileOffset > m_releasedOffset)
+    {
+        /* Also drops the pages that were still under writeback when their range was released */
+        fdatasync(m_fd);
+        posix_fadvise(m_fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+
+    if (ftruncate(m_fd, off_t(m_bytesWritten)) != 0)
+        std::cerr << "[Persyst] Could not truncate data file: " << strerror(errno) << std::endl;
+
+    if (m_failed)
+        std::cerr << "[Persyst] Errors occurred while writing a data file, it may be incomplete" << std::endl;
+
+#ifdef PERSYST_HAVE_LIBURING
+    if (m_uring)
+        io_uring_queue_exit(&m_uring->ring);
+#endif
+    m_uring.reset();
+
+    ::close(m_fd);
+    m_fd = -1;
+
+    for (int i = 0; i < DIRECT_NUM_BUFFERS; i++)
+    {
+        free(m_buffers[i]);
+        m_buffers[i] = nullptr;
+    }
+}
+
+uint64 DirectFileSink::flush()
+{
+    /* The buffer being filled is not aligned yet and stays here; of the submitted ones, only
+       those before the oldest write still in flight are known to be on disk */
+    uint64 completed = m_fileOffset;
+    for (int i = 0; i < DIRECT_NUM_BUFFERS; i++)
+    {
+        if (m_inFlight[i])
+            completed = jmin(completed, m_submittedOffsets[i]);
+    }
+    return completed;
+}
+
+bool DirectFileSink::submit(int buffer, size_t numBytes)
+{
+    const uint64 offset = m_fileOffset;
+    m_fileOffset += numBytes;
+
+    m_submittedBytes[buffer] = numBytes;
+    m_submittedOffsets[buffer] = offset;
+    m_completedBytes[buffer] = 0;
+
+    return writeRemaining(buffer);
+}
+
+bool DirectFileSink::writeRemaining(int buffer)
+{
+    const uint64 offset = m_submittedOffsets[buffer];
+    const size_t numBytes = m_submittedBytes[buffer];
+    size_t done = m_completedBytes[buffer];
+
+#ifdef PERSYST_HAVE_LIBURING
+    if (m_uring)
+    {
+        struct io_uring_sqe* sqe = io_uring_get_sqe(&m_uring->ring);
+        if (sqe != nullptr)
+        {
+            io_uring_prep_write(sqe, m_fd, m_buffers[buffer] + done, unsigned(numBytes - done), offset + done);
+            io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(intptr_t(buffer)));
+
+            if (io_uring_submit(&m_uring->ring) >= 0)
+            {
+                m_inFlight[buffer] = true;
+                return true;
+            }
+        }
+        /* The submission queue is sized for every buffer, so this is unexpected; write synchronously */
+    }
+#endif
+
+    while (done < numBytes)
+    {
+        ssize_t n = pwrite(m_fd, m_buffers[buffer] + done, numBytes - done, off_t(offset + done));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            std::cerr << "[Persyst] Write error: " << strerror(errno) << std::endl;
+            m_failed = true;
+            return false;
+        }
+        done += size_t(n);
+    }
+
+    releaseWrittenRange(offset, numBytes);
+    return true;
+}
+
+bool DirectFileSink::waitFor(int buffer)
+{
+    while (m_inFlight[buffer])
+    {
+        if (!reapCompletion())
+            return false;
+    }
+    return !m_failed;
+}
+
+bool DirectFileSink::reapCompletion()
+{
+#ifdef PERSYST_HAVE_LIBURING
+    struct io_uring_cqe* cqe;
+    int ret = io_uring_wait_cqe(&m_uring->ring, &cqe);
+    if (ret == -EINTR)
+        return true;
+    if (ret < 0)
+    {
+        std::cerr << "[Persyst] io_uring wait failed: " << strerror(-ret) << std::endl;
+        m_failed = true;
+        for (int i = 0; i < DIRECT_NUM_BUFFERS; i++)
+            m_inFlight[i] = false;
+        return false;
+    }
+
+    int buffer = int(intptr_t(io_uring_cqe_get_data(cqe)));
+    const int res = cqe->res;
+    m_inFlight[buffer] = false;
+    io_uring_cqe_seen(&m_uring->ring, cqe);
+
+    if (res <= 0)
+    {
+        std::cerr << "[Persyst] Write error: " << (res < 0 ? strerror(-res) : "no bytes written") << std::endl;
+        m_failed = true;
+        return true;
+    }
+
+    /* A short write is not an error: carry on from where it stopped, like the pwrite loop */
+    m_completedBytes[buffer] += size_t(res);
+    if (m_completedBytes[buffer] < m_submittedBytes[buffer])
+        writeRemaining(buffer);
+    else
+        releaseWrittenRange(m_submittedOffsets[buffer], m_submittedBytes[buffer]);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+void DirectFileSink::releaseWrittenRange(uint64 offset, size_t numBytes)
+{
+    if (m_direct)
+        return;
+
+    /* Buffered fallback: start writeback of this range without waiting for it, and drop the
+       ranges a few buffers back from the page cache. By then they have normally been written
+       back; pages that have not are skipped rather than waited on, and dropped on close() */
+    sync_file_range(m_fd, off_t(offset), off_t(numBytes), SYNC_FILE_RANGE_WRITE);
+
+    const uint64 lag = uint64(DIRECT_NUM_BUFFERS) * DIRECT_BUFFER_SIZE;
+    if (offset > m_releasedOffset + lag)
+    {
+        posix_fadvise(m_fd, off_t(m_releasedOffset), off_t(offset - lag - m_releasedOffset), POSIX_FADV_DONTNEED);
+        m_releasedOffset = offset - lag;
+    }
+}
+
+#else
+
+struct DirectFileSink::Uring
+{
+};
+
+DirectFileSink::DirectFileSink() :
+    m_fd(-1),
+    m_direct(false),
+    m_failed(false),
+    m_currentBuffer(0),
+    m_bufferFill(0),
+    m_fileOffset(0),
+    m_bytesWritten(0),
+    m_releasedOffset(0)
+{
+}
+
+DirectFileSink::~DirectFileSink()
+{
+}
+
+bool DirectFileSink::isAvailable()
+{
+    return false;
+}
+
+bool DirectFileSink::usesIoUring() const
+{
+    return false;
+}
+
+bool DirectFileSink::open(const String& path)
+{
+    return false;
+}
+
+bool DirectFileSink::write(const void* data, size_t numBytes)
+{
+    return false;
+}
+
+void DirectFileSink::close()
+{
+}
+
+uint64 DirectFileSink::flush()
+{
+    return 0;
+}
+
+bool DirectFileSink::submit(int buffer, size_t numBytes)
+{
+    return false;
+}
+
+bool DirectFileSink::writeRemaining(int buffer)
+{
+    return false;
+}
+
+bool DirectFileSink::waitFor(int buffer)
+{
+    return false;
+}
+
+bool DirectFileSink::reapCompletion()
+{
+    return false;
+}
+
+void DirectFileSink::releaseWrittenRange(uint64 offset, size_t numBytes)
+{
+}
+
+#endif
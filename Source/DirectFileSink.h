@@ -0,0 +1,100 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DIRECTFILESINK_H_DEFINED
+#define DIRECTFILESINK_H_DEFINED
+
+#include "BlockFileSink.h"
+
+/**
+    Linux sink that keeps recording.dat out of the page cache.
+
+    Data is gathered into a few aligned 1 MB buffers which are written with O_DIRECT,
+    submitted asynchronously through io_uring when the plugin is built with liburing
+    and the kernel allows it, or with pwrite otherwise. The last buffer is padded to
+    the device alignment and the file truncated back to its exact length on close().
+
+    File systems that refuse O_DIRECT (e.g. tmpfs) get buffered writes instead, with
+    each written range handed to writeback right away and dropped from the page cache
+    a few buffers later, without ever waiting on the disk.
+*/
+class TESTABLE DirectFileSink : public BlockFileSink
+{
+public:
+
+    /** Constructor */
+    DirectFileSink();
+
+    /** Destructor */
+    ~DirectFileSink();
+
+    bool open(const String& path) override;
+
+    bool write(const void* data, size_t numBytes) override;
+
+    void close() override;
+
+    uint64 flush() override;
+
+    /** True if the file was opened with O_DIRECT */
+    bool isDirect() const { return m_direct; }
+
+    /** True if writes are submitted through io_uring rather than pwrite */
+    bool usesIoUring() const;
+
+    /** Returns true on platforms that support this sink */
+    static bool isAvailable();
+
+private:
+
+    bool submit(int buffer, size_t numBytes);
+    bool writeRemaining(int buffer);
+    bool waitFor(int buffer);
+    bool reapCompletion();
+    void releaseWrittenRange(uint64 offset, size_t numBytes);
+
+    struct Uring;
+    std::unique_ptr<Uring> m_uring;
+
+    int m_fd;
+    bool m_direct;
+    bool m_failed;
+
+    HeapBlock<uint8*> m_buffers;
+    HeapBlock<bool> m_inFlight;
+    HeapBlock<size_t> m_submittedBytes;
+    HeapBlock<size_t> m_completedBytes;
+    HeapBlock<uint64> m_submittedOffsets;
+
+    int m_currentBuffer;
+    size_t m_bufferFill;
+    uint64 m_fileOffset;
+    uint64 m_bytesWritten;
+
+    /* Buffered fallback: everything before this offset has been dropped from the page cache */
+    uint64 m_releasedOffset;
+
+    JUCE_DECLARE_NON_COPYABLE(DirectFileSink);
+};
+
+#endif
@@ -0,0 +1,230 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "EnvelopePyramid.h"
+
+#include <cmath>
+
+/* Page header: uint32 level, uint32 numBins, uint64 firstBin, as int16 slots at the start of a page */
+#define PAGE_HEADER_VALUES 8
+
+EnvelopePyramid::EnvelopePyramid(int numChannels, bool withRms, const Array<int>& factors) :
+    m_numChannels(numChannels),
+    m_withRms(withRms),
+    m_valuesPerBin(withRms ? 3 : 2)
+{
+    for (int i = 0; i < factors.size(); i++)
+    {
+        jassert(factors[i] >= 2 && (i == 0 || factors[i] % factors[i - 1] == 0));
+
+        Level* level = m_levels.add(new Level());
+        level->factor = factors[i];
+        level->mins.malloc(m_numChannels);
+        level->maxs.malloc(m_numChannels);
+        level->sumSquares.malloc(m_numChannels);
+        level->page.calloc(PAGE_HEADER_VALUES + size_t(m_numChannels) * m_valuesPerBin * PAGE_BINS);
+        level->pageFill = 0;
+        level->binsCompleted = 0;
+        resetBin(level);
+    }
+}
+
+EnvelopePyramid::~EnvelopePyramid()
+{
+    close();
+}
+
+Array<int> EnvelopePyramid::getDefaultFactors()
+{
+    return { 64, 1024, 16384 };
+}
+
+bool EnvelopePyramid::openFile(String filename)
+{
+    File(filename).deleteFile();
+
+    m_file = BlockFileSink::create(BlockFileSink::BUFFERED);
+    if (!m_file->open(filename))
+    {
+        m_file.reset();
+        return false;
+    }
+
+    HeapBlock<uint32> header(6 + m_levels.size());
+    memcpy(header.getData(), "PENV", 4);
+    header[1] = VERSION;
+    header[2] = uint32(m_numChannels);
+    header[3] = uint32(m_levels.size());
+    header[4] = m_withRms ? HAS_RMS : 0;
+    header[5] = PAGE_BINS;
+    for (int i = 0; i < m_levels.size(); i++)
+        header[6 + i] = uint32(m_levels[i]->factor);
+
+    return m_file->write(header.getData(), (6 + m_levels.size()) * sizeof(uint32));
+}
+
+void EnvelopePyramid::blockWritten(uint64 firstSample, const int16* frames, int nFrames)
+{
+    addFrames(frames, nFrames);
+}
+
+void EnvelopePyramid::addFrames(const int16* frames, int nFrames)
+{
+    if (m_levels.size() == 0)
+        return;
+
+    Level* level = m_levels[0];
+    const int numChannels = m_numChannels;
+
+    while (nFrames > 0)
+    {
+        const int count = jmin(nFrames, level->factor - level->samples);
+
+        int16* mins = level->mins;
+        int16* maxs = level->maxs;
+        float* sumSquares = level->sumSquares;
+        if (m_withRms)
+        {
+            for (int f = 0; f < count; f++)
+            {
+                const int16* frame = frames + size_t(f) * numChannels;
+                for (int ch = 0; ch < numChannels; ch++)
+                {
+                    mins[ch] = frame[ch] < mins[ch] ? frame[ch] : mins[ch];
+                    maxs[ch] = frame[ch] > maxs[ch] ? frame[ch] : maxs[ch];
+                    sumSquares[ch] += float(frame[ch]) * float(frame[ch]);
+                }
+            }
+        }
+        else
+        {
+            for (int f = 0; f < count; f++)
+            {
+                const int16* frame = frames + size_t(f) * numChannels;
+                for (int ch = 0; ch < numChannels; ch++)
+                {
+                    mins[ch] = frame[ch] < mins[ch] ? frame[ch] : mins[ch];
+                    maxs[ch] = frame[ch] > maxs[ch] ? frame[ch] : maxs[ch];
+                }
+            }
+        }
+
+        level->samples += count;
+        frames += size_t(count) * numChannels;
+        nFrames -= count;
+
+        if (level->samples == level->factor)
+            completeBin(0);
+    }
+}
+
+void EnvelopePyramid::resetBin(Level* level)
+{
+    for (int ch = 0; ch < m_numChannels; ch++)
+    {
+        level->mins[ch] = std::numeric_limits<int16>::max();
+        level->maxs[ch] = std::numeric_limits<int16>::min();
+        level->sumSquares[ch] = 0;
+    }
+    level->samples = 0;
+}
+
+void EnvelopePyramid::completeBin(int levelIndex)
+{
+    Level* level = m_levels[levelIndex];
+
+    /* Store the bin in its column of the channel-major page */
+    int16* page = level->page + PAGE_HEADER_VALUES + level->pageFill;
+    for (int ch = 0; ch < m_numChannels; ch++)
+    {
+        int16* values = page + size_t(ch) * m_valuesPerBin * PAGE_BINS;
+        values[0] = level->mins[ch];
+        values[PAGE_BINS] = level->maxs[ch];
+        if (m_withRms)
+            values[2 * PAGE_BINS] = int16(jmin(32767, roundToInt(std::sqrt(level->sumSquares[ch] / level->samples))));
+    }
+
+    level->binsCompleted++;
+    if (++level->pageFill == PAGE_BINS)
+        writePage(levelIndex);
+
+    if (levelIndex + 1 < m_levels.size())
+    {
+        Level* parent = m_levels[levelIndex + 1];
+        for (int ch = 0; ch < m_numChannels; ch++)
+        {
+            parent->mins[ch] = jmin(parent->mins[ch], level->mins[ch]);
+            parent->maxs[ch] = jmax(parent->maxs[ch], level->maxs[ch]);
+            parent->sumSquares[ch] += level->sumSquares[ch];
+        }
+        parent->samples += level->samples;
+        resetBin(level);
+
+        if (parent->samples == parent->factor)
+            completeBin(levelIndex + 1);
+    }
+    else
+    {
+        resetBin(level);
+    }
+}
+
+bool EnvelopePyramid::writePage(int levelIndex)
+{
+    Level* level = m_levels[levelIndex];
+    const int numBins = level->pageFill;
+    level->pageFill = 0;
+
+    if (!m_file)
+        return false;
+
+    const uint32 header[2] = { uint32(levelIndex), uint32(numBins) };
+    const uint64 firstBin = uint64(level->binsCompleted - numBins);
+    memcpy(level->page.getData(), header, sizeof(header));
+    memcpy(level->page.getData() + 4, &firstBin, sizeof(firstBin));
+
+    return m_file->write(level->page.getData(), (PAGE_HEADER_VALUES + size_t(m_numChannels) * m_valuesPerBin * PAGE_BINS) * sizeof(int16));
+}
+
+void EnvelopePyramid::close()
+{
+    if (!m_file)
+        return;
+
+    /* Partial bins go up the pyramid in order, so each level's last bin includes the ones below */
+    for (int i = 0; i < m_levels.size(); i++)
+    {
+        if (m_levels[i]->samples > 0)
+            completeBin(i);
+    }
+
+    for (int i = 0; i < m_levels.size(); i++)
+    {
+        if (m_levels[i]->pageFill > 0)
+            writePage(i);
+    }
+
+    m_file->close();
+    m_file.reset();
+}
@@ -0,0 +1,131 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef ENVELOPEPYRAMID_H_DEFINED
+#define ENVELOPEPYRAMID_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include "BlockFileSink.h"
+#include "InterleavedBlockFile.h"
+
+/**
+    Writes the min/max (and optionally RMS) envelope of every channel of an interleaved
+    int16 stream at several decimation levels, for drawing long spans without reading
+    the data file.
+
+    Each level summarises bins of getFactor(level) samples, and every factor is a multiple
+    of the one before, so only the finest level looks at the samples: a completed bin is
+    merged into the next level up. The per-sample work is a min, a max and a multiply-add
+    per channel, in loops over the channels of a frame that the compiler vectorises.
+
+    The file starts with a header,
+
+        char magic[4] = "PENV", uint32 version, numChannels, numLevels, flags, pageBins,
+        uint32 factors[numLevels]
+
+    followed by fixed-size pages, each holding pageBins bins of one level as they complete,
+
+        uint32 level, uint32 numBins, uint64 firstBin,
+        then for each channel: int16 min[pageBins], int16 max[pageBins], and if flags & HAS_RMS,
+        int16 rms[pageBins]
+
+    in the raw units of the data file. Only the last page of each level has fewer than pageBins
+    bins, and the last bin of each level may cover fewer samples than its factor.
+*/
+class TESTABLE EnvelopePyramid : public InterleavedBlockFile::Listener
+{
+public:
+
+    enum Flags
+    {
+        HAS_RMS = 1
+    };
+
+    /** Constructor. factors must increase, each a multiple of the previous one. */
+    EnvelopePyramid(int numChannels, bool withRms, const Array<int>& factors = getDefaultFactors());
+
+    /** Destructor. Calls close(). */
+    ~EnvelopePyramid();
+
+    /** Creates the file and writes its header */
+    bool openFile(String filename);
+
+    /** Adds nFrames interleaved frames of numChannels samples */
+    void addFrames(const int16* frames, int nFrames);
+
+    /** Adds the blocks of the data file this envelope belongs to */
+    void blockWritten(uint64 firstSample, const int16* frames, int nFrames) override;
+
+    /** Writes the partially filled bins and pages and closes the file */
+    void close();
+
+    int getNumChannels() const { return m_numChannels; }
+
+    int getNumLevels() const { return m_levels.size(); }
+
+    int getFactor(int level) const { return m_levels[level]->factor; }
+
+    /** Bins of a level completed so far */
+    int64 getNumBins(int level) const { return m_levels[level]->binsCompleted; }
+
+    /** 64x, 1024x and 16384x */
+    static Array<int> getDefaultFactors();
+
+    static const uint32 VERSION = 1;
+    static const int PAGE_BINS = 256;
+
+private:
+
+    struct Level
+    {
+        int factor;
+
+        /* The bin being filled: per channel extremes and sum of squares, and its sample count */
+        HeapBlock<int16> mins;
+        HeapBlock<int16> maxs;
+        HeapBlock<float> sumSquares;
+        int samples;
+
+        /* Channel-major page being filled */
+        HeapBlock<int16> page;
+        int pageFill;
+        int64 binsCompleted;
+    };
+
+    void resetBin(Level* level);
+    void completeBin(int levelIndex);
+    bool writePage(int levelIndex);
+
+    const int m_numChannels;
+    const bool m_withRms;
+    const int m_valuesPerBin;
+    OwnedArray<Level> m_levels;
+
+    std::unique_ptr<BlockFileSink> m_file;
+
+    JUCE_DECLARE_NON_COPYABLE(EnvelopePyramid);
+};
+
+#endif
@@ -0,0 +1,143 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "EnvelopeReader.h"
+#include "EnvelopePyramid.h"
+
+EnvelopeReader::EnvelopeReader()
+{
+}
+
+EnvelopeReader::~EnvelopeReader()
+{
+    close();
+}
+
+bool EnvelopeReader::open(const File& file)
+{
+    close();
+
+    std::unique_ptr<MemoryMappedFile> mapped(new MemoryMappedFile(file, MemoryMappedFile::readOnly));
+    const char* data = static_cast<const char*>(mapped->getData());
+    const size_t size = mapped->getSize();
+
+    uint32 header[6];
+    if (data == nullptr || size < sizeof(header))
+        return false;
+
+    memcpy(header, data, sizeof(header));
+    if (memcmp(data, "PENV", 4) != 0 || header[1] != EnvelopePyramid::VERSION || header[2] == 0 || header[5] == 0)
+    {
+        std::cerr << "[Persyst] Not an envelope file: " << file.getFullPathName() << std::endl;
+        return false;
+    }
+
+    m_numChannels = int(header[2]);
+    m_valuesPerBin = (header[4] & EnvelopePyramid::HAS_RMS) ? 3 : 2;
+    m_pageBins = int(header[5]);
+
+    const int numLevels = int(header[3]);
+    size_t offset = sizeof(header) + numLevels * sizeof(uint32);
+    if (offset > size)
+        return false;
+
+    for (int i = 0; i < numLevels; i++)
+    {
+        uint32 factor;
+        memcpy(&factor, data + sizeof(header) + i * sizeof(uint32), sizeof(factor));
+        Level* level = m_levels.add(new Level());
+        level->factor = int(factor);
+        level->numBins = 0;
+    }
+
+    /* Pages of a level are in bin order, and all but the last one are full */
+    const size_t pageHeaderSize = 2 * sizeof(uint32) + sizeof(uint64);
+    const size_t pageSize = pageHeaderSize + size_t(m_numChannels) * m_valuesPerBin * m_pageBins * sizeof(int16);
+    for (; offset + pageSize <= size; offset += pageSize)
+    {
+        uint32 pageHeader[2];
+        uint64 firstBin;
+        memcpy(pageHeader, data + offset, sizeof(pageHeader));
+        memcpy(&firstBin, data + offset + sizeof(pageHeader), sizeof(firstBin));
+
+        Level* level = m_levels[int(pageHeader[0])];
+        if (level == nullptr || firstBin != uint64(level->pages.size()) * m_pageBins || int(pageHeader[1]) > m_pageBins)
+        {
+            std::cerr << "[Persyst] Envelope file " << file.getFullPathName() << " has an unexpected page at " << (int64)offset << std::endl;
+            break;
+        }
+
+        level->pages.add(reinterpret_cast<const int16*>(data + offset + pageHeaderSize));
+        level->numBins = int64(firstBin) + pageHeader[1];
+    }
+
+    m_file = std::move(mapped);
+    return true;
+}
+
+void EnvelopeReader::close()
+{
+    m_levels.clear();
+    m_file.reset();
+    m_numChannels = 0;
+}
+
+int EnvelopeReader::getLevelFor(double maxSamplesPerBin) const
+{
+    for (int i = m_levels.size() - 1; i >= 0; i--)
+    {
+        if (m_levels[i]->factor <= maxSamplesPerBin)
+            return i;
+    }
+    return -1;
+}
+
+int EnvelopeReader::readBins(int level, int channel, int64 firstBin, int numBins, int16* mins, int16* maxs, int16* rms) const
+{
+    if (!isOpen() || level < 0 || level >= m_levels.size() || channel < 0 || channel >= m_numChannels
+        || firstBin < 0 || numBins < 0 || (rms != nullptr && !hasRms()))
+        return -1;
+
+    const Level* lvl = m_levels[level];
+    numBins = int(jmin(int64(numBins), jmax(int64(0), lvl->numBins - firstBin)));
+
+    int read = 0;
+    while (read < numBins)
+    {
+        const int64 bin = firstBin + read;
+        const int offset = int(bin % m_pageBins);
+        const int count = jmin(m_pageBins - offset, numBins - read);
+        const int16* values = lvl->pages[int(bin / m_pageBins)] + size_t(channel) * m_valuesPerBin * m_pageBins + offset;
+
+        if (mins != nullptr)
+            memcpy(mins + read, values, count * sizeof(int16));
+        if (maxs != nullptr)
+            memcpy(maxs + read, values + m_pageBins, count * sizeof(int16));
+        if (rms != nullptr)
+            memcpy(rms + read, values + 2 * m_pageBins, count * sizeof(int16));
+        read += count;
+    }
+
+    return read;
+}
@@ -0,0 +1,93 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef ENVELOPEREADER_H_DEFINED
+#define ENVELOPEREADER_H_DEFINED
+
+#include <RecordingLib.h>
+
+/**
+    Reads an envelope file written by EnvelopePyramid.
+
+    The file is memory mapped and its pages are indexed once on open, after which any
+    run of bins of one channel is read from the mapped pages without copying the rest.
+*/
+class TESTABLE EnvelopeReader
+{
+public:
+
+    /** Constructor */
+    EnvelopeReader();
+
+    /** Destructor */
+    ~EnvelopeReader();
+
+    /** Maps the file and indexes its pages. Returns false if it is not an envelope file. */
+    bool open(const File& file);
+
+    /** Unmaps the file */
+    void close();
+
+    bool isOpen() const { return m_file != nullptr; }
+
+    int getNumChannels() const { return m_numChannels; }
+
+    int getNumLevels() const { return m_levels.size(); }
+
+    int getFactor(int level) const { return m_levels[level]->factor; }
+
+    bool hasRms() const { return m_valuesPerBin == 3; }
+
+    /** Number of bins of a level in the file */
+    int64 getNumBins(int level) const { return m_levels[level]->numBins; }
+
+    /** Coarsest level whose bins have at most maxSamplesPerBin samples, or -1 if there is none */
+    int getLevelFor(double maxSamplesPerBin) const;
+
+    /** Reads numBins bins of a channel at a level, starting at firstBin, in the raw units of the
+        data file. Any of the outputs may be nullptr; rms must be if !hasRms(). Stops at the
+        last bin and returns the number read, or -1 if the arguments are out of range. */
+    int readBins(int level, int channel, int64 firstBin, int numBins, int16* mins, int16* maxs, int16* rms) const;
+
+private:
+
+    struct Level
+    {
+        int factor;
+        int64 numBins;
+
+        /* Start of the bin data of each page, in bin order */
+        Array<const int16*> pages;
+    };
+
+    std::unique_ptr<MemoryMappedFile> m_file;
+    int m_numChannels{ 0 };
+    int m_valuesPerBin{ 2 };
+    int m_pageBins{ 0 };
+    OwnedArray<Level> m_levels;
+
+    JUCE_DECLARE_NON_COPYABLE(EnvelopeReader);
+};
+
+#endif
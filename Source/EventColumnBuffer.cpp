@@ -0,0 +1,51 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "EventColumnBuffer.h"
+
+EventColumnBuffer::EventColumnBuffer(int capacity) :
+    m_capacity(jmax(1, capacity)),
+    m_numRecords(0)
+{
+}
+
+int EventColumnBuffer::addColumn(size_t recordSize)
+{
+    Column* column = m_columns.add(new Column());
+    column->recordSize = recordSize;
+    column->data.malloc(recordSize * m_capacity);
+    return m_columns.size() - 1;
+}
+
+void EventColumnBuffer::setValue(int column, const void* data)
+{
+    const Column* c = m_columns[column];
+    memcpy(c->data + c->recordSize * m_numRecords, data, c->recordSize);
+}
+
+bool EventColumnBuffer::commitRecord()
+{
+    jassert(m_numRecords < m_capacity);
+    m_numRecords++;
+    return isFull();
+}
@@ -0,0 +1,80 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef EVENTCOLUMNBUFFER_H_DEFINED
+#define EVENTCOLUMNBUFFER_H_DEFINED
+
+#include <RecordingLib.h>
+
+/**
+    Accumulates events in struct-of-arrays form, one contiguous column per output file.
+
+    Each column holds fixed-size records. A record is filled in with setValue() on
+    every column and committed with commitRecord(); once isFull() the owner writes
+    every column out in a single write each and calls clear().
+*/
+class TESTABLE EventColumnBuffer
+{
+public:
+
+    /** Constructor. Each column holds up to capacity records. */
+    explicit EventColumnBuffer(int capacity);
+
+    /** Adds a column of records of recordSize bytes and returns its index */
+    int addColumn(size_t recordSize);
+
+    /** Copies the value of the current record for a column */
+    void setValue(int column, const void* data);
+
+    /** Completes the current record. Returns true if the buffer is now full. */
+    bool commitRecord();
+
+    bool isFull() const { return m_numRecords >= m_capacity; }
+
+    /** Number of committed records */
+    int getNumRecords() const { return m_numRecords; }
+
+    /** Committed records of a column, getNumRecords() * record size bytes */
+    const void* getColumnData(int column) const { return m_columns[column]->data.getData(); }
+
+    size_t getColumnBytes(int column) const { return m_columns[column]->recordSize * m_numRecords; }
+
+    /** Discards all committed records */
+    void clear() { m_numRecords = 0; }
+
+private:
+
+    struct Column
+    {
+        HeapBlock<uint8> data;
+        size_t recordSize;
+    };
+
+    OwnedArray<Column> m_columns;
+    const int m_capacity;
+    int m_numRecords;
+
+    JUCE_DECLARE_NON_COPYABLE(EventColumnBuffer);
+};
+
+#endif
@@ -0,0 +1,77 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "EventPacketView.h"
+
+/* Offsets within the serialized event */
+#define EVENT_TYPE_OFFSET 1
+#define SAMPLE_NUMBER_OFFSET 8
+#define TIMESTAMP_OFFSET 16
+#define TTL_LINE_OFFSET 24
+#define TTL_STATE_OFFSET 25
+#define TTL_WORD_OFFSET 26
+#define TEXT_OFFSET 24
+
+EventPacketView::EventPacketView() :
+    kind(UNKNOWN),
+    sampleNumber(0),
+    timestamp(0),
+    line(0),
+    state(false),
+    word(0),
+    text(nullptr)
+{
+}
+
+bool EventPacketView::decode(const uint8* data, size_t size, uint8 ttlType, uint8 textType, size_t textSize)
+{
+    kind = UNKNOWN;
+
+    if (size < HEADER_SIZE)
+        return false;
+
+    const uint8 type = data[EVENT_TYPE_OFFSET];
+
+    if (type == ttlType && size >= TTL_SIZE)
+    {
+        kind = TTL;
+        line = data[TTL_LINE_OFFSET];
+        state = data[TTL_STATE_OFFSET] != 0;
+        memcpy(&word, data + TTL_WORD_OFFSET, sizeof(uint64));
+        text = nullptr;
+    }
+    else if (type == textType && size >= HEADER_SIZE + textSize)
+    {
+        kind = TEXT;
+        text = reinterpret_cast<const char*>(data + TEXT_OFFSET);
+    }
+    else
+    {
+        return false;
+    }
+
+    /* The packet has no alignment guarantees, so copy rather than cast */
+    memcpy(&sampleNumber, data + SAMPLE_NUMBER_OFFSET, sizeof(int64));
+    memcpy(&timestamp, data + TIMESTAMP_OFFSET, sizeof(double));
+    return true;
+}
@@ -0,0 +1,72 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef EVENTPACKETVIEW_H_DEFINED
+#define EVENTPACKETVIEW_H_DEFINED
+
+#include <RecordingLib.h>
+
+/**
+    Reads a serialized TTL or TEXT event in place, without deserializing it into an Event.
+
+    The packet layout is the one written by Event::serialize: a 24-byte header (base
+    type, event type, processor id, stream id, channel index, sample number and
+    timestamp in seconds), followed by the line, state and word of a TTL event or
+    the characters of a TEXT event. The view only points into the packet, so it is
+    valid as long as the packet is.
+*/
+class TESTABLE EventPacketView
+{
+public:
+
+    enum Kind
+    {
+        UNKNOWN = 0,
+        TTL,
+        TEXT
+    };
+
+    EventPacketView();
+
+    /** Decodes a packet. ttlType and textType are the EventChannel::Type values of the two
+        event types; textSize is the number of characters a TEXT event carries.
+        Returns false, leaving the view UNKNOWN, for any other type or a short packet. */
+    bool decode(const uint8* data, size_t size, uint8 ttlType, uint8 textType, size_t textSize);
+
+    Kind kind;
+    int64 sampleNumber;
+    double timestamp;
+
+    /* TTL events */
+    uint8 line;
+    bool state;
+    uint64 word;
+
+    /* TEXT events */
+    const char* text;
+
+    static const size_t HEADER_SIZE = 24;
+    static const size_t TTL_SIZE = HEADER_SIZE + 10;
+};
+
+#endif
@@ -0,0 +1,241 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "InterleavedBlockFile.h"
+#include "SampleConversion.h"
+
+InterleavedBlockFile::InterleavedBlockFile(int nChannels, int samplesPerBlock, BlockFileSink::Type sinkType) :
+    m_sinkType(sinkType),
+    m_nChannels(nChannels),
+    m_samplesPerBlock(samplesPerBlock),
+    m_blockSize(nChannels * samplesPerBlock),
+    m_kernels(SampleConversion::getChannelKernels(nChannels)),
+    m_firstBlockStart(0),
+    m_lastSample(0),
+    m_stats(nullptr)
+{
+}
+
+InterleavedBlockFile::~InterleavedBlockFile()
+{
+    if (!m_file)
+        return;
+
+    /* Write out everything that is still pending, trimming the last block to the data received */
+    for (int i = 0; i < m_pendingBlocks.size(); i++)
+    {
+        uint64 blockStart = m_firstBlockStart + uint64(i) * m_samplesPerBlock;
+        if (blockStart >= m_lastSample)
+            break;
+
+        int nFrames = (int)jmin(uint64(m_samplesPerBlock), m_lastSample - blockStart);
+        writeBlock(m_pendingBlocks[i], blockStart, nFrames);
+    }
+
+    m_file->close();
+}
+
+bool InterleavedBlockFile::openFile(String filename)
+{
+    m_file = BlockFileSink::create(m_sinkType);
+
+    if (!m_file->open(filename))
+    {
+        m_file.reset();
+        return false;
+    }
+
+    return true;
+}
+
+bool InterleavedBlockFile::writeChannel(uint64 startPos, int channel, const int16* data, int nSamples)
+{
+    if (!m_file || startPos < m_firstBlockStart)
+    {
+        jassertfalse;
+        return false;
+    }
+
+    const int64 start = m_stats != nullptr ? RecordStreamStats::now() : 0;
+    uint64 pos = startPos;
+    int written = 0;
+
+    while (written < nSamples)
+    {
+        int blockIndex = int((pos - m_firstBlockStart) / m_samplesPerBlock);
+        int offset = int((pos - m_firstBlockStart) % m_samplesPerBlock);
+        int count = jmin(m_samplesPerBlock - offset, nSamples - written);
+
+        int16* dest = getBlock(blockIndex)->data.getData() + offset * m_nChannels + channel;
+        m_kernels.scatter(data + written, dest, m_nChannels, count);
+
+        written += count;
+        pos += count;
+    }
+
+    if (m_stats != nullptr)
+        m_stats->getHistogram(RecordStreamStats::INTERLEAVE).record(RecordStreamStats::nanosecondsSince(start));
+
+    channelsReached(startPos, startPos + nSamples, 1);
+    return true;
+}
+
+bool InterleavedBlockFile::writeChannel(uint64 startPos, int channel, const float* data, float scale, int nSamples,
+                                        SampleConversion::ClipStats* stats)
+{
+    if (!m_file || startPos < m_firstBlockStart)
+    {
+        jassertfalse;
+        return false;
+    }
+
+    const int64 start = m_stats != nullptr ? RecordStreamStats::now() : 0;
+    uint64 pos = startPos;
+    int written = 0;
+
+    while (written < nSamples)
+    {
+        int blockIndex = int((pos - m_firstBlockStart) / m_samplesPerBlock);
+        int offset = int((pos - m_firstBlockStart) % m_samplesPerBlock);
+        int count = jmin(m_samplesPerBlock - offset, nSamples - written);
+
+        int16* dest = getBlock(blockIndex)->data.getData() + offset * m_nChannels + channel;
+        m_kernels.convertScatter(data + written, dest, m_nChannels, scale, count, stats);
+
+        written += count;
+        pos += count;
+    }
+
+    /* Conversion and placement are one pass here, so they are timed together as the conversion */
+    if (m_stats != nullptr)
+        m_stats->getHistogram(RecordStreamStats::CONVERSION).record(RecordStreamStats::nanosecondsSince(start));
+
+    channelsReached(startPos, startPos + nSamples, 1);
+    return true;
+}
+
+bool InterleavedBlockFile::writeChannels(uint64 startPos, const int16* data, int channelStride, int nSamples)
+{
+    if (!m_file || startPos < m_firstBlockStart)
+    {
+        jassertfalse;
+        return false;
+    }
+
+    const int64 start = m_stats != nullptr ? RecordStreamStats::now() : 0;
+    uint64 pos = startPos;
+    int written = 0;
+
+    while (written < nSamples)
+    {
+        int blockIndex = int((pos - m_firstBlockStart) / m_samplesPerBlock);
+        int offset = int((pos - m_firstBlockStart) % m_samplesPerBlock);
+        int count = jmin(m_samplesPerBlock - offset, nSamples - written);
+
+        int16* dest = getBlock(blockIndex)->data.getData() + offset * m_nChannels;
+        m_kernels.interleave(data + written, channelStride, dest, m_nChannels, count);
+
+        written += count;
+        pos += count;
+    }
+
+    if (m_stats != nullptr)
+        m_stats->getHistogram(RecordStreamStats::INTERLEAVE).record(RecordStreamStats::nanosecondsSince(start));
+
+    channelsReached(startPos, startPos + nSamples, m_nChannels);
+    return true;
+}
+
+InterleavedBlockFile::Block* InterleavedBlockFile::getBlock(int blockIndex)
+{
+    while (m_pendingBlocks.size() <= blockIndex)
+    {
+        Block* block;
+        if (m_freeBlocks.size() > 0)
+        {
+            block = m_freeBlocks.removeAndReturn(m_freeBlocks.size() - 1);
+        }
+        else
+        {
+            block = new Block();
+            block->data.malloc(m_blockSize);
+        }
+        block->data.clear(m_blockSize);
+        block->channelsFilled = 0;
+        m_pendingBlocks.add(block);
+    }
+    return m_pendingBlocks[blockIndex];
+}
+
+void InterleavedBlockFile::channelsReached(uint64 startPos, uint64 endPos, int nChannels)
+{
+    /* Count the channels that completed each block this write ended in or went past */
+    int blockIndex = int((startPos - m_firstBlockStart) / m_samplesPerBlock);
+    while (m_firstBlockStart + uint64(blockIndex + 1) * m_samplesPerBlock <= endPos)
+    {
+        m_pendingBlocks[blockIndex]->channelsFilled += nChannels;
+        blockIndex++;
+    }
+
+    m_lastSample = jmax(m_lastSample, endPos);
+
+    flushCompleteBlocks();
+}
+
+int64 InterleavedBlockFile::flush()
+{
+    if (!m_file)
+        return 0;
+
+    return int64(m_file->flush() / (uint64(m_nChannels) * sizeof(int16)));
+}
+
+void InterleavedBlockFile::flushCompleteBlocks()
+{
+    while (m_pendingBlocks.size() > 0 && m_pendingBlocks[0]->channelsFilled >= m_nChannels)
+    {
+        writeBlock(m_pendingBlocks[0], m_firstBlockStart, m_samplesPerBlock);
+        m_freeBlocks.add(m_pendingBlocks.removeAndReturn(0));
+        m_firstBlockStart += m_samplesPerBlock;
+    }
+}
+
+bool InterleavedBlockFile::writeBlock(const Block* block, uint64 blockStart, int nFrames)
+{
+    bool written;
+    if (m_stats == nullptr)
+    {
+        written = m_file->write(block->data.getData(), size_t(nFrames) * m_nChannels * sizeof(int16));
+    }
+    else
+    {
+        ScopedLatency timer(&m_stats->getHistogram(RecordStreamStats::DAT_WRITE));
+        m_stats->addBlock();
+        written = m_file->write(block->data.getData(), size_t(nFrames) * m_nChannels * sizeof(int16));
+    }
+
+    for (auto listener : m_listeners)
+        listener->blockWritten(blockStart, block->data.getData(), nFrames);
+
+    return written;
+}
@@ -0,0 +1,131 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef INTERLEAVEDBLOCKFILE_H_DEFINED
+#define INTERLEAVEDBLOCKFILE_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include "BlockFileSink.h"
+#include "RecordStats.h"
+#include "SampleConversion.h"
+
+/**
+    Channel-interleaved int16 data file, written in blocks of samplesPerBlock frames.
+
+    Produces the same file as the GUI's SequentialBlockFile, but in addition to the
+    per-channel writeChannel() it accepts whole-stream writes that are transposed
+    into the interleaved blocks in one pass.
+
+    A block is written to disk once every channel has filled it. On destruction the
+    last, partially filled block is written up to the furthest sample received.
+*/
+class TESTABLE InterleavedBlockFile
+{
+public:
+
+    /** Sees every block as it is written, in file order, on the thread that writes it */
+    class Listener
+    {
+    public:
+        virtual ~Listener() {}
+
+        /** nFrames interleaved frames, starting at sample firstSample of the file, were just written */
+        virtual void blockWritten(uint64 firstSample, const int16* frames, int nFrames) = 0;
+    };
+
+    /** Constructor. Completed blocks are written through a sink of the given type. */
+    InterleavedBlockFile(int nChannels, int samplesPerBlock, BlockFileSink::Type sinkType = BlockFileSink::BUFFERED);
+
+    /** Destructor */
+    ~InterleavedBlockFile();
+
+    /** Creates the file (and any missing parent folders) */
+    bool openFile(String filename);
+
+    /** Writes nSamples of a single channel, starting at sample startPos */
+    bool writeChannel(uint64 startPos, int channel, const int16* data, int nSamples);
+
+    /** Converts nSamples floats of a single channel to int16, exactly like
+        SampleConversion::floatToInt16, straight into their slots in the interleaved blocks.
+        If stats is not nullptr, the converted samples are added to it. */
+    bool writeChannel(uint64 startPos, int channel, const float* data, float scale, int nSamples,
+                      SampleConversion::ClipStats* stats = nullptr);
+
+    /** Writes nSamples of every channel, starting at sample startPos.
+        Channel c starts at data + c * channelStride. */
+    bool writeChannels(uint64 startPos, const int16* data, int channelStride, int nSamples);
+
+    /** Hands the blocks written so far to the operating system, as far as the sink can without
+        waiting, and returns how many samples at the start of the file are complete. Blocks still
+        waiting for some channels are not included. */
+    int64 flush();
+
+    /** Handle through which another thread can sync the file; see BlockFileSink::getSyncHandle() */
+    FileSyncHandle::Ptr getSyncHandle() const { return m_file ? m_file->getSyncHandle() : nullptr; }
+
+    /** Returns the number of interleaved channels */
+    int getNumChannels() const { return m_nChannels; }
+
+    /** Times the interleaving and the block writes into the stream's histograms. Pass nullptr to stop. */
+    void setStats(RecordStreamStats* stats) { m_stats = stats; }
+
+    /** Adds a listener for the written blocks. It must outlive this file, whose destructor writes the last block. */
+    void addListener(Listener* listener) { m_listeners.add(listener); }
+
+private:
+
+    struct Block
+    {
+        HeapBlock<int16> data;
+        int channelsFilled;
+    };
+
+    Block* getBlock(int blockIndex);
+    void channelsReached(uint64 startPos, uint64 endPos, int nChannels);
+    void flushCompleteBlocks();
+    bool writeBlock(const Block* block, uint64 blockStart, int nFrames);
+
+    const BlockFileSink::Type m_sinkType;
+    std::unique_ptr<BlockFileSink> m_file;
+
+    const int m_nChannels;
+    const int m_samplesPerBlock;
+    const int m_blockSize;
+
+    /* Interleaving kernels for this channel count */
+    const SampleConversion::ChannelKernels m_kernels;
+
+    /* Blocks waiting for all channels, oldest first; m_pendingBlocks[0] starts at m_firstBlockStart */
+    OwnedArray<Block> m_pendingBlocks;
+    OwnedArray<Block> m_freeBlocks;
+    uint64 m_firstBlockStart;
+    uint64 m_lastSample;
+
+    RecordStreamStats* m_stats;
+    Array<Listener*> m_listeners;
+
+    JUCE_DECLARE_NON_COPYABLE(InterleavedBlockFile);
+};
+
+#endif
@@ -0,0 +1,263 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "LiveTap.h"
+
+const char LiveTap::MAGIC[8] = { 'P', 'S', 'Y', 'T', 'A', 'P', 0, 0 };
+
+LiveTap::LiveTap(int numChannels, double sampleRate, double bitVolts, int capacityFrames, int timesCapacity) :
+    m_numChannels(numChannels),
+    m_sampleRate(sampleRate),
+    m_bitVolts(bitVolts),
+    m_capacityFrames(jmax(1, capacityFrames)),
+    m_timesCapacity(jmax(1, timesCapacity))
+{
+}
+
+LiveTap::~LiveTap()
+{
+    close();
+}
+
+String LiveTap::getNameFor(const String& streamName)
+{
+    String name = "/persyst_";
+    for (const char* p = streamName.toRawUTF8(); *p != 0; p++)
+    {
+        const char c = *p;
+        const bool keep = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_';
+        name += String::charToString(keep ? c : '_');
+    }
+
+#if JUCE_MAC
+    /* macOS limits shared memory names to 31 characters */
+    name = name.substring(0, 31);
+#endif
+    return name;
+}
+
+void LiveTap::beginWrite()
+{
+    m_header->sequence.store(++m_sequence, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void LiveTap::endWrite()
+{
+    m_header->sequence.store(++m_sequence, std::memory_order_release);
+}
+
+void LiveTap::blockWritten(uint64 firstSample, const int16* frames, int nFrames)
+{
+    if (m_header == nullptr || nFrames <= 0)
+        return;
+
+    /* Blocks arrive in file order and segments follow each other without gaps */
+    const uint64 start = uint64(m_segmentStart) + firstSample;
+    jassert(start == m_framesWritten);
+    const uint64 end = start + uint64(nFrames);
+
+    /* Only the last capacityFrames frames of an oversized block would survive */
+    const int skip = jmax(0, nFrames - m_capacityFrames);
+
+    beginWrite();
+    m_header->framesWriting.store(end, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint64 frame = start + uint64(skip);
+    const int16* source = frames + size_t(skip) * m_numChannels;
+    while (frame < end)
+    {
+        const int slot = int(frame % uint64(m_capacityFrames));
+        const int count = int(jmin(uint64(m_capacityFrames - slot), end - frame));
+        memcpy(m_frames + size_t(slot) * m_numChannels, source, size_t(count) * m_numChannels * sizeof(int16));
+        source += size_t(count) * m_numChannels;
+        frame += uint64(count);
+    }
+
+    m_framesWritten = end;
+    m_header->framesWritten.store(end, std::memory_order_relaxed);
+    endWrite();
+}
+
+void LiveTap::addSampleTime(int64 sample, double time)
+{
+    if (m_header == nullptr)
+        return;
+
+    const uint64 end = m_timesWritten + 1;
+
+    beginWrite();
+    m_header->timesWriting.store(end, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    SampleTime& entry = m_times[m_timesWritten % uint64(m_timesCapacity)];
+    entry.sample = sample;
+    entry.time = time;
+
+    m_timesWritten = end;
+    m_header->timesWritten.store(end, std::memory_order_relaxed);
+    endWrite();
+}
+
+#if JUCE_LINUX || JUCE_MAC
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+bool LiveTap::isAvailable()
+{
+    return true;
+}
+
+bool LiveTap::open(const String& name, const String& streamName, const Array<String>& channelNames)
+{
+    close();
+
+    String channelMap;
+    for (const String& channelName : channelNames)
+        channelMap += channelName + "\n";
+
+    /* Channel names need not be ASCII: lay out and copy the UTF-8 bytes, not the characters */
+    const size_t channelMapBytes = channelMap.getNumBytesAsUTF8();
+
+    const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+    const auto roundUp = [pageSize](size_t bytes) { return (bytes + pageSize - 1) / pageSize * pageSize; };
+
+    const size_t channelMapOffset = roundUp(sizeof(Header));
+    const size_t timesOffset = roundUp(channelMapOffset + channelMapBytes);
+    const size_t framesOffset = roundUp(timesOffset + size_t(m_timesCapacity) * sizeof(SampleTime));
+    const size_t totalSize = framesOffset + size_t(m_capacityFrames) * m_numChannels * sizeof(int16);
+
+    /* Readers of an earlier object keep their mapping; new readers only ever see this one */
+    shm_unlink(name.toRawUTF8());
+    const int fd = shm_open(name.toRawUTF8(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+    {
+        std::cerr << "[Persyst] Could not create live tap " << name << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    if (ftruncate(fd, off_t(totalSize)) != 0)
+    {
+        std::cerr << "[Persyst] Could not size live tap " << name << ": " << strerror(errno) << std::endl;
+        ::close(fd);
+        shm_unlink(name.toRawUTF8());
+        return false;
+    }
+
+    /* Fault the pages in now rather than on the writer's first pass through the ring */
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;
+#endif
+    void* mapping = mmap(nullptr, totalSize, PROT_READ | PROT_WRITE, flags, fd, 0);
+    ::close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "[Persyst] Could not map live tap " << name << ": " << strerror(errno) << std::endl;
+        shm_unlink(name.toRawUTF8());
+        return false;
+    }
+
+    m_name = name;
+    m_mapping = mapping;
+    m_mappingSize = totalSize;
+
+    char* base = static_cast<char*>(mapping);
+    m_header = new (base) Header();
+    m_header->version = VERSION;
+    m_header->numChannels = uint32(m_numChannels);
+    m_header->capacityFrames = uint32(m_capacityFrames);
+    m_header->timesCapacity = uint32(m_timesCapacity);
+    m_header->framesOffset = framesOffset;
+    m_header->timesOffset = timesOffset;
+    m_header->channelMapOffset = channelMapOffset;
+    m_header->channelMapBytes = uint32(channelMapBytes);
+    m_header->reserved = 0;
+    m_header->sampleRate = m_sampleRate;
+    m_header->bitVolts = m_bitVolts;
+    memset(m_header->streamName, 0, sizeof(m_header->streamName));
+    strncpy(m_header->streamName, streamName.toRawUTF8(), sizeof(m_header->streamName) - 1);
+    m_header->sequence.store(0, std::memory_order_relaxed);
+    m_header->framesWritten.store(0, std::memory_order_relaxed);
+    m_header->timesWritten.store(0, std::memory_order_relaxed);
+    m_header->state.store(0, std::memory_order_relaxed);
+    m_header->framesWriting.store(0, std::memory_order_relaxed);
+    m_header->timesWriting.store(0, std::memory_order_relaxed);
+    memcpy(base + channelMapOffset, channelMap.toRawUTF8(), channelMapBytes);
+
+    m_frames = reinterpret_cast<int16*>(base + framesOffset);
+    m_times = reinterpret_cast<SampleTime*>(base + timesOffset);
+    m_segmentStart = 0;
+    m_sequence = 0;
+    m_framesWritten = 0;
+    m_timesWritten = 0;
+
+    /* Readers wait for the state, so they never see a half-initialised header */
+    memcpy(m_header->magic, MAGIC, sizeof(MAGIC));
+    m_header->state.store(RECORDING, std::memory_order_release);
+    return true;
+}
+
+void LiveTap::close()
+{
+    if (m_header == nullptr)
+        return;
+
+    beginWrite();
+    m_header->state.store(STOPPED, std::memory_order_relaxed);
+    endWrite();
+
+    munmap(m_mapping, m_mappingSize);
+    shm_unlink(m_name.toRawUTF8());
+
+    m_header = nullptr;
+    m_mapping = nullptr;
+    m_frames = nullptr;
+    m_times = nullptr;
+}
+
+#else
+
+bool LiveTap::isAvailable()
+{
+    return false;
+}
+
+bool LiveTap::open(const String& name, const String& streamName, const Array<String>& channelNames)
+{
+    std::cerr << "[Persyst] Live taps need POSIX shared memory, not available on this platform" << std::endl;
+    return false;
+}
+
+void LiveTap::close()
+{
+}
+
+#endif
@@ -0,0 +1,161 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef LIVETAP_H_DEFINED
+#define LIVETAP_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include "InterleavedBlockFile.h"
+
+#include <atomic>
+
+/**
+    Publishes the int16 frames of one stream to a POSIX shared-memory ring, so that local
+    processes can follow a recording without reading recording.dat back from disk.
+
+    The shared memory object holds a Header, the stream's channel names (one per line, in
+    [ChannelMap] order), a ring of SampleTime anchors and a ring of interleaved frames. Frame n
+    of the stream (counted from the start of the recording, across segments) is stored at
+    slot n % capacityFrames; anchor n at slot n % timesCapacity.
+
+    There is a single writer, which never waits for readers. It bumps sequence to an odd
+    value, records how far it is about to write in framesWriting or timesWriting, copies the
+    data, advances framesWritten or timesWritten and bumps sequence back to even. Readers take
+    a consistent copy of the counters by retrying while sequence is odd or changes, and after
+    copying frames discard those that framesWriting shows may have been overwritten meanwhile.
+    LiveTapReader implements the reading side.
+
+    Only available where POSIX shared memory is; open() fails elsewhere.
+*/
+class TESTABLE LiveTap : public InterleavedBlockFile::Listener
+{
+public:
+
+    enum State
+    {
+        RECORDING = 1,
+        STOPPED = 2
+    };
+
+    struct SampleTime
+    {
+        int64 sample;
+        double time;
+    };
+
+    struct Header
+    {
+        char magic[8];
+        uint32 version;
+        uint32 numChannels;
+        uint32 capacityFrames;
+        uint32 timesCapacity;
+        uint64 framesOffset;
+        uint64 timesOffset;
+        uint64 channelMapOffset;
+        uint32 channelMapBytes;
+        uint32 reserved;
+        double sampleRate;
+        double bitVolts;
+        char streamName[128];
+
+        /* Written under the sequence lock */
+        alignas(64) std::atomic<uint64> sequence;
+        std::atomic<uint64> framesWritten;
+        std::atomic<uint64> timesWritten;
+        std::atomic<uint32> state;
+
+        /* Ends of the frames and anchors being written, set before the data is copied */
+        alignas(64) std::atomic<uint64> framesWriting;
+        std::atomic<uint64> timesWriting;
+    };
+
+    static_assert(std::atomic<uint64>::is_always_lock_free, "the shared header needs lock-free 64-bit atomics");
+
+    /** Constructor. The ring holds capacityFrames frames of numChannels samples. */
+    LiveTap(int numChannels, double sampleRate, double bitVolts, int capacityFrames, int timesCapacity = DEFAULT_TIMES_CAPACITY);
+
+    /** Destructor. Calls close(). */
+    ~LiveTap();
+
+    /** Creates the shared memory object, replacing any left over from an earlier recording */
+    bool open(const String& name, const String& streamName, const Array<String>& channelNames);
+
+    /** Marks the tap as stopped and removes the shared memory object. Readers that have it
+        open keep their mapping and can read what is left. */
+    void close();
+
+    /** Stream sample number of the first sample of the data file whose blocks come next */
+    void setSegmentStart(int64 firstSample) { m_segmentStart = firstSample; }
+
+    /** Publishes a block of nFrames interleaved frames */
+    void blockWritten(uint64 firstSample, const int16* frames, int nFrames) override;
+
+    /** Publishes the timestamp of a stream sample, like a [SampleTimes] row */
+    void addSampleTime(int64 sample, double time);
+
+    bool isOpen() const { return m_header != nullptr; }
+
+    const String& getName() const { return m_name; }
+
+    int getCapacity() const { return m_capacityFrames; }
+
+    /** Returns the shared memory name used for a stream */
+    static String getNameFor(const String& streamName);
+
+    /** Returns true on platforms with POSIX shared memory */
+    static bool isAvailable();
+
+    static const uint32 VERSION = 1;
+    static const int DEFAULT_TIMES_CAPACITY = 4096;
+    static const char MAGIC[8];
+
+private:
+
+    void beginWrite();
+    void endWrite();
+
+    const int m_numChannels;
+    const double m_sampleRate;
+    const double m_bitVolts;
+    const int m_capacityFrames;
+    const int m_timesCapacity;
+
+    String m_name;
+    Header* m_header{ nullptr };
+    void* m_mapping{ nullptr };
+    size_t m_mappingSize{ 0 };
+    int16* m_frames{ nullptr };
+    SampleTime* m_times{ nullptr };
+
+    int64 m_segmentStart{ 0 };
+    uint64 m_sequence{ 0 };
+    uint64 m_framesWritten{ 0 };
+    uint64 m_timesWritten{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(LiveTap);
+};
+
+#endif
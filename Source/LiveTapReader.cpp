@@ -0,0 +1,236 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "LiveTapReader.h"
+
+#include <thread>
+
+LiveTapReader::LiveTapReader()
+{
+}
+
+LiveTapReader::~LiveTapReader()
+{
+    close();
+}
+
+bool LiveTapReader::getStatus(Status& status) const
+{
+    if (m_header == nullptr)
+        return false;
+
+    for (int attempt = 0; attempt < 100000; attempt++)
+    {
+        const uint64 before = m_header->sequence.load(std::memory_order_acquire);
+        if ((before & 1) == 0)
+        {
+            status.framesWritten = int64(m_header->framesWritten.load(std::memory_order_relaxed));
+            status.timesWritten = int64(m_header->timesWritten.load(std::memory_order_relaxed));
+            status.stopped = m_header->state.load(std::memory_order_relaxed) == LiveTap::STOPPED;
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_header->sequence.load(std::memory_order_relaxed) == before)
+                return true;
+        }
+        std::this_thread::yield();
+    }
+    return false;
+}
+
+int LiveTapReader::read(int16* dest, int maxFrames, int64& firstSample)
+{
+    Status status;
+    if (!getStatus(status))
+        return 0;
+
+    const uint64 capacity = m_header->capacityFrames;
+    const uint64 written = uint64(status.framesWritten);
+    const uint64 oldest = written > capacity ? written - capacity : 0;
+    if (m_nextFrame < oldest)
+    {
+        m_framesLost += int64(oldest - m_nextFrame);
+        m_nextFrame = oldest;
+    }
+
+    const int numFrames = int(jmin(uint64(jmax(0, maxFrames)), written - m_nextFrame));
+    const size_t numChannels = m_header->numChannels;
+
+    uint64 frame = m_nextFrame;
+    int copied = 0;
+    while (copied < numFrames)
+    {
+        const uint64 slot = frame % capacity;
+        const int count = int(jmin(capacity - slot, uint64(numFrames - copied)));
+        memcpy(dest + copied * numChannels, m_frames + slot * numChannels, count * numChannels * sizeof(int16));
+        copied += count;
+        frame += uint64(count);
+    }
+
+    /* Frames the writer may have started overwriting while they were copied are dropped */
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64 writing = m_header->framesWriting.load(std::memory_order_relaxed);
+    const uint64 valid = writing > capacity ? writing - capacity : 0;
+    int overwritten = 0;
+    if (m_nextFrame < valid)
+    {
+        overwritten = int(jmin(uint64(numFrames), valid - m_nextFrame));
+        memmove(dest, dest + overwritten * numChannels, (numFrames - overwritten) * numChannels * sizeof(int16));
+        m_framesLost += overwritten;
+    }
+
+    firstSample = int64(m_nextFrame) + overwritten;
+    m_nextFrame += uint64(numFrames);
+    return numFrames - overwritten;
+}
+
+int LiveTapReader::readSampleTimes(LiveTap::SampleTime* dest, int maxTimes)
+{
+    Status status;
+    if (!getStatus(status))
+        return 0;
+
+    const uint64 capacity = m_header->timesCapacity;
+    const uint64 written = uint64(status.timesWritten);
+    if (m_nextTime + capacity < written)
+        m_nextTime = written - capacity;
+
+    const int numTimes = int(jmin(uint64(jmax(0, maxTimes)), written - m_nextTime));
+    for (int i = 0; i < numTimes; i++)
+        dest[i] = m_times[(m_nextTime + uint64(i)) % capacity];
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64 writing = m_header->timesWriting.load(std::memory_order_relaxed);
+    const uint64 valid = writing > capacity ? writing - capacity : 0;
+    int overwritten = 0;
+    if (m_nextTime < valid)
+    {
+        overwritten = int(jmin(uint64(numTimes), valid - m_nextTime));
+        memmove(dest, dest + overwritten, (numTimes - overwritten) * sizeof(LiveTap::SampleTime));
+    }
+
+    m_nextTime += uint64(numTimes);
+    return numTimes - overwritten;
+}
+
+void LiveTapReader::skipToLatest()
+{
+    Status status;
+    if (getStatus(status))
+    {
+        m_nextFrame = uint64(status.framesWritten);
+        m_nextTime = uint64(status.timesWritten);
+    }
+}
+
+#if JUCE_LINUX || JUCE_MAC
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool LiveTapReader::open(const String& name)
+{
+    close();
+
+    const int fd = shm_open(name.toRawUTF8(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(LiveTap::Header))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    m_mapping = mapping;
+    m_mappingSize = size_t(info.st_size);
+
+    const char* base = static_cast<const char*>(mapping);
+    const LiveTap::Header* header = reinterpret_cast<const LiveTap::Header*>(base);
+
+    /* The writer sets the state once the rest of the header is in place */
+    const bool ready = header->state.load(std::memory_order_acquire) != 0
+        && memcmp(header->magic, LiveTap::MAGIC, sizeof(LiveTap::MAGIC)) == 0
+        && header->version == LiveTap::VERSION
+        && header->numChannels > 0
+        && header->capacityFrames > 0
+        && header->timesCapacity > 0
+        && header->channelMapOffset + header->channelMapBytes <= m_mappingSize
+        && header->timesOffset + uint64(header->timesCapacity) * sizeof(LiveTap::SampleTime) <= m_mappingSize
+        && header->framesOffset + uint64(header->capacityFrames) * header->numChannels * sizeof(int16) <= m_mappingSize;
+
+    if (!ready)
+    {
+        close();
+        return false;
+    }
+
+    m_header = header;
+    m_frames = reinterpret_cast<const int16*>(base + header->framesOffset);
+    m_times = reinterpret_cast<const LiveTap::SampleTime*>(base + header->timesOffset);
+
+    m_channelNames.clear();
+    m_channelNames.addLines(String::fromUTF8(base + header->channelMapOffset, int(header->channelMapBytes)));
+    m_channelNames.removeEmptyStrings();
+
+    /* Start at the oldest frame and anchor still in the rings */
+    Status status;
+    getStatus(status);
+    m_nextFrame = uint64(jmax(int64(0), status.framesWritten - int64(header->capacityFrames)));
+    m_nextTime = uint64(jmax(int64(0), status.timesWritten - int64(header->timesCapacity)));
+    m_framesLost = 0;
+    return true;
+}
+
+void LiveTapReader::close()
+{
+    if (m_mapping != nullptr)
+        munmap(const_cast<void*>(m_mapping), m_mappingSize);
+
+    m_header = nullptr;
+    m_mapping = nullptr;
+    m_mappingSize = 0;
+    m_frames = nullptr;
+    m_times = nullptr;
+}
+
+#else
+
+bool LiveTapReader::open(const String& name)
+{
+    return false;
+}
+
+void LiveTapReader::close()
+{
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef LIVETAPREADER_H_DEFINED
+#define LIVETAPREADER_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include "LiveTap.h"
+
+/**
+    Follows a stream published by LiveTap from another process.
+
+    read() returns the frames in stream order, starting from the oldest frame still in the
+    ring when the reader was opened. A reader that falls more than the ring's capacity behind
+    skips ahead to the oldest frame still available and counts the frames it missed; the
+    writer never waits for it. Reading only maps the shared memory read-only.
+*/
+class TESTABLE LiveTapReader
+{
+public:
+
+    struct Status
+    {
+        int64 framesWritten;
+        int64 timesWritten;
+        bool stopped;
+    };
+
+    LiveTapReader();
+
+    ~LiveTapReader();
+
+    /** Maps the shared memory object with the given name, e.g. LiveTap::getNameFor(stream) */
+    bool open(const String& name);
+
+    void close();
+
+    bool isOpen() const { return m_header != nullptr; }
+
+    int getNumChannels() const { return int(m_header->numChannels); }
+
+    double getSampleRate() const { return m_header->sampleRate; }
+
+    double getBitVolts() const { return m_header->bitVolts; }
+
+    int getCapacity() const { return int(m_header->capacityFrames); }
+
+    String getStreamName() const { return String(m_header->streamName); }
+
+    /** Channel names, in the order of the samples in each frame */
+    const StringArray& getChannelNames() const { return m_channelNames; }
+
+    /** Takes a consistent copy of the writer's counters. Returns false if the writer stayed in
+        the middle of an update for the whole attempt, e.g. because it crashed there. */
+    bool getStatus(Status& status) const;
+
+    /** Copies up to maxFrames of the next frames into dest, which must hold maxFrames * getNumChannels()
+        samples. firstSample is set to the stream sample number of the first frame returned. */
+    int read(int16* dest, int maxFrames, int64& firstSample);
+
+    /** Copies up to maxTimes of the next sample timestamps into dest */
+    int readSampleTimes(LiveTap::SampleTime* dest, int maxTimes);
+
+    /** Skips to the newest frame, so the next read() only returns frames written from now on */
+    void skipToLatest();
+
+    /** Stream sample number of the next frame read() returns */
+    int64 getNextFrame() const { return int64(m_nextFrame); }
+
+    /** Frames that were overwritten before this reader got to them */
+    int64 getFramesLost() const { return m_framesLost; }
+
+private:
+
+    const LiveTap::Header* m_header{ nullptr };
+    const void* m_mapping{ nullptr };
+    size_t m_mappingSize{ 0 };
+    const int16* m_frames{ nullptr };
+    const LiveTap::SampleTime* m_times{ nullptr };
+    StringArray m_channelNames;
+
+    uint64 m_nextFrame{ 0 };
+    uint64 m_nextTime{ 0 };
+    int64 m_framesLost{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(LiveTapReader);
+};
+
+#endif
@@ -0,0 +1,226 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "MappedFileSink.h"
+
+#if JUCE_LINUX
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+MappedFileSink::MappedFileSink(size_t extentSize) :
+    m_fd(-1),
+    m_failed(false),
+    m_extent(nullptr),
+    m_extentOffset(0),
+    m_extentFill(0),
+    m_bytesWritten(0)
+{
+    const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+    m_extentSize = jmax(pageSize, (extentSize + pageSize - 1) / pageSize * pageSize);
+}
+
+MappedFileSink::~MappedFileSink()
+{
+    close();
+}
+
+bool MappedFileSink::isAvailable()
+{
+    return true;
+}
+
+bool MappedFileSink::open(const String& path)
+{
+    /* Let JUCE create any missing parent folders */
+    Result res = File(path).create();
+    if (res.failed())
+    {
+        std::cerr << "Error creating file " << path << ":" << res.getErrorMessage() << std::endl;
+        return false;
+    }
+
+    m_fd = ::open(path.toRawUTF8(), O_RDWR | O_TRUNC, 0644);
+
+    if (m_fd < 0)
+    {
+        std::cerr << "Error opening file " << path << ":" << strerror(errno) << std::endl;
+        return false;
+    }
+
+    /* Syncing the file also writes back the pages dirtied through the mapping */
+    m_syncHandle = FileSyncHandle::create(m_fd, path);
+    return mapNextExtent();
+}
+
+bool MappedFileSink::write(const void* data, size_t numBytes)
+{
+    if (m_fd < 0 || m_failed)
+        return false;
+
+    const uint8* source = static_cast<const uint8*>(data);
+
+    while (numBytes > 0)
+    {
+        if (m_extentFill == m_extentSize && !mapNextExtent())
+            return false;
+
+        size_t count = jmin(numBytes, m_extentSize - m_extentFill);
+        memcpy(m_extent + m_extentFill, source, count);
+
+        m_extentFill += count;
+        m_bytesWritten += count;
+        source += count;
+        numBytes -= count;
+    }
+
+    return true;
+}
+
+void MappedFileSink::close()
+{
+    if (m_fd < 0)
+        return;
+
+    unmapExtent();
+
+    if (ftruncate(m_fd, off_t(m_bytesWritten)) != 0)
+        std::cerr << "[Persyst] Could not truncate data file: " << strerror(errno) << std::endl;
+
+    if (m_failed)
+        std::cerr << "[Persyst] Errors occurred while writing a data file, it may be incomplete" << std::endl;
+
+    ::close(m_fd);
+    m_fd = -1;
+}
+
+uint64 MappedFileSink::flush()
+{
+    /* Blocks are in the page cache as soon as they are copied into the mapping */
+    return m_fd >= 0 ? m_bytesWritten : 0;
+}
+
+bool MappedFileSink::mapNextExtent()
+{
+    if (m_extent != nullptr)
+    {
+        m_extentOffset += m_extentSize;
+        unmapExtent();
+    }
+
+    /* Reserve the whole extent on disk first; writing into a mapping past the end of
+       the file would fault, and a hole could not be filled if the disk runs out */
+    int err = posix_fallocate(m_fd, off_t(m_extentOffset), off_t(m_extentSize));
+    if (err == EOPNOTSUPP || err == EINVAL)
+    {
+        /* File systems without preallocation still need the file to cover the mapping */
+        err = (ftruncate(m_fd, off_t(m_extentOffset + m_extentSize)) == 0) ? 0 : errno;
+    }
+
+    if (err != 0)
+    {
+        std::cerr << "[Persyst] Could not allocate data file space: " << strerror(err) << std::endl;
+        m_failed = true;
+        return false;
+    }
+
+    void* extent = mmap(nullptr, m_extentSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, off_t(m_extentOffset));
+    if (extent == MAP_FAILED)
+    {
+        std::cerr << "[Persyst] Could not map data file: " << strerror(errno) << std::endl;
+        m_failed = true;
+        return false;
+    }
+
+    madvise(extent, m_extentSize, MADV_SEQUENTIAL);
+
+    m_extent = static_cast<uint8*>(extent);
+    m_extentFill = 0;
+    return true;
+}
+
+void MappedFileSink::unmapExtent()
+{
+    if (m_extent == nullptr)
+        return;
+
+    /* Start writeback of the finished extent now rather than leaving it all to close() */
+    msync(m_extent, m_extentSize, MS_ASYNC);
+    munmap(m_extent, m_extentSize);
+    m_extent = nullptr;
+}
+
+#else
+
+MappedFileSink::MappedFileSink(size_t extentSize) :
+    m_fd(-1),
+    m_failed(false),
+    m_extentSize(extentSize),
+    m_extent(nullptr),
+    m_extentOffset(0),
+    m_extentFill(0),
+    m_bytesWritten(0)
+{
+}
+
+MappedFileSink::~MappedFileSink()
+{
+}
+
+bool MappedFileSink::isAvailable()
+{
+    return false;
+}
+
+bool MappedFileSink::open(const String& path)
+{
+    return false;
+}
+
+bool MappedFileSink::write(const void* data, size_t numBytes)
+{
+    return false;
+}
+
+void MappedFileSink::close()
+{
+}
+
+uint64 MappedFileSink::flush()
+{
+    return 0;
+}
+
+bool MappedFileSink::mapNextExtent()
+{
+    return false;
+}
+
+void MappedFileSink::unmapExtent()
+{
+}
+
+#endif
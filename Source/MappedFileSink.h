@@ -0,0 +1,81 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef MAPPEDFILESINK_H_DEFINED
+#define MAPPEDFILESINK_H_DEFINED
+
+#include "BlockFileSink.h"
+
+/**
+    Linux sink that writes recording.dat through a memory mapping.
+
+    The file is preallocated with fallocate() one large extent at a time, so that many
+    streams growing in parallel still get contiguous files. Only the extent currently
+    being filled is mapped; blocks are copied straight into it and the next extent is
+    allocated and mapped when it runs out, so there is no system call per block.
+    close() truncates the file back to the number of bytes written.
+*/
+class TESTABLE MappedFileSink : public BlockFileSink
+{
+public:
+
+    /** Constructor. extentSize is rounded up to a multiple of the page size. */
+    explicit MappedFileSink(size_t extentSize = DEFAULT_EXTENT_SIZE);
+
+    /** Destructor */
+    ~MappedFileSink();
+
+    bool open(const String& path) override;
+
+    bool write(const void* data, size_t numBytes) override;
+
+    void close() override;
+
+    uint64 flush() override;
+
+    /** Bytes allocated and mapped at a time */
+    size_t getExtentSize() const { return m_extentSize; }
+
+    /** Returns true on platforms that support this sink */
+    static bool isAvailable();
+
+    static const size_t DEFAULT_EXTENT_SIZE = size_t(64) << 20;
+
+private:
+
+    bool mapNextExtent();
+    void unmapExtent();
+
+    int m_fd;
+    bool m_failed;
+
+    size_t m_extentSize;
+    uint8* m_extent;
+    uint64 m_extentOffset;
+    size_t m_extentFill;
+    uint64 m_bytesWritten;
+
+    JUCE_DECLARE_NON_COPYABLE(MappedFileSink);
+};
+
+#endif
@@ -0,0 +1,127 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "NpyWriter.h"
+
+/* Space left in the header for the record count to grow, as numpy leaves it */
+#define NPY_GROWTH_DIGITS 21
+#define NPY_ALIGNMENT 64
+#define NPY_PREAMBLE_LENGTH 10
+
+NpyWriter::NpyWriter(const String& path, BaseType type, int length) :
+    m_file(File(path)),
+    m_descr(getTypeString(type, length)),
+    m_headerLength(0),
+    m_recordCount(0),
+    m_headerCount(0)
+{
+    if (type != BaseType::CHAR && length > 1)
+        m_innerShape = " " + String(length);
+
+    if (!m_file.openedOk())
+        return;
+
+    /* Padded so the data starts aligned, with room for the count to reach NPY_GROWTH_DIGITS digits */
+    String header = getHeader(0) + String::repeatedString(" ", NPY_GROWTH_DIGITS - 1);
+    const int total = NPY_PREAMBLE_LENGTH + header.length() + 1;
+    header = header.paddedRight(' ', header.length() + (NPY_ALIGNMENT - total % NPY_ALIGNMENT) % NPY_ALIGNMENT) + "\n";
+    m_headerLength = header.length();
+
+    const uint8 preamble[NPY_PREAMBLE_LENGTH] = { 0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0,
+                                                  uint8(m_headerLength & 0xff), uint8(m_headerLength >> 8) };
+    m_file.setPosition(0);
+    m_file.truncate();
+    m_file.write(preamble, sizeof(preamble));
+    m_file.write(header.toRawUTF8(), size_t(m_headerLength));
+    m_file.flush();
+}
+
+NpyWriter::~NpyWriter()
+{
+    updateHeader();
+}
+
+String NpyWriter::getTypeString(BaseType type, int length)
+{
+    switch (type)
+    {
+    case BaseType::CHAR:
+        return "|S" + String(length);
+    case BaseType::INT8:
+        return "|i1";
+    case BaseType::UINT8:
+        return "|u1";
+    case BaseType::INT16:
+        return "<i2";
+    case BaseType::UINT16:
+        return "<u2";
+    case BaseType::INT32:
+        return "<i4";
+    case BaseType::UINT32:
+        return "<u4";
+    case BaseType::INT64:
+        return "<i8";
+    case BaseType::UINT64:
+        return "<u8";
+    case BaseType::FLOAT:
+        return "<f4";
+    case BaseType::DOUBLE:
+        return "<f8";
+    default:
+        return "|b1";
+    }
+}
+
+String NpyWriter::getHeader(int64 recordCount) const
+{
+    return "{'descr': '" + m_descr + "', 'fortran_order': False, 'shape': (" + String(recordCount) + ","
+        + m_innerShape + "), }";
+}
+
+void NpyWriter::writeData(const void* data, size_t size)
+{
+    m_file.write(data, size);
+}
+
+void NpyWriter::updateHeader()
+{
+    if (!m_file.openedOk() || m_recordCount == m_headerCount)
+        return;
+
+    const String header = getHeader(m_recordCount).paddedRight(' ', m_headerLength - 1) + "\n";
+    if (header.length() != m_headerLength)
+    {
+        std::cerr << "[Persyst] No room for " << m_recordCount << " records in the header of "
+                  << m_file.getFile().getFullPathName() << std::endl;
+        return;
+    }
+
+    const int64 end = m_file.getPosition();
+    if (m_file.setPosition(NPY_PREAMBLE_LENGTH))
+    {
+        m_file.write(header.toRawUTF8(), size_t(m_headerLength));
+        m_file.setPosition(end);
+        m_headerCount = m_recordCount;
+    }
+}
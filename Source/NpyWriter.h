@@ -0,0 +1,82 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef NPYWRITER_H_DEFINED
+#define NPYWRITER_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include "SyncableFileStream.h"
+
+/**
+    Appends records to a version 1 .npy file, like the GUI's NpyFile.
+
+    The header is written with room for the record count to grow, and updateHeader()
+    rewrites the shape in place. The file is written through a SyncableFileStream, so a
+    checkpoint can make it durable from another thread.
+*/
+class TESTABLE NpyWriter
+{
+public:
+
+    /** Creates the file for records of length elements of type; a CHAR record is one string of length bytes */
+    NpyWriter(const String& path, BaseType type, int length = 1);
+
+    /** Destructor. Updates the header. */
+    ~NpyWriter();
+
+    bool openedOk() const { return m_file.openedOk(); }
+
+    /** Appends size bytes of records; call increaseRecordCount() for them */
+    void writeData(const void* data, size_t size);
+
+    void increaseRecordCount(int count = 1) { m_recordCount += count; }
+
+    /** Rewrites the record count in the header, which also hands the buffered records to the operating system */
+    void updateHeader();
+
+    int64 getRecordCount() const { return m_recordCount; }
+
+    /** Handle through which another thread can sync the file */
+    FileSyncHandle::Ptr getSyncHandle() const { return m_file.getSyncHandle(); }
+
+    /** numpy's type string for an element, e.g. <i8 */
+    static String getTypeString(BaseType type, int length);
+
+private:
+
+    String getHeader(int64 recordCount) const;
+
+    SyncableFileStream m_file;
+    String m_descr;
+    String m_innerShape;
+    int m_headerLength;
+    int64 m_recordCount;
+    int64 m_headerCount;
+
+    JUCE_DECLARE_NON_COPYABLE(NpyWriter);
+};
+
+#endif
@@ -0,0 +1,119 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "NumberText.h"
+
+#if defined(__cpp_lib_to_chars) && !defined(PERSYST_NO_FLOAT_CHARCONV)
+#define PERSYST_FLOAT_CHARCONV 1
+#else
+#define PERSYST_FLOAT_CHARCONV 0
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#endif
+
+#if !PERSYST_FLOAT_CHARCONV
+
+static double readFloat(const char* text, char** stop, double)
+{
+    return std::strtod(text, stop);
+}
+
+static float readFloat(const char* text, char** stop, float)
+{
+    return std::strtof(text, stop);
+}
+
+template <typename T>
+static bool parseFallback(const char* begin, const char* end, T& value)
+{
+    /* strtod also takes leading whitespace, a '+' and hexadecimal, which from_chars rejects */
+    if (begin == end || *begin == '+' || *begin == ' ' || (*begin >= '\t' && *begin <= '\r'))
+        return false;
+    for (const char* c = begin; c < end; c++)
+    {
+        if (*c == 'x' || *c == 'X' || *c == '\0')
+            return false;
+    }
+
+    const std::string text(begin, end);
+    char* stop = nullptr;
+    errno = 0;
+    value = readFloat(text.c_str(), &stop, T());
+    /* ERANGE also flags subnormal results, which from_chars returns */
+    return stop == text.c_str() + text.size() && (errno != ERANGE || (value != 0 && std::isfinite(value)));
+}
+
+#endif
+
+char* NumberText::format(char* begin, char* end, double value)
+{
+#if PERSYST_FLOAT_CHARCONV
+    const auto result = std::to_chars(begin, end, value);
+    return result.ec == std::errc() ? result.ptr : end;
+#else
+    char text[32];
+    for (int precision = 15; precision <= 17; precision++)
+    {
+        std::snprintf(text, sizeof(text), "%.*g", precision, value);
+        if (precision == 17 || std::strtod(text, nullptr) == value)
+            break;
+    }
+
+    const size_t length = std::strlen(text);
+    if (length > size_t(end - begin))
+        return end;
+
+    std::memcpy(begin, text, length);
+    return begin + length;
+#endif
+}
+
+bool NumberText::parse(const char* begin, const char* end, double& value)
+{
+#if PERSYST_FLOAT_CHARCONV
+    const auto result = std::from_chars(begin, end, value);
+    return result.ec == std::errc() && result.ptr == end;
+#else
+    return parseFallback(begin, end, value);
+#endif
+}
+
+bool NumberText::parse(const char* begin, const char* end, float& value)
+{
+#if PERSYST_FLOAT_CHARCONV
+    const auto result = std::from_chars(begin, end, value);
+    return result.ec == std::errc() && result.ptr == end;
+#else
+    return parseFallback(begin, end, value);
+#endif
+}
+
+bool NumberText::hasFloatingPointCharConv()
+{
+    return PERSYST_FLOAT_CHARCONV != 0;
+}
@@ -0,0 +1,80 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef NUMBERTEXT_H_DEFINED
+#define NUMBERTEXT_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include <charconv>
+#include <type_traits>
+
+/**
+    Locale-independent number formatting and parsing for the text files (.lay, segments.json)
+    written and read by this plugin.
+
+    Integers go through std::to_chars/from_chars. Floating-point std::to_chars/from_chars
+    need libstdc++ 11 or MSVC 16.4, so where the standard library doesn't announce them
+    (__cpp_lib_to_chars) doubles fall back to snprintf and strtod: the shortest of "%.15g",
+    "%.16g" and "%.17g" that reads back to the same double, and strtod restricted to what
+    from_chars accepts. The fallback reads and writes in the C locale's decimal point, which
+    is "." unless the application calls setlocale.
+*/
+class TESTABLE NumberText
+{
+public:
+
+    /** Longest text format() writes for a double */
+    static const size_t MAX_DOUBLE_LENGTH = 24;
+
+    /** Writes the shortest text that reads back to exactly value. Returns the end of the
+        text, or end if it doesn't fit. */
+    static char* format(char* begin, char* end, double value);
+
+    /** Writes an integer. Returns the end of the text, or end if it doesn't fit. */
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value, char*>::type format(char* begin, char* end, T value)
+    {
+        const auto result = std::to_chars(begin, end, value);
+        return result.ec == std::errc() ? result.ptr : end;
+    }
+
+    /** Parses all of [begin, end) as a number. Returns false, leaving value undefined, on any
+        other character, a leading '+' or whitespace, or a number out of range. */
+    static bool parse(const char* begin, const char* end, double& value);
+    static bool parse(const char* begin, const char* end, float& value);
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value, bool>::type parse(const char* begin, const char* end, T& value)
+    {
+        const auto result = std::from_chars(begin, end, value);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+    /** Returns true if doubles go through std::to_chars/from_chars rather than the fallback */
+    static bool hasFloatingPointCharConv();
+};
+
+#endif
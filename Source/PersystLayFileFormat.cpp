@@ -26,6 +26,12 @@ String PersystLayFileFormat::toString(){
     returnString += addField("Calibration", m_calibration);
     returnString += addField("WaveformCount", m_waveformCount);
     returnString += addField("DataType", m_dataType);
+    if (m_segmentIndex >= 0) {
+        //Position of this file within a recording split into segments
+        returnString += String("[Segment]\n");
+        returnString += addField("Index", m_segmentIndex);
+        returnString += addField("FirstSample", m_firstSample);
+    }
     return returnString;
 }
 
@@ -45,7 +51,9 @@ PersystLayFileFormat::PersystLayFileFormat(String layoutFile,
                                             m_dataFile("recording.dat"),
                                             m_fileType("Interleaved"),
                                             m_headerLength(0),
-                                            m_dataType(DataSubType::bits16){}
+                                            m_dataType(DataSubType::bits16),
+                                            m_segmentIndex(-1),
+                                            m_firstSample(0){}
 
 
 PersystLayFileFormat& PersystLayFileFormat::withDataFile(String dataFile) {
@@ -60,6 +68,11 @@ PersystLayFileFormat& PersystLayFileFormat::withHeaderLength(int headerLength) {
     m_headerLength = headerLength;
     return *this;
 }
+PersystLayFileFormat& PersystLayFileFormat::withSegment(int segmentIndex, int64 firstSample) {
+    m_segmentIndex = segmentIndex;
+    m_firstSample = firstSample;
+    return *this;
+}
 PersystLayFileFormat& PersystLayFileFormat::withDataType(DataSubType dataType) {
     switch (dataType) {
         case DataSubType::bits16 : {
@@ -21,6 +21,7 @@ public:
     PersystLayFileFormat& withFileType(String fileType);
     PersystLayFileFormat& withHeaderLength(int headerLength);
     PersystLayFileFormat& withDataType(DataSubType dataType);
+    PersystLayFileFormat& withSegment(int segmentIndex, int64 firstSample);
         
     String toString();
     
@@ -39,6 +40,8 @@ private:
     float m_calibration;
     int m_waveformCount;
     int m_dataType;
+    int m_segmentIndex;
+    int64 m_firstSample;
 };
 
 
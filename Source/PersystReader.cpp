@@ -0,0 +1,427 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "PersystReader.h"
+#include "NumberText.h"
+#include "SampleConversion.h"
+
+#include <cmath>
+
+/* Frames converted per pass in readChannels(). One tile of every requested channel stays in L1. */
+#define READ_TILE_SAMPLES 256
+
+/* Envelope bins combined per read in readEnvelope() */
+#define ENVELOPE_READ_BINS 256
+
+static void trim(const char*& begin, const char*& end)
+{
+    while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r'))
+        begin++;
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+        end--;
+}
+
+PersystReader::PersystReader()
+{
+}
+
+PersystReader::~PersystReader()
+{
+}
+
+bool PersystReader::open(const File& layoutFile)
+{
+    close();
+
+    if (!layoutFile.existsAsFile())
+    {
+        std::cerr << "[Persyst] Layout file " << layoutFile.getFullPathName() << " does not exist" << std::endl;
+        return false;
+    }
+
+    const String text = layoutFile.loadFileAsString();
+    const char* begin = text.toRawUTF8();
+
+    if (!parseLayout(begin, begin + std::strlen(begin)))
+    {
+        std::cerr << "[Persyst] Could not parse layout file " << layoutFile.getFullPathName() << std::endl;
+        close();
+        return false;
+    }
+
+    if (!m_info.fileType.equalsIgnoreCase("Interleaved") || m_info.dataType != 0
+        || m_info.waveformCount <= 0 || m_info.samplingRate <= 0
+        || m_info.headerLength < 0 || m_info.headerLength % 2 != 0)
+    {
+        std::cerr << "[Persyst] Unsupported layout in " << layoutFile.getFullPathName()
+                  << ": only 16-bit interleaved files can be read" << std::endl;
+        close();
+        return false;
+    }
+
+    /* File may be a full path or a name relative to the layout file */
+    const File dataFile = layoutFile.getParentDirectory().getChildFile(m_info.file);
+    if (!dataFile.existsAsFile())
+    {
+        std::cerr << "[Persyst] Data file " << dataFile.getFullPathName() << " does not exist" << std::endl;
+        close();
+        return false;
+    }
+
+    const int64 frameSize = int64(m_info.waveformCount) * sizeof(int16);
+    const int64 dataSize = dataFile.getSize() - m_info.headerLength;
+
+    if (dataSize >= frameSize)
+    {
+        m_dataFile.reset(new MemoryMappedFile(dataFile, MemoryMappedFile::readOnly));
+        if (m_dataFile->getData() == nullptr)
+        {
+            std::cerr << "[Persyst] Could not map data file " << dataFile.getFullPathName() << std::endl;
+            close();
+            return false;
+        }
+
+        m_frames = reinterpret_cast<const int16*>(static_cast<const char*>(m_dataFile->getData()) + m_info.headerLength);
+        m_numSamples = int64(m_dataFile->getSize() - m_info.headerLength) / frameSize;
+    }
+
+    const File envelopeFile = layoutFile.withFileExtension("env");
+    if (envelopeFile.existsAsFile())
+    {
+        m_envelope = std::make_unique<EnvelopeReader>();
+        if (!m_envelope->open(envelopeFile) || m_envelope->getNumChannels() != m_info.waveformCount)
+            m_envelope.reset();
+    }
+
+    m_isOpen = true;
+    return true;
+}
+
+void PersystReader::close()
+{
+    m_envelope.reset();
+    m_dataFile.reset();
+    m_frames = nullptr;
+    m_numSamples = 0;
+    m_info = FileInfo();
+    m_segmentIndex = -1;
+    m_firstSample = 0;
+    m_channelNames.clear();
+    m_sampleTimes.clear();
+    m_isOpen = false;
+}
+
+bool PersystReader::parseLayout(const char* text, const char* end)
+{
+    Section section = NO_SECTION;
+    bool sorted = true;
+
+    while (text < end)
+    {
+        const char* lineEnd = std::find(text, end, '\n');
+        const char* line = text;
+        const char* last = lineEnd;
+        text = lineEnd + 1;
+
+        trim(line, last);
+        if (line == last)
+            continue;
+
+        if (*line == '[' && last[-1] == ']')
+        {
+            const String name = String::fromUTF8(line + 1, int(last - line - 2));
+            if (name.equalsIgnoreCase("FileInfo"))
+                section = FILE_INFO;
+            else if (name.equalsIgnoreCase("Segment"))
+                section = SEGMENT;
+            else if (name.equalsIgnoreCase("ChannelMap"))
+                section = CHANNEL_MAP;
+            else if (name.equalsIgnoreCase("SampleTimes"))
+                section = SAMPLE_TIMES;
+            else
+                section = UNKNOWN_SECTION;
+            continue;
+        }
+
+        const char* separator = std::find(line, last, '=');
+        if (separator == last)
+            return false;
+
+        const char* key = line;
+        const char* keyEnd = separator;
+        const char* value = separator + 1;
+        const char* valueEnd = last;
+        trim(key, keyEnd);
+        trim(value, valueEnd);
+
+        /* The bulk of a layout file, so parsed without building any strings */
+        if (section == SAMPLE_TIMES)
+        {
+            SampleTime row;
+            if (!NumberText::parse(key, keyEnd, row.sample) || !NumberText::parse(value, valueEnd, row.time))
+                return false;
+
+            if (m_sampleTimes.size() > 0 && row.sample < m_sampleTimes.getLast().sample)
+                sorted = false;
+
+            m_sampleTimes.add(row);
+        }
+        else if (!parseField(section, key, keyEnd, value, valueEnd))
+        {
+            return false;
+        }
+    }
+
+    if (!sorted)
+        std::stable_sort(m_sampleTimes.begin(), m_sampleTimes.end(),
+                         [](const SampleTime& a, const SampleTime& b) { return a.sample < b.sample; });
+
+    return true;
+}
+
+bool PersystReader::parseField(Section section, const char* key, const char* keyEnd, const char* value, const char* valueEnd)
+{
+    const String name = String::fromUTF8(key, int(keyEnd - key));
+
+    if (section == FILE_INFO)
+    {
+        if (name.equalsIgnoreCase("File"))
+            m_info.file = String::fromUTF8(value, int(valueEnd - value));
+        else if (name.equalsIgnoreCase("FileType"))
+            m_info.fileType = String::fromUTF8(value, int(valueEnd - value));
+        else if (name.equalsIgnoreCase("SamplingRate"))
+            return NumberText::parse(value, valueEnd, m_info.samplingRate);
+        else if (name.equalsIgnoreCase("HeaderLength"))
+            return NumberText::parse(value, valueEnd, m_info.headerLength);
+        else if (name.equalsIgnoreCase("Calibration"))
+            return NumberText::parse(value, valueEnd, m_info.calibration);
+        else if (name.equalsIgnoreCase("WaveformCount"))
+            return NumberText::parse(value, valueEnd, m_info.waveformCount);
+        else if (name.equalsIgnoreCase("DataType"))
+            return NumberText::parse(value, valueEnd, m_info.dataType);
+    }
+    else if (section == SEGMENT)
+    {
+        if (name.equalsIgnoreCase("Index"))
+            return NumberText::parse(value, valueEnd, m_segmentIndex);
+        else if (name.equalsIgnoreCase("FirstSample"))
+            return NumberText::parse(value, valueEnd, m_firstSample);
+    }
+    else if (section == CHANNEL_MAP)
+    {
+        //Persyst uses first index = 1
+        int index;
+        if (!NumberText::parse(value, valueEnd, index) || index < 1
+            || (m_info.waveformCount > 0 && index > m_info.waveformCount))
+            return false;
+
+        while (m_channelNames.size() < index)
+            m_channelNames.add(String());
+        m_channelNames.set(index - 1, name);
+    }
+
+    return true;
+}
+
+String PersystReader::getChannelName(int channel) const
+{
+    return m_channelNames[channel];
+}
+
+int PersystReader::getChannelIndex(const String& name) const
+{
+    for (int i = 0; i < m_channelNames.size(); i++)
+        if (m_channelNames[i] == name)
+            return i;
+    return -1;
+}
+
+double PersystReader::getTimeOfSample(int64 sample) const
+{
+    if (m_sampleTimes.size() == 0)
+        return double(sample) / m_info.samplingRate;
+
+    const SampleTime* first = m_sampleTimes.begin();
+    const SampleTime* row = std::upper_bound(first, m_sampleTimes.end(), sample,
+                                             [](int64 s, const SampleTime& t) { return s < t.sample; });
+    if (row != first)
+        row--;
+
+    return row->time + double(sample - row->sample) / m_info.samplingRate;
+}
+
+int64 PersystReader::getSampleAtTime(double time) const
+{
+    /* Tolerates the rounding of the times in the layout file */
+    const double epsilon = 1e-6;
+
+    if (m_sampleTimes.size() == 0)
+        return int64(std::ceil(time * m_info.samplingRate - epsilon));
+
+    const SampleTime* first = m_sampleTimes.begin();
+    const SampleTime* end = m_sampleTimes.end();
+    const SampleTime* next = std::upper_bound(first, end, time,
+                                              [](double t, const SampleTime& row) { return t < row.time; });
+    const SampleTime* row = next != first ? next - 1 : first;
+
+    int64 sample = row->sample + int64(std::ceil((time - row->time) * m_info.samplingRate - epsilon));
+
+    if (next != first && next != end)
+        sample = jmin(sample, next->sample);
+
+    return sample;
+}
+
+const int16* PersystReader::getFrames(int64 sample) const
+{
+    if (sample < 0 || sample >= m_numSamples)
+        return nullptr;
+    return m_frames + sample * m_info.waveformCount;
+}
+
+int PersystReader::readChannels(const int* channels, int numChannels, int64 startSample, int numSamples, float* const* dest) const
+{
+    if (startSample < 0 || numSamples < 0)
+        return -1;
+
+    for (int c = 0; c < numChannels; c++)
+        if (channels[c] < 0 || channels[c] >= m_info.waveformCount)
+            return -1;
+
+    const int count = int(jlimit(int64(0), int64(numSamples), m_numSamples - startSample));
+    const int stride = m_info.waveformCount;
+    const float scale = float(m_info.calibration);
+
+    if (stride == 1)
+    {
+        for (int c = 0; c < numChannels; c++)
+            SampleConversion::int16ToFloat(m_frames + startSample, dest[c], scale, count);
+        return count;
+    }
+
+    int16 gathered[READ_TILE_SAMPLES];
+
+    for (int tileStart = 0; tileStart < count; tileStart += READ_TILE_SAMPLES)
+    {
+        const int tileSize = jmin(READ_TILE_SAMPLES, count - tileStart);
+        const int16* frames = m_frames + (startSample + tileStart) * stride;
+
+        for (int c = 0; c < numChannels; c++)
+        {
+            const int16* source = frames + channels[c];
+            for (int i = 0; i < tileSize; i++)
+                gathered[i] = source[i * stride];
+
+            SampleConversion::int16ToFloat(gathered, dest[c] + tileStart, scale, tileSize);
+        }
+    }
+
+    return count;
+}
+
+int PersystReader::readTimeWindow(const int* channels, int numChannels, double startTime, double endTime,
+                                  float* const* dest, int maxSamples) const
+{
+    const int64 first = jmax(int64(0), getSampleAtTime(startTime));
+    const int64 last = jmin(m_numSamples, getSampleAtTime(endTime));
+
+    if (last <= first)
+        return 0;
+
+    return readChannels(channels, numChannels, first, int(jmin(int64(maxSamples), last - first)), dest);
+}
+
+bool PersystReader::readEnvelope(int channel, int64 startSample, int64 endSample, int numColumns,
+                                 float* mins, float* maxs, float* rms) const
+{
+    if (!m_isOpen || channel < 0 || channel >= m_info.waveformCount || numColumns <= 0
+        || startSample < 0 || endSample > m_numSamples || endSample <= startSample)
+        return false;
+
+    const int64 span = endSample - startSample;
+    const int level = (m_envelope != nullptr && (rms == nullptr || m_envelope->hasRms()))
+                          ? m_envelope->getLevelFor(double(span) / numColumns)
+                          : -1;
+    const float scale = float(m_info.calibration);
+
+    int16 binMins[ENVELOPE_READ_BINS];
+    int16 binMaxs[ENVELOPE_READ_BINS];
+    int16 binRms[ENVELOPE_READ_BINS];
+
+    for (int column = 0; column < numColumns; column++)
+    {
+        const int64 first = startSample + span * column / numColumns;
+        const int64 last = jmax(first + 1, startSample + span * (column + 1) / numColumns);
+
+        int lo = std::numeric_limits<int16>::max();
+        int hi = std::numeric_limits<int16>::min();
+        double sumSquares = 0;
+        int64 count = 0;
+
+        if (level >= 0)
+        {
+            /* Every bin that overlaps the column; the RMS weighs them equally */
+            const int factor = m_envelope->getFactor(level);
+            int64 bin = first / factor;
+            const int64 endBin = (last + factor - 1) / factor;
+
+            while (bin < endBin)
+            {
+                const int read = m_envelope->readBins(level, channel, bin, int(jmin(int64(ENVELOPE_READ_BINS), endBin - bin)),
+                                                      binMins, binMaxs, rms != nullptr ? binRms : nullptr);
+                if (read <= 0)
+                    break;
+
+                for (int i = 0; i < read; i++)
+                {
+                    lo = jmin(lo, int(binMins[i]));
+                    hi = jmax(hi, int(binMaxs[i]));
+                    if (rms != nullptr)
+                        sumSquares += double(binRms[i]) * binRms[i];
+                }
+                count += read;
+                bin += read;
+            }
+        }
+        else
+        {
+            const int16* source = m_frames + first * m_info.waveformCount + channel;
+            for (int64 i = 0; i < last - first; i++)
+            {
+                const int value = source[i * m_info.waveformCount];
+                lo = jmin(lo, value);
+                hi = jmax(hi, value);
+                sumSquares += double(value) * value;
+            }
+            count = last - first;
+        }
+
+        mins[column] = count > 0 ? lo * scale : 0.0f;
+        maxs[column] = count > 0 ? hi * scale : 0.0f;
+        if (rms != nullptr)
+            rms[column] = count > 0 ? float(std::sqrt(sumSquares / count)) * scale : 0.0f;
+    }
+
+    return true;
+}
@@ -0,0 +1,169 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef PERSYSTREADER_H_DEFINED
+#define PERSYSTREADER_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include "EnvelopeReader.h"
+
+/**
+    Reads a recording written by the Persyst record engine: a .lay file and the
+    interleaved 16-bit .dat file it points to.
+
+    The layout file is parsed once into its [FileInfo], [Segment], [ChannelMap] and
+    [SampleTimes] sections. The data file is memory mapped, so frames can be accessed
+    in place without copying, and any subset of channels can be read and converted
+    to microvolts with the SIMD kernels of SampleConversion.
+
+    If the envelope file written during recording (the .env next to the .lay) is there,
+    readEnvelope() draws long spans from it instead of reading the data file.
+
+    Sample numbers are relative to the start of the data file. For a segment of a
+    split recording, add getFirstSample() to get the stream sample number.
+*/
+class TESTABLE PersystReader
+{
+public:
+
+    struct FileInfo
+    {
+        String file;
+        String fileType;
+        double samplingRate{ 0 };
+        int headerLength{ 0 };
+        double calibration{ 1 };
+        int waveformCount{ 0 };
+        int dataType{ 0 };
+    };
+
+    struct SampleTime
+    {
+        int64 sample;
+        double time;
+    };
+
+    /** Constructor */
+    PersystReader();
+
+    /** Destructor */
+    ~PersystReader();
+
+    /** Parses the layout file and maps its data file. Returns false if either cannot be used. */
+    bool open(const File& layoutFile);
+
+    /** Unmaps the data file and forgets the layout */
+    void close();
+
+    /** Returns true if a recording is open */
+    bool isOpen() const { return m_isOpen; }
+
+    const FileInfo& getFileInfo() const { return m_info; }
+
+    /** Index of this segment, or -1 if the recording was not split */
+    int getSegmentIndex() const { return m_segmentIndex; }
+
+    /** Stream sample number of the first sample in this file */
+    int64 getFirstSample() const { return m_firstSample; }
+
+    int getNumChannels() const { return m_info.waveformCount; }
+
+    /** Number of complete frames in the data file */
+    int64 getNumSamples() const { return m_numSamples; }
+
+    /** Name of a channel from [ChannelMap], or an empty string if it has none */
+    String getChannelName(int channel) const;
+
+    /** Returns the index of the channel with the given name, or -1 */
+    int getChannelIndex(const String& name) const;
+
+    /** The [SampleTimes] rows, sorted by sample */
+    const Array<SampleTime>& getSampleTimes() const { return m_sampleTimes; }
+
+    /** Time in seconds of a sample, extrapolated at the sampling rate from the closest
+        [SampleTimes] row at or before it */
+    double getTimeOfSample(int64 sample) const;
+
+    /** First sample whose time is at or after the given time. Times are expected to be
+        non-decreasing. Inside a gap between two rows this is the sample of the later row. */
+    int64 getSampleAtTime(double time) const;
+
+    /** Returns the mapped frame of a sample, getNumChannels() interleaved values, or nullptr
+        if the sample is out of range. Consecutive frames follow each other in memory and
+        stay valid until close(). */
+    const int16* getFrames(int64 sample) const;
+
+    /** Reads numSamples samples of the given channels, starting at startSample, into
+        dest[0] .. dest[numChannels - 1], in microvolts. Stops at the end of the file.
+        Returns the number of samples read, or -1 if the arguments are out of range. */
+    int readChannels(const int* channels, int numChannels, int64 startSample, int numSamples, float* const* dest) const;
+
+    /** Reads the samples from getSampleAtTime(startTime) up to, but not including,
+        getSampleAtTime(endTime), at most maxSamples of them. Returns the number read. */
+    int readTimeWindow(const int* channels, int numChannels, double startTime, double endTime,
+                       float* const* dest, int maxSamples) const;
+
+    /** The envelope file of this recording, or nullptr if it has none */
+    const EnvelopeReader* getEnvelope() const { return m_envelope.get(); }
+
+    /** Splits the samples from startSample up to, but not including, endSample into numColumns
+        equal columns and writes the minimum, maximum and, if rms is not nullptr, RMS of a
+        channel in each, in microvolts. Columns of at least 64 samples are read from the
+        coarsest envelope level that fits, everything else from the data file. Returns false
+        if the arguments are out of range. */
+    bool readEnvelope(int channel, int64 startSample, int64 endSample, int numColumns,
+                      float* mins, float* maxs, float* rms = nullptr) const;
+
+private:
+
+    enum Section
+    {
+        NO_SECTION = 0,
+        FILE_INFO,
+        SEGMENT,
+        CHANNEL_MAP,
+        SAMPLE_TIMES,
+        UNKNOWN_SECTION
+    };
+
+    bool parseLayout(const char* text, const char* end);
+    bool parseField(Section section, const char* key, const char* keyEnd, const char* value, const char* valueEnd);
+
+    FileInfo m_info;
+    int m_segmentIndex{ -1 };
+    int64 m_firstSample{ 0 };
+    Array<String> m_channelNames;
+    Array<SampleTime> m_sampleTimes;
+
+    std::unique_ptr<MemoryMappedFile> m_dataFile;
+    const int16* m_frames{ nullptr };
+    int64 m_numSamples{ 0 };
+    std::unique_ptr<EnvelopeReader> m_envelope;
+    bool m_isOpen{ false };
+
+    JUCE_DECLARE_NON_COPYABLE(PersystReader);
+};
+
+#endif
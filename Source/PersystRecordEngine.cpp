@@ -23,14 +23,13 @@
 
 #include "PersystRecordEngine.h"
 #include "PersystLayFileFormat.h"
+#include "SampleConversion.h"
 
-#define MAX_BUFFER_SIZE 40960
+#define EVENT_BUFFER_RECORDS 4096
+#define PREVIEW_CHUNK 4096
 
 PersystRecordEngine::PersystRecordEngine() 
 { 
-    m_bufferSize = MAX_BUFFER_SIZE;
-    m_scaledBuffer.malloc(MAX_BUFFER_SIZE);
-    m_intBuffer.malloc(MAX_BUFFER_SIZE);
 
 }
 	
@@ -44,7 +43,44 @@ RecordEngineManager* PersystRecordEngine::getEngineManager()
 {
 	RecordEngineManager* man = new RecordEngineManager("PERSYST", "Persyst",
 		&(engineFactory<PersystRecordEngine>));
-	
+
+	EngineParameter* param;
+	param = new EngineParameter(EngineParameter::BOOL, 0, "Record TTL full words", true);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::BOOL, 1, "Whole-stream block writes", false);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::BOOL, 2, "Asynchronous disk writer", false);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 3, "Writer ring size per stream (MB)", 64, 1, 4096);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 4, "Continuous file backend (0=buffered, 1=direct I/O, 2=memory-mapped)", 0, 0, 2);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::BOOL, 5, "Compress SampleTimes", false);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 6, "SampleTimes tolerance (us)", 100, 1, 1000000);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 7, "SampleTimes keyframe interval (s)", 60, 1, 86400);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 8, "Segment length (minutes, 0=off)", 0, 0, 10080);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 9, "Segment size (GB, 0=off)", 0, 0, 16384);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 10, "Writer threads", 1, 1, 16);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 11, "Writer CPU affinity (first core, -1=off)", -1, -1, 31);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 12, "Preview rate (Hz, 0=off)", 0, 0, 10000);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 13, "Envelope file (0=off, 1=min/max, 2=min/max/RMS)", 0, 0, 2);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::BOOL, 14, "Block checksums (CRC32C)", false);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 15, "Checkpoint interval (s, 0=off)", 0, 0, 3600);
+	man->addParameter(param);
+
+	param = new EngineParameter(EngineParameter::INT, 16, "Live tap buffer (s, 0=off)", 0, 0, 60);
+	man->addParameter(param);
+
 	return man;
 }
 
@@ -66,11 +102,10 @@ String PersystRecordEngine::getProcessorString(const InfoObject* channelInfo)
 
 void PersystRecordEngine::openFiles(File rootFolder, int experimentNumber, int recordingNumber)
 {
+    const int64 openStart = RecordStreamStats::now();
 
-    
-    m_channelIndexes.insertMultiple(0, 0, getNumRecordedContinuousChannels());
-    m_fileIndexes.insertMultiple(0, 0, getNumRecordedContinuousChannels());
-    m_samplesWritten.insertMultiple(0, 0, getNumRecordedContinuousChannels());
+    m_channelPlans.reset(new ChannelPlan[getNumRecordedContinuousChannels()]);
+    m_samplesWritten.calloc(getNumRecordedContinuousChannels());
     
     String basepath = rootFolder.getFullPathName() + rootFolder.getSeparatorString() + "experiment" + String(experimentNumber)
         + File::getSeparatorString() + "recording" + String(recordingNumber + 1) + File::getSeparatorString();
@@ -81,6 +116,7 @@ void PersystRecordEngine::openFiles(File rootFolder, int experimentNumber, int r
     uint16 lastStreamId = 0;
     int indexWithinStream = 0;
     Array<const ContinuousChannel*> firstChannels;
+    Array<int> firstChannelIndexes;
     Array<int> channelCounts;
 
     std::map<uint16, Array<String>> channelNamesByStreamID;
@@ -100,6 +136,7 @@ void PersystRecordEngine::openFiles(File rootFolder, int experimentNumber, int r
         if (streamId != lastStreamId)
         {
             firstChannels.add(channelInfo);
+            firstChannelIndexes.add(ch);
             streamIndex++;
 
             if (streamIndex > 0)
@@ -112,8 +149,10 @@ void PersystRecordEngine::openFiles(File rootFolder, int experimentNumber, int r
 
         channelNamesByStreamID[channelInfo->getStreamId()].set(localIndex,channelInfo ->getName());
 
-        m_fileIndexes.set(ch, streamIndex);
-        m_channelIndexes.set(ch, indexWithinStream++);
+        ChannelPlan& plan = m_channelPlans[ch];
+        plan.scale = 1 / (float(0x7fff) * channelInfo->getBitVolts());
+        plan.streamIndex = streamIndex;
+        plan.channelIndex = indexWithinStream++;
 
         lastStreamId = streamId;
 
@@ -128,55 +167,110 @@ void PersystRecordEngine::openFiles(File rootFolder, int experimentNumber, int r
     {
         streamIndex++;
 
-        String datPath = getProcessorString(ch);
-        String dataFileName = "recording.dat";
-        String dataFilePath = contPath + datPath + dataFileName;
-        String layoutFilePath = contPath + datPath + "recording.lay";
-
-
-        ScopedPointer<SequentialBlockFile> bFile = new SequentialBlockFile(channelCounts[streamIndex], samplesPerBlock);
-
-        if (bFile->openFile(dataFilePath))
-            m_continuousFiles.add(bFile.release());
-        else
-            m_continuousFiles.add(nullptr);
+        StreamStaging* staging = m_streamStaging.add(new StreamStaging());
+        staging->numChannels = channelCounts[streamIndex];
+        if (m_wholeStreamWrites)
+        {
+            staging->stride = samplesPerBlock;
+            staging->data.malloc(staging->stride * staging->numChannels);
+        }
 
-        
-        PersystLayFileFormat layoutFile = PersystLayFileFormat::create(layoutFilePath,
-                                                                         ch->getSampleRate(),
-                                                                         ch->getBitVolts(),
-                                                                         channelCounts[streamIndex])
-                                                                .withDataFile(dataFileName);
-        
-        ScopedPointer<FileOutputStream> layoutFileStream  = new FileOutputStream(layoutFile.getLayoutFilePath());
-        if(layoutFileStream -> openedOk()){
-            layoutFileStream -> writeText(layoutFile.toString(), false, false, nullptr);
-            layoutFileStream -> writeText("[ChannelMap]\n", false, false, nullptr);
-            //Persyst uses first index = 1
-            int persystChannelIndex = 1;
-            for(auto channelName : channelNamesByStreamID[ch->getStreamId()]) {
-                layoutFileStream -> writeText(channelName + String("=") + String(persystChannelIndex++) + String("\n"), false, false, nullptr);
-            }
-            layoutFileStream -> writeText("[SampleTimes]\n", false, false, nullptr);
-            layoutFiles.add(layoutFileStream.release());
+        StreamSegments* segments = m_streamSegments.add(new StreamSegments());
+        segments->directory = contPath + getProcessorString(ch);
+        segments->relativeDirectory = ("continuous" + File::getSeparatorString() + getProcessorString(ch)).replace(File::getSeparatorString(), "/");
+        segments->sampleRate = ch->getSampleRate();
+        segments->bitVolts = ch->getBitVolts();
+        segments->numChannels = channelCounts[streamIndex];
+        segments->firstChannel = firstChannelIndexes[streamIndex];
+        segments->channelNames = channelNamesByStreamID[ch->getStreamId()];
+
+        int64 segmentLength = 0;
+        if (m_segmentMinutes > 0)
+            segmentLength = int64(m_segmentMinutes * 60.0 * ch->getSampleRate());
+        if (m_segmentGB > 0)
+        {
+            int64 segmentLengthBySize = (int64(m_segmentGB) << 30) / (int64(channelCounts[streamIndex]) * int64(sizeof(int16)));
+            segmentLength = segmentLength > 0 ? jmin(segmentLength, segmentLengthBySize) : segmentLengthBySize;
         }
-        else {
-            layoutFiles.add(nullptr);
+        segments->segmentLength = segmentLength;
+
+        /* The live tap follows the stream across segments, so it is opened once per recording */
+        ScopedPointer<LiveTap> tap;
+        if (m_liveTapSeconds > 0)
+        {
+            const String streamName = getProcessorString(ch).trimCharactersAtEnd(File::getSeparatorString());
+            tap = new LiveTap(segments->numChannels, segments->sampleRate, segments->bitVolts,
+                              int(jlimit(1.0, 1e9, double(m_liveTapSeconds) * segments->sampleRate)));
+            if (tap->open(LiveTap::getNameFor(streamName), streamName, segments->channelNames))
+                LOGC("Persyst: live tap of ", streamName, " at ", tap->getName());
+            else
+                tap = nullptr;
         }
+        m_liveTaps.add(tap.release());
     }
     
+    {
+        /* One entry per stream, and one for events of streams without continuous data */
+        const ScopedLock lock(m_recordStatsLock);
+        m_recordStats.clear();
+        for (int i = 0; i <= firstChannels.size(); i++)
+            m_recordStats.add(new RecordStreamStats())->start();
+
+        /* Asynchronous rings queue float samples, twice the size of what is written */
+        m_backpressure.clear();
+        for (int i = 0; i < firstChannels.size(); i++)
+        {
+            const double incomingBytesPerSecond = firstChannels[i]->getSampleRate() * channelCounts[i] * sizeof(int16);
+            m_backpressure.add(new BackpressureMonitor(incomingBytesPerSecond, m_asyncWrites ? sizeof(float) / double(sizeof(int16)) : 1.0));
+        }
+
+        m_saturation.clear();
+        for (int i = 0; i < firstChannels.size(); i++)
+            m_saturation.add(new SaturationStats(channelCounts[i]));
+
+        m_liveTapNames.clear();
+        for (auto tap : m_liveTaps)
+            m_liveTapNames.add(tap != nullptr ? tap->getName() : String());
+    }
+
+    /* Resolve each stream's targets once, so the write path only indexes plain arrays */
+    m_streamPlans.reset(new StreamPlan[firstChannels.size()]);
+    for (int i = 0; i < firstChannels.size(); i++)
+    {
+        m_streamPlans[i].staging = m_streamStaging[i];
+        m_streamPlans[i].stats = m_recordStats[i];
+        m_streamPlans[i].backpressure = m_backpressure[i];
+        m_streamPlans[i].saturation = m_saturation[i];
+        m_streamPlans[i].tap = m_liveTaps[i];
+        openSegment(i, 0);
+        openPreview(i);
+    }
+
     //Event data files
     String eventPath(basepath + "events" + File::getSeparatorString());
+    m_eventDirectory = getNumRecordedEventChannels() > 0 ? eventPath : String();
     Array<var> eventChannelJSON;
 
     std::map<String, int> ttlMap;
 
+    /* Events share the writer ring of their stream; streams without continuous data use the last ring */
+    std::map<uint16, int> ringsByStreamId;
+    for (int i = 0; i < firstChannels.size(); i++)
+        ringsByStreamId[firstChannels[i]->getStreamId()] = i;
+
     for (int ev = 0; ev < getNumRecordedEventChannels(); ev++)
     {
 
         const EventChannel* chan = getEventChannel(ev);
         String eventName;
-        NpyType type;
+
+        if (ringsByStreamId.count(chan->getStreamId()))
+            m_eventRings.add(ringsByStreamId[chan->getStreamId()]);
+        else
+            m_eventRings.add(firstChannels.size());
+
+        BaseType type;
+        int typeLength = 1;
         String dataFileName;
 
         switch (chan->getType())
@@ -184,7 +278,8 @@ void PersystRecordEngine::openFiles(File rootFolder, int experimentNumber, int r
         case EventChannel::TEXT:
             LOGD("Got text channel");
             eventName = "MessageCenter" + File::getSeparatorString();
-            type = NpyType(BaseType::CHAR, chan->getLength());
+            type = BaseType::CHAR;
+            typeLength = chan->getLength();
             dataFileName = "text";
             break;
         case EventChannel::TTL:
@@ -195,28 +290,36 @@ void PersystRecordEngine::openFiles(File rootFolder, int experimentNumber, int r
             else
                 ttlMap[eventName] = 0;
             eventName += "TTL" + (ttlMap[eventName] ? "_" + String(ttlMap[eventName]) : "") + File::getSeparatorString();
-            type = NpyType(BaseType::INT16, 1);
+            type = BaseType::INT16;
             dataFileName = "states";
             break;
         default:
             LOGD("Got BINARY group");
             eventName = getProcessorString(chan);
             eventName += "BINARY_group";
-            type = NpyType(chan->getEquivalentMetadataType(), chan->getLength());
+            type = chan->getEquivalentMetadataType();
+            typeLength = chan->getLength();
             dataFileName = "data_array";
             break;
         }
 
         ScopedPointer<EventRecording> rec = new EventRecording();
 
-        rec->data = std::make_unique<NpyFile>(eventPath + eventName + dataFileName + ".npy", type);
-        rec->samples = std::make_unique<NpyFile>(eventPath + eventName + "sample_numbers.npy", NpyType(BaseType::INT64, 1));
-        rec->timestamps = std::make_unique<NpyFile>(eventPath + eventName + "timestamps.npy", NpyType(BaseType::DOUBLE, 1));
+        rec->data = std::make_unique<NpyWriter>(eventPath + eventName + dataFileName + ".npy", type, typeLength);
+        rec->samples = std::make_unique<NpyWriter>(eventPath + eventName + "sample_numbers.npy", BaseType::INT64);
+        rec->timestamps = std::make_unique<NpyWriter>(eventPath + eventName + "timestamps.npy", BaseType::DOUBLE);
         if (chan->getType() == EventChannel::TTL && m_saveTTLWords)
         {
-            rec->extraFile = std::make_unique<NpyFile>(eventPath + eventName + "full_words.npy", NpyType(BaseType::UINT64, 1));
+            rec->extraFile = std::make_unique<NpyWriter>(eventPath + eventName + "full_words.npy", BaseType::UINT64);
         }
 
+        rec->columns = std::make_unique<EventColumnBuffer>(EVENT_BUFFER_RECORDS);
+        rec->dataColumn = rec->columns->addColumn(chan->getType() == EventChannel::TTL ? sizeof(int16) : chan->getDataSize());
+        rec->samplesColumn = rec->columns->addColumn(sizeof(int64));
+        rec->timestampsColumn = rec->columns->addColumn(sizeof(double));
+        if (rec->extraFile)
+            rec->extraColumn = rec->columns->addColumn(sizeof(uint64));
+
         DynamicObject::Ptr jsonChannel = new DynamicObject();
         jsonChannel->setProperty("folder_name", eventName.replace(File::getSeparatorString(), "/"));
         jsonChannel->setProperty("channel_name", chan->getName());
@@ -224,7 +327,7 @@ void PersystRecordEngine::openFiles(File rootFolder, int experimentNumber, int r
 
         jsonChannel->setProperty("identifier", chan->getIdentifier());
         jsonChannel->setProperty("sample_rate", chan->getSampleRate());
-        jsonChannel->setProperty("type", jsonTypeValue(type.getType()));
+        jsonChannel->setProperty("type", jsonTypeValue(type));
         jsonChannel->setProperty("source_processor", chan->getSourceNodeName());
         jsonChannel->setProperty("stream_name", chan->getStreamName());
 
@@ -240,27 +343,122 @@ void PersystRecordEngine::openFiles(File rootFolder, int experimentNumber, int r
         eventChannelJSON.add(var(jsonChannel));
     }
 
+    /* One checkpoint writer per ring, each handled by a single thread in either write mode */
+    if (m_checkpointSeconds > 0)
+    {
+        m_checkpointer = std::make_unique<RecordingCheckpointer>(RecordingCheckpointer::getJournalFileFor(File(basepath)),
+                                                                 firstChannels.size() + 1,
+                                                                 m_checkpointSeconds * 1000);
+        m_checkpointer->startThread();
+    }
+
+    if (m_asyncWrites)
+    {
+        const ScopedLock lock(m_asyncWriterLock);
+        m_asyncWriter = std::make_unique<AsyncRecordWriter>(*this,
+                                                            firstChannels.size() + 1,
+                                                            size_t(m_ringSizeMB) * 1024 * 1024,
+                                                            m_writerThreads,
+                                                            m_writerFirstCore);
+        m_asyncWriter->start();
+    }
+
+    /* Every stream's files were opened by this call, so each entry gets its whole duration */
+    const int64 openNs = RecordStreamStats::nanosecondsSince(openStart);
+    for (auto stats : m_recordStats)
+        stats->getHistogram(RecordStreamStats::OPEN).record(openNs);
 }
 
 void PersystRecordEngine::closeFiles()
 {
+    const int64 closeStart = RecordStreamStats::now();
+
+    if (m_asyncWriter)
+    {
+        /* Write out everything still queued before the files go away */
+        m_asyncWriter->stop();
+
+        const ScopedLock lock(m_asyncWriterLock);
+        m_lastRingStats.clear();
+        for (int i = 0; i < m_asyncWriter->getNumRings(); i++)
+        {
+            AsyncRecordWriter::RingStats stats = m_asyncWriter->getStats(i);
+            LOGD("Persyst writer ring ", i, ": high-water mark ", (int64)stats.highWaterMark, " of ", (int64)stats.capacity, " bytes, ", stats.stalls, " stalls");
+            m_lastRingStats.add(stats);
+        }
+        m_asyncWriter.reset();
+    }
 
-    for(auto layoutFile : layoutFiles){
-        layoutFile -> flush();
+    /* The journal stays valid until every file below is complete */
+    if (m_checkpointer)
+        m_checkpointer->stopThread(-1);
+
+    for (int i = 0; i < m_streamStaging.size(); i++)
+    {
+        writeStagedChannels(i);
     }
-    layoutFiles.clear();
-    m_continuousFiles.clear();
+    m_streamStaging.clear();
 
-    m_channelIndexes.clear();
-    m_fileIndexes.clear();
+    for (int i = 0; i < m_streamSegments.size(); i++)
+    {
+        closeSegment(i);
+        closePreview(i);
+    }
+    m_streamPreviews.clear();
+
+    /* Closing the data files published their last blocks; readers now see the taps stopped */
+    m_liveTaps.clear();
+
+    for (auto stats : m_recordStats)
+        stats->stop();
+
+    {
+        const ScopedLock lock(m_layoutFilesLock);
+        m_lastSampleTimesStats.clear();
 
-    m_scaledBuffer.malloc(MAX_BUFFER_SIZE);
-    m_intBuffer.malloc(MAX_BUFFER_SIZE);
+        for (int i = 0; i < m_streamSegments.size(); i++)
+        {
+            const SampleTimesWriter::Stats& stats = m_streamSegments[i]->closedSampleTimes;
+            LOGD("Persyst SampleTimes ", i, ": ", stats.rowsEmitted, " rows written, ",
+                 stats.rowsSuppressed, " suppressed, ", stats.discontinuities, " discontinuities");
+            m_lastSampleTimesStats.add(stats);
+        }
+        layoutFiles.clear();
+    }
+    m_continuousFiles.clear();
+    m_envelopes.clear();
+    m_checksums.clear();
+
+    m_channelPlans.reset();
+    m_streamPlans.reset();
 
-    m_samplesWritten.clear();
+    m_samplesWritten.free();
     
+    for (auto rec : m_eventFiles)
+        flushEventColumns(rec);
     m_eventFiles.clear();
+    m_eventRings.clear();
+
+    /* A recording closed normally needs no recovery */
+    if (m_checkpointer)
+    {
+        m_checkpointer->getJournalFile().deleteFile();
+        m_checkpointer.reset();
+    }
+
+    /* Everything above is closing; the statistics files below already include it */
+    const int64 closeNs = RecordStreamStats::nanosecondsSince(closeStart);
+    for (auto stats : m_recordStats)
+        stats->getHistogram(RecordStreamStats::CLOSE).record(closeNs);
+
+    for (int i = 0; i < m_streamSegments.size(); i++)
+    {
+        writeRecordStats(i);
+    }
+    writeEventRecordStats();
 
+    const ScopedLock lock(m_layoutFilesLock);
+    m_streamSegments.clear();
 }
 
 void PersystRecordEngine::writeContinuousData(int writeChannel, 
@@ -272,94 +470,814 @@ void PersystRecordEngine::writeContinuousData(int writeChannel,
     if (!size)
         return;
 
-    /* If our internal buffer is too small to hold the data... */
-    if (size > m_bufferSize) //shouldn't happen, but if does, this prevents crash...
+    const ChannelPlan& plan = m_channelPlans[writeChannel];
+    ScopedLatency timer(&m_streamPlans[plan.streamIndex].stats->getHistogram(RecordStreamStats::WRITE_CALL));
+
+    if (plan.channelIndex == 0)
+        checkBackpressure(plan.streamIndex);
+
+    if (m_asyncWriter)
+        m_asyncWriter->pushContinuousData(plan.streamIndex, writeChannel, realChannel, dataBuffer, ftsBuffer, size);
+    else
+        writeContinuousBlock(writeChannel, realChannel, dataBuffer, ftsBuffer[0], size);
+}
+
+void PersystRecordEngine::checkBackpressure(int streamIndex)
+{
+    const StreamPlan& stream = m_streamPlans[streamIndex];
+
+    int64 queuedBytes = 0;
+    int64 capacityBytes = 0;
+    if (m_asyncWriter)
     {
-        std::cerr << "[RN] Write buffer overrun, resizing from: " << m_bufferSize << " to: " << size << std::endl;
-        m_scaledBuffer.malloc(size);
-        m_intBuffer.malloc(size);
-        m_bufferSize = size;
+        AsyncRecordWriter::RingStats ring = m_asyncWriter->getStats(streamIndex);
+        queuedBytes = int64(ring.usedBytes);
+        capacityBytes = int64(ring.capacity);
     }
 
-    /* Convert signal from float to int w/ bitVolts scaling */
-    double multFactor = 1 / (float(0x7fff) * getContinuousChannel(realChannel)->getBitVolts());
-    FloatVectorOperations::copyWithMultiply(m_scaledBuffer.getData(), dataBuffer, multFactor, size);
-    AudioDataConverters::convertFloatToInt16LE(m_scaledBuffer.getData(), m_intBuffer.getData(), size);
+    const double now = Time::getMillisecondCounterHiRes() * 0.001;
+    switch (stream.backpressure->update(now, stream.stats->getBytes(), queuedBytes, capacityBytes))
+    {
+    case BackpressureMonitor::WARNING:
+    {
+        const BackpressureMonitor::Status status = stream.backpressure->getStatus();
+        const String directory = m_streamSegments[streamIndex]->directory;
+        if (status.secondsToOverflow >= 0)
+            LOGE("Persyst: disk is not keeping up with ", directory, ": writing ", status.writtenBytesPerSecond / 1e6,
+                 " MB/s of ", status.incomingBytesPerSecond / 1e6, " MB/s, writer buffer full in ", status.secondsToOverflow, " s");
+        else
+            LOGE("Persyst: disk is not keeping up with ", directory, ": writing ", status.writtenBytesPerSecond / 1e6,
+                 " MB/s of ", status.incomingBytesPerSecond / 1e6, " MB/s");
+        break;
+    }
+    case BackpressureMonitor::RECOVERED:
+        LOGC("Persyst: disk caught up with ", m_streamSegments[streamIndex]->directory);
+        break;
+    default:
+        break;
+    }
+}
 
-    /* Get the file index that belongs to the current recording channel */
-    int fileIndex = m_fileIndexes[writeChannel];
+void PersystRecordEngine::writeContinuousBlock(int writeChannel,
+                                               int realChannel,
+                                               const float* dataBuffer,
+                                               double firstTimestamp,
+                                               int size)
+{
 
-    /* Write the data to that file */
-    m_continuousFiles[fileIndex]->writeChannel(
-        m_samplesWritten[writeChannel],
-        m_channelIndexes[writeChannel],
-        m_intBuffer.getData(),
-        size);
-    
+    const ChannelPlan& plan = m_channelPlans[writeChannel];
+    const StreamPlan& stream = m_streamPlans[plan.streamIndex];
+
+    const float multFactor = plan.scale;
+    const int fileIndex = plan.streamIndex;
+    const int channelIndex = plan.channelIndex;
+    StreamStaging* staging = stream.staging;
+    RecordStreamStats* stats = stream.stats;
+    int64& samplesWritten = m_samplesWritten[writeChannel];
+
+    if (channelIndex == 0 && samplesWritten >= stream.segmentEnd && canRollOver(fileIndex))
+    {
+        /* Every channel has finished the previous block, so the segment ends exactly here */
+        writeStagedChannels(fileIndex);
+        {
+            ScopedLatency timer(&stats->getHistogram(RecordStreamStats::CLOSE));
+            closeSegment(fileIndex);
+        }
+        {
+            ScopedLatency timer(&stats->getHistogram(RecordStreamStats::OPEN));
+            openSegment(fileIndex, samplesWritten);
+        }
+    }
+
+    if (channelIndex == 0 && m_checkpointer != nullptr && m_checkpointer->isDue(fileIndex))
+        publishCheckpoint(fileIndex);
+
+    if (m_wholeStreamWrites && channelIndex == 0)
+    {
+        /* Start gathering a new block for this stream */
+        writeStagedChannels(fileIndex);
+
+        if (size > staging->stride)
+        {
+            staging->stride = size;
+            staging->data.malloc(staging->stride * staging->numChannels);
+        }
+
+        staging->size = size;
+        staging->startPos = samplesWritten - stream.segmentStart;
+    }
+
+    if (m_wholeStreamWrites && staging->size == size && staging->channelsStaged == channelIndex)
+    {
+        /* Convert straight into the channel's row; the stream is interleaved once all rows are in */
+        {
+            ScopedLatency timer(&stats->getHistogram(RecordStreamStats::CONVERSION));
+            SampleConversion::ClipStats clip;
+            SampleConversion::floatToInt16(dataBuffer, staging->data + channelIndex * staging->stride, multFactor, size, clip);
+            stream.saturation->add(channelIndex, size, clip);
+        }
+
+        if (++staging->channelsStaged == staging->numChannels)
+        {
+            if (stream.file != nullptr)
+                stream.file->writeChannels(staging->startPos, staging->data, staging->stride, size);
+            staging->channelsStaged = 0;
+        }
+    }
+    else
+    {
+        if (m_wholeStreamWrites)
+        {
+            /* Channels of this stream did not arrive as one uniform block, fall back to per-channel writes */
+            writeStagedChannels(fileIndex);
+            staging->size = -1;
+        }
+
+        /* Convert signal from float to int w/ bitVolts scaling, straight into the file's blocks */
+        if (stream.file != nullptr)
+        {
+            SampleConversion::ClipStats clip;
+            stream.file->writeChannel(
+                samplesWritten - stream.segmentStart,
+                channelIndex,
+                dataBuffer,
+                multFactor,
+                size,
+                &clip);
+            stream.saturation->add(channelIndex, size, clip);
+        }
+    }
 
     /* If is first channel in stream, then write timestamp for sample */
-    if (m_channelIndexes[writeChannel] == 0)
+    if (channelIndex == 0)
     {
 
-        int64 baseSampleNumber = m_samplesWritten[writeChannel];
-        String timestampString = String(baseSampleNumber) + String("=") + String(ftsBuffer[0]) + String("\n");
-        layoutFiles[fileIndex]  -> writeText(timestampString, false, false, nullptr);        
+        if (stream.sampleTimes != nullptr)
+        {
+            ScopedLatency timer(&stats->getHistogram(RecordStreamStats::LAY_WRITE));
+            stream.sampleTimes->add(samplesWritten - stream.segmentStart, firstTimestamp);
+        }
+
+        if (stream.tap != nullptr)
+            stream.tap->addSampleTime(samplesWritten, firstTimestamp);
+    }
+
+    if (stream.preview != nullptr)
+    {
+        ScopedLatency timer(&stats->getHistogram(RecordStreamStats::PREVIEW));
+        writePreview(plan, dataBuffer, firstTimestamp, samplesWritten, size);
     }
     
-    m_samplesWritten.set(writeChannel, m_samplesWritten[writeChannel] + size);
+    samplesWritten += size;
+    stats->addSamples(channelIndex == 0 ? size : 0, int64(size) * int64(sizeof(int16)));
+
+}
+
+void PersystRecordEngine::writeStagedChannels(int fileIndex)
+{
+    StreamStaging* staging = m_streamPlans[fileIndex].staging;
+    InterleavedBlockFile* file = m_streamPlans[fileIndex].file;
+
+    if (file != nullptr)
+    {
+        for (int ch = 0; ch < staging->channelsStaged; ch++)
+            file->writeChannel(staging->startPos, ch, staging->data + ch * staging->stride, staging->size);
+    }
+
+    staging->channelsStaged = 0;
+}
+
+void PersystRecordEngine::openSegment(int streamIndex, int64 firstSample)
+{
+    StreamSegments* segments = m_streamSegments[streamIndex];
+    StreamPlan& stream = m_streamPlans[streamIndex];
+    const bool rollover = segments->segmentLength > 0;
+
+    segments->segmentIndex++;
+
+    /* Without rollover a stream keeps its single recording.dat / recording.lay pair */
+    String baseName = "recording";
+    if (rollover)
+        baseName += "_" + String(segments->segmentIndex).paddedLeft('0', 4);
+
+    String dataFileName = baseName + ".dat";
+    String layoutFileName = baseName + ".lay";
+    segments->dataFileName = dataFileName;
+    segments->layoutFileName = layoutFileName;
+
+    ScopedPointer<InterleavedBlockFile> bFile = new InterleavedBlockFile(segments->numChannels,
+                                                                         samplesPerBlock,
+                                                                         BlockFileSink::Type(m_continuousBackend));
+
+    if (bFile->openFile(segments->directory + dataFileName))
+    {
+        bFile->setStats(stream.stats);
+        m_continuousFiles.set(streamIndex, bFile.release());
+    }
+    else
+        m_continuousFiles.set(streamIndex, nullptr);
+
+    /* The envelope and checksums see each block of the data file as it is written */
+    ScopedPointer<EnvelopePyramid> envelope;
+    if (m_envelopeMode > 0 && m_continuousFiles[streamIndex] != nullptr)
+    {
+        envelope = new EnvelopePyramid(segments->numChannels, m_envelopeMode == 2);
+        if (envelope->openFile(segments->directory + baseName + ".env"))
+            m_continuousFiles[streamIndex]->addListener(envelope);
+        else
+            envelope = nullptr;
+    }
+    m_envelopes.set(streamIndex, envelope.release());
+
+    ScopedPointer<BlockChecksumWriter> checksums;
+    if (m_blockChecksums && m_continuousFiles[streamIndex] != nullptr)
+    {
+        checksums = new BlockChecksumWriter(segments->numChannels);
+        if (checksums->openFile(segments->directory + baseName + ".crc"))
+            m_continuousFiles[streamIndex]->addListener(checksums);
+        else
+            checksums = nullptr;
+    }
+    m_checksums.set(streamIndex, checksums.release());
 
+    /* The live tap numbers the frames of every segment from the start of the stream */
+    LiveTap* tap = m_liveTaps[streamIndex];
+    if (tap != nullptr && m_continuousFiles[streamIndex] != nullptr)
+    {
+        tap->setSegmentStart(firstSample);
+        m_continuousFiles[streamIndex]->addListener(tap);
+    }
+
+    PersystLayFileFormat layoutFile = PersystLayFileFormat::create(segments->directory + layoutFileName,
+                                                                     segments->sampleRate,
+                                                                     segments->bitVolts,
+                                                                     segments->numChannels)
+                                                            .withDataFile(dataFileName);
+    if (rollover)
+        layoutFile.withSegment(segments->segmentIndex, firstSample);
+
+    SampleTimesWriter* sampleTimes = createLayoutFile(layoutFile, segments->channelNames, segments->sampleRate);
+
+    {
+        const ScopedLock lock(m_layoutFilesLock);
+        layoutFiles.set(streamIndex, sampleTimes);
+    }
+
+    stream.file = m_continuousFiles[streamIndex];
+    stream.sampleTimes = sampleTimes;
+    stream.segmentStart = firstSample;
+    stream.segmentEnd = rollover ? firstSample + segments->segmentLength : std::numeric_limits<int64>::max();
+
+    if (rollover)
+    {
+        DynamicObject::Ptr entry = new DynamicObject();
+        entry->setProperty("index", segments->segmentIndex);
+        entry->setProperty("data_file", dataFileName);
+        entry->setProperty("layout_file", layoutFileName);
+        entry->setProperty("first_sample", firstSample);
+        segments->manifest.add(var(entry));
+        writeSegmentManifest(streamIndex);
+    }
+}
+
+void PersystRecordEngine::closeSegment(int streamIndex)
+{
+    StreamSegments* segments = m_streamSegments[streamIndex];
+    StreamPlan& stream = m_streamPlans[streamIndex];
+
+    {
+        const ScopedLock lock(m_layoutFilesLock);
+        if (stream.sampleTimes != nullptr)
+        {
+            stream.sampleTimes->finish();
+            SampleTimesWriter::Stats stats = stream.sampleTimes->getStats();
+            segments->closedSampleTimes.rowsEmitted += stats.rowsEmitted;
+            segments->closedSampleTimes.rowsSuppressed += stats.rowsSuppressed;
+            segments->closedSampleTimes.discontinuities += stats.discontinuities;
+        }
+        /* Closed files still have to reach the disk before the journal can stop describing them */
+        if (m_checkpointer)
+        {
+            if (stream.file != nullptr)
+                segments->unsyncedFiles.add(stream.file->getSyncHandle());
+            if (stream.sampleTimes != nullptr)
+                segments->unsyncedFiles.add(stream.sampleTimes->getSyncHandle());
+        }
+        layoutFiles.set(streamIndex, nullptr);
+    }
+
+    /* Deleting the file writes out its last, partial block, which completes the envelope */
+    m_continuousFiles.set(streamIndex, nullptr);
+    m_envelopes.set(streamIndex, nullptr);
+    m_checksums.set(streamIndex, nullptr);
+    stream.file = nullptr;
+    stream.sampleTimes = nullptr;
+
+    if (segments->segmentLength > 0 && segments->manifest.size() > 0)
+    {
+        const int64 numSamples = getStreamSamplesWritten(streamIndex) - stream.segmentStart;
+        segments->manifest.getReference(segments->manifest.size() - 1).getDynamicObject()->setProperty("num_samples", numSamples);
+        writeSegmentManifest(streamIndex);
+    }
+}
+
+SampleTimesWriter* PersystRecordEngine::createLayoutFile(PersystLayFileFormat& layoutFile, const Array<String>& channelNames, double sampleRate)
+{
+    SampleTimesWriter* sampleTimes = nullptr;
+
+    ScopedPointer<SyncableFileStream> layoutFileStream  = new SyncableFileStream(layoutFile.getLayoutFilePath());
+    if(layoutFileStream -> openedOk()){
+        layoutFileStream -> writeText(layoutFile.toString(), false, false, nullptr);
+        layoutFileStream -> writeText("[ChannelMap]\n", false, false, nullptr);
+        //Persyst uses first index = 1
+        int persystChannelIndex = 1;
+        for(auto channelName : channelNames) {
+            layoutFileStream -> writeText(channelName + String("=") + String(persystChannelIndex++) + String("\n"), false, false, nullptr);
+        }
+        layoutFileStream -> writeText("[SampleTimes]\n", false, false, nullptr);
+        sampleTimes = new SampleTimesWriter(layoutFileStream.release());
+        if (m_compressSampleTimes)
+            sampleTimes->setCompression(sampleRate, m_sampleTimesToleranceUs * 1e-6, m_sampleTimesKeyframeSeconds);
+    }
+
+    return sampleTimes;
+}
+
+void PersystRecordEngine::openPreview(int streamIndex)
+{
+    const StreamSegments* segments = m_streamSegments[streamIndex];
+    const int factor = m_previewRate > 0 ? Decimator::getFactorFor(segments->sampleRate, m_previewRate) : 0;
+
+    if (factor < 2)
+    {
+        if (m_previewRate > 0)
+            LOGC("Persyst: no preview for ", segments->directory, ", its sample rate is already close to ", m_previewRate, " Hz");
+        m_streamPreviews.set(streamIndex, nullptr);
+        return;
+    }
+
+    ScopedPointer<StreamPreview> preview = new StreamPreview();
+    preview->decimator = std::make_unique<Decimator>(factor);
+    for (int ch = 0; ch < segments->numChannels; ch++)
+        preview->channels.add(new Decimator::Channel(*preview->decimator));
+    preview->outputSize = jmax(preview->decimator->getMaxOutputs(PREVIEW_CHUNK), preview->decimator->getMaxFlushOutputs());
+    preview->output.malloc(preview->outputSize);
+    preview->samplesWritten.calloc(segments->numChannels);
+    preview->active.calloc(segments->numChannels);
+
+    /* The preview is small, so it is always one buffered file per recording, whatever the segmenting */
+    const double previewRate = segments->sampleRate / factor;
+    preview->file = std::make_unique<InterleavedBlockFile>(segments->numChannels, samplesPerBlock);
+    if (!preview->file->openFile(segments->directory + "preview.dat"))
+    {
+        m_streamPreviews.set(streamIndex, nullptr);
+        return;
+    }
+
+    PersystLayFileFormat layoutFile = PersystLayFileFormat::create(segments->directory + "preview.lay",
+                                                                     roundToInt(previewRate),
+                                                                     segments->bitVolts,
+                                                                     segments->numChannels)
+                                                            .withDataFile("preview.dat");
+    preview->sampleTimes.reset(createLayoutFile(layoutFile, segments->channelNames, previewRate));
+
+    m_streamPlans[streamIndex].preview = preview;
+    m_streamPreviews.set(streamIndex, preview.release());
+}
+
+void PersystRecordEngine::writePreview(const ChannelPlan& plan, const float* dataBuffer, double firstTimestamp, int64 firstSample, int size)
+{
+    const StreamPlan& stream = m_streamPlans[plan.streamIndex];
+    StreamPreview* preview = stream.preview;
+    const int channel = plan.channelIndex;
+    const int factor = preview->decimator->getFactor();
+
+    if (channel == 0)
+    {
+        /* Decided once per block, so every channel skips the same samples */
+        const bool suspend = stream.backpressure->isFallingBehind();
+        if (suspend != preview->suspended)
+        {
+            if (suspend)
+                LOGC("Persyst: pausing the preview of ", m_streamSegments[plan.streamIndex]->directory, " until the disk catches up");
+            else
+                LOGC("Persyst: resuming the preview of ", m_streamSegments[plan.streamIndex]->directory);
+            preview->suspended = suspend;
+        }
+    }
+
+    if (preview->suspended)
+    {
+        /* The preview is the first thing dropped when the disk falls behind; finish what is in the filter */
+        if (preview->active[channel])
+            flushPreviewChannel(preview, channel, plan.scale);
+        return;
+    }
+
+    Decimator::Channel* filter = preview->channels[channel];
+    if (!preview->active[channel])
+    {
+        /* A new run of the preview: its next sample is centred on this block's first sample */
+        filter->reset();
+        preview->active[channel] = true;
+        if (channel == 0)
+        {
+            preview->anchorInput = firstSample;
+            preview->anchorPreview = preview->samplesWritten[0];
+        }
+    }
+
+    if (channel == 0 && preview->sampleTimes != nullptr)
+    {
+        /* First preview sample centred in this block, timed on the stream's clock */
+        const int64 k = (firstSample - preview->anchorInput + factor - 1) / factor;
+        const int64 previewSample = preview->anchorPreview + k;
+        if (previewSample > preview->lastSampleTimesRow && preview->anchorInput + k * factor < firstSample + size)
+        {
+            const double offset = double(preview->anchorInput + k * factor - firstSample) / m_streamSegments[plan.streamIndex]->sampleRate;
+            preview->sampleTimes->add(previewSample, firstTimestamp + offset);
+            preview->lastSampleTimesRow = previewSample;
+        }
+    }
+
+    for (int offset = 0; offset < size; offset += PREVIEW_CHUNK)
+    {
+        const int outputs = filter->process(dataBuffer + offset, jmin(PREVIEW_CHUNK, size - offset), preview->output);
+        if (outputs > 0)
+        {
+            preview->file->writeChannel(preview->samplesWritten[channel], channel, preview->output, plan.scale, outputs);
+            preview->samplesWritten[channel] += outputs;
+        }
+    }
+}
+
+void PersystRecordEngine::flushPreviewChannel(StreamPreview* preview, int channel, float scale)
+{
+    const int outputs = preview->channels[channel]->flush(preview->output);
+    if (outputs > 0)
+    {
+        preview->file->writeChannel(preview->samplesWritten[channel], channel, preview->output, scale, outputs);
+        preview->samplesWritten[channel] += outputs;
+    }
+    preview->active[channel] = false;
+}
+
+void PersystRecordEngine::closePreview(int streamIndex)
+{
+    StreamPreview* preview = m_streamPreviews[streamIndex];
+    if (preview == nullptr)
+        return;
+
+    const StreamSegments* segments = m_streamSegments[streamIndex];
+    for (int ch = 0; ch < segments->numChannels; ch++)
+    {
+        if (preview->active[ch])
+            flushPreviewChannel(preview, ch, m_channelPlans[segments->firstChannel + ch].scale);
+    }
+
+    if (preview->sampleTimes != nullptr)
+        preview->sampleTimes->finish();
+
+    /* Deleting the file writes out its last, partial block */
+    preview->sampleTimes.reset();
+    preview->file.reset();
+    m_streamPlans[streamIndex].preview = nullptr;
+}
+
+void PersystRecordEngine::publishCheckpoint(int ring)
+{
+    Array<FileSyncHandle::Ptr> files;
+    Array<var> entries;
+
+    /* Only hands buffered data to the operating system; the checkpointer thread does the syncing */
+    if (ring < m_streamSegments.size())
+    {
+        StreamSegments* segments = m_streamSegments[ring];
+        const StreamPlan& stream = m_streamPlans[ring];
+
+        files.addArray(segments->unsyncedFiles);
+        segments->unsyncedFiles.clear();
+
+        DynamicObject::Ptr entry = new DynamicObject();
+        entry->setProperty("type", "continuous");
+        entry->setProperty("directory", segments->relativeDirectory);
+        entry->setProperty("data_file", segments->dataFileName);
+        entry->setProperty("layout_file", segments->layoutFileName);
+        entry->setProperty("sample_rate", segments->sampleRate);
+        entry->setProperty("bit_volts", segments->bitVolts);
+        entry->setProperty("num_channels", segments->numChannels);
+
+        Array<var> channelNames;
+        for (const String& name : segments->channelNames)
+            channelNames.add(name);
+        entry->setProperty("channel_names", channelNames);
+
+        if (segments->segmentLength > 0)
+        {
+            entry->setProperty("segment_index", segments->segmentIndex);
+            entry->setProperty("first_sample", stream.segmentStart);
+        }
+
+        entry->setProperty("preallocated", m_continuousBackend == BlockFileSink::MAPPED);
+        entry->setProperty("samples", stream.file != nullptr ? stream.file->flush() : int64(0));
+
+        if (stream.sampleTimes != nullptr)
+        {
+            stream.sampleTimes->flush();
+
+            int64 lastSample;
+            double lastTime;
+            if (stream.sampleTimes->getLastRow(lastSample, lastTime))
+            {
+                entry->setProperty("last_sample", lastSample);
+                entry->setProperty("last_time", lastTime);
+            }
+        }
+
+        if (stream.file != nullptr)
+            files.add(stream.file->getSyncHandle());
+        if (stream.sampleTimes != nullptr)
+            files.add(stream.sampleTimes->getSyncHandle());
+        entries.add(var(entry));
+
+        if (stream.preview != nullptr)
+        {
+            stream.preview->file->flush();
+            files.add(stream.preview->file->getSyncHandle());
+            if (stream.preview->sampleTimes != nullptr)
+            {
+                stream.preview->sampleTimes->flush();
+                files.add(stream.preview->sampleTimes->getSyncHandle());
+            }
+        }
+    }
+
+    for (int ev = 0; ev < m_eventFiles.size(); ev++)
+    {
+        EventRecording* rec = m_eventFiles[ev];
+        if (rec == nullptr || m_eventRings[ev] != ring)
+            continue;
+
+        /* Rewriting the record count in place also writes out each file's buffer */
+        flushEventColumns(rec);
+        for (NpyWriter* file : { rec->data.get(), rec->samples.get(), rec->timestamps.get(), rec->channels.get(), rec->extraFile.get() })
+        {
+            if (file != nullptr)
+            {
+                file->updateHeader();
+                files.add(file->getSyncHandle());
+            }
+        }
+    }
+
+    m_checkpointer->publish(ring, files, entries);
+}
+
+bool PersystRecordEngine::canRollOver(int streamIndex) const
+{
+    /* Only split where every channel of the stream has written the same number of samples */
+    const StreamSegments* segments = m_streamSegments[streamIndex];
+    const int64 first = m_samplesWritten[segments->firstChannel];
+
+    for (int ch = 1; ch < segments->numChannels; ch++)
+    {
+        if (m_samplesWritten[segments->firstChannel + ch] != first)
+            return false;
+    }
+    return true;
+}
+
+int64 PersystRecordEngine::getStreamSamplesWritten(int streamIndex) const
+{
+    const StreamSegments* segments = m_streamSegments[streamIndex];
+    int64 samples = 0;
+
+    for (int ch = 0; ch < segments->numChannels; ch++)
+        samples = jmax(samples, m_samplesWritten[segments->firstChannel + ch]);
+    return samples;
+}
+
+void PersystRecordEngine::writeSegmentManifest(int streamIndex)
+{
+    const StreamSegments* segments = m_streamSegments[streamIndex];
+
+    DynamicObject::Ptr manifest = new DynamicObject();
+    manifest->setProperty("sample_rate", segments->sampleRate);
+    manifest->setProperty("num_channels", segments->numChannels);
+    manifest->setProperty("segments", segments->manifest);
+
+    File manifestFile(segments->directory + "segments.json");
+    if (!manifestFile.replaceWithText(JSON::toString(var(manifest))))
+        std::cerr << "[Persyst] Could not write segment manifest " << manifestFile.getFullPathName() << std::endl;
+}
+
+/* Counters, throughput and latency summaries shared by every persyst_stats.json */
+static DynamicObject::Ptr recordStatsToJson(const RecordStreamStats::Snapshot& stats)
+{
+    DynamicObject::Ptr json = new DynamicObject();
+    json->setProperty("samples", stats.samples);
+    json->setProperty("bytes", stats.bytes);
+    json->setProperty("blocks", stats.blocks);
+    json->setProperty("events", stats.events);
+    json->setProperty("elapsed_seconds", stats.elapsedSeconds);
+    json->setProperty("mb_per_second", stats.elapsedSeconds > 0 ? stats.bytes / stats.elapsedSeconds / (1024.0 * 1024.0) : 0.0);
+
+    DynamicObject::Ptr latency = new DynamicObject();
+    for (int phase = 0; phase < RecordStreamStats::NUM_PHASES; phase++)
+    {
+        const LatencyHistogram::Summary& summary = stats.latency[phase];
+
+        DynamicObject::Ptr histogram = new DynamicObject();
+        histogram->setProperty("count", summary.count);
+        histogram->setProperty("mean_ns", summary.meanNs);
+        histogram->setProperty("p50_ns", summary.p50Ns);
+        histogram->setProperty("p90_ns", summary.p90Ns);
+        histogram->setProperty("p99_ns", summary.p99Ns);
+        histogram->setProperty("p999_ns", summary.p999Ns);
+        histogram->setProperty("max_ns", summary.maxNs);
+        latency->setProperty(RecordStreamStats::getPhaseName(RecordStreamStats::Phase(phase)), var(histogram));
+    }
+    json->setProperty("latency", var(latency));
+    return json;
+}
+
+void PersystRecordEngine::writeRecordStats(int streamIndex)
+{
+    DynamicObject::Ptr json = recordStatsToJson(m_recordStats[streamIndex]->getSnapshot());
+
+    const StreamSegments* segments = m_streamSegments[streamIndex];
+    const SaturationStats::Snapshot saturation = m_saturation[streamIndex]->getSnapshot();
+    json->setProperty("saturated_samples", saturation.saturated);
+    json->setProperty("saturated_channels", saturation.saturatedChannels);
+
+    Array<var> channels;
+    for (int ch = 0; ch < saturation.channels.size(); ch++)
+    {
+        const SaturationStats::Channel& channel = saturation.channels.getReference(ch);
+
+        DynamicObject::Ptr channelJson = new DynamicObject();
+        channelJson->setProperty("name", segments->channelNames[ch]);
+        channelJson->setProperty("saturated", channel.saturated);
+        if (channel.samples > 0)
+        {
+            channelJson->setProperty("min", channel.minimum);
+            channelJson->setProperty("max", channel.maximum);
+            channelJson->setProperty("min_uv", channel.minimum * segments->bitVolts);
+            channelJson->setProperty("max_uv", channel.maximum * segments->bitVolts);
+        }
+        channels.add(var(channelJson));
+    }
+    json->setProperty("channels", channels);
+
+    if (saturation.saturated > 0)
+        LOGC("Persyst: ", saturation.saturated, " samples saturated on ", saturation.saturatedChannels,
+             " channels of ", segments->directory);
+
+    File statsFile(segments->directory + "persyst_stats.json");
+    if (!statsFile.replaceWithText(JSON::toString(var(json))))
+        std::cerr << "[Persyst] Could not write record statistics " << statsFile.getFullPathName() << std::endl;
+}
+
+void PersystRecordEngine::writeEventRecordStats()
+{
+    /* The last entry holds the events of streams without continuous data */
+    if (m_eventDirectory.isEmpty() || m_recordStats.size() == 0)
+        return;
+
+    DynamicObject::Ptr json = recordStatsToJson(m_recordStats.getLast()->getSnapshot());
+
+    File statsFile(m_eventDirectory + "persyst_stats.json");
+    if (!statsFile.replaceWithText(JSON::toString(var(json))))
+        std::cerr << "[Persyst] Could not write record statistics " << statsFile.getFullPathName() << std::endl;
 }
 
 void PersystRecordEngine::writeEvent(int eventChannel, const EventPacket& event)
 {
+    if (m_asyncWriter)
+        m_asyncWriter->pushEvent(m_eventRings[eventChannel], eventChannel, event);
+    else
+        writeEventPacket(eventChannel, event);
+}
 
-    const EventChannel* info = getEventChannel(eventChannel);
+void PersystRecordEngine::writeEventPacket(int eventChannel, const EventPacket& event)
+{
 
-    EventPtr ev = Event::deserialize(event, info);
+    const EventChannel* info = getEventChannel(eventChannel);
     EventRecording* rec = m_eventFiles[eventChannel];
 
     if (!rec) return;
 
-    if (ev->getEventType() == EventChannel::TTL)
-    {
-
-        TTLEvent* ttl = static_cast<TTLEvent*>(ev.get());
+    RecordStreamStats* stats = m_recordStats[m_eventRings[eventChannel]];
+    ScopedLatency timer(&stats->getHistogram(RecordStreamStats::EVENT_WRITE));
+    stats->addEvent();
 
-        int16 state = (ttl->getLine() + 1) * (ttl->getState() ? 1 : -1);
-        rec->data->writeData(&state, sizeof(int16));
+    if (m_checkpointer != nullptr && m_checkpointer->isDue(m_eventRings[eventChannel]))
+        publishCheckpoint(m_eventRings[eventChannel]);
 
-        int64 sampleIdx = ev->getSampleNumber();
-        rec->samples->writeData(&sampleIdx, sizeof(int64));
+    EventPacketView view;
 
-        double ts = ev->getTimestampInSeconds();
-        rec->timestamps->writeData(&ts, sizeof(double));
+    /* Fast path: read TTL and TEXT events in place. The layout is checked against
+       Event::deserialize on the first event of each channel. */
+    if (rec->fastDecode != 0
+        && view.decode(event.getRawData(), event.getRawDataSize(),
+                       uint8(EventChannel::TTL), uint8(EventChannel::TEXT), info->getDataSize()))
+    {
+        if (rec->fastDecode < 0)
+            rec->fastDecode = matchesDeserializedEvent(view, event, info) ? 1 : 0;
 
-        if (rec->extraFile)
+        if (rec->fastDecode > 0)
         {
-            uint64 fullWord = ttl->getWord();
-            rec->extraFile->writeData(&fullWord, sizeof(uint64));
+            appendEvent(rec, view);
+            return;
         }
+    }
+
+    EventPtr ev = Event::deserialize(event, info);
+
+    if (ev->getEventType() == EventChannel::TTL)
+    {
+
+        TTLEvent* ttl = static_cast<TTLEvent*>(ev.get());
+
+        view.kind = EventPacketView::TTL;
+        view.line = ttl->getLine();
+        view.state = ttl->getState();
+        view.word = ttl->getWord();
 
     }
     else if (ev->getEventType() == EventChannel::TEXT)
     {
 
-        TextEvent* text = static_cast<TextEvent*>(ev.get());
+        view.kind = EventPacketView::TEXT;
+        view.text = static_cast<const char*>(ev->getRawDataPointer());
+    }
+    else
+    {
+        /* Nothing is written for other event types, only the record counts grow */
+        increaseEventCounts(rec, 1);
+        return;
+    }
+
+    view.sampleNumber = ev->getSampleNumber();
+    view.timestamp = ev->getTimestampInSeconds();
+
+    appendEvent(rec, view);
 
-        int64 sampleIdx = text->getSampleNumber();
-        rec->samples->writeData(&sampleIdx, sizeof(int64));
+}
+
+void PersystRecordEngine::appendEvent(EventRecording* rec, const EventPacketView& view)
+{
+    EventColumnBuffer* columns = rec->columns.get();
 
-        double ts = text->getTimestampInSeconds();
-        rec->timestamps->writeData(&ts, sizeof(double));
+    if (view.kind == EventPacketView::TTL)
+    {
+        int16 state = (view.line + 1) * (view.state ? 1 : -1);
+        columns->setValue(rec->dataColumn, &state);
 
-        rec->data->writeData(ev->getRawDataPointer(), info->getDataSize());
+        if (rec->extraFile)
+            columns->setValue(rec->extraColumn, &view.word);
+    }
+    else
+    {
+        columns->setValue(rec->dataColumn, view.text);
     }
 
+    columns->setValue(rec->samplesColumn, &view.sampleNumber);
+    columns->setValue(rec->timestampsColumn, &view.timestamp);
+
     // NOT IMPLEMENTED
     //writeEventMetadata(ev.get(), rec->metaDataFile.get());
 
-    increaseEventCounts(rec);
+    if (columns->commitRecord())
+        flushEventColumns(rec);
+}
+
+bool PersystRecordEngine::matchesDeserializedEvent(const EventPacketView& view, const EventPacket& event, const EventChannel* info)
+{
+    EventPtr ev = Event::deserialize(event, info);
 
+    bool matches = ev != nullptr
+        && ev->getSampleNumber() == view.sampleNumber
+        && ev->getTimestampInSeconds() == view.timestamp;
+
+    if (matches && view.kind == EventPacketView::TTL)
+    {
+        TTLEvent* ttl = static_cast<TTLEvent*>(ev.get());
+        matches = ev->getEventType() == EventChannel::TTL
+            && ttl->getLine() == view.line
+            && ttl->getState() == view.state
+            && ttl->getWord() == view.word;
+    }
+    else if (matches)
+    {
+        matches = ev->getEventType() == EventChannel::TEXT
+            && memcmp(ev->getRawDataPointer(), view.text, info->getDataSize()) == 0;
+    }
+
+    if (!matches)
+        LOGD("Persyst: event layout of ", info->getName(), " not recognized, decoding every event");
+
+    return matches;
 }
 
 
@@ -378,13 +1296,30 @@ void PersystRecordEngine::writeTimestampSyncText(
 
 }
 
-void PersystRecordEngine::increaseEventCounts(EventRecording* rec)
+void PersystRecordEngine::increaseEventCounts(EventRecording* rec, int count)
+{
+    rec->data->increaseRecordCount(count);
+    rec->samples->increaseRecordCount(count);
+    rec->timestamps->increaseRecordCount(count);
+    if (rec->channels) rec->channels->increaseRecordCount(count);
+    if (rec->extraFile) rec->extraFile->increaseRecordCount(count);
+}
+
+void PersystRecordEngine::flushEventColumns(EventRecording* rec)
 {
-    rec->data->increaseRecordCount();
-    rec->samples->increaseRecordCount();
-    rec->timestamps->increaseRecordCount();
-    if (rec->channels) rec->channels->increaseRecordCount();
-    if (rec->extraFile) rec->extraFile->increaseRecordCount();
+    EventColumnBuffer* columns = rec->columns.get();
+    if (columns == nullptr || columns->getNumRecords() == 0)
+        return;
+
+    /* One write per column, in the same layout the files had with a write per event */
+    rec->data->writeData(columns->getColumnData(rec->dataColumn), columns->getColumnBytes(rec->dataColumn));
+    rec->samples->writeData(columns->getColumnData(rec->samplesColumn), columns->getColumnBytes(rec->samplesColumn));
+    rec->timestamps->writeData(columns->getColumnData(rec->timestampsColumn), columns->getColumnBytes(rec->timestampsColumn));
+    if (rec->extraFile)
+        rec->extraFile->writeData(columns->getColumnData(rec->extraColumn), columns->getColumnBytes(rec->extraColumn));
+
+    increaseEventCounts(rec, columns->getNumRecords());
+    columns->clear();
 }
 
 String PersystRecordEngine::jsonTypeValue(BaseType type)
@@ -504,6 +1439,102 @@ void PersystRecordEngine::createChannelMetadata(const MetadataObject* channel, D
 void PersystRecordEngine::setParameter(EngineParameter& parameter)
 {
     boolParameter(0, m_saveTTLWords);
+    boolParameter(1, m_wholeStreamWrites);
+    boolParameter(2, m_asyncWrites);
+    intParameter(3, m_ringSizeMB);
+    intParameter(4, m_continuousBackend);
+    boolParameter(5, m_compressSampleTimes);
+    intParameter(6, m_sampleTimesToleranceUs);
+    intParameter(7, m_sampleTimesKeyframeSeconds);
+    intParameter(8, m_segmentMinutes);
+    intParameter(9, m_segmentGB);
+    intParameter(10, m_writerThreads);
+    intParameter(11, m_writerFirstCore);
+    intParameter(12, m_previewRate);
+    intParameter(13, m_envelopeMode);
+    boolParameter(14, m_blockChecksums);
+    intParameter(15, m_checkpointSeconds);
+    intParameter(16, m_liveTapSeconds);
+}
+
+Array<SampleTimesWriter::Stats> PersystRecordEngine::getSampleTimesStats() const
+{
+    const ScopedLock lock(m_layoutFilesLock);
+
+    if (layoutFiles.size() == 0)
+        return m_lastSampleTimesStats;
+
+    Array<SampleTimesWriter::Stats> stats;
+    for (int i = 0; i < layoutFiles.size(); i++)
+    {
+        SampleTimesWriter::Stats total = m_streamSegments[i]->closedSampleTimes;
+        if (layoutFiles[i] != nullptr)
+        {
+            SampleTimesWriter::Stats current = layoutFiles[i]->getStats();
+            total.rowsEmitted += current.rowsEmitted;
+            total.rowsSuppressed += current.rowsSuppressed;
+            total.discontinuities += current.discontinuities;
+        }
+        stats.add(total);
+    }
+    return stats;
+}
+
+Array<RecordStreamStats::Snapshot> PersystRecordEngine::getRecordStats() const
+{
+    const ScopedLock lock(m_recordStatsLock);
+
+    Array<RecordStreamStats::Snapshot> stats;
+    for (auto streamStats : m_recordStats)
+        stats.add(streamStats->getSnapshot());
+    return stats;
+}
+
+Array<BackpressureMonitor::Status> PersystRecordEngine::getBackpressureStatus() const
+{
+    const ScopedLock lock(m_recordStatsLock);
+
+    Array<BackpressureMonitor::Status> status;
+    for (auto monitor : m_backpressure)
+        status.add(monitor->getStatus());
+    return status;
+}
+
+bool PersystRecordEngine::isFallingBehind(int streamIndex) const
+{
+    const ScopedLock lock(m_recordStatsLock);
+
+    const BackpressureMonitor* monitor = m_backpressure[streamIndex];
+    return monitor != nullptr && monitor->isFallingBehind();
+}
+
+StringArray PersystRecordEngine::getLiveTapNames() const
+{
+    const ScopedLock lock(m_recordStatsLock);
+    return m_liveTapNames;
+}
+
+Array<SaturationStats::Snapshot> PersystRecordEngine::getSaturationStats() const
+{
+    const ScopedLock lock(m_recordStatsLock);
+
+    Array<SaturationStats::Snapshot> stats;
+    for (auto streamSaturation : m_saturation)
+        stats.add(streamSaturation->getSnapshot());
+    return stats;
+}
+
+Array<AsyncRecordWriter::RingStats> PersystRecordEngine::getAsyncWriterStats() const
+{
+    const ScopedLock lock(m_asyncWriterLock);
+
+    if (!m_asyncWriter)
+        return m_lastRingStats;
+
+    Array<AsyncRecordWriter::RingStats> stats;
+    for (int i = 0; i < m_asyncWriter->getNumRings(); i++)
+        stats.add(m_asyncWriter->getStats(i));
+    return stats;
 }
 
 
@@ -26,7 +26,25 @@
 
 #include <RecordingLib.h>
 
-class TESTABLE PersystRecordEngine : public RecordEngine
+#include "AsyncRecordWriter.h"
+#include "BackpressureMonitor.h"
+#include "BlockChecksumWriter.h"
+#include "Decimator.h"
+#include "EnvelopePyramid.h"
+#include "EventColumnBuffer.h"
+#include "EventPacketView.h"
+#include "InterleavedBlockFile.h"
+#include "LiveTap.h"
+#include "NpyWriter.h"
+#include "RecordStats.h"
+#include "RecordingCheckpointer.h"
+#include "SampleTimesWriter.h"
+#include "SaturationStats.h"
+
+class PersystLayFileFormat;
+
+class TESTABLE PersystRecordEngine : public RecordEngine,
+                                     private AsyncRecordWriter::Consumer
 {
 public:
 
@@ -73,39 +91,228 @@ public:
     
     void setParameter(EngineParameter& parameter) override;
 
-    
+    /** Returns the ring usage of the asynchronous writer, one entry per ring. While recording the
+        values are live; after closeFiles they describe the last recording. */
+    Array<AsyncRecordWriter::RingStats> getAsyncWriterStats() const;
+
+    /** Returns the [SampleTimes] row counters, one entry per stream. While recording the
+        values are live; after closeFiles they describe the last recording. */
+    Array<SampleTimesWriter::Stats> getSampleTimesStats() const;
+
+    /** Returns the byte, sample and event counters and latency histograms of the record path,
+        one entry per stream plus a last one for events of streams without continuous data.
+        While recording the values are live; after closeFiles they describe the last recording. */
+    Array<RecordStreamStats::Snapshot> getRecordStats() const;
+
+    /** Returns the incoming and written data rates of each stream and whether its writes are
+        falling behind, one entry per stream. */
+    Array<BackpressureMonitor::Status> getBackpressureStatus() const;
+
+    /** True while the data of a stream is written slower than it arrives */
+    bool isFallingBehind(int streamIndex) const;
+
+    /** Returns the saturated sample count and int16 range of every channel, one entry per stream,
+        gathered while converting. While recording the values are live; after closeFiles they
+        describe the last recording. */
+    Array<SaturationStats::Snapshot> getSaturationStats() const;
+
+    /** Returns the shared memory name of each stream's live tap, one entry per stream, empty for
+        streams without one. Names stay valid until the next recording starts. */
+    StringArray getLiveTapNames() const;
+
 private:
+
+    /** Converts and writes a block of one channel. Runs on the writer thread in asynchronous mode. */
+    void writeContinuousBlock(int writeChannel,
+                              int realChannel,
+                              const float* dataBuffer,
+                              double firstTimestamp,
+                              int size) override;
+
+    /** Writes a single event. Runs on the writer thread in asynchronous mode. */
+    void writeEventPacket(int eventChannel, const EventPacket& event) override;
     
     class EventRecording
     {
     public:
-        std::unique_ptr<NpyFile> data;
-        std::unique_ptr<NpyFile> samples;
-        std::unique_ptr<NpyFile> channels;
-        std::unique_ptr<NpyFile> extraFile;
-        std::unique_ptr<NpyFile> timestamps;
+        std::unique_ptr<NpyWriter> data;
+        std::unique_ptr<NpyWriter> samples;
+        std::unique_ptr<NpyWriter> channels;
+        std::unique_ptr<NpyWriter> extraFile;
+        std::unique_ptr<NpyWriter> timestamps;
+
+        /* Events not yet written, one column per file above */
+        std::unique_ptr<EventColumnBuffer> columns;
+        int dataColumn{ -1 };
+        int samplesColumn{ -1 };
+        int timestampsColumn{ -1 };
+        int extraColumn{ -1 };
+
+        /* Whether packets can be read in place: -1 not checked yet, 0 no, 1 yes */
+        int fastDecode{ -1 };
     };
     
+    /** Channel-major staging area used to gather a whole stream before interleaving it */
+    class StreamStaging
+    {
+    public:
+        HeapBlock<int16> data;
+        int stride{ 0 };
+        int numChannels{ 0 };
+        int channelsStaged{ 0 };
+        int size{ 0 };
+        uint64 startPos{ 0 };
+    };
+
+    /** What is needed to open each segment of a stream's continuous data */
+    class StreamSegments
+    {
+    public:
+        String directory;
+        String relativeDirectory;
+        float sampleRate{ 0 };
+        float bitVolts{ 0 };
+        int numChannels{ 0 };
+        int firstChannel{ 0 };
+        Array<String> channelNames;
+
+        /* Samples per segment, 0 when segment rollover is off */
+        int64 segmentLength{ 0 };
+        int segmentIndex{ -1 };
+        Array<var> manifest;
+
+        /* Files of the current segment, and of closed ones not synced by a checkpoint yet */
+        String dataFileName;
+        String layoutFileName;
+        Array<FileSyncHandle::Ptr> unsyncedFiles;
+
+        /* SampleTimes counters of the segments already closed */
+        SampleTimesWriter::Stats closedSampleTimes{ 0, 0, 0 };
+    };
+
+    /** Decimated copy of a stream, written next to it as preview.dat and preview.lay */
+    class StreamPreview
+    {
+    public:
+        std::unique_ptr<Decimator> decimator;
+        OwnedArray<Decimator::Channel> channels;
+        HeapBlock<float> output;
+        int outputSize{ 0 };
+
+        std::unique_ptr<InterleavedBlockFile> file;
+        std::unique_ptr<SampleTimesWriter> sampleTimes;
+
+        /* Per channel: preview samples written, and whether its filter is running */
+        HeapBlock<int64> samplesWritten;
+        HeapBlock<bool> active;
+
+        /* Preview sample anchorPreview is centred on stream sample anchorInput */
+        int64 anchorInput{ 0 };
+        int64 anchorPreview{ 0 };
+        int64 lastSampleTimesRow{ -1 };
+
+        /* Set while the stream's disk writes fall behind; the preview skips those blocks */
+        bool suspended{ false };
+    };
+
+    /** Targets of one stream's continuous data, resolved in openFiles and at each segment rollover */
+    struct alignas(64) StreamPlan
+    {
+        InterleavedBlockFile* file{ nullptr };
+        SampleTimesWriter* sampleTimes{ nullptr };
+        StreamStaging* staging{ nullptr };
+        RecordStreamStats* stats{ nullptr };
+        BackpressureMonitor* backpressure{ nullptr };
+        StreamPreview* preview{ nullptr };
+        SaturationStats* saturation{ nullptr };
+        LiveTap* tap{ nullptr };
+        int64 segmentStart{ 0 };
+        int64 segmentEnd{ 0 };
+    };
+
+    /** Constants of one recorded channel, resolved in openFiles */
+    struct ChannelPlan
+    {
+        float scale{ 0 };
+        int streamIndex{ 0 };
+        int channelIndex{ 0 };
+    };
+
     static String jsonTypeValue(BaseType type);
+    void writeStagedChannels(int fileIndex);
+    void openSegment(int streamIndex, int64 firstSample);
+    void closeSegment(int streamIndex);
+    bool canRollOver(int streamIndex) const;
+    int64 getStreamSamplesWritten(int streamIndex) const;
+    void writeSegmentManifest(int streamIndex);
+    void writeRecordStats(int streamIndex);
+    void writeEventRecordStats();
+    SampleTimesWriter* createLayoutFile(PersystLayFileFormat& layoutFile, const Array<String>& channelNames, double sampleRate);
+    void openPreview(int streamIndex);
+    void writePreview(const ChannelPlan& plan, const float* dataBuffer, double firstTimestamp, int64 firstSample, int size);
+    void flushPreviewChannel(StreamPreview* preview, int channel, float scale);
+    void closePreview(int streamIndex);
+    void checkBackpressure(int streamIndex);
+    void publishCheckpoint(int ring);
     void createChannelMetadata(const MetadataObject* channel, DynamicObject* jsonObject);
-    void increaseEventCounts(EventRecording* rec);
+    void increaseEventCounts(EventRecording* rec, int count);
+    void flushEventColumns(EventRecording* rec);
+    void appendEvent(EventRecording* rec, const EventPacketView& view);
+    bool matchesDeserializedEvent(const EventPacketView& view, const EventPacket& event, const EventChannel* info);
 
-    Array<unsigned int> m_channelIndexes;
-    Array<unsigned int> m_fileIndexes;
+    /* Indexed by recorded channel and stream index; immutable while recording */
+    std::unique_ptr<ChannelPlan[]> m_channelPlans;
+    std::unique_ptr<StreamPlan[]> m_streamPlans;
     
-    OwnedArray<FileOutputStream> layoutFiles;
+    OwnedArray<SampleTimesWriter> layoutFiles;
+    Array<SampleTimesWriter::Stats> m_lastSampleTimesStats;
+    CriticalSection m_layoutFilesLock;
     OwnedArray<EventRecording> m_eventFiles;
+    String m_eventDirectory;
 
-    HeapBlock<float> m_scaledBuffer;
-    HeapBlock<int16> m_intBuffer;
     
-    Array<int64> m_samplesWritten;
+    HeapBlock<int64> m_samplesWritten;
 
     bool m_saveTTLWords{ true };
+    bool m_wholeStreamWrites{ false };
+    bool m_asyncWrites{ false };
+    int m_ringSizeMB{ 64 };
+    int m_continuousBackend{ BlockFileSink::BUFFERED };
+    bool m_compressSampleTimes{ false };
+    int m_sampleTimesToleranceUs{ 100 };
+    int m_sampleTimesKeyframeSeconds{ 60 };
+    int m_segmentMinutes{ 0 };
+    int m_segmentGB{ 0 };
+    int m_writerThreads{ 1 };
+    int m_writerFirstCore{ -1 };
+    int m_previewRate{ 0 };
+    int m_envelopeMode{ 0 };
+    bool m_blockChecksums{ false };
+    int m_checkpointSeconds{ 0 };
+    int m_liveTapSeconds{ 0 };
+
+    std::unique_ptr<AsyncRecordWriter> m_asyncWriter;
+    Array<int> m_eventRings;
+    Array<AsyncRecordWriter::RingStats> m_lastRingStats;
+    CriticalSection m_asyncWriterLock;
+
+    /* Set while recording with checkpoints; outlives the asynchronous writer, which publishes to it */
+    std::unique_ptr<RecordingCheckpointer> m_checkpointer;
+
+    OwnedArray<RecordStreamStats> m_recordStats;
+    OwnedArray<BackpressureMonitor> m_backpressure;
+    OwnedArray<SaturationStats> m_saturation;
+    StringArray m_liveTapNames;
+    CriticalSection m_recordStatsLock;
     
-    int m_bufferSize;
     
-    OwnedArray<SequentialBlockFile> m_continuousFiles;
+    OwnedArray<InterleavedBlockFile> m_continuousFiles;
+    OwnedArray<EnvelopePyramid> m_envelopes;
+    OwnedArray<BlockChecksumWriter> m_checksums;
+    OwnedArray<StreamStaging> m_streamStaging;
+    OwnedArray<StreamSegments> m_streamSegments;
+    OwnedArray<StreamPreview> m_streamPreviews;
+    OwnedArray<LiveTap> m_liveTaps;
     
     const int samplesPerBlock{ 4096 };
 
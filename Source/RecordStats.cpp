@@ -0,0 +1,185 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "RecordStats.h"
+
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto& bucket : m_buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+int LatencyHistogram::getBucketIndex(uint64 value)
+{
+    if (value < 16)
+        return int(value);
+
+    int highestBit = 0;
+    for (int step = 32; step > 0; step >>= 1)
+    {
+        if (value >> (highestBit + step))
+            highestBit += step;
+    }
+
+    /* The 5 leading bits select one of 16 buckets within the power of two */
+    const int shift = highestBit - 4;
+    return 16 * shift + int(value >> shift);
+}
+
+uint64 LatencyHistogram::getBucketUpperValue(int index)
+{
+    if (index < 16)
+        return uint64(index);
+
+    const int shift = index / 16 - 1;
+    const uint64 top = uint64(index - 16 * shift);
+    return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(int64 nanoseconds)
+{
+    const uint64 value = nanoseconds > 0 ? uint64(nanoseconds) : 0;
+
+    m_buckets[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64 max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+int64 LatencyHistogram::getValueAtPercentile(double percentile) const
+{
+    /* Count from the buckets themselves, so a snapshot taken while recording stays consistent */
+    uint64 total = 0;
+    for (const auto& bucket : m_buckets)
+        total += bucket.load(std::memory_order_relaxed);
+
+    if (total == 0)
+        return 0;
+
+    const double fraction = jlimit(0.0, 100.0, percentile) / 100.0;
+    const uint64 target = jmax(uint64(1), uint64(std::ceil(fraction * double(total))));
+
+    uint64 seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++)
+    {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target)
+            return int64(jmin(getBucketUpperValue(i), m_max.load(std::memory_order_relaxed)));
+    }
+    return getMax();
+}
+
+LatencyHistogram::Summary LatencyHistogram::getSummary() const
+{
+    Summary summary;
+    summary.count = getCount();
+    summary.meanNs = summary.count > 0 ? double(m_sum.load(std::memory_order_relaxed)) / double(summary.count) : 0.0;
+    summary.p50Ns = getValueAtPercentile(50.0);
+    summary.p90Ns = getValueAtPercentile(90.0);
+    summary.p99Ns = getValueAtPercentile(99.0);
+    summary.p999Ns = getValueAtPercentile(99.9);
+    summary.maxNs = getMax();
+    return summary;
+}
+
+RecordStreamStats::RecordStreamStats()
+{
+}
+
+void RecordStreamStats::start()
+{
+    m_startTicks.store(now(), std::memory_order_relaxed);
+    m_stopTicks.store(0, std::memory_order_relaxed);
+}
+
+void RecordStreamStats::stop()
+{
+    m_stopTicks.store(now(), std::memory_order_relaxed);
+}
+
+int64 RecordStreamStats::nanosecondsSince(int64 start)
+{
+    static const double nanosecondsPerTick = 1.0e9 / double(Time::getHighResolutionTicksPerSecond());
+    return int64(double(now() - start) * nanosecondsPerTick);
+}
+
+RecordStreamStats::Snapshot RecordStreamStats::getSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.samples = int64(m_samples.load(std::memory_order_relaxed));
+    snapshot.bytes = int64(m_bytes.load(std::memory_order_relaxed));
+    snapshot.blocks = int64(m_blocks.load(std::memory_order_relaxed));
+    snapshot.events = int64(m_events.load(std::memory_order_relaxed));
+
+    const int64 startTicks = m_startTicks.load(std::memory_order_relaxed);
+    const int64 stopTicks = m_stopTicks.load(std::memory_order_relaxed);
+    snapshot.elapsedSeconds = startTicks == 0 ? 0.0
+        : double((stopTicks != 0 ? stopTicks : now()) - startTicks) / double(Time::getHighResolutionTicksPerSecond());
+
+    for (int phase = 0; phase < NUM_PHASES; phase++)
+        snapshot.latency[phase] = m_latency[phase].getSummary();
+
+    return snapshot;
+}
+
+const char* RecordStreamStats::getPhaseName(Phase phase)
+{
+    switch (phase)
+    {
+    case WRITE_CALL:
+        return "write_call";
+    case CONVERSION:
+        return "conversion";
+    case INTERLEAVE:
+        return "interleave";
+    case DAT_WRITE:
+        return "dat_write";
+    case LAY_WRITE:
+        return "lay_write";
+    case EVENT_WRITE:
+        return "event_write";
+    case OPEN:
+        return "open";
+    case CLOSE:
+        return "close";
+    case PREVIEW:
+        return "preview";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,187 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef RECORDSTATS_H_DEFINED
+#define RECORDSTATS_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include <atomic>
+
+/**
+    Lock-free latency histogram with HDR-style log-linear buckets.
+
+    Values below 16 ns are counted exactly; above that every power of two is split
+    into 16 buckets, so a percentile is reported within about 6% of the true value.
+    record() only does relaxed atomic increments and may be called from any thread.
+*/
+class TESTABLE LatencyHistogram
+{
+public:
+
+    struct Summary
+    {
+        int64 count;
+        double meanNs;
+        int64 p50Ns;
+        int64 p90Ns;
+        int64 p99Ns;
+        int64 p999Ns;
+        int64 maxNs;
+    };
+
+    LatencyHistogram();
+
+    /** Adds one measurement in nanoseconds; negative values count as 0 */
+    void record(int64 nanoseconds);
+
+    /** Clears every bucket. Not safe against concurrent record() calls. */
+    void reset();
+
+    int64 getCount() const { return int64(m_count.load(std::memory_order_relaxed)); }
+
+    int64 getMax() const { return int64(m_max.load(std::memory_order_relaxed)); }
+
+    /** Smallest bucket value that at least the given percentage (0-100) of the values are below */
+    int64 getValueAtPercentile(double percentile) const;
+
+    Summary getSummary() const;
+
+    static const int NUM_BUCKETS = 60 * 16 + 16;
+
+private:
+
+    static int getBucketIndex(uint64 value);
+    static uint64 getBucketUpperValue(int index);
+
+    std::atomic<uint64> m_buckets[NUM_BUCKETS];
+    std::atomic<uint64> m_count{ 0 };
+    std::atomic<uint64> m_sum{ 0 };
+    std::atomic<uint64> m_max{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(LatencyHistogram);
+};
+
+/**
+    Throughput counters and per-phase latency histograms of one recorded stream.
+
+    The continuous and event write paths update it without locking; getSnapshot()
+    can be called from any thread while recording.
+*/
+class TESTABLE RecordStreamStats
+{
+public:
+
+    enum Phase
+    {
+        WRITE_CALL = 0, // writeContinuousData, as seen by the Record Node
+        CONVERSION,     // float to int16
+        INTERLEAVE,     // copy into the interleaved blocks
+        DAT_WRITE,      // recording.dat block writes
+        LAY_WRITE,      // [SampleTimes] rows
+        EVENT_WRITE,    // writeEvent
+        OPEN,           // openFiles, and each segment opened while recording
+        CLOSE,          // closeFiles, and each segment closed while recording
+        PREVIEW,        // decimating into the preview file
+        NUM_PHASES
+    };
+
+    struct Snapshot
+    {
+        int64 samples;
+        int64 bytes;
+        int64 blocks;
+        int64 events;
+        double elapsedSeconds;
+        LatencyHistogram::Summary latency[NUM_PHASES];
+    };
+
+    RecordStreamStats();
+
+    /** Starts the clock that throughput is measured against */
+    void start();
+
+    /** Stops the clock; later snapshots keep the final elapsed time */
+    void stop();
+
+    void addSamples(int64 samples, int64 bytes)
+    {
+        m_samples.fetch_add(uint64(samples), std::memory_order_relaxed);
+        m_bytes.fetch_add(uint64(bytes), std::memory_order_relaxed);
+    }
+
+    void addBlock() { m_blocks.fetch_add(1, std::memory_order_relaxed); }
+
+    void addEvent() { m_events.fetch_add(1, std::memory_order_relaxed); }
+
+    int64 getBytes() const { return int64(m_bytes.load(std::memory_order_relaxed)); }
+
+    LatencyHistogram& getHistogram(Phase phase) { return m_latency[phase]; }
+
+    Snapshot getSnapshot() const;
+
+    static const char* getPhaseName(Phase phase);
+
+    /** Current value of the high resolution clock, for timing a phase */
+    static int64 now() { return Time::getHighResolutionTicks(); }
+
+    /** Nanoseconds since a value returned by now() */
+    static int64 nanosecondsSince(int64 start);
+
+private:
+
+    std::atomic<uint64> m_samples{ 0 };
+    std::atomic<uint64> m_bytes{ 0 };
+    std::atomic<uint64> m_blocks{ 0 };
+    std::atomic<uint64> m_events{ 0 };
+    std::atomic<int64> m_startTicks{ 0 };
+    std::atomic<int64> m_stopTicks{ 0 };
+
+    LatencyHistogram m_latency[NUM_PHASES];
+
+    JUCE_DECLARE_NON_COPYABLE(RecordStreamStats);
+};
+
+/** Records the time from construction to destruction into a histogram, if there is one */
+class ScopedLatency
+{
+public:
+    explicit ScopedLatency(LatencyHistogram* histogram) :
+        m_histogram(histogram),
+        m_start(histogram != nullptr ? RecordStreamStats::now() : 0)
+    {
+    }
+
+    ~ScopedLatency()
+    {
+        if (m_histogram != nullptr)
+            m_histogram->record(RecordStreamStats::nanosecondsSince(m_start));
+    }
+
+private:
+    LatencyHistogram* const m_histogram;
+    const int64 m_start;
+};
+
+#endif
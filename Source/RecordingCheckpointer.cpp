@@ -0,0 +1,224 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "RecordingCheckpointer.h"
+
+#if JUCE_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+RecordingCheckpointer::RecordingCheckpointer(const File& journalFile, int numWriters, int intervalMs) :
+    Thread("Persyst checkpoints"),
+    m_journalFile(journalFile),
+    m_intervalMs(jmax(1, intervalMs))
+{
+    m_writerGenerations.reset(new std::atomic<int>[numWriters]);
+    for (int i = 0; i < numWriters; i++)
+    {
+        m_writerGenerations[i] = 0;
+        m_unsyncedFiles.add(Array<FileSyncHandle::Ptr>());
+        m_entries.add(Array<var>());
+    }
+}
+
+RecordingCheckpointer::~RecordingCheckpointer()
+{
+    stopThread(-1);
+}
+
+File RecordingCheckpointer::getJournalFileFor(const File& recordingFolder)
+{
+    return recordingFolder.getChildFile("recovery.json");
+}
+
+void RecordingCheckpointer::publish(int writer, const Array<FileSyncHandle::Ptr>& files, const Array<var>& entries)
+{
+    const ScopedLock lock(m_lock);
+
+    Array<FileSyncHandle::Ptr>& unsynced = m_unsyncedFiles.getReference(writer);
+    for (const FileSyncHandle::Ptr& file : files)
+    {
+        if (file != nullptr && !unsynced.contains(file))
+            unsynced.add(file);
+    }
+    m_entries.set(writer, entries);
+
+    const int generation = m_generation.load(std::memory_order_relaxed);
+    m_writerGenerations[writer].store(generation, std::memory_order_relaxed);
+
+    for (int i = 0; i < m_entries.size(); i++)
+    {
+        if (m_writerGenerations[i].load(std::memory_order_relaxed) != generation)
+            return;
+    }
+    m_allPublished.signal();
+}
+
+bool RecordingCheckpointer::writeCheckpoint()
+{
+    const ScopedLock checkpointLock(m_checkpointLock);
+
+    Array<Array<FileSyncHandle::Ptr>> files;
+    Array<var> entries;
+    {
+        const ScopedLock lock(m_lock);
+        for (int i = 0; i < m_entries.size(); i++)
+        {
+            files.add(m_unsyncedFiles[i]);
+            m_unsyncedFiles.getReference(i).clear();
+
+            for (const var& entry : m_entries.getReference(i))
+                entries.add(entry);
+        }
+    }
+
+    /* The entries were published before these syncs start, so they only describe data on disk */
+    const double syncStart = Time::getMillisecondCounterHiRes();
+    bool synced = true;
+    for (const Array<FileSyncHandle::Ptr>& writerFiles : files)
+    {
+        for (const FileSyncHandle::Ptr& file : writerFiles)
+        {
+            if (!file->sync())
+            {
+                std::cerr << "[Persyst] Could not sync " << file->getPath() << " to disk" << std::endl;
+                synced = false;
+            }
+        }
+    }
+    const double syncMs = Time::getMillisecondCounterHiRes() - syncStart;
+    if (syncMs > m_maxSyncMs.load(std::memory_order_relaxed))
+        m_maxSyncMs.store(syncMs, std::memory_order_relaxed);
+
+    if (!synced)
+    {
+        /* Keep the last journal, which only describes synced data, and try these files again */
+        const ScopedLock lock(m_lock);
+        for (int i = 0; i < files.size(); i++)
+        {
+            Array<FileSyncHandle::Ptr>& unsynced = m_unsyncedFiles.getReference(i);
+            for (const FileSyncHandle::Ptr& file : files.getReference(i))
+            {
+                if (!unsynced.contains(file))
+                    unsynced.add(file);
+            }
+        }
+        return false;
+    }
+
+    const int64 checkpoint = m_numCheckpoints.load(std::memory_order_relaxed) + 1;
+
+    DynamicObject::Ptr journal = new DynamicObject();
+    journal->setProperty("version", 1);
+    journal->setProperty("checkpoint", checkpoint);
+    journal->setProperty("time_ms", Time::currentTimeMillis());
+    journal->setProperty("entries", entries);
+
+    /* Written next to the journal and renamed over it, so a crash leaves one or the other */
+    const File tempFile = m_journalFile.withFileExtension("json.tmp");
+    tempFile.deleteFile();
+    bool written;
+    {
+        SyncableFileStream out(tempFile);
+        written = out.openedOk() && out.writeText(JSON::toString(var(journal)), false, false, nullptr) && out.sync();
+    }
+    if (!written)
+    {
+        std::cerr << "[Persyst] Could not write recovery journal " << tempFile.getFullPathName() << std::endl;
+        return false;
+    }
+
+    if (!tempFile.moveFileTo(m_journalFile))
+    {
+        std::cerr << "[Persyst] Could not replace recovery journal " << m_journalFile.getFullPathName() << std::endl;
+        return false;
+    }
+    syncFile(m_journalFile.getParentDirectory());
+
+    m_numCheckpoints.store(checkpoint, std::memory_order_relaxed);
+    return true;
+}
+
+void RecordingCheckpointer::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(m_intervalMs);
+        if (threadShouldExit())
+            break;
+
+        /* Ask every writer for a checkpoint, and give them half an interval to provide it */
+        m_allPublished.reset();
+        m_generation.fetch_add(1, std::memory_order_relaxed);
+        m_allPublished.wait(m_intervalMs / 2);
+
+        if (threadShouldExit())
+            break;
+
+        writeCheckpoint();
+    }
+}
+
+#if JUCE_WINDOWS
+
+bool RecordingCheckpointer::syncFile(const File& file)
+{
+    /* NTFS journals its metadata, so only file data needs flushing */
+    if (file.isDirectory())
+        return true;
+
+    HANDLE handle = CreateFileW(file.getFullPathName().toWideCharPointer(), GENERIC_WRITE,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    const bool flushed = FlushFileBuffers(handle) != 0;
+    CloseHandle(handle);
+    return flushed;
+}
+
+#else
+
+bool RecordingCheckpointer::syncFile(const File& file)
+{
+    /* Syncing a file flushes all of its dirty pages, whichever descriptor wrote them */
+    const int fd = ::open(file.getFullPathName().toRawUTF8(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+#if JUCE_LINUX
+    const bool synced = fdatasync(fd) == 0;
+#else
+    const bool synced = fsync(fd) == 0;
+#endif
+
+    ::close(fd);
+    return synced;
+}
+
+#endif
@@ -0,0 +1,113 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef RECORDINGCHECKPOINTER_H_DEFINED
+#define RECORDINGCHECKPOINTER_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include "SyncableFileStream.h"
+
+#include <atomic>
+
+/**
+    Keeps an interrupted recording recoverable, at a bounded cost to the record path.
+
+    Every interval the checkpointer asks each writer, one per thread of the record path,
+    for a checkpoint. A writer provides it on its own thread the next time it writes: it
+    hands its buffered data to the operating system, which costs a few write calls, and
+    publishes what its files hold, with a sync handle for each file. The checkpointer
+    thread then syncs those files to disk through the handles and replaces the journal
+    with the published entries, so everything the journal describes has reached the disk.
+    If any file fails to sync the journal is left as it was. Writers never wait for the
+    disk, and a writer with nothing to write keeps its last entries in the journal.
+
+    The journal is a JSON object with the checkpoint number, the time it was written and
+    the entries of every writer, concatenated in writer order.
+*/
+class TESTABLE RecordingCheckpointer : public Thread
+{
+public:
+
+    /** Constructor. Checkpoints of numWriters writers are journaled to journalFile every intervalMs. */
+    RecordingCheckpointer(const File& journalFile, int numWriters, int intervalMs);
+
+    /** Destructor. Stops the thread. */
+    ~RecordingCheckpointer();
+
+    /** True when the writer should publish. Cheap enough to call for every block. */
+    bool isDue(int writer) const
+    {
+        return m_writerGenerations[writer].load(std::memory_order_relaxed) != m_generation.load(std::memory_order_relaxed);
+    }
+
+    /** Publishes a writer's checkpoint: the entries describing its files, replacing its previous
+        ones, and the files written since its last checkpoint, which are synced before the journal
+        is written. */
+    void publish(int writer, const Array<FileSyncHandle::Ptr>& files, const Array<var>& entries);
+
+    /** Syncs the files published so far and rewrites the journal. Returns false, leaving the
+        journal as it was, if a file could not be synced or the journal could not be written;
+        the files are then synced again at the next checkpoint. Called by the thread every interval. */
+    bool writeCheckpoint();
+
+    /** Number of journals written */
+    int64 getNumCheckpoints() const { return m_numCheckpoints.load(std::memory_order_relaxed); }
+
+    /** Longest time a checkpoint took to sync its files, in milliseconds */
+    double getMaxSyncMs() const { return m_maxSyncMs.load(std::memory_order_relaxed); }
+
+    const File& getJournalFile() const { return m_journalFile; }
+
+    /** Where the record engine keeps the journal of the recording in recordingFolder */
+    static File getJournalFileFor(const File& recordingFolder);
+
+    /** Forces the data of a closed file, or the entries of a folder, to disk */
+    static bool syncFile(const File& file);
+
+    void run() override;
+
+private:
+
+    const File m_journalFile;
+    const int m_intervalMs;
+
+    std::atomic<int> m_generation{ 0 };
+    std::unique_ptr<std::atomic<int>[]> m_writerGenerations;
+    WaitableEvent m_allPublished;
+
+    /* Per writer: files to sync at the next checkpoint, and its last entries */
+    Array<Array<FileSyncHandle::Ptr>> m_unsyncedFiles;
+    Array<Array<var>> m_entries;
+    CriticalSection m_lock;
+
+    /* Serialises writeCheckpoint() */
+    CriticalSection m_checkpointLock;
+    std::atomic<int64> m_numCheckpoints{ 0 };
+    std::atomic<double> m_maxSyncMs{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(RecordingCheckpointer);
+};
+
+#endif
@@ -0,0 +1,528 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "RecordingRecovery.h"
+#include "PersystLayFileFormat.h"
+#include "NumberText.h"
+#include "RecordingCheckpointer.h"
+
+#include <cstring>
+#include <limits>
+
+static void trim(const char*& begin, const char*& end)
+{
+    while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r'))
+        begin++;
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+        end--;
+}
+
+static void writeSampleTime(MemoryOutputStream& out, int64 sample, double time)
+{
+    char row[64];
+    char* pos = NumberText::format(row, row + sizeof(row), sample);
+    *pos++ = '=';
+    pos = NumberText::format(pos, row + sizeof(row), time);
+    *pos++ = '\n';
+    out.write(row, size_t(pos - row));
+}
+
+bool RecordingRecovery::isRecordingFolder(const File& folder)
+{
+    return folder.getChildFile("continuous").isDirectory()
+        || folder.getChildFile("events").isDirectory()
+        || RecordingCheckpointer::getJournalFileFor(folder).existsAsFile();
+}
+
+bool RecordingRecovery::recover(const File& recordingFolder, Report& report)
+{
+    const File journalFile = RecordingCheckpointer::getJournalFileFor(recordingFolder);
+
+    /* The journal is replaced by renaming, so it is either complete or missing */
+    Array<var> journalEntries;
+    if (journalFile.existsAsFile())
+    {
+        var journal;
+        if (JSON::parse(journalFile.loadFileAsString(), journal).failed() || journal["entries"].getArray() == nullptr)
+            report.errors.add("Could not read recovery journal " + journalFile.getFullPathName());
+        else
+            journalEntries = *journal["entries"].getArray();
+    }
+
+    const File continuousFolder = recordingFolder.getChildFile("continuous");
+    Array<File> layoutFiles;
+    if (continuousFolder.isDirectory())
+        layoutFiles = continuousFolder.findChildFiles(File::findFiles, true, "*.lay");
+
+    /* A .lay file whose creation never reached the disk is rebuilt from its journal entry */
+    Array<var> layoutEntries;
+    for (int i = 0; i < layoutFiles.size(); i++)
+        layoutEntries.add(var());
+
+    for (const var& entry : journalEntries)
+    {
+        if (entry["type"].toString() != "continuous")
+            continue;
+
+        const File layoutFile = recordingFolder.getChildFile(entry["directory"].toString()).getChildFile(entry["layout_file"].toString());
+        bool found = false;
+        for (int i = 0; i < layoutFiles.size() && !found; i++)
+        {
+            if (layoutFiles[i] == layoutFile)
+            {
+                layoutEntries.set(i, entry);
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            layoutFiles.add(layoutFile);
+            layoutEntries.add(entry);
+        }
+    }
+
+    for (int i = 0; i < layoutFiles.size(); i++)
+        recoverLayout(layoutFiles[i], layoutEntries[i], report);
+
+    if (continuousFolder.isDirectory())
+    {
+        for (const File& manifestFile : continuousFolder.findChildFiles(File::findFiles, true, "segments.json"))
+            recoverSegmentManifest(manifestFile, report);
+    }
+
+    const File eventsFolder = recordingFolder.getChildFile("events");
+    if (eventsFolder.isDirectory())
+    {
+        for (const File& folder : eventsFolder.findChildFiles(File::findDirectories, true))
+            recoverEventFolder(folder, report);
+    }
+
+    if (report.isOk() && journalFile.existsAsFile())
+        journalFile.deleteFile();
+
+    return report.isOk();
+}
+
+bool RecordingRecovery::recoverLayout(const File& layoutFile, const var& journalEntry, Report& report)
+{
+    report.layoutFiles++;
+
+    const String text = layoutFile.existsAsFile() ? layoutFile.loadFileAsString() : String();
+    const char* const begin = text.toRawUTF8();
+
+    /* A crash can leave the last line half written */
+    const char* complete = begin + std::strlen(begin);
+    while (complete > begin && complete[-1] != '\n')
+        complete--;
+
+    String dataFileName;
+    double samplingRate = 0;
+    int headerLength = 0;
+    int waveformCount = 0;
+
+    /* Everything up to [SampleTimes] is kept as it is */
+    const char* headerEnd = complete;
+    const char* rows = complete;
+    bool inFileInfo = false;
+
+    for (const char* pos = begin; pos < complete;)
+    {
+        const char* lineStart = pos;
+        const char* lineEnd = std::find(pos, complete, '\n');
+        const char* line = pos;
+        const char* last = lineEnd;
+        pos = lineEnd + 1;
+
+        trim(line, last);
+        if (line == last)
+            continue;
+
+        if (*line == '[' && last[-1] == ']')
+        {
+            const String name = String::fromUTF8(line + 1, int(last - line - 2));
+            if (name.equalsIgnoreCase("SampleTimes"))
+            {
+                headerEnd = lineStart;
+                rows = pos;
+                break;
+            }
+            inFileInfo = name.equalsIgnoreCase("FileInfo");
+            continue;
+        }
+
+        const char* separator = std::find(line, last, '=');
+        if (!inFileInfo || separator == last)
+            continue;
+
+        const char* key = line;
+        const char* keyEnd = separator;
+        const char* value = separator + 1;
+        const char* valueEnd = last;
+        trim(key, keyEnd);
+        trim(value, valueEnd);
+
+        const String name = String::fromUTF8(key, int(keyEnd - key));
+        if (name.equalsIgnoreCase("File"))
+            dataFileName = String::fromUTF8(value, int(valueEnd - value));
+        else if (name.equalsIgnoreCase("SamplingRate"))
+            NumberText::parse(value, valueEnd, samplingRate);
+        else if (name.equalsIgnoreCase("HeaderLength"))
+            NumberText::parse(value, valueEnd, headerLength);
+        else if (name.equalsIgnoreCase("WaveformCount"))
+            NumberText::parse(value, valueEnd, waveformCount);
+    }
+
+    /* The repaired file is built in one buffer; appending to a String row by row is quadratic */
+    MemoryOutputStream repaired(size_t(complete - begin) + 64);
+
+    if (dataFileName.isEmpty() || samplingRate <= 0 || waveformCount <= 0 || headerLength < 0)
+    {
+        if (!journalEntry.isObject())
+        {
+            report.errors.add(layoutFile.getFullPathName() + " has no usable [FileInfo], and no journal entry to rebuild it from");
+            return false;
+        }
+
+        dataFileName = journalEntry["data_file"].toString();
+        samplingRate = double(journalEntry["sample_rate"]);
+        headerLength = 0;
+        waveformCount = int(journalEntry["num_channels"]);
+
+        PersystLayFileFormat format = PersystLayFileFormat::create(layoutFile.getFullPathName(),
+                                                                   int(samplingRate),
+                                                                   float(double(journalEntry["bit_volts"])),
+                                                                   waveformCount)
+                                                          .withDataFile(dataFileName);
+        if (journalEntry.hasProperty("segment_index"))
+            format.withSegment(int(journalEntry["segment_index"]), int64(journalEntry["first_sample"]));
+
+        repaired << format.toString() << "[ChannelMap]\n";
+        if (const Array<var>* names = journalEntry["channel_names"].getArray())
+        {
+            //Persyst uses first index = 1
+            for (int i = 0; i < names->size(); i++)
+                repaired << (*names)[i].toString() << "=" << String(i + 1) << "\n";
+        }
+    }
+    else
+    {
+        repaired.write(begin, size_t(headerEnd - begin));
+    }
+    repaired << "[SampleTimes]\n";
+
+    const File dataFile = layoutFile.getParentDirectory().getChildFile(dataFileName);
+    if (!dataFile.existsAsFile())
+    {
+        report.errors.add("Data file " + dataFile.getFullPathName() + " of " + layoutFile.getFullPathName() + " does not exist");
+        return false;
+    }
+
+    const int64 frameSize = int64(waveformCount) * sizeof(int16);
+    int64 numSamples = jmax(int64(0), dataFile.getSize() - headerLength) / frameSize;
+
+    /* Preallocated files hold zeros past their data; only the checkpointed part is known to be data */
+    if (journalEntry.isObject() && bool(journalEntry["preallocated"]))
+        numSamples = jmin(numSamples, int64(journalEntry["samples"]));
+
+    if (!truncateFile(dataFile, headerLength + numSamples * frameSize, report))
+        return false;
+
+    /* Keep the rows within the data, in order */
+    int64 lastSample = -1;
+    for (const char* pos = rows; pos < complete;)
+    {
+        const char* lineEnd = std::find(pos, complete, '\n');
+        const char* line = pos;
+        const char* last = lineEnd;
+        pos = lineEnd + 1;
+
+        trim(line, last);
+        if (line == last)
+            continue;
+
+        const char* separator = std::find(line, last, '=');
+        const char* key = line;
+        const char* keyEnd = separator;
+        const char* value = separator + 1;
+        const char* valueEnd = last;
+        trim(key, keyEnd);
+        if (separator != last)
+            trim(value, valueEnd);
+
+        int64 sample;
+        double time;
+        if (separator == last || !NumberText::parse(key, keyEnd, sample) || !NumberText::parse(value, valueEnd, time)
+            || sample <= lastSample || sample >= numSamples)
+        {
+            report.sampleTimesDropped++;
+            continue;
+        }
+
+        repaired.write(line, size_t(last - line));
+        repaired.writeByte('\n');
+        lastSample = sample;
+    }
+
+    /* The journal knows the last row added before the checkpoint, even if it was never written */
+    if (journalEntry.isObject() && journalEntry.hasProperty("last_sample"))
+    {
+        const int64 sample = int64(journalEntry["last_sample"]);
+        if (sample > lastSample && sample < numSamples)
+            writeSampleTime(repaired, sample, double(journalEntry["last_time"]));
+    }
+
+    const size_t textSize = std::strlen(begin);
+    if (repaired.getDataSize() != textSize || std::memcmp(repaired.getData(), begin, textSize) != 0)
+    {
+        if (!layoutFile.replaceWithData(repaired.getData(), repaired.getDataSize()))
+        {
+            report.errors.add("Could not write " + layoutFile.getFullPathName());
+            return false;
+        }
+        report.filesRepaired++;
+    }
+
+    report.samplesRecovered += numSamples;
+    return true;
+}
+
+void RecordingRecovery::recoverSegmentManifest(const File& manifestFile, Report& report)
+{
+    var manifest;
+    if (JSON::parse(manifestFile.loadFileAsString(), manifest).failed() || manifest["segments"].getArray() == nullptr)
+    {
+        report.errors.add("Could not read segment manifest " + manifestFile.getFullPathName());
+        return;
+    }
+
+    const int64 frameSize = int64(int(manifest["num_channels"])) * sizeof(int16);
+    bool changed = false;
+
+    /* The last segment's length is only written when it is closed */
+    for (const var& segment : *manifest["segments"].getArray())
+    {
+        if (segment.hasProperty("num_samples") || frameSize <= 0)
+            continue;
+
+        const File dataFile = manifestFile.getParentDirectory().getChildFile(segment["data_file"].toString());
+        segment.getDynamicObject()->setProperty("num_samples", dataFile.getSize() / frameSize);
+        changed = true;
+    }
+
+    if (changed)
+    {
+        if (manifestFile.replaceWithText(JSON::toString(manifest)))
+            report.filesRepaired++;
+        else
+            report.errors.add("Could not write " + manifestFile.getFullPathName());
+    }
+}
+
+/* Location and shape of the array in a .npy file */
+struct NpyLayout
+{
+    File file;
+    int64 dictStart;
+    int64 dictLength;
+    String dict;
+    int shapeStart;
+    int shapeEnd;
+    String innerShape;
+    int64 recordSize;
+    int64 records;
+    int64 fileRecords;
+};
+
+static bool readNpyLayout(const File& file, NpyLayout& layout)
+{
+    MemoryMappedFile mapped(file, MemoryMappedFile::readOnly);
+    const char* bytes = static_cast<const char*>(mapped.getData());
+    const size_t size = mapped.getSize();
+
+    if (bytes == nullptr || size < 12 || std::memcmp(bytes, "\x93NUMPY", 6) != 0)
+        return false;
+
+    /* Version 1 has a 16-bit header length, later versions a 32-bit one */
+    size_t headerStart, headerLength;
+    if (bytes[6] == 1)
+    {
+        headerStart = 10;
+        headerLength = size_t(uint8(bytes[8])) | size_t(uint8(bytes[9])) << 8;
+    }
+    else
+    {
+        headerStart = 12;
+        headerLength = size_t(uint8(bytes[8])) | size_t(uint8(bytes[9])) << 8
+                     | size_t(uint8(bytes[10])) << 16 | size_t(uint8(bytes[11])) << 24;
+    }
+
+    if (headerStart + headerLength > size)
+        return false;
+
+    layout.file = file;
+    layout.dictStart = int64(headerStart);
+    layout.dictLength = int64(headerLength);
+    layout.dict = String::fromUTF8(bytes + headerStart, int(headerLength));
+
+    /* e.g. {'descr': '<i8', 'fortran_order': False, 'shape': (120, 2), } */
+    const std::string dict = layout.dict.toStdString();
+    const size_t descr = dict.find("'descr':");
+    const size_t typeStart = descr == std::string::npos ? descr : dict.find('\'', descr + 8);
+    const size_t typeEnd = typeStart == std::string::npos ? typeStart : dict.find('\'', typeStart + 1);
+    const size_t shape = dict.find("'shape':");
+    const size_t shapeStart = shape == std::string::npos ? shape : dict.find('(', shape);
+    const size_t shapeEnd = shapeStart == std::string::npos ? shapeStart : dict.find(')', shapeStart);
+
+    if (typeEnd == std::string::npos || shapeEnd == std::string::npos)
+        return false;
+
+    /* Item size from the dtype, where unicode strings take 4 bytes per character */
+    size_t digits = typeEnd;
+    while (digits > typeStart + 1 && dict[digits - 1] >= '0' && dict[digits - 1] <= '9')
+        digits--;
+    int64 itemSize;
+    if (digits == typeEnd || !NumberText::parse(dict.data() + digits, dict.data() + typeEnd, itemSize))
+        return false;
+    if (dict[digits - 1] == 'U')
+        itemSize *= 4;
+
+    /* Every dimension after the first is part of a record */
+    layout.shapeStart = int(shapeStart);
+    layout.shapeEnd = int(shapeEnd) + 1;
+    const size_t firstComma = dict.find(',', shapeStart);
+    int64 records = 0;
+    if (firstComma == std::string::npos || firstComma > shapeEnd
+        || !NumberText::parse(dict.data() + shapeStart + 1, dict.data() + firstComma, records))
+        return false;
+    layout.records = records;
+
+    layout.innerShape = String(dict.substr(firstComma + 1, shapeEnd - firstComma - 1)).trim();
+    layout.recordSize = itemSize;
+    for (size_t pos = firstComma + 1; pos < shapeEnd;)
+    {
+        size_t next = dict.find(',', pos);
+        if (next == std::string::npos || next > shapeEnd)
+            next = shapeEnd;
+
+        const char* dim = dict.data() + pos;
+        const char* dimEnd = dict.data() + next;
+        trim(dim, dimEnd);
+        int64 length;
+        if (dim != dimEnd)
+        {
+            if (!NumberText::parse(dim, dimEnd, length) || length <= 0)
+                return false;
+            layout.recordSize *= length;
+        }
+        pos = next + 1;
+    }
+
+    if (layout.recordSize <= 0)
+        return false;
+
+    layout.fileRecords = (int64(size) - layout.dictStart - layout.dictLength) / layout.recordSize;
+    return true;
+}
+
+bool RecordingRecovery::recoverEventFolder(const File& folder, Report& report)
+{
+    const Array<File> files = folder.findChildFiles(File::findFiles, false, "*.npy");
+    if (files.size() == 0)
+        return true;
+
+    report.eventFolders++;
+
+    /* The files of a folder are columns of the same events, so they keep the records all of them hold */
+    Array<NpyLayout> layouts;
+    int64 numRecords = std::numeric_limits<int64>::max();
+    for (const File& file : files)
+    {
+        NpyLayout layout;
+        if (!readNpyLayout(file, layout))
+        {
+            report.errors.add("Could not read the header of " + file.getFullPathName());
+            continue;
+        }
+        layouts.add(layout);
+        numRecords = jmin(numRecords, layout.fileRecords);
+    }
+
+    bool ok = true;
+    for (const NpyLayout& layout : layouts)
+    {
+        if (layout.records != numRecords)
+        {
+            String shape = "(" + String(numRecords) + ",";
+            if (layout.innerShape.isNotEmpty())
+                shape += " " + layout.innerShape;
+            shape += ")";
+
+            /* The header keeps its length, padded with spaces up to its closing newline */
+            String dict = layout.dict.substring(0, layout.shapeStart) + shape + layout.dict.substring(layout.shapeEnd);
+            dict = dict.trimEnd();
+            if (dict.length() + 1 > layout.dictLength)
+            {
+                report.errors.add("No room in the header of " + layout.file.getFullPathName() + " for " + String(numRecords) + " records");
+                ok = false;
+                continue;
+            }
+            dict = dict.paddedRight(' ', int(layout.dictLength) - 1) + "\n";
+
+            FileOutputStream out(layout.file);
+            if (!out.openedOk() || !out.setPosition(layout.dictStart) || !out.write(dict.toRawUTF8(), size_t(layout.dictLength)))
+            {
+                report.errors.add("Could not write " + layout.file.getFullPathName());
+                ok = false;
+                continue;
+            }
+            out.flush();
+            report.filesRepaired++;
+        }
+
+        ok = truncateFile(layout.file, layout.dictStart + layout.dictLength + numRecords * layout.recordSize, report) && ok;
+    }
+
+    if (layouts.size() > 0)
+        report.eventsRecovered += numRecords;
+
+    return ok && layouts.size() == files.size();
+}
+
+bool RecordingRecovery::truncateFile(const File& file, int64 size, Report& report)
+{
+    const int64 fileSize = file.getSize();
+    if (fileSize <= size)
+        return true;
+
+    FileOutputStream out(file);
+    if (!out.openedOk() || !out.setPosition(size) || out.truncate().failed())
+    {
+        report.errors.add("Could not truncate " + file.getFullPathName());
+        return false;
+    }
+
+    report.bytesTruncated += fileSize - size;
+    report.filesRepaired++;
+    return true;
+}
@@ -0,0 +1,86 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef RECORDINGRECOVERY_H_DEFINED
+#define RECORDINGRECOVERY_H_DEFINED
+
+#include <RecordingLib.h>
+
+/**
+    Repairs a recording that was interrupted by a crash or power loss, so that its
+    layout, data and event files can be read again.
+
+    Each .dat file is cut back to whole frames, and its .lay file rewritten with the
+    [SampleTimes] rows that fall within the data. The .npy files of each event folder
+    get the number of records they all hold written into their headers, and any partly
+    written record is cut off. A segments.json gets the length of any segment it is
+    missing. Files that are already consistent are left untouched, so recovering a
+    recording twice changes nothing.
+
+    When the journal of the record engine's checkpoints is there, it also supplies the
+    header of a .lay file that did not reach the disk, the last [SampleTimes] row, and
+    the data length of memory-mapped files, which are preallocated past their data.
+    The journal is removed once the recording has been repaired.
+*/
+class TESTABLE RecordingRecovery
+{
+public:
+
+    struct Report
+    {
+        int layoutFiles{ 0 };
+        int eventFolders{ 0 };
+
+        /* Files that had to be changed */
+        int filesRepaired{ 0 };
+
+        int64 samplesRecovered{ 0 };
+        int64 eventsRecovered{ 0 };
+        int64 bytesTruncated{ 0 };
+        int64 sampleTimesDropped{ 0 };
+
+        StringArray errors;
+
+        bool isOk() const { return errors.size() == 0; }
+    };
+
+    /** Repairs the recording in recordingFolder, the folder holding its continuous and events folders */
+    static bool recover(const File& recordingFolder, Report& report);
+
+    /** Repairs a .lay file and its data file. journalEntry is the stream's journal entry, or a void var. */
+    static bool recoverLayout(const File& layoutFile, const var& journalEntry, Report& report);
+
+    /** Repairs the .npy files of one event folder */
+    static bool recoverEventFolder(const File& folder, Report& report);
+
+    /** True if folder looks like a recording folder */
+    static bool isRecordingFolder(const File& folder);
+
+private:
+
+    static void recoverSegmentManifest(const File& manifestFile, Report& report);
+    static bool truncateFile(const File& file, int64 size, Report& report);
+};
+
+#endif
@@ -0,0 +1,720 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SampleConversion.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PERSYST_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PERSYST_TARGET(isa)
+#else
+#define PERSYST_TARGET(isa) __attribute__((target(isa)))
+#endif
+#else
+#define PERSYST_X86 0
+#endif
+
+/* Reference conversion of a single sample, written exactly like the JUCE two-pass path */
+static inline int16 convertSample(float value, float scale)
+{
+    const double maxVal = (double)0x7fff;
+    const float scaled = value * scale;
+    return (int16)roundToInt(jlimit(-maxVal, maxVal, maxVal * scaled));
+}
+
+/* Conversion kernels are compiled twice: Track adds every output sample to stats, and the
+   plain variant never touches it. The scatter kernels write every destStride-th sample of
+   dest; FixedStride, when not 0, is that stride known at compile time. */
+template <bool Track, int FixedStride>
+static void floatToInt16ScatterScalar(const float* source, int16* dest, int destStride, float scale, int numSamples,
+                                      SampleConversion::ClipStats& stats)
+{
+    const int stride = FixedStride != 0 ? FixedStride : destStride;
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        const int16 value = convertSample(source[i], scale);
+        dest[i * stride] = value;
+
+        if (Track)
+        {
+            stats.minimum = jmin(stats.minimum, value);
+            stats.maximum = jmax(stats.maximum, value);
+            stats.saturated += (value == 0x7fff || value == -0x7fff) ? 1 : 0;
+        }
+    }
+}
+
+template <bool Track>
+static void floatToInt16Scalar(const float* source, int16* dest, float scale, int numSamples, SampleConversion::ClipStats& stats)
+{
+    floatToInt16ScatterScalar<Track, 1>(source, dest, 1, scale, numSamples, stats);
+}
+
+static void int16ToFloatScalar(const int16* source, float* dest, float scale, int numSamples)
+{
+    for (int i = 0; i < numSamples; i++)
+        dest[i] = float(source[i]) * scale;
+}
+
+#if PERSYST_X86
+
+/* The SIMD kernels work in double precision after the float multiply so that rounding ties
+   resolve exactly like the scalar path. cvtpd2dq rounds with the current MXCSR mode, which is
+   the same mode the scalar roundToInt trick relies on. Vectors containing NaN fall back to the
+   scalar path so that even NaN payloads convert identically. */
+
+static inline __m128i roundAndClampSSE2(__m128 scaled, __m128d maxVal, __m128d minVal)
+{
+    __m128d lo = _mm_mul_pd(_mm_cvtps_pd(scaled), maxVal);
+    __m128d hi = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(scaled, scaled)), maxVal);
+    lo = _mm_min_pd(_mm_max_pd(lo, minVal), maxVal);
+    hi = _mm_min_pd(_mm_max_pd(hi, minVal), maxVal);
+    return _mm_unpacklo_epi64(_mm_cvtpd_epi32(lo), _mm_cvtpd_epi32(hi));
+}
+
+/* Running minimum, maximum and saturation count of packed int16 output. Saturated lanes compare
+   to -1, and pmaddwd sums pairs of them into 32-bit counters that cannot overflow in one call. */
+struct ClipTracker
+{
+    __m128i minimum = _mm_set1_epi16(32767);
+    __m128i maximum = _mm_set1_epi16(-32768);
+    __m128i saturated = _mm_setzero_si128();
+
+    inline void add(__m128i packed)
+    {
+        minimum = _mm_min_epi16(minimum, packed);
+        maximum = _mm_max_epi16(maximum, packed);
+        const __m128i rails = _mm_or_si128(_mm_cmpeq_epi16(packed, _mm_set1_epi16(0x7fff)),
+                                           _mm_cmpeq_epi16(packed, _mm_set1_epi16(-0x7fff)));
+        saturated = _mm_sub_epi32(saturated, _mm_madd_epi16(rails, _mm_set1_epi16(1)));
+    }
+
+    void addTo(SampleConversion::ClipStats& stats) const
+    {
+        alignas(16) int16 minimums[8], maximums[8];
+        alignas(16) int32 counts[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(minimums), minimum);
+        _mm_store_si128(reinterpret_cast<__m128i*>(maximums), maximum);
+        _mm_store_si128(reinterpret_cast<__m128i*>(counts), saturated);
+
+        for (int lane = 0; lane < 8; lane++)
+        {
+            stats.minimum = jmin(stats.minimum, minimums[lane]);
+            stats.maximum = jmax(stats.maximum, maximums[lane]);
+        }
+        for (int lane = 0; lane < 4; lane++)
+            stats.saturated += counts[lane];
+    }
+};
+
+template <bool Track>
+static void floatToInt16SSE2(const float* source, int16* dest, float scale, int numSamples, SampleConversion::ClipStats& stats)
+{
+    const __m128 s = _mm_set1_ps(scale);
+    const __m128d maxVal = _mm_set1_pd(32767.0);
+    const __m128d minVal = _mm_set1_pd(-32767.0);
+    ClipTracker tracker;
+
+    int i = 0;
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        const __m128 a = _mm_mul_ps(_mm_loadu_ps(source + i), s);
+        const __m128 b = _mm_mul_ps(_mm_loadu_ps(source + i + 4), s);
+
+        if (_mm_movemask_ps(_mm_or_ps(_mm_cmpunord_ps(a, a), _mm_cmpunord_ps(b, b))))
+        {
+            floatToInt16Scalar<Track>(source + i, dest + i, scale, 8, stats);
+            continue;
+        }
+
+        const __m128i packed = _mm_packs_epi32(roundAndClampSSE2(a, maxVal, minVal),
+                                               roundAndClampSSE2(b, maxVal, minVal));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), packed);
+
+        if (Track)
+            tracker.add(packed);
+    }
+
+    if (Track)
+        tracker.addTo(stats);
+
+    floatToInt16Scalar<Track>(source + i, dest + i, scale, numSamples - i, stats);
+}
+
+/* Converts 8 samples as a vector like floatToInt16SSE2 and stores each lane straight into its
+   frame. Wider vectors would only add lanes to extract, since the stores dominate. */
+template <bool Track, int FixedStride>
+static void floatToInt16ScatterSSE2(const float* source, int16* dest, int destStride, float scale, int numSamples,
+                                    SampleConversion::ClipStats& stats)
+{
+    const int stride = FixedStride != 0 ? FixedStride : destStride;
+    const __m128 s = _mm_set1_ps(scale);
+    const __m128d maxVal = _mm_set1_pd(32767.0);
+    const __m128d minVal = _mm_set1_pd(-32767.0);
+    ClipTracker tracker;
+
+    int i = 0;
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        const __m128 a = _mm_mul_ps(_mm_loadu_ps(source + i), s);
+        const __m128 b = _mm_mul_ps(_mm_loadu_ps(source + i + 4), s);
+        int16* const out = dest + i * stride;
+
+        if (_mm_movemask_ps(_mm_or_ps(_mm_cmpunord_ps(a, a), _mm_cmpunord_ps(b, b))))
+        {
+            floatToInt16ScatterScalar<Track, FixedStride>(source + i, out, stride, scale, 8, stats);
+            continue;
+        }
+
+        const __m128i packed = _mm_packs_epi32(roundAndClampSSE2(a, maxVal, minVal),
+                                               roundAndClampSSE2(b, maxVal, minVal));
+        out[0] = int16(_mm_extract_epi16(packed, 0));
+        out[stride] = int16(_mm_extract_epi16(packed, 1));
+        out[2 * stride] = int16(_mm_extract_epi16(packed, 2));
+        out[3 * stride] = int16(_mm_extract_epi16(packed, 3));
+        out[4 * stride] = int16(_mm_extract_epi16(packed, 4));
+        out[5 * stride] = int16(_mm_extract_epi16(packed, 5));
+        out[6 * stride] = int16(_mm_extract_epi16(packed, 6));
+        out[7 * stride] = int16(_mm_extract_epi16(packed, 7));
+
+        if (Track)
+            tracker.add(packed);
+    }
+
+    if (Track)
+        tracker.addTo(stats);
+
+    floatToInt16ScatterScalar<Track, FixedStride>(source + i, dest + i * stride, stride, scale, numSamples - i, stats);
+}
+
+PERSYST_TARGET("avx2")
+static inline __m128i roundAndClampAVX2(__m128 scaled, __m256d maxVal, __m256d minVal)
+{
+    __m256d d = _mm256_mul_pd(_mm256_cvtps_pd(scaled), maxVal);
+    d = _mm256_min_pd(_mm256_max_pd(d, minVal), maxVal);
+    return _mm256_cvtpd_epi32(d);
+}
+
+template <bool Track>
+PERSYST_TARGET("avx2")
+static void floatToInt16AVX2(const float* source, int16* dest, float scale, int numSamples, SampleConversion::ClipStats& stats)
+{
+    const __m256 s = _mm256_set1_ps(scale);
+    const __m256d maxVal = _mm256_set1_pd(32767.0);
+    const __m256d minVal = _mm256_set1_pd(-32767.0);
+    ClipTracker tracker;
+
+    int i = 0;
+    for (; i + 16 <= numSamples; i += 16)
+    {
+        const __m256 a = _mm256_mul_ps(_mm256_loadu_ps(source + i), s);
+        const __m256 b = _mm256_mul_ps(_mm256_loadu_ps(source + i + 8), s);
+
+        if (_mm256_movemask_ps(_mm256_or_ps(_mm256_cmp_ps(a, a, _CMP_UNORD_Q), _mm256_cmp_ps(b, b, _CMP_UNORD_Q))))
+        {
+            floatToInt16Scalar<Track>(source + i, dest + i, scale, 16, stats);
+            continue;
+        }
+
+        const __m128i lo = _mm_packs_epi32(roundAndClampAVX2(_mm256_castps256_ps128(a), maxVal, minVal),
+                                           roundAndClampAVX2(_mm256_extractf128_ps(a, 1), maxVal, minVal));
+        const __m128i hi = _mm_packs_epi32(roundAndClampAVX2(_mm256_castps256_ps128(b), maxVal, minVal),
+                                           roundAndClampAVX2(_mm256_extractf128_ps(b, 1), maxVal, minVal));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i + 8), hi);
+
+        if (Track)
+        {
+            tracker.add(lo);
+            tracker.add(hi);
+        }
+    }
+
+    if (Track)
+        tracker.addTo(stats);
+
+    floatToInt16Scalar<Track>(source + i, dest + i, scale, numSamples - i, stats);
+}
+
+template <bool Track>
+PERSYST_TARGET("avx512f")
+static void floatToInt16AVX512(const float* source, int16* dest, float scale, int numSamples, SampleConversion::ClipStats& stats)
+{
+    const __m512 s = _mm512_set1_ps(scale);
+    const __m512d maxVal = _mm512_set1_pd(32767.0);
+    const __m512d minVal = _mm512_set1_pd(-32767.0);
+    ClipTracker tracker;
+
+    int i = 0;
+    for (; i + 16 <= numSamples; i += 16)
+    {
+        const __m512 a = _mm512_mul_ps(_mm512_loadu_ps(source + i), s);
+
+        if (_mm512_cmp_ps_mask(a, a, _CMP_UNORD_Q))
+        {
+            floatToInt16Scalar<Track>(source + i, dest + i, scale, 16, stats);
+            continue;
+        }
+
+        __m512d lo = _mm512_mul_pd(_mm512_cvtps_pd(_mm512_castps512_ps256(a)), maxVal);
+        __m512d hi = _mm512_mul_pd(_mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(a), 1))), maxVal);
+        lo = _mm512_min_pd(_mm512_max_pd(lo, minVal), maxVal);
+        hi = _mm512_min_pd(_mm512_max_pd(hi, minVal), maxVal);
+
+        const __m512i ints = _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvtpd_epi32(lo)), _mm512_cvtpd_epi32(hi), 1);
+        const __m256i packed = _mm512_cvtsepi32_epi16(ints);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), packed);
+
+        if (Track)
+        {
+            tracker.add(_mm256_castsi256_si128(packed));
+            tracker.add(_mm256_extractf128_si256(packed, 1));
+        }
+    }
+
+    if (Track)
+        tracker.addTo(stats);
+
+    floatToInt16Scalar<Track>(source + i, dest + i, scale, numSamples - i, stats);
+}
+
+/* int16 -> int32 -> float is exact, so a single float multiply gives the scalar result */
+
+static void int16ToFloatSSE2(const int16* source, float* dest, float scale, int numSamples)
+{
+    const __m128 s = _mm_set1_ps(scale);
+
+    int i = 0;
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), s));
+        _mm_storeu_ps(dest + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), s));
+    }
+
+    int16ToFloatScalar(source + i, dest + i, scale, numSamples - i);
+}
+
+PERSYST_TARGET("avx2")
+static void int16ToFloatAVX2(const int16* source, float* dest, float scale, int numSamples)
+{
+    const __m256 s = _mm256_set1_ps(scale);
+
+    int i = 0;
+    for (; i + 16 <= numSamples; i += 16)
+    {
+        const __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)));
+        const __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i + 8)));
+        _mm256_storeu_ps(dest + i, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), s));
+        _mm256_storeu_ps(dest + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), s));
+    }
+
+    int16ToFloatScalar(source + i, dest + i, scale, numSamples - i);
+}
+
+PERSYST_TARGET("avx512f")
+static void int16ToFloatAVX512(const int16* source, float* dest, float scale, int numSamples)
+{
+    const __m512 s = _mm512_set1_ps(scale);
+
+    int i = 0;
+    for (; i + 16 <= numSamples; i += 16)
+    {
+        const __m512i v = _mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i)));
+        _mm512_storeu_ps(dest + i, _mm512_mul_ps(_mm512_cvtepi32_ps(v), s));
+    }
+
+    int16ToFloatScalar(source + i, dest + i, scale, numSamples - i);
+}
+
+#ifdef _MSC_VER
+static bool osSupportsRegisters(unsigned long long mask)
+{
+    int info[4];
+    __cpuid(info, 1);
+    if (!(info[2] & (1 << 27))) // OSXSAVE
+        return false;
+    return (_xgetbv(0) & mask) == mask;
+}
+#endif
+
+static bool cpuSupports(SampleConversion::InstructionSet set)
+{
+    switch (set)
+    {
+    case SampleConversion::SCALAR:
+    case SampleConversion::SSE2:
+        return true;
+#ifdef _MSC_VER
+    case SampleConversion::AVX2:
+    {
+        int info[4];
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) && osSupportsRegisters(0x6);
+    }
+    case SampleConversion::AVX512:
+    {
+        int info[4];
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 16)) && osSupportsRegisters(0xe6);
+    }
+#else
+    case SampleConversion::AVX2:
+        return __builtin_cpu_supports("avx2");
+    case SampleConversion::AVX512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return false;
+    }
+}
+
+#else
+
+static bool cpuSupports(SampleConversion::InstructionSet set)
+{
+    return set == SampleConversion::SCALAR;
+}
+
+#endif
+
+/* Samples per tile in interleave(). A tile of 8 channel rows stays in L1 while its frames are written. */
+#define INTERLEAVE_TILE_SAMPLES 64
+
+static void interleaveScalar(const int16* source, int sourceStride, int16* dest, int numChannels,
+                             int firstChannel, int lastChannel, int firstSample, int lastSample)
+{
+    for (int s = firstSample; s < lastSample; s++)
+        for (int ch = firstChannel; ch < lastChannel; ch++)
+            dest[s * numChannels + ch] = source[ch * sourceStride + s];
+}
+
+#if PERSYST_X86
+static inline void transpose8x8(const int16* source, int sourceStride, int16* dest, int destStride)
+{
+    const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+    const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + sourceStride));
+    const __m128i a2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * sourceStride));
+    const __m128i a3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 3 * sourceStride));
+    const __m128i a4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 4 * sourceStride));
+    const __m128i a5 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 5 * sourceStride));
+    const __m128i a6 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 6 * sourceStride));
+    const __m128i a7 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 7 * sourceStride));
+
+    const __m128i t0 = _mm_unpacklo_epi16(a0, a1);
+    const __m128i t1 = _mm_unpackhi_epi16(a0, a1);
+    const __m128i t2 = _mm_unpacklo_epi16(a2, a3);
+    const __m128i t3 = _mm_unpackhi_epi16(a2, a3);
+    const __m128i t4 = _mm_unpacklo_epi16(a4, a5);
+    const __m128i t5 = _mm_unpackhi_epi16(a4, a5);
+    const __m128i t6 = _mm_unpacklo_epi16(a6, a7);
+    const __m128i t7 = _mm_unpackhi_epi16(a6, a7);
+
+    const __m128i u0 = _mm_unpacklo_epi32(t0, t2);
+    const __m128i u1 = _mm_unpackhi_epi32(t0, t2);
+    const __m128i u2 = _mm_unpacklo_epi32(t1, t3);
+    const __m128i u3 = _mm_unpackhi_epi32(t1, t3);
+    const __m128i u4 = _mm_unpacklo_epi32(t4, t6);
+    const __m128i u5 = _mm_unpackhi_epi32(t4, t6);
+    const __m128i u6 = _mm_unpacklo_epi32(t5, t7);
+    const __m128i u7 = _mm_unpackhi_epi32(t5, t7);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_unpacklo_epi64(u0, u4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + destStride), _mm_unpackhi_epi64(u0, u4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 2 * destStride), _mm_unpacklo_epi64(u1, u5));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 3 * destStride), _mm_unpackhi_epi64(u1, u5));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 4 * destStride), _mm_unpacklo_epi64(u2, u6));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 5 * destStride), _mm_unpackhi_epi64(u2, u6));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 6 * destStride), _mm_unpacklo_epi64(u3, u7));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 7 * destStride), _mm_unpackhi_epi64(u3, u7));
+}
+#endif
+
+static void interleaveGeneric(const int16* source, int sourceStride, int16* dest, int numChannels, int numSamples)
+{
+#if PERSYST_X86
+    const int vectorChannels = numChannels & ~7;
+
+    for (int tileStart = 0; tileStart < numSamples; tileStart += INTERLEAVE_TILE_SAMPLES)
+    {
+        const int tileEnd = jmin(tileStart + INTERLEAVE_TILE_SAMPLES, numSamples);
+        const int vectorEnd = tileStart + ((tileEnd - tileStart) & ~7);
+
+        for (int ch = 0; ch < vectorChannels; ch += 8)
+        {
+            for (int s = tileStart; s < vectorEnd; s += 8)
+                transpose8x8(source + ch * sourceStride + s, sourceStride, dest + s * numChannels + ch, numChannels);
+        }
+
+        /* Leftover channels and samples that don't fill an 8x8 tile */
+        interleaveScalar(source, sourceStride, dest, numChannels, vectorChannels, numChannels, tileStart, vectorEnd);
+        interleaveScalar(source, sourceStride, dest, numChannels, 0, numChannels, vectorEnd, tileEnd);
+    }
+#else
+    for (int tileStart = 0; tileStart < numSamples; tileStart += INTERLEAVE_TILE_SAMPLES)
+        interleaveScalar(source, sourceStride, dest, numChannels, 0, numChannels,
+                         tileStart, jmin(tileStart + INTERLEAVE_TILE_SAMPLES, numSamples));
+#endif
+}
+
+/* Same tiling as interleaveGeneric, with the channel count known at compile time.
+   NumChannels is a multiple of 8, so every channel is covered by the 8x8 transposes. */
+template <int NumChannels>
+static void interleaveFixed(const int16* source, int sourceStride, int16* dest, int, int numSamples)
+{
+    static_assert(NumChannels % 8 == 0, "fixed kernels need whole groups of 8 channels");
+
+    for (int tileStart = 0; tileStart < numSamples; tileStart += INTERLEAVE_TILE_SAMPLES)
+    {
+        const int tileEnd = jmin(tileStart + INTERLEAVE_TILE_SAMPLES, numSamples);
+#if PERSYST_X86
+        const int vectorEnd = tileStart + ((tileEnd - tileStart) & ~7);
+
+        for (int ch = 0; ch < NumChannels; ch += 8)
+        {
+            for (int s = tileStart; s < vectorEnd; s += 8)
+                transpose8x8(source + ch * sourceStride + s, sourceStride, dest + s * NumChannels + ch, NumChannels);
+        }
+#else
+        const int vectorEnd = tileStart;
+#endif
+        for (int s = vectorEnd; s < tileEnd; s++)
+            for (int ch = 0; ch < NumChannels; ch++)
+                dest[s * NumChannels + ch] = source[ch * sourceStride + s];
+    }
+}
+
+static void scatterGeneric(const int16* source, int16* dest, int numChannels, int numSamples)
+{
+    for (int i = 0; i < numSamples; i++)
+        dest[i * numChannels] = source[i];
+}
+
+template <int NumChannels>
+static void scatterFixed(const int16* source, int16* dest, int, int numSamples)
+{
+    for (int i = 0; i < numSamples; i++)
+        dest[i * NumChannels] = source[i];
+}
+
+typedef void (*ScatterKernel)(const float*, int16*, int, float, int, SampleConversion::ClipStats&);
+
+template <bool Track, int FixedStride>
+static ScatterKernel getScatterKernel(SampleConversion::InstructionSet set)
+{
+#if PERSYST_X86
+    if (set != SampleConversion::SCALAR)
+        return floatToInt16ScatterSSE2<Track, FixedStride>;
+#endif
+    return floatToInt16ScatterScalar<Track, FixedStride>;
+}
+
+template <int FixedStride>
+static void convertScatter(const float* source, int16* dest, int numChannels, float scale, int numSamples,
+                           SampleConversion::ClipStats* stats)
+{
+    if (stats != nullptr)
+    {
+        static const ScatterKernel kernel = getScatterKernel<true, FixedStride>(SampleConversion::getInstructionSet());
+        kernel(source, dest, numChannels, scale, numSamples, *stats);
+    }
+    else
+    {
+        static const ScatterKernel kernel = getScatterKernel<false, FixedStride>(SampleConversion::getInstructionSet());
+        SampleConversion::ClipStats unused;
+        kernel(source, dest, numChannels, scale, numSamples, unused);
+    }
+}
+
+static void convertScatterGeneric(const float* source, int16* dest, int numChannels, float scale, int numSamples,
+                                  SampleConversion::ClipStats* stats)
+{
+    convertScatter<0>(source, dest, numChannels, scale, numSamples, stats);
+}
+
+template <int NumChannels>
+static void convertScatterFixed(const float* source, int16* dest, int, float scale, int numSamples,
+                                SampleConversion::ClipStats* stats)
+{
+    convertScatter<NumChannels>(source, dest, NumChannels, scale, numSamples, stats);
+}
+
+template <int NumChannels>
+static SampleConversion::ChannelKernels fixedChannelKernels()
+{
+    return { interleaveFixed<NumChannels>, scatterFixed<NumChannels>, convertScatterFixed<NumChannels> };
+}
+
+SampleConversion::ChannelKernels SampleConversion::getChannelKernels(int numChannels)
+{
+    switch (numChannels)
+    {
+    case 8:
+        return fixedChannelKernels<8>();
+    case 16:
+        return fixedChannelKernels<16>();
+    case 32:
+        return fixedChannelKernels<32>();
+    case 64:
+        return fixedChannelKernels<64>();
+    case 128:
+        return fixedChannelKernels<128>();
+    case 384:
+        return fixedChannelKernels<384>();
+    default:
+        return getGenericChannelKernels();
+    }
+}
+
+SampleConversion::ChannelKernels SampleConversion::getGenericChannelKernels()
+{
+    return { interleaveGeneric, scatterGeneric, convertScatterGeneric };
+}
+
+bool SampleConversion::hasFixedChannelKernels(int numChannels)
+{
+    return getChannelKernels(numChannels).interleave != interleaveGeneric;
+}
+
+void SampleConversion::interleave(const int16* source, int sourceStride, int16* dest, int numChannels, int numSamples)
+{
+    getChannelKernels(numChannels).interleave(source, sourceStride, dest, numChannels, numSamples);
+}
+
+typedef void (*ConversionKernel)(const float*, int16*, float, int, SampleConversion::ClipStats&);
+
+template <bool Track>
+static ConversionKernel getKernel(SampleConversion::InstructionSet set)
+{
+    switch (set)
+    {
+#if PERSYST_X86
+    case SampleConversion::AVX512:
+        return floatToInt16AVX512<Track>;
+    case SampleConversion::AVX2:
+        return floatToInt16AVX2<Track>;
+    case SampleConversion::SSE2:
+        return floatToInt16SSE2<Track>;
+#endif
+    default:
+        return floatToInt16Scalar<Track>;
+    }
+}
+
+typedef void (*WideningKernel)(const int16*, float*, float, int);
+
+static WideningKernel getWideningKernel(SampleConversion::InstructionSet set)
+{
+    switch (set)
+    {
+#if PERSYST_X86
+    case SampleConversion::AVX512:
+        return int16ToFloatAVX512;
+    case SampleConversion::AVX2:
+        return int16ToFloatAVX2;
+    case SampleConversion::SSE2:
+        return int16ToFloatSSE2;
+#endif
+    default:
+        return int16ToFloatScalar;
+    }
+}
+
+SampleConversion::InstructionSet SampleConversion::getInstructionSet()
+{
+    static const InstructionSet best = []
+    {
+        if (cpuSupports(AVX512))
+            return AVX512;
+        if (cpuSupports(AVX2))
+            return AVX2;
+        if (cpuSupports(SSE2))
+            return SSE2;
+        return SCALAR;
+    }();
+
+    return best;
+}
+
+bool SampleConversion::isSupported(InstructionSet set)
+{
+    return cpuSupports(set);
+}
+
+const char* SampleConversion::getName(InstructionSet set)
+{
+    switch (set)
+    {
+    case SSE2:
+        return "SSE2";
+    case AVX2:
+        return "AVX2";
+    case AVX512:
+        return "AVX-512";
+    default:
+        return "Scalar";
+    }
+}
+
+void SampleConversion::floatToInt16(const float* source, int16* dest, float scale, int numSamples)
+{
+    static const ConversionKernel kernel = getKernel<false>(getInstructionSet());
+    ClipStats unused;
+    kernel(source, dest, scale, numSamples, unused);
+}
+
+void SampleConversion::floatToInt16(InstructionSet set, const float* source, int16* dest, float scale, int numSamples)
+{
+    jassert(isSupported(set));
+    ClipStats unused;
+    getKernel<false>(set)(source, dest, scale, numSamples, unused);
+}
+
+void SampleConversion::floatToInt16(const float* source, int16* dest, float scale, int numSamples, ClipStats& stats)
+{
+    static const ConversionKernel kernel = getKernel<true>(getInstructionSet());
+    kernel(source, dest, scale, numSamples, stats);
+}
+
+void SampleConversion::floatToInt16(InstructionSet set, const float* source, int16* dest, float scale, int numSamples, ClipStats& stats)
+{
+    jassert(isSupported(set));
+    getKernel<true>(set)(source, dest, scale, numSamples, stats);
+}
+
+void SampleConversion::int16ToFloat(const int16* source, float* dest, float scale, int numSamples)
+{
+    static const WideningKernel kernel = getWideningKernel(getInstructionSet());
+    kernel(source, dest, scale, numSamples);
+}
+
+void SampleConversion::int16ToFloat(InstructionSet set, const int16* source, float* dest, float scale, int numSamples)
+{
+    jassert(isSupported(set));
+    getWideningKernel(set)(source, dest, scale, numSamples);
+}
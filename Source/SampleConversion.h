@@ -0,0 +1,125 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SAMPLECONVERSION_H_DEFINED
+#define SAMPLECONVERSION_H_DEFINED
+
+#include <RecordingLib.h>
+
+/**
+    Float to int16 conversion kernels used by the continuous write path, and the
+    int16 to float kernels used to read recordings back.
+
+    floatToInt16 scales, rounds, saturates and packs in a single pass. Its output
+    is bit-identical to the two-pass JUCE path it replaces:
+
+        FloatVectorOperations::copyWithMultiply (tmp, source, scale, n);
+        AudioDataConverters::convertFloatToInt16LE (tmp, dest, n);
+
+    i.e. the product is rounded to float, widened to double, multiplied by 0x7fff,
+    clamped to +-0x7fff and rounded half-to-even.
+
+    The widest instruction set supported by the CPU is picked at runtime.
+*/
+class TESTABLE SampleConversion
+{
+public:
+
+    enum InstructionSet
+    {
+        SCALAR = 0,
+        SSE2,
+        AVX2,
+        AVX512
+    };
+
+    /** Range of converted samples, accumulated over any number of conversions */
+    struct ClipStats
+    {
+        /* Samples that came out at +-0x7fff, i.e. reached or exceeded full scale */
+        int64 saturated{ 0 };
+        int16 minimum{ 32767 };
+        int16 maximum{ -32768 };
+    };
+
+    /** Converts numSamples floats to int16 using the best available kernel */
+    static void floatToInt16(const float* source, int16* dest, float scale, int numSamples);
+
+    /** Converts using a specific kernel. The instruction set must be supported by this CPU. */
+    static void floatToInt16(InstructionSet set, const float* source, int16* dest, float scale, int numSamples);
+
+    /** Converts like floatToInt16, and adds the saturated samples and the range of the output to
+        stats in the same pass, while the converted values are still in registers */
+    static void floatToInt16(const float* source, int16* dest, float scale, int numSamples, ClipStats& stats);
+
+    /** Converts and tracks using a specific kernel. The instruction set must be supported by this CPU. */
+    static void floatToInt16(InstructionSet set, const float* source, int16* dest, float scale, int numSamples, ClipStats& stats);
+
+    /** Converts numSamples int16 values to float, multiplying each by scale, using the best
+        available kernel. The result is identical to float (source[i]) * scale. */
+    static void int16ToFloat(const int16* source, float* dest, float scale, int numSamples);
+
+    /** Converts using a specific kernel. The instruction set must be supported by this CPU. */
+    static void int16ToFloat(InstructionSet set, const int16* source, float* dest, float scale, int numSamples);
+
+    /** Interleaves numChannels channel-major rows (sourceStride samples apart) into frames of
+        numChannels samples each, using a cache-blocked 8x8 transpose */
+    static void interleave(const int16* source, int sourceStride, int16* dest, int numChannels, int numSamples);
+
+    /** Kernels that write into frames of a fixed number of channels. The numChannels argument
+        must be the count the kernels were obtained for. */
+    struct ChannelKernels
+    {
+        /** Interleaves channel-major rows into frames, like interleave() */
+        void (*interleave)(const int16* source, int sourceStride, int16* dest, int numChannels, int numSamples);
+
+        /** Copies one channel into every numChannels-th sample of dest */
+        void (*scatter)(const int16* source, int16* dest, int numChannels, int numSamples);
+
+        /** Converts one channel like floatToInt16, writing every numChannels-th sample of dest.
+            If stats is not nullptr, the converted samples are added to it. */
+        void (*convertScatter)(const float* source, int16* dest, int numChannels, float scale, int numSamples, ClipStats* stats);
+    };
+
+    /** Returns the kernels for frames of numChannels samples. The common stream widths of 8, 16,
+        32, 64, 128 and 384 channels get kernels compiled for that count, so their loops are fully
+        unrolled; other widths get the generic kernels. Meant to be looked up once per stream. */
+    static ChannelKernels getChannelKernels(int numChannels);
+
+    /** Returns the kernels that take the channel count at runtime */
+    static ChannelKernels getGenericChannelKernels();
+
+    /** Returns true if numChannels has kernels compiled for it */
+    static bool hasFixedChannelKernels(int numChannels);
+
+    /** Returns the widest instruction set this CPU (and build) supports */
+    static InstructionSet getInstructionSet();
+
+    /** Returns true if the kernel for the given instruction set can run on this CPU */
+    static bool isSupported(InstructionSet set);
+
+    /** Returns a human-readable name for an instruction set */
+    static const char* getName(InstructionSet set);
+};
+
+#endif
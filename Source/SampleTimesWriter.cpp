@@ -0,0 +1,199 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SampleTimesWriter.h"
+#include "NumberText.h"
+
+#include <cmath>
+
+SampleTimesWriter::SampleTimesWriter(SyncableFileStream* stream, size_t arenaSize, uint32 flushInterval) :
+    m_stream(stream),
+    m_arenaSize(jmax(arenaSize, MAX_ENTRY_LENGTH)),
+    m_fill(0),
+    m_flushInterval(flushInterval),
+    m_lastFlush(Time::getMillisecondCounter()),
+    m_compress(false),
+    m_sampleRate(0),
+    m_tolerance(0),
+    m_keyframeSamples(0),
+    m_hasAnchor(false),
+    m_anchorSample(0),
+    m_anchorTime(0),
+    m_hasPending(false),
+    m_pendingSample(0),
+    m_pendingTime(0),
+    m_rowsEmitted(0),
+    m_rowsSuppressed(0),
+    m_discontinuities(0)
+{
+    m_arena.malloc(m_arenaSize);
+}
+
+SampleTimesWriter::~SampleTimesWriter()
+{
+    finish();
+}
+
+void SampleTimesWriter::finish()
+{
+    /* Close the last uniform stretch */
+    if (m_hasPending)
+    {
+        m_rowsSuppressed.fetch_sub(1, std::memory_order_relaxed);
+        emit(m_pendingSample, m_pendingTime);
+    }
+
+    flush();
+}
+
+void SampleTimesWriter::setCompression(double sampleRate, double tolerance, double keyframeInterval)
+{
+    m_compress = sampleRate > 0;
+    m_sampleRate = sampleRate;
+    m_tolerance = tolerance;
+    m_keyframeSamples = jmax(int64(1), int64(keyframeInterval * sampleRate));
+}
+
+SampleTimesWriter::Stats SampleTimesWriter::getStats() const
+{
+    Stats stats;
+    stats.rowsEmitted = m_rowsEmitted.load(std::memory_order_relaxed);
+    stats.rowsSuppressed = m_rowsSuppressed.load(std::memory_order_relaxed);
+    stats.discontinuities = m_discontinuities.load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool SampleTimesWriter::getLastRow(int64& sampleNumber, double& timestamp) const
+{
+    if (m_hasPending)
+    {
+        sampleNumber = m_pendingSample;
+        timestamp = m_pendingTime;
+        return true;
+    }
+
+    sampleNumber = m_anchorSample;
+    timestamp = m_anchorTime;
+    return m_hasAnchor;
+}
+
+void SampleTimesWriter::add(int64 sampleNumber, double timestamp)
+{
+    if (m_compress && m_hasAnchor)
+    {
+        const bool fits = fitsPrediction(sampleNumber, timestamp);
+
+        if (fits && sampleNumber - m_anchorSample < m_keyframeSamples)
+        {
+            suppress(sampleNumber, timestamp);
+            return;
+        }
+
+        if (!fits)
+        {
+            /* Only a step away from the previous row counts as a discontinuity; straying
+               from the prediction while following the previous row is drift */
+            const int64 previousSample = m_hasPending ? m_pendingSample : m_anchorSample;
+            const double previousTime = m_hasPending ? m_pendingTime : m_anchorTime;
+            const double step = timestamp - (previousTime + double(sampleNumber - previousSample) / m_sampleRate);
+            const bool discontinuity = !(std::abs(step) <= m_tolerance);
+
+            if (discontinuity)
+                m_discontinuities.fetch_add(1, std::memory_order_relaxed);
+
+            /* End the previous stretch at the last row that still fitted it; after drift,
+               the new stretch may start from that row */
+            if (m_hasPending)
+            {
+                m_rowsSuppressed.fetch_sub(1, std::memory_order_relaxed);
+                emit(m_pendingSample, m_pendingTime);
+
+                if (!discontinuity && fitsPrediction(sampleNumber, timestamp) && sampleNumber - m_anchorSample < m_keyframeSamples)
+                {
+                    suppress(sampleNumber, timestamp);
+                    return;
+                }
+            }
+        }
+    }
+
+    emit(sampleNumber, timestamp);
+    flushIfDue();
+}
+
+bool SampleTimesWriter::fitsPrediction(int64 sampleNumber, double timestamp) const
+{
+    /* Readers reconstruct times from the last row and the nominal rate, so predict the same way */
+    const double predicted = m_anchorTime + double(sampleNumber - m_anchorSample) / m_sampleRate;
+    return std::abs(timestamp - predicted) <= m_tolerance;
+}
+
+void SampleTimesWriter::suppress(int64 sampleNumber, double timestamp)
+{
+    m_hasPending = true;
+    m_pendingSample = sampleNumber;
+    m_pendingTime = timestamp;
+    m_rowsSuppressed.fetch_add(1, std::memory_order_relaxed);
+    flushIfDue();
+}
+
+void SampleTimesWriter::emit(int64 sampleNumber, double timestamp)
+{
+    if (m_arenaSize - m_fill < MAX_ENTRY_LENGTH)
+        flush();
+
+    char* const end = m_arena + m_arenaSize;
+    char* pos = m_arena + m_fill;
+
+    /* An int64 takes at most 20 characters and a double NumberText::MAX_DOUBLE_LENGTH, so this can't run out */
+    pos = NumberText::format(pos, end, sampleNumber);
+    *pos++ = '=';
+    pos = NumberText::format(pos, end, timestamp);
+    *pos++ = '\n';
+
+    m_fill = size_t(pos - m_arena);
+
+    m_hasAnchor = true;
+    m_anchorSample = sampleNumber;
+    m_anchorTime = timestamp;
+    m_hasPending = false;
+    m_rowsEmitted.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SampleTimesWriter::flushIfDue()
+{
+    if (Time::getMillisecondCounter() - m_lastFlush >= m_flushInterval)
+        flush();
+}
+
+void SampleTimesWriter::flush()
+{
+    m_lastFlush = Time::getMillisecondCounter();
+
+    if (m_fill == 0)
+        return;
+
+    m_stream->write(m_arena, m_fill);
+    m_stream->flush();
+    m_fill = 0;
+}
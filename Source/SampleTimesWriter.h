@@ -0,0 +1,131 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SAMPLETIMESWRITER_H_DEFINED
+#define SAMPLETIMESWRITER_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include "SyncableFileStream.h"
+
+#include <atomic>
+
+/**
+    Appends the [SampleTimes] entries of a .lay file.
+
+    Each "sample=timestamp" line is formatted into a preallocated text arena, without
+    any allocation, and the arena is written to the layout file in one piece once it
+    is nearly full, once flushInterval milliseconds have passed since the last write,
+    or on flush(). Timestamps use the shortest representation that reads back to the
+    exact same double.
+
+    With compression enabled, a row is only written when its timestamp deviates from
+    the one predicted by the last written row and the nominal sample rate by more than
+    the tolerance, or when a keyframe is due. That is how Persyst and PersystReader
+    reconstruct the times between rows, so every sample reads back within the
+    tolerance. The last suppressed row is written first, and the last row is always
+    written. Only a row that also steps away from the previous row by more than the
+    tolerance counts as a discontinuity (a clock jump or dropped data); a clock that
+    runs slightly fast or slow just writes a row whenever it has drifted that far.
+*/
+class TESTABLE SampleTimesWriter
+{
+public:
+
+    /** Constructor. Takes ownership of the layout file stream, positioned after the [SampleTimes] header. */
+    SampleTimesWriter(SyncableFileStream* stream, size_t arenaSize = 65536, uint32 flushInterval = 1000);
+
+    struct Stats
+    {
+        int64 rowsEmitted;
+        int64 rowsSuppressed;
+        int64 discontinuities;
+    };
+
+    /** Destructor. Calls finish(). */
+    ~SampleTimesWriter();
+
+    /** Adds a sample number / timestamp pair */
+    void add(int64 sampleNumber, double timestamp);
+
+    /** Hands all pending entries to the operating system */
+    void flush();
+
+    /** Handle through which another thread can sync the layout file */
+    FileSyncHandle::Ptr getSyncHandle() const { return m_stream->getSyncHandle(); }
+
+    /** Writes the last suppressed row, if any, and flushes. Call once no more rows will be added. */
+    void finish();
+
+    /** Only write rows that deviate from the linear prediction by more than tolerance seconds,
+        plus one at least every keyframeInterval seconds */
+    void setCompression(double sampleRate, double tolerance, double keyframeInterval);
+
+    /** Gets the last row added, whether it was written or suppressed. Returns false if there is none. */
+    bool getLastRow(int64& sampleNumber, double& timestamp) const;
+
+    /** Row counters. Safe to call from any thread. */
+    Stats getStats() const;
+
+    /** Longest line add() can produce */
+    static const size_t MAX_ENTRY_LENGTH = 64;
+
+private:
+
+    void emit(int64 sampleNumber, double timestamp);
+    bool fitsPrediction(int64 sampleNumber, double timestamp) const;
+    void suppress(int64 sampleNumber, double timestamp);
+    void flushIfDue();
+
+    std::unique_ptr<SyncableFileStream> m_stream;
+
+    HeapBlock<char> m_arena;
+    const size_t m_arenaSize;
+    size_t m_fill;
+
+    const uint32 m_flushInterval;
+    uint32 m_lastFlush;
+
+    bool m_compress;
+    double m_sampleRate;
+    double m_tolerance;
+    int64 m_keyframeSamples;
+
+    /* Last written row, the origin of the prediction */
+    bool m_hasAnchor;
+    int64 m_anchorSample;
+    double m_anchorTime;
+
+    /* Last suppressed row since the anchor */
+    bool m_hasPending;
+    int64 m_pendingSample;
+    double m_pendingTime;
+
+    std::atomic<int64> m_rowsEmitted;
+    std::atomic<int64> m_rowsSuppressed;
+    std::atomic<int64> m_discontinuities;
+
+    JUCE_DECLARE_NON_COPYABLE(SampleTimesWriter);
+};
+
+#endif
@@ -0,0 +1,60 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "SaturationStats.h"
+
+SaturationStats::SaturationStats(int numChannels) :
+    m_numChannels(numChannels),
+    m_channels(new Counters[jmax(1, numChannels)])
+{
+}
+
+SaturationStats::Channel SaturationStats::getChannel(int channel) const
+{
+    const Counters& c = m_channels[channel];
+
+    Channel result;
+    result.samples = c.samples.load(std::memory_order_relaxed);
+    result.saturated = c.saturated.load(std::memory_order_relaxed);
+    result.minimum = c.minimum.load(std::memory_order_relaxed);
+    result.maximum = c.maximum.load(std::memory_order_relaxed);
+    return result;
+}
+
+SaturationStats::Snapshot SaturationStats::getSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.saturated = 0;
+    snapshot.saturatedChannels = 0;
+
+    for (int ch = 0; ch < m_numChannels; ch++)
+    {
+        const Channel channel = getChannel(ch);
+        snapshot.channels.add(channel);
+        snapshot.saturated += channel.saturated;
+        if (channel.saturated > 0)
+            snapshot.saturatedChannels++;
+    }
+    return snapshot;
+}
@@ -0,0 +1,99 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef SATURATIONSTATS_H_DEFINED
+#define SATURATIONSTATS_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include "SampleConversion.h"
+
+#include <atomic>
+
+/**
+    Saturated sample counts and running minimum and maximum of each channel of a stream.
+
+    The conversion kernels gather a block's counts while converting it; add() then folds
+    them in with a few relaxed atomic stores. Each channel must only be added to from one
+    thread at a time, which the record path guarantees; getChannel() and getSnapshot() may
+    be called from any thread.
+*/
+class TESTABLE SaturationStats
+{
+public:
+
+    struct Channel
+    {
+        int64 samples;
+        int64 saturated;
+        /* Range of the written int16 values; minimum > maximum while no samples were written */
+        int minimum;
+        int maximum;
+    };
+
+    struct Snapshot
+    {
+        Array<Channel> channels;
+        int64 saturated;
+        int saturatedChannels;
+    };
+
+    explicit SaturationStats(int numChannels);
+
+    /** Adds a converted block of numSamples samples of one channel */
+    void add(int channel, int numSamples, const SampleConversion::ClipStats& block)
+    {
+        Counters& c = m_channels[channel];
+        c.samples.store(c.samples.load(std::memory_order_relaxed) + numSamples, std::memory_order_relaxed);
+        if (block.saturated > 0)
+            c.saturated.store(c.saturated.load(std::memory_order_relaxed) + block.saturated, std::memory_order_relaxed);
+        if (block.minimum < c.minimum.load(std::memory_order_relaxed))
+            c.minimum.store(block.minimum, std::memory_order_relaxed);
+        if (block.maximum > c.maximum.load(std::memory_order_relaxed))
+            c.maximum.store(block.maximum, std::memory_order_relaxed);
+    }
+
+    int getNumChannels() const { return m_numChannels; }
+
+    Channel getChannel(int channel) const;
+
+    Snapshot getSnapshot() const;
+
+private:
+
+    struct Counters
+    {
+        std::atomic<int64> samples{ 0 };
+        std::atomic<int64> saturated{ 0 };
+        std::atomic<int> minimum{ 32767 };
+        std::atomic<int> maximum{ -32768 };
+    };
+
+    const int m_numChannels;
+    std::unique_ptr<Counters[]> m_channels;
+
+    JUCE_DECLARE_NON_COPYABLE(SaturationStats);
+};
+
+#endif
@@ -0,0 +1,107 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SpscRing.h"
+
+/* Length prefix marking that the rest of the lap is padding */
+#define WRAP_MARKER (~uint64(0))
+
+SpscRing::SpscRing(size_t capacityBytes) :
+    m_capacity((capacityBytes + 7) & ~size_t(7))
+{
+    m_data.malloc(m_capacity);
+}
+
+uint8* SpscRing::beginWrite(size_t size)
+{
+    const size_t span = recordSpan(size);
+    if (span > m_capacity / 2)
+        return nullptr;
+
+    const uint64 writePos = m_writePos.load(std::memory_order_relaxed);
+    const uint64 readPos = m_readPos.load(std::memory_order_acquire);
+
+    const size_t offset = size_t(writePos % m_capacity);
+    const size_t tail = m_capacity - offset;
+
+    /* If the record doesn't fit before the end of the buffer, pad to the next lap */
+    const size_t padding = (tail < span) ? tail : 0;
+
+    if (writePos - readPos + padding + span > m_capacity)
+        return nullptr;
+
+    if (padding > 0)
+        *reinterpret_cast<uint64*>(m_data + offset) = WRAP_MARKER;
+
+    m_reservedPos = writePos + padding;
+    m_reservedSpan = span;
+
+    uint8* record = m_data + size_t(m_reservedPos % m_capacity);
+    *reinterpret_cast<uint64*>(record) = size;
+    return record + sizeof(uint64);
+}
+
+void SpscRing::endWrite()
+{
+    const uint64 newWritePos = m_reservedPos + m_reservedSpan;
+    m_writePos.store(newWritePos, std::memory_order_release);
+
+    const size_t used = size_t(newWritePos - m_readPos.load(std::memory_order_relaxed));
+    if (used > m_highWaterMark.load(std::memory_order_relaxed))
+        m_highWaterMark.store(used, std::memory_order_relaxed);
+}
+
+const uint8* SpscRing::beginRead(size_t& size)
+{
+    uint64 readPos = m_readPos.load(std::memory_order_relaxed);
+    const uint64 writePos = m_writePos.load(std::memory_order_acquire);
+
+    if (readPos == writePos)
+        return nullptr;
+
+    size_t offset = size_t(readPos % m_capacity);
+    m_readSpan = 0;
+
+    if (*reinterpret_cast<const uint64*>(m_data + offset) == WRAP_MARKER)
+    {
+        m_readSpan = m_capacity - offset;
+        offset = 0;
+    }
+
+    const uint8* record = m_data + offset;
+    size = size_t(*reinterpret_cast<const uint64*>(record));
+    m_readSpan += recordSpan(size);
+
+    return record + sizeof(uint64);
+}
+
+void SpscRing::endRead()
+{
+    m_readPos.store(m_readPos.load(std::memory_order_relaxed) + m_readSpan, std::memory_order_release);
+    m_readSpan = 0;
+}
+
+size_t SpscRing::getUsedBytes() const
+{
+    return size_t(m_writePos.load(std::memory_order_acquire) - m_readPos.load(std::memory_order_acquire));
+}
@@ -0,0 +1,91 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SPSCRING_H_DEFINED
+#define SPSCRING_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include <atomic>
+
+/**
+    Lock-free single-producer/single-consumer ring of variable-sized records.
+
+    All memory is allocated up front. The producer reserves a contiguous record with
+    beginWrite() and publishes it with endWrite(); the consumer takes the oldest record
+    with beginRead() and releases it with endRead(). Records never wrap around the end
+    of the buffer, so both sides always see a single contiguous span.
+*/
+class TESTABLE SpscRing
+{
+public:
+
+    /** Constructor. The capacity is rounded up to a multiple of 8 bytes. */
+    explicit SpscRing(size_t capacityBytes);
+
+    /** Producer: reserves size bytes. Returns nullptr if there isn't room right now. */
+    uint8* beginWrite(size_t size);
+
+    /** Producer: publishes the record reserved by the last beginWrite() */
+    void endWrite();
+
+    /** Consumer: returns the oldest record and its size, or nullptr if the ring is empty */
+    const uint8* beginRead(size_t& size);
+
+    /** Consumer: releases the record returned by the last beginRead() */
+    void endRead();
+
+    /** Largest record that is guaranteed to fit in an empty ring */
+    size_t getMaxRecordSize() const { return m_capacity / 2 - sizeof(uint64); }
+
+    size_t getCapacity() const { return m_capacity; }
+
+    /** Bytes currently queued, including record headers and padding */
+    size_t getUsedBytes() const;
+
+    /** Highest value getUsedBytes() has reached since construction */
+    size_t getHighWaterMark() const { return m_highWaterMark.load(std::memory_order_relaxed); }
+
+private:
+
+    static size_t recordSpan(size_t size) { return sizeof(uint64) + ((size + 7) & ~size_t(7)); }
+
+    HeapBlock<uint8> m_data;
+    const size_t m_capacity;
+
+    /* Monotonic byte counters; the buffer offset is the counter modulo the capacity */
+    alignas(64) std::atomic<uint64> m_writePos{ 0 };
+    alignas(64) std::atomic<uint64> m_readPos{ 0 };
+
+    /* Producer-side state */
+    alignas(64) uint64 m_reservedPos{ 0 };
+    size_t m_reservedSpan{ 0 };
+    std::atomic<size_t> m_highWaterMark{ 0 };
+
+    /* Consumer-side state */
+    alignas(64) size_t m_readSpan{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(SpscRing);
+};
+
+#endif
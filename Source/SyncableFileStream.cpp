@@ -0,0 +1,258 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "SyncableFileStream.h"
+
+#if JUCE_WINDOWS
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+FileSyncHandle::FileSyncHandle(NativeHandle handle, const String& path) :
+    m_handle(handle),
+    m_path(path)
+{
+}
+
+#if JUCE_WINDOWS
+
+FileSyncHandle::Ptr FileSyncHandle::create(NativeHandle handle, const String& path)
+{
+    /* A new file object, so syncing never queues behind the writer's synchronous writes */
+    HANDLE reopened = ReOpenFile(handle, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0);
+    if (reopened == INVALID_HANDLE_VALUE)
+        return nullptr;
+    return Ptr(new FileSyncHandle(reopened, path));
+}
+
+FileSyncHandle::~FileSyncHandle()
+{
+    CloseHandle(m_handle);
+}
+
+bool FileSyncHandle::sync()
+{
+    return FlushFileBuffers(m_handle) != 0;
+}
+
+#else
+
+FileSyncHandle::Ptr FileSyncHandle::create(NativeHandle handle, const String& path)
+{
+    const int duplicate = dup(handle);
+    if (duplicate < 0)
+        return nullptr;
+    return Ptr(new FileSyncHandle(duplicate, path));
+}
+
+FileSyncHandle::~FileSyncHandle()
+{
+    ::close(m_handle);
+}
+
+bool FileSyncHandle::sync()
+{
+#if JUCE_LINUX
+    return fdatasync(m_handle) == 0;
+#else
+    return fsync(m_handle) == 0;
+#endif
+}
+
+#endif
+
+SyncableFileStream::SyncableFileStream(const File& file, size_t bufferSize) :
+    m_file(file),
+    m_handle(INVALID_HANDLE),
+    m_bufferSize(bufferSize),
+    m_bufferFill(0),
+    m_position(0),
+    m_failed(false)
+{
+    if (m_file.create().failed())
+    {
+        std::cerr << "[Persyst] Could not create " << m_file.getFullPathName() << std::endl;
+        return;
+    }
+
+#if JUCE_WINDOWS
+    /* Shared for writing, so that FileSyncHandle can open its own handle for syncing */
+    HANDLE handle = CreateFileW(m_file.getFullPathName().toWideCharPointer(), GENERIC_WRITE,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER end;
+    if (handle == INVALID_HANDLE_VALUE || !SetFilePointerEx(handle, LARGE_INTEGER(), &end, FILE_END))
+    {
+        if (handle != INVALID_HANDLE_VALUE)
+            CloseHandle(handle);
+        std::cerr << "[Persyst] Could not open " << m_file.getFullPathName() << std::endl;
+        return;
+    }
+    m_handle = handle;
+    m_position = int64(end.QuadPart);
+#else
+    const int fd = ::open(m_file.getFullPathName().toRawUTF8(), O_WRONLY | O_CREAT, 0644);
+    const off_t end = fd >= 0 ? lseek(fd, 0, SEEK_END) : off_t(-1);
+    if (end < 0)
+    {
+        if (fd >= 0)
+            ::close(fd);
+        std::cerr << "[Persyst] Could not open " << m_file.getFullPathName() << std::endl;
+        return;
+    }
+    m_handle = fd;
+    m_position = int64(end);
+#endif
+
+    m_syncHandle = FileSyncHandle::create(m_handle, m_file.getFullPathName());
+    if (m_bufferSize > 0)
+        m_buffer.malloc(m_bufferSize);
+}
+
+SyncableFileStream::~SyncableFileStream()
+{
+    if (!openedOk())
+        return;
+
+    flush();
+#if JUCE_WINDOWS
+    CloseHandle(m_handle);
+#else
+    ::close(m_handle);
+#endif
+}
+
+bool SyncableFileStream::write(const void* data, size_t numBytes)
+{
+    if (!openedOk() || m_failed)
+        return false;
+
+    if (m_bufferFill + numBytes <= m_bufferSize)
+    {
+        memcpy(m_buffer + m_bufferFill, data, numBytes);
+        m_bufferFill += numBytes;
+    }
+    else
+    {
+        flush();
+        if (numBytes < m_bufferSize)
+        {
+            memcpy(m_buffer, data, numBytes);
+            m_bufferFill = numBytes;
+        }
+        else if (!writeOut(data, numBytes))
+            return false;
+    }
+
+    m_position += int64(numBytes);
+    return !m_failed;
+}
+
+void SyncableFileStream::flush()
+{
+    if (m_bufferFill > 0)
+    {
+        writeOut(m_buffer, m_bufferFill);
+        m_bufferFill = 0;
+    }
+}
+
+bool SyncableFileStream::setPosition(int64 position)
+{
+    if (!openedOk())
+        return false;
+    if (position == m_position)
+        return true;
+
+    flush();
+
+#if JUCE_WINDOWS
+    LARGE_INTEGER target;
+    target.QuadPart = position;
+    if (!SetFilePointerEx(m_handle, target, nullptr, FILE_BEGIN))
+        return false;
+#else
+    if (lseek(m_handle, off_t(position), SEEK_SET) < 0)
+        return false;
+#endif
+
+    m_position = position;
+    return true;
+}
+
+bool SyncableFileStream::truncate()
+{
+    if (!openedOk())
+        return false;
+
+    flush();
+#if JUCE_WINDOWS
+    return SetEndOfFile(m_handle) != 0;
+#else
+    return ftruncate(m_handle, off_t(m_position)) == 0;
+#endif
+}
+
+bool SyncableFileStream::sync()
+{
+    if (!openedOk())
+        return false;
+
+    flush();
+    return !m_failed && m_syncHandle != nullptr && m_syncHandle->sync();
+}
+
+bool SyncableFileStream::writeOut(const void* data, size_t numBytes)
+{
+    const char* bytes = static_cast<const char*>(data);
+
+    while (numBytes > 0)
+    {
+#if JUCE_WINDOWS
+        DWORD written = 0;
+        const DWORD chunk = DWORD(jmin(numBytes, size_t(1) << 30));
+        if (!WriteFile(m_handle, bytes, chunk, &written, nullptr) || written == 0)
+        {
+            m_failed = true;
+            return false;
+        }
+#else
+        const ssize_t written = ::write(m_handle, bytes, numBytes);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+        {
+            m_failed = true;
+            return false;
+        }
+#endif
+        bytes += written;
+        numBytes -= size_t(written);
+    }
+
+    return true;
+}
@@ -0,0 +1,137 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef SYNCABLEFILESTREAM_H_DEFINED
+#define SYNCABLEFILESTREAM_H_DEFINED
+
+#include <RecordingLib.h>
+
+#include <memory>
+
+/**
+    A handle on a file that another thread is writing, used to force the file's data to disk
+    without the writer waiting for it.
+
+    It is opened from the writer's own handle, so it works even where the file can't be opened
+    again for writing, and stays valid after the writer closes the file.
+*/
+class TESTABLE FileSyncHandle
+{
+public:
+
+    typedef std::shared_ptr<FileSyncHandle> Ptr;
+
+#if JUCE_WINDOWS
+    typedef void* NativeHandle;
+#else
+    typedef int NativeHandle;
+#endif
+
+    /** Opens a second handle on the file a writer has open as handle. Returns nullptr on failure. */
+    static Ptr create(NativeHandle handle, const String& path);
+
+    /** Destructor. Closes the handle. */
+    ~FileSyncHandle();
+
+    /** Forces the file's data, written through any handle, to disk. Returns false on failure. */
+    bool sync();
+
+    const String& getPath() const { return m_path; }
+
+private:
+
+    FileSyncHandle(NativeHandle handle, const String& path);
+
+    NativeHandle m_handle;
+    const String m_path;
+
+    JUCE_DECLARE_NON_COPYABLE(FileSyncHandle);
+};
+
+/**
+    Buffered output file that can be made durable from another thread.
+
+    Works like FileOutputStream: the file is created if needed and written from its end.
+    flush() only hands the buffered data to the operating system, and getSyncHandle() gives
+    a handle through which another thread can sync the file while it is being written.
+*/
+class TESTABLE SyncableFileStream : public OutputStream
+{
+public:
+
+    /** Constructor. Opens the file, creating it and any missing parent folders. */
+    explicit SyncableFileStream(const File& file, size_t bufferSize = 16384);
+
+    /** Destructor. Writes out the buffer and closes the file. */
+    ~SyncableFileStream();
+
+    bool openedOk() const { return m_handle != INVALID_HANDLE; }
+
+    bool failedToOpen() const { return !openedOk(); }
+
+    const File& getFile() const { return m_file; }
+
+    bool write(const void* data, size_t numBytes) override;
+
+    /** Hands the buffered data to the operating system, without waiting for the disk */
+    void flush() override;
+
+    bool setPosition(int64 position) override;
+
+    int64 getPosition() override { return m_position; }
+
+    /** Cuts the file at the current position */
+    bool truncate();
+
+    /** Writes out the buffer and forces the file's data to disk */
+    bool sync();
+
+    /** Handle through which another thread can sync this file, or nullptr if it isn't open */
+    FileSyncHandle::Ptr getSyncHandle() const { return m_syncHandle; }
+
+private:
+
+    bool writeOut(const void* data, size_t numBytes);
+
+#if JUCE_WINDOWS
+    static constexpr FileSyncHandle::NativeHandle INVALID_HANDLE = nullptr;
+#else
+    static constexpr FileSyncHandle::NativeHandle INVALID_HANDLE = -1;
+#endif
+
+    const File m_file;
+    FileSyncHandle::NativeHandle m_handle;
+    FileSyncHandle::Ptr m_syncHandle;
+
+    HeapBlock<char> m_buffer;
+    const size_t m_bufferSize;
+    size_t m_bufferFill;
+    int64 m_position;
+    bool m_failed;
+
+    JUCE_DECLARE_NON_COPYABLE(SyncableFileStream);
+};
+
+#endif
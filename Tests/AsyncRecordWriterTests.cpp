@@ -0,0 +1,68 @@
+#include "gtest/gtest.h"
+
+#include "../Source/AsyncRecordWriter.h"
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+    // Records what arrives on each ring; blocks of ring r are tagged with writeChannel = r
+    class RecordingConsumer : public AsyncRecordWriter::Consumer {
+    public:
+        void writeContinuousBlock(int writeChannel, int realChannel, const float* dataBuffer, double firstTimestamp, int size) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            threads[writeChannel].insert(std::this_thread::get_id());
+            for (int i = 0; i < size; i++) {
+                values[writeChannel].push_back(dataBuffer[i]);
+            }
+        }
+
+        void writeEventPacket(int eventChannel, const EventPacket& event) override {}
+
+        std::mutex mutex;
+        std::map<int, std::vector<float>> values;
+        std::map<int, std::set<std::thread::id>> threads;
+    };
+}
+
+TEST(AsyncRecordWriterTests, WorkersKeepEachRingInOrder) {
+    const int numRings = 5;
+    const int blocks = 200;
+    const int blockSize = 64;
+
+    RecordingConsumer consumer;
+    AsyncRecordWriter writer(consumer, numRings, 16384, 3);
+    ASSERT_EQ(writer.getNumWorkers(), 3);
+    writer.start();
+
+    std::vector<float> data(blockSize);
+    std::vector<double> timestamps(blockSize, 0.0);
+    for (int b = 0; b < blocks; b++) {
+        for (int ring = 0; ring < numRings; ring++) {
+            for (int i = 0; i < blockSize; i++) {
+                data[i] = float(b * blockSize + i);
+            }
+            writer.pushContinuousData(ring, ring, ring, data.data(), timestamps.data(), blockSize);
+        }
+    }
+    writer.stop();
+
+    for (int ring = 0; ring < numRings; ring++) {
+        const auto& values = consumer.values[ring];
+        ASSERT_EQ(values.size(), blocks * blockSize);
+        for (size_t i = 0; i < values.size(); i++) {
+            ASSERT_EQ(values[i], float(i));
+        }
+        // One worker thread, plus possibly the thread that drained the rest in stop()
+        ASSERT_LE(consumer.threads[ring].size(), 2);
+    }
+}
+
+TEST(AsyncRecordWriterTests, NoMoreWorkersThanRings) {
+    RecordingConsumer consumer;
+    AsyncRecordWriter writer(consumer, 2, 4096, 8);
+    ASSERT_EQ(writer.getNumWorkers(), 2);
+}
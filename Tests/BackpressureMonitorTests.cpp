@@ -0,0 +1,81 @@
+#include "gtest/gtest.h"
+
+#include "../Source/BackpressureMonitor.h"
+
+#include <utility>
+#include <vector>
+
+// 30 kHz, 384 channels of int16
+static const double kIncoming = 30000.0 * 384 * 2;
+
+TEST(BackpressureMonitorTests, KeepingUpNeverWarns) {
+    BackpressureMonitor monitor(kIncoming);
+    int64 written = 0;
+    for (int step = 0; step <= 100; step++) {
+        double now = step * 0.1;
+        // Writes arrive in bursts, but keep up on average
+        if (step % 5 == 0) {
+            written = int64(kIncoming * now);
+        }
+        ASSERT_EQ(monitor.update(now, written, 0, 0), BackpressureMonitor::NONE);
+    }
+    ASSERT_FALSE(monitor.isFallingBehind());
+    ASSERT_NEAR(monitor.getStatus().writtenBytesPerSecond, kIncoming, kIncoming * 0.05);
+}
+
+TEST(BackpressureMonitorTests, SlowDiskWarnsWithProjectedOverflow) {
+    const int64 capacity = int64(1) << 30;
+    BackpressureMonitor monitor(kIncoming, 2.0);
+
+    std::vector<BackpressureMonitor::Event> events;
+    int64 written = 0;
+    double queued = 0;
+    for (int step = 0; step <= 40; step++) {
+        double now = step * 0.25;
+        // The disk only writes 60% of the incoming data; the float ring fills with twice the difference
+        written = int64(kIncoming * 0.6 * now);
+        queued = kIncoming * 0.4 * 2 * now;
+        auto event = monitor.update(now, written, int64(queued), capacity);
+        if (event != BackpressureMonitor::NONE) {
+            events.push_back(event);
+        }
+        // The first window only starts the measurement, then three slow windows are needed
+        ASSERT_EQ(monitor.isFallingBehind(), now >= 3.0) << now;
+    }
+
+    // A single warning, the run is shorter than the warning interval
+    ASSERT_EQ(events.size(), 1);
+    ASSERT_EQ(events[0], BackpressureMonitor::WARNING);
+
+    auto status = monitor.getStatus();
+    ASSERT_TRUE(status.fallingBehind);
+    ASSERT_NEAR(status.writtenBytesPerSecond, kIncoming * 0.6, kIncoming * 0.01);
+    double expected = (capacity - queued) / (kIncoming * 0.4 * 2);
+    ASSERT_NEAR(status.secondsToOverflow, expected, 0.1);
+}
+
+TEST(BackpressureMonitorTests, RepeatsWarningAndReportsRecovery) {
+    BackpressureMonitor monitor(kIncoming, 1.0, 1.0, 2, 5.0);
+
+    std::vector<std::pair<double, BackpressureMonitor::Event>> events;
+    int64 written = 0;
+    for (int second = 0; second <= 20; second++) {
+        // Too slow for 12 s, then catching up at twice the incoming rate
+        written += int64(second <= 12 ? kIncoming * 0.5 : kIncoming * 2);
+        auto event = monitor.update(second, written, 0, 0);
+        if (event != BackpressureMonitor::NONE) {
+            events.emplace_back(second, event);
+        }
+    }
+
+    std::vector<std::pair<double, BackpressureMonitor::Event>> expected = {
+        { 2.0, BackpressureMonitor::WARNING },
+        { 7.0, BackpressureMonitor::WARNING },
+        { 12.0, BackpressureMonitor::WARNING },
+        { 13.0, BackpressureMonitor::RECOVERED },
+    };
+    ASSERT_EQ(events, expected);
+    ASSERT_FALSE(monitor.isFallingBehind());
+    // Without a buffer there is nothing to project
+    ASSERT_EQ(monitor.getStatus().secondsToOverflow, -1.0);
+}
@@ -0,0 +1,229 @@
+#include "gtest/gtest.h"
+
+#include "../Source/BinaryRecordingConverter.h"
+#include "../Source/PersystReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class BinaryRecordingConverterTests : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() / "persyst_binary_converter_tests";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir / "source");
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    template <typename T>
+    void WriteNpy(const std::filesystem::path& path, const std::string& descr, const std::vector<T>& values) {
+        std::string header = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (" + std::to_string(values.size()) + ",), }";
+        while ((10 + header.size() + 1) % 64 != 0) {
+            header += ' ';
+        }
+        header += '\n';
+
+        std::ofstream out(path, std::ios::binary);
+        out.write("\x93NUMPY\x01\x00", 8);
+        const uint16_t length = uint16_t(header.size());
+        out.write(reinterpret_cast<const char*>(&length), 2);
+        out << header;
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    // Writes continuous.dat with pseudo-random samples and returns them
+    std::vector<int16_t> WriteStream(const std::string& folder, int num_channels, int num_samples) {
+        std::filesystem::create_directories(dir / "source" / "continuous" / folder);
+        std::vector<int16_t> data(size_t(num_channels) * num_samples);
+        uint32_t state = 1234;
+        for (auto& value : data) {
+            state = state * 1664525 + 1013904223;
+            value = int16_t(state >> 16);
+        }
+        std::ofstream out(dir / "source" / "continuous" / folder / "continuous.dat", std::ios::binary);
+        out.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(int16_t));
+        return data;
+    }
+
+    BinaryRecordingConverter::Stream MakeStream(const std::string& folder, int num_channels, float bit_volts) {
+        BinaryRecordingConverter::Stream stream;
+        stream.folderName = String(folder);
+        stream.sampleRate = 1000;
+        stream.numChannels = num_channels;
+        for (int ch = 0; ch < num_channels; ch++) {
+            stream.channelNames.add(String("CH") + String(ch + 1));
+            stream.bitVolts.add(bit_volts);
+        }
+        return stream;
+    }
+
+    std::vector<int16_t> ReadAll(const std::filesystem::path& path) {
+        std::vector<int16_t> data(std::filesystem::file_size(path) / sizeof(int16_t));
+        std::ifstream in(path, std::ios::binary);
+        in.read(reinterpret_cast<char*>(data.data()), data.size() * sizeof(int16_t));
+        return data;
+    }
+
+    File Source() { return File(String((dir / "source").string())); }
+    File Output() { return File(String((dir / "output").string())); }
+    File Layout(const std::string& folder) {
+        return File(String((dir / "output" / "continuous" / folder / "recording.lay").string()));
+    }
+
+    std::filesystem::path dir;
+};
+
+TEST_F(BinaryRecordingConverterTests, ConvertsStreamsInParallelChunks) {
+    auto probe = WriteStream("Probe-A", 16, 20000);
+    auto adc = WriteStream("ADC", 3, 7001);
+
+    std::vector<double> timestamps(20000);
+    for (size_t i = 0; i < timestamps.size(); i++) {
+        timestamps[i] = 12.5 + i / 1000.0;
+    }
+    WriteNpy(dir / "source" / "continuous" / "Probe-A" / "timestamps.npy", "<f8", timestamps);
+
+    BinaryRecordingConverter converter(Source(), Output());
+    converter.addStream(MakeStream("Probe-A", 16, 0.195f));
+    converter.addStream(MakeStream("ADC", 3, 0.05f));
+
+    BinaryRecordingConverter::Options options;
+    options.numThreads = 4;
+    options.chunkSize = 4000;
+    options.sampleTimesInterval = 1000;
+
+    int64 lastDone = -1;
+    ASSERT_TRUE(converter.convert(options, [&](int64 done, int64 total) {
+        EXPECT_GE(done, lastDone);
+        EXPECT_EQ(total, int64((probe.size() + adc.size()) * sizeof(int16_t)));
+        lastDone = done;
+    })) << converter.getLastError();
+    ASSERT_EQ(lastDone, converter.getTotalBytes());
+
+    ASSERT_EQ(ReadAll(dir / "output" / "continuous" / "Probe-A" / "recording.dat"), probe);
+    ASSERT_EQ(ReadAll(dir / "output" / "continuous" / "ADC" / "recording.dat"), adc);
+
+    PersystReader reader;
+    ASSERT_TRUE(reader.open(Layout("Probe-A")));
+    EXPECT_EQ(reader.getNumChannels(), 16);
+    EXPECT_EQ(reader.getNumSamples(), 20000);
+    EXPECT_FLOAT_EQ(float(reader.getFileInfo().calibration), 0.195f);
+    EXPECT_EQ(reader.getChannelName(15), String("CH16"));
+    ASSERT_EQ(reader.getSampleTimes().size(), 20);
+    for (int i = 0; i < 20; i++) {
+        EXPECT_EQ(reader.getSampleTimes()[i].sample, i * 1000);
+        EXPECT_EQ(reader.getSampleTimes()[i].time, timestamps[i * 1000]);
+    }
+
+    // No timestamps for this stream: nominal sample rate from zero
+    ASSERT_TRUE(reader.open(Layout("ADC")));
+    ASSERT_EQ(reader.getSampleTimes().size(), 8);
+    EXPECT_EQ(reader.getSampleTimes()[7].time, 7.0);
+}
+
+TEST_F(BinaryRecordingConverterTests, UsesSampleNumbers) {
+    WriteStream("Probe-A", 4, 5000);
+    std::vector<int64_t> sample_numbers(5000);
+    for (size_t i = 0; i < sample_numbers.size(); i++) {
+        sample_numbers[i] = 30000 + i;
+    }
+    WriteNpy(dir / "source" / "continuous" / "Probe-A" / "sample_numbers.npy", "<i8", sample_numbers);
+
+    BinaryRecordingConverter converter(Source(), Output());
+    converter.addStream(MakeStream("Probe-A", 4, 0.195f));
+    BinaryRecordingConverter::Options options;
+    options.sampleTimesInterval = 2500;
+    ASSERT_TRUE(converter.convert(options)) << converter.getLastError();
+
+    PersystReader reader;
+    ASSERT_TRUE(reader.open(Layout("Probe-A")));
+    ASSERT_EQ(reader.getSampleTimes().size(), 2);
+    EXPECT_EQ(reader.getSampleTimes()[0].time, 30.0);
+    EXPECT_EQ(reader.getSampleTimes()[1].time, 32.5);
+}
+
+TEST_F(BinaryRecordingConverterTests, RequantisesChannelsWithOtherBitVolts) {
+    auto source = WriteStream("Probe-A", 5, 3000);
+
+    auto stream = MakeStream("Probe-A", 5, 0.25f);
+    stream.bitVolts.set(2, 0.5f);
+    stream.bitVolts.set(4, 0.125f);
+
+    BinaryRecordingConverter converter(Source(), Output());
+    converter.addStream(stream);
+    BinaryRecordingConverter::Options options;
+    options.numThreads = 3;
+    options.chunkSize = 1000;
+    ASSERT_TRUE(converter.convert(options)) << converter.getLastError();
+
+    auto output = ReadAll(dir / "output" / "continuous" / "Probe-A" / "recording.dat");
+    ASSERT_EQ(output.size(), source.size());
+
+    // What the record engine writes for the same microvolt value
+    const float scale = 1 / (float(0x7fff) * 0.25f);
+    auto engine = [&](float microvolts) {
+        return int16_t(roundToInt(jlimit(-32767.0, 32767.0, 32767.0 * double(microvolts * scale))));
+    };
+
+    for (size_t i = 0; i < source.size(); i++) {
+        int expected = source[i];
+        if (i % 5 == 2) {
+            expected = engine(source[i] * 0.5f);
+            ASSERT_EQ(expected, std::clamp(source[i] * 2, -32767, 32767));
+        } else if (i % 5 == 4) {
+            expected = engine(source[i] * 0.125f);
+            ASSERT_NEAR(expected, source[i] / 2.0, 0.5);
+        }
+        ASSERT_EQ(output[i], expected) << "index=" << i << " source=" << source[i];
+    }
+}
+
+TEST_F(BinaryRecordingConverterTests, ReadsStructure) {
+    std::ofstream(dir / "source" / "structure.oebin") << R"({
+        "GUI version": "0.6.4",
+        "continuous": [
+            {
+                "folder_name": "Rhythm_FPGA-100.0/",
+                "sample_rate": 30000.0,
+                "num_channels": 2,
+                "channels": [
+                    { "channel_name": "CH1", "bit_volts": 0.195 },
+                    { "channel_name": "ADC1", "bit_volts": 0.00037 }
+                ]
+            }
+        ],
+        "events": [],
+        "spikes": []
+    })";
+
+    BinaryRecordingConverter converter(Source(), Output());
+    ASSERT_TRUE(converter.readStructure()) << converter.getLastError();
+    ASSERT_EQ(converter.getNumStreams(), 1);
+
+    WriteStream("Rhythm_FPGA-100.0", 2, 100);
+    ASSERT_TRUE(converter.convert(BinaryRecordingConverter::Options())) << converter.getLastError();
+
+    PersystReader reader;
+    ASSERT_TRUE(reader.open(Layout("Rhythm_FPGA-100.0")));
+    EXPECT_EQ(reader.getFileInfo().samplingRate, 30000.0);
+    EXPECT_EQ(reader.getChannelName(1), String("ADC1"));
+}
+
+TEST_F(BinaryRecordingConverterTests, FailsOnMissingData) {
+    std::ofstream(dir / "source" / "structure.oebin") << "not json";
+
+    BinaryRecordingConverter converter(Source(), Output());
+    EXPECT_FALSE(converter.readStructure());
+
+    converter.addStream(MakeStream("Missing", 2, 0.195f));
+    EXPECT_FALSE(converter.convert(BinaryRecordingConverter::Options()));
+    EXPECT_TRUE(converter.getLastError().isNotEmpty());
+}
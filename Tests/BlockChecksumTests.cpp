@@ -0,0 +1,131 @@
+#include "gtest/gtest.h"
+
+#include "../Source/BlockChecksumVerifier.h"
+#include "../Source/BlockChecksumWriter.h"
+#include "../Source/InterleavedBlockFile.h"
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+class BlockChecksumTests : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() / "persyst_block_checksum_tests";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        dat_path = dir / "recording.dat";
+        crc_path = dir / "recording.crc";
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    // num_samples frames of num_channels, written in blocks of samples_per_block
+    void WriteRecording(int num_channels, int num_samples, int samples_per_block) {
+        std::vector<int16_t> rows(size_t(num_channels) * num_samples);
+        for (size_t i = 0; i < rows.size(); i++) {
+            rows[i] = int16_t(i * 31);
+        }
+
+        BlockChecksumWriter checksums(num_channels);
+        ASSERT_TRUE(checksums.openFile(String(crc_path.string())));
+        {
+            InterleavedBlockFile file(num_channels, samples_per_block);
+            ASSERT_TRUE(file.openFile(String(dat_path.string())));
+            file.addListener(&checksums);
+            file.writeChannels(0, rows.data(), num_samples, num_samples);
+        }
+        checksums.close();
+        ASSERT_EQ(checksums.getNumBlocks(), (num_samples + samples_per_block - 1) / samples_per_block);
+    }
+
+    bool Verify(BlockChecksumVerifier::Report& report, int num_threads = 4) {
+        BlockChecksumVerifier verifier;
+        return verifier.open(File(String(crc_path.string())))
+            && verifier.verify(File(String(dat_path.string())), num_threads, report);
+    }
+
+    std::filesystem::path dir;
+    std::filesystem::path dat_path;
+    std::filesystem::path crc_path;
+};
+
+TEST_F(BlockChecksumTests, IntactRecordingVerifies) {
+    WriteRecording(6, 100000, 1000);
+
+    BlockChecksumVerifier verifier;
+    ASSERT_TRUE(verifier.open(File(String(crc_path.string()))));
+    ASSERT_EQ(verifier.getNumChannels(), 6);
+    ASSERT_EQ(verifier.getNumEntries(), 100);
+    ASSERT_EQ(verifier.getEntry(99).firstSample, 99000u);
+    ASSERT_EQ(verifier.getEntry(99).numSamples, 1000u);
+
+    int64 last_done = -1;
+    BlockChecksumVerifier::Report report;
+    ASSERT_TRUE(verifier.verify(File(String(dat_path.string())), 3, report, [&](int64 done, int64 total) {
+        ASSERT_GE(done, last_done);
+        ASSERT_EQ(total, 100000 * 6 * 2);
+        last_done = done;
+    }));
+    ASSERT_TRUE(report.isOk());
+    ASSERT_EQ(report.blocksChecked, 100);
+    ASSERT_EQ(report.bytesChecked, 100000 * 6 * 2);
+    ASSERT_EQ(report.uncheckedBytes, 0);
+    ASSERT_EQ(last_done, report.bytesChecked);
+}
+
+TEST_F(BlockChecksumTests, LocatesCorruptedBlocks) {
+    WriteRecording(4, 10500, 1000);
+
+    // Flip one byte in samples 3000..3999 and one in the last, partial block
+    {
+        std::fstream dat(dat_path, std::ios::in | std::ios::out | std::ios::binary);
+        for (std::streamoff offset : { std::streamoff(3456 * 4 * 2 + 3), std::streamoff(10499 * 4 * 2) }) {
+            dat.seekg(offset);
+            char c = char(dat.get());
+            dat.seekp(offset);
+            dat.put(char(c ^ 0x10));
+        }
+    }
+
+    BlockChecksumVerifier::Report report;
+    ASSERT_TRUE(Verify(report));
+    ASSERT_EQ(report.failures.size(), 2);
+    ASSERT_EQ(report.failures[0].entry.firstSample, 3000u);
+    ASSERT_EQ(report.failures[0].entry.numSamples, 1000u);
+    ASSERT_FALSE(report.failures[0].missing);
+    ASSERT_NE(report.failures[0].actualCrc, report.failures[0].entry.crc);
+    ASSERT_EQ(report.failures[1].entry.firstSample, 10000u);
+    ASSERT_EQ(report.failures[1].entry.numSamples, 500u);
+}
+
+TEST_F(BlockChecksumTests, ReportsMissingAndUncheckedData) {
+    WriteRecording(2, 5000, 1000);
+
+    std::filesystem::resize_file(dat_path, 3500 * 2 * 2);
+    BlockChecksumVerifier::Report report;
+    ASSERT_TRUE(Verify(report, 1));
+    ASSERT_EQ(report.failures.size(), 2);
+    ASSERT_TRUE(report.failures[0].missing);
+    ASSERT_EQ(report.failures[0].entry.firstSample, 3000u);
+    ASSERT_EQ(report.failures[1].entry.firstSample, 4000u);
+
+    // Data appended after the last checksummed block is reported, but is not a failure
+    std::filesystem::remove(dat_path);
+    WriteRecording(2, 5000, 1000);
+    std::filesystem::resize_file(dat_path, 5100 * 2 * 2);
+    ASSERT_TRUE(Verify(report, 1));
+    ASSERT_TRUE(report.isOk());
+    ASSERT_EQ(report.uncheckedBytes, 100 * 2 * 2);
+}
+
+TEST_F(BlockChecksumTests, RejectsOtherFiles) {
+    WriteRecording(2, 100, 64);
+
+    BlockChecksumVerifier verifier;
+    ASSERT_FALSE(verifier.open(File(String(dat_path.string()))));
+    ASSERT_FALSE(verifier.open(File(String((dir / "missing.crc").string()))));
+}
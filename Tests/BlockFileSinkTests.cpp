@@ -0,0 +1,110 @@
+#include "gtest/gtest.h"
+
+#include "../Source/BlockFileSink.h"
+#include "../Source/DirectFileSink.h"
+#include "../Source/MappedFileSink.h"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+class BlockFileSinkTests : public ::testing::TestWithParam<BlockFileSink::Type> {
+protected:
+    void SetUp() override {
+        if (!BlockFileSink::isAvailable(GetParam())) {
+            GTEST_SKIP() << "Backend not available on this platform";
+        }
+        dir = std::filesystem::temp_directory_path() / "persyst_block_file_sink_tests";
+        std::filesystem::remove_all(dir);
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    std::vector<char> ReadFile(const std::filesystem::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<char>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    std::filesystem::path dir;
+};
+
+TEST_P(BlockFileSinkTests, WritesExactBytes) {
+    // Mix of sizes that are and aren't sector multiples, spanning several 1 MB staging buffers
+    std::mt19937 rng(42);
+    std::vector<char> expected;
+    std::vector<size_t> sizes = { 8192, 13, 4096 * 100, 777, 3 << 20, 1, 65536 * 3 + 5 };
+
+    auto path = dir / "sub" / "recording.dat";
+    auto sink = BlockFileSink::create(GetParam());
+    ASSERT_TRUE(sink->open(path.string()));
+
+    for (size_t size : sizes) {
+        std::vector<char> chunk(size);
+        for (auto& c : chunk) {
+            c = (char) rng();
+        }
+        ASSERT_TRUE(sink->write(chunk.data(), chunk.size()));
+        expected.insert(expected.end(), chunk.begin(), chunk.end());
+    }
+    sink->close();
+
+    auto actual = ReadFile(path);
+    ASSERT_EQ(actual.size(), expected.size());
+    ASSERT_TRUE(actual == expected);
+}
+
+TEST_P(BlockFileSinkTests, EmptyFile) {
+    auto path = dir / "empty.dat";
+    auto sink = BlockFileSink::create(GetParam());
+    ASSERT_TRUE(sink->open(path.string()));
+    sink->close();
+    ASSERT_TRUE(std::filesystem::exists(path));
+    ASSERT_EQ(std::filesystem::file_size(path), 0);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    AllBackends,
+    BlockFileSinkTests,
+    ::testing::Values(BlockFileSink::BUFFERED, BlockFileSink::DIRECT, BlockFileSink::MAPPED),
+    [](const ::testing::TestParamInfo<BlockFileSink::Type>& info) {
+        switch (info.param) {
+            case BlockFileSink::DIRECT: return std::string("Direct");
+            case BlockFileSink::MAPPED: return std::string("Mapped");
+            default: return std::string("Buffered");
+        }
+    });
+
+TEST(MappedFileSinkTests, GrowsAcrossExtents) {
+    if (!MappedFileSink::isAvailable()) {
+        GTEST_SKIP() << "Memory-mapped sink not available on this platform";
+    }
+
+    auto path = std::filesystem::temp_directory_path() / "persyst_mapped_file_sink_test.dat";
+    MappedFileSink sink(1);
+    const size_t extent = sink.getExtentSize();
+
+    std::vector<char> expected;
+    ASSERT_TRUE(sink.open(path.string()));
+    // Writes that end exactly on, and straddle, extent boundaries
+    for (size_t size : { extent, extent / 2 + 3, extent, extent * 2 + 11 }) {
+        std::vector<char> chunk(size);
+        for (size_t i = 0; i < size; i++) {
+            chunk[i] = (char) (expected.size() + i * 7);
+        }
+        ASSERT_TRUE(sink.write(chunk.data(), chunk.size()));
+        expected.insert(expected.end(), chunk.begin(), chunk.end());
+    }
+    sink.close();
+
+    std::ifstream in(path, std::ios::binary);
+    std::vector<char> actual((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::filesystem::remove(path);
+
+    ASSERT_EQ(actual.size(), expected.size());
+    ASSERT_TRUE(actual == expected);
+}
@@ -0,0 +1,59 @@
+#include "gtest/gtest.h"
+
+#include "../Source/Crc32c.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+static std::vector<Crc32c::Implementation> SupportedImplementations() {
+    std::vector<Crc32c::Implementation> implementations;
+    for (auto implementation : { Crc32c::TABLE, Crc32c::SSE42 }) {
+        if (Crc32c::isSupported(implementation)) {
+            implementations.push_back(implementation);
+        }
+    }
+    return implementations;
+}
+
+TEST(Crc32cTests, MatchesKnownValues) {
+    for (auto implementation : SupportedImplementations()) {
+        SCOPED_TRACE(Crc32c::getName(implementation));
+        ASSERT_EQ(Crc32c::update(implementation, 0, "", 0), 0u);
+        ASSERT_EQ(Crc32c::update(implementation, 0, "123456789", 9), 0xe3069283u);
+
+        // RFC 3720, B.4: 32 bytes of zeros, and of 0xff
+        std::vector<uint8_t> bytes(32, 0);
+        ASSERT_EQ(Crc32c::update(implementation, 0, bytes.data(), bytes.size()), 0x8a9136aau);
+        std::fill(bytes.begin(), bytes.end(), 0xff);
+        ASSERT_EQ(Crc32c::update(implementation, 0, bytes.data(), bytes.size()), 0x62a8ab43u);
+    }
+}
+
+TEST(Crc32cTests, ImplementationsAgreeOnAnyLengthAndAlignment) {
+    std::mt19937 rng(3);
+    std::vector<uint8_t> bytes(3 * 3 * 4096 + 1000 + 8);
+    for (auto& b : bytes) {
+        b = uint8_t(rng());
+    }
+
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t length : { 0, 1, 7, 8, 9, 63, 64, 1000, 4096, 3 * 4096 - 1, 3 * 4096, 3 * 4096 + 9, 3 * 3 * 4096 + 999 }) {
+            uint32_t expected = Crc32c::update(Crc32c::TABLE, 0, bytes.data() + offset, length);
+            for (auto implementation : SupportedImplementations()) {
+                ASSERT_EQ(Crc32c::update(implementation, 0, bytes.data() + offset, length), expected)
+                    << Crc32c::getName(implementation) << " offset " << offset << " length " << length;
+            }
+            ASSERT_EQ(Crc32c::update(0, bytes.data() + offset, length), expected);
+        }
+    }
+}
+
+TEST(Crc32cTests, UpdatesChain) {
+    const char* text = "The quick brown fox jumps over the lazy dog";
+    const size_t length = strlen(text);
+    const uint32_t whole = Crc32c::update(0, text, length);
+    for (size_t split = 0; split <= length; split++) {
+        ASSERT_EQ(Crc32c::update(Crc32c::update(0, text, split), text + split, length - split), whole);
+    }
+}
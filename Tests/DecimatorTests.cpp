@@ -0,0 +1,110 @@
+#include "gtest/gtest.h"
+
+#include "../Source/Decimator.h"
+
+#include <cmath>
+#include <vector>
+
+static std::vector<float> Decimate(Decimator& decimator, const std::vector<float>& input, int chunk) {
+    Decimator::Channel channel(decimator);
+    std::vector<float> output;
+    std::vector<float> buffer(decimator.getMaxOutputs(chunk));
+    for (size_t start = 0; start < input.size(); start += chunk) {
+        int n = (int) std::min<size_t>(chunk, input.size() - start);
+        int count = channel.process(input.data() + start, n, buffer.data());
+        EXPECT_LE(count, decimator.getMaxOutputs(n));
+        output.insert(output.end(), buffer.begin(), buffer.begin() + count);
+    }
+    EXPECT_LE(channel.getFlushOutputs(), decimator.getMaxFlushOutputs());
+    std::vector<float> tail(channel.getFlushOutputs());
+    int count = channel.flush(tail.data());
+    EXPECT_EQ(count, (int) tail.size());
+    output.insert(output.end(), tail.begin(), tail.end());
+    return output;
+}
+
+static std::vector<float> Sine(double frequency, double sample_rate, int n, double amplitude) {
+    std::vector<float> samples(n);
+    for (int i = 0; i < n; i++) {
+        samples[i] = float(amplitude * std::sin(2 * M_PI * frequency * i / sample_rate));
+    }
+    return samples;
+}
+
+TEST(DecimatorTests, ChoosesFactorsForWholeRates) {
+    ASSERT_EQ(Decimator::getFactorFor(30000, 2500), 12);
+    ASSERT_EQ(Decimator::getFactorFor(30000, 1000), 30);
+    ASSERT_EQ(Decimator::getFactorFor(30000, 2000), 15);
+    ASSERT_EQ(Decimator::getFactorFor(40000, 1000), 40);
+    ASSERT_EQ(Decimator::getFactorFor(30000, 0), 0);
+    ASSERT_EQ(Decimator::getFactorFor(1000, 2500), 0);
+    ASSERT_EQ(Decimator::getFactorFor(1000, 900), 0);
+}
+
+TEST(DecimatorTests, ProducesOneOutputPerFactorInputs) {
+    Decimator decimator(12);
+    ASSERT_EQ(decimator.getNumTaps(), 2 * 10 * 12 + 1);
+    for (int n : { 0, 1, 11, 12, 13, 1000, 30001 }) {
+        std::vector<float> input(n, 1.0f);
+        ASSERT_EQ(Decimate(decimator, input, 4096).size(), size_t((n + 11) / 12)) << n;
+    }
+}
+
+TEST(DecimatorTests, ChunkSizeDoesNotChangeOutput) {
+    Decimator decimator(12);
+    auto input = Sine(37.0, 30000, 50000, 500.0);
+    auto whole = Decimate(decimator, input, int(input.size()));
+    for (int chunk : { 1, 7, 12, 1000, 1024, 1025, 4096 }) {
+        ASSERT_EQ(Decimate(decimator, input, chunk), whole) << chunk;
+    }
+}
+
+TEST(DecimatorTests, PassesLowFrequenciesWithoutDelay) {
+    const double sample_rate = 30000;
+    const int factor = 12;
+    Decimator decimator(factor);
+
+    // DC and a 100 Hz sine come through unchanged, centred on input sample k * factor
+    auto input = Sine(100.0, sample_rate, 60000, 1000.0);
+    for (auto& sample : input) {
+        sample += 250.0f;
+    }
+    auto output = Decimate(decimator, input, 4096);
+
+    const int edge = decimator.getNumTaps() / factor;
+    for (int k = edge; k < (int) output.size() - edge; k++) {
+        ASSERT_NEAR(output[k], input[k * factor], 1.0) << k;
+    }
+}
+
+TEST(DecimatorTests, RejectsFrequenciesAboveOutputNyquist) {
+    const double sample_rate = 30000;
+    Decimator decimator(12);
+
+    // 1.4 kHz would alias to 1.1 kHz at 2.5 kHz
+    auto output = Decimate(decimator, Sine(1400.0, sample_rate, 60000, 1000.0), 4096);
+
+    double peak = 0;
+    const int edge = decimator.getNumTaps() / 12;
+    for (int k = edge; k < (int) output.size() - edge; k++) {
+        peak = std::max(peak, std::abs((double) output[k]));
+    }
+    // At least 60 dB down
+    ASSERT_LT(peak, 1.0);
+}
+
+TEST(DecimatorTests, ResetStartsOver) {
+    Decimator decimator(4);
+    Decimator::Channel channel(decimator);
+    std::vector<float> input(100, 3.0f), first(64), second(64);
+
+    int n = channel.process(input.data(), 100, first.data());
+    n += channel.flush(first.data() + n);
+    ASSERT_EQ(n, 25);
+
+    channel.reset();
+    int m = channel.process(input.data(), 100, second.data());
+    m += channel.flush(second.data() + m);
+    ASSERT_EQ(m, 25);
+    ASSERT_EQ(first, second);
+}
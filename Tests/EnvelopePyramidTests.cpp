@@ -0,0 +1,148 @@
+#include "gtest/gtest.h"
+
+#include "../Source/EnvelopePyramid.h"
+#include "../Source/EnvelopeReader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+class EnvelopePyramidTests : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() / "envelope_pyramid_tests";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        path = String((dir / "recording.env").string());
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    std::vector<int16_t> RandomFrames(int num_channels, int num_samples) {
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<int> dist(-32768, 32767);
+        std::vector<int16_t> frames(size_t(num_channels) * num_samples);
+        for (auto& value : frames) {
+            value = int16_t(dist(rng));
+        }
+        return frames;
+    }
+
+    void WriteEnvelope(const std::vector<int16_t>& frames, int num_channels, bool rms, int chunk) {
+        EnvelopePyramid pyramid(num_channels, rms, { 4, 16, 64 });
+        ASSERT_TRUE(pyramid.openFile(path));
+        int num_samples = int(frames.size() / num_channels);
+        for (int start = 0; start < num_samples; start += chunk) {
+            pyramid.addFrames(frames.data() + size_t(start) * num_channels, std::min(chunk, num_samples - start));
+        }
+    }
+
+    std::filesystem::path dir;
+    String path;
+};
+
+TEST_F(EnvelopePyramidTests, EveryLevelMatchesTheSamples) {
+    const int num_channels = 5;
+    const int num_samples = 70000;
+    auto frames = RandomFrames(num_channels, num_samples);
+    WriteEnvelope(frames, num_channels, true, 1000);
+
+    EnvelopeReader reader;
+    ASSERT_TRUE(reader.open(File(path)));
+    ASSERT_EQ(reader.getNumChannels(), num_channels);
+    ASSERT_EQ(reader.getNumLevels(), 3);
+    ASSERT_TRUE(reader.hasRms());
+
+    for (int level = 0; level < 3; level++) {
+        const int factor = reader.getFactor(level);
+        const int64 num_bins = (num_samples + factor - 1) / factor;
+        ASSERT_EQ(reader.getNumBins(level), num_bins);
+
+        for (int ch = 0; ch < num_channels; ch++) {
+            std::vector<int16_t> mins(num_bins), maxs(num_bins), rms(num_bins);
+            ASSERT_EQ(reader.readBins(level, ch, 0, int(num_bins), mins.data(), maxs.data(), rms.data()), num_bins);
+
+            for (int64 bin = 0; bin < num_bins; bin++) {
+                int lo = 32767, hi = -32768;
+                double sum_squares = 0;
+                int64 end = std::min<int64>((bin + 1) * factor, num_samples);
+                for (int64 s = bin * factor; s < end; s++) {
+                    int value = frames[s * num_channels + ch];
+                    lo = std::min(lo, value);
+                    hi = std::max(hi, value);
+                    sum_squares += double(value) * value;
+                }
+                ASSERT_EQ(mins[bin], lo);
+                ASSERT_EQ(maxs[bin], hi);
+                ASSERT_NEAR(rms[bin], std::sqrt(sum_squares / (end - bin * factor)), 2);
+            }
+        }
+    }
+}
+
+TEST_F(EnvelopePyramidTests, BlockSizeDoesNotChangeTheFile) {
+    const int num_channels = 3;
+    auto frames = RandomFrames(num_channels, 20000);
+
+    WriteEnvelope(frames, num_channels, false, 20000);
+    auto whole = std::filesystem::file_size(dir / "recording.env");
+    std::filesystem::rename(dir / "recording.env", dir / "whole.env");
+
+    WriteEnvelope(frames, num_channels, false, 7);
+    ASSERT_EQ(std::filesystem::file_size(dir / "recording.env"), whole);
+
+    EnvelopeReader a, b;
+    ASSERT_TRUE(a.open(File(String((dir / "whole.env").string()))));
+    ASSERT_TRUE(b.open(File(path)));
+    ASSERT_FALSE(a.hasRms());
+    for (int level = 0; level < 3; level++) {
+        int num_bins = int(a.getNumBins(level));
+        ASSERT_EQ(b.getNumBins(level), num_bins);
+        for (int ch = 0; ch < num_channels; ch++) {
+            std::vector<int16_t> a_mins(num_bins), a_maxs(num_bins), b_mins(num_bins), b_maxs(num_bins);
+            a.readBins(level, ch, 0, num_bins, a_mins.data(), a_maxs.data(), nullptr);
+            b.readBins(level, ch, 0, num_bins, b_mins.data(), b_maxs.data(), nullptr);
+            ASSERT_EQ(a_mins, b_mins);
+            ASSERT_EQ(a_maxs, b_maxs);
+        }
+    }
+}
+
+TEST_F(EnvelopePyramidTests, ReadsRangesAcrossPages) {
+    const int num_channels = 2;
+    const int num_samples = 4 * EnvelopePyramid::PAGE_BINS * 3 + 10;
+    auto frames = RandomFrames(num_channels, num_samples);
+    WriteEnvelope(frames, num_channels, false, 4096);
+
+    EnvelopeReader reader;
+    ASSERT_TRUE(reader.open(File(path)));
+    const int64 num_bins = reader.getNumBins(0);
+    std::vector<int16_t> all(num_bins), part(num_bins);
+    ASSERT_EQ(reader.readBins(0, 1, 0, int(num_bins), nullptr, all.data(), nullptr), num_bins);
+
+    // A run straddling two pages, and one running past the last bin
+    ASSERT_EQ(reader.readBins(0, 1, 200, 100, nullptr, part.data(), nullptr), 100);
+    ASSERT_TRUE(std::equal(part.begin(), part.begin() + 100, all.begin() + 200));
+    ASSERT_EQ(reader.readBins(0, 1, num_bins - 5, 100, nullptr, part.data(), nullptr), 5);
+    ASSERT_TRUE(std::equal(part.begin(), part.begin() + 5, all.end() - 5));
+
+    ASSERT_EQ(reader.readBins(0, 2, 0, 1, nullptr, part.data(), nullptr), -1);
+    ASSERT_EQ(reader.readBins(0, 0, 0, 1, nullptr, nullptr, part.data()), -1);
+}
+
+TEST_F(EnvelopePyramidTests, ChoosesCoarsestLevelThatFits) {
+    auto frames = RandomFrames(1, 100);
+    WriteEnvelope(frames, 1, false, 100);
+
+    EnvelopeReader reader;
+    ASSERT_TRUE(reader.open(File(path)));
+    ASSERT_EQ(reader.getLevelFor(3), -1);
+    ASSERT_EQ(reader.getLevelFor(4), 0);
+    ASSERT_EQ(reader.getLevelFor(63.5), 1);
+    ASSERT_EQ(reader.getLevelFor(1e9), 2);
+}
@@ -0,0 +1,55 @@
+#include "gtest/gtest.h"
+
+#include "../Source/EventColumnBuffer.h"
+
+#include <cstring>
+#include <vector>
+
+TEST(EventColumnBufferTests, ColumnsAreContiguousPerRecordType) {
+    EventColumnBuffer buffer(8);
+    int states = buffer.addColumn(sizeof(int16));
+    int samples = buffer.addColumn(sizeof(int64));
+    int text = buffer.addColumn(5);
+
+    for (int i = 0; i < 3; i++) {
+        int16 state = int16(i + 1);
+        int64 sample = 1000 + i;
+        char message[5] = { 'm', 's', 'g', char('0' + i), 0 };
+        buffer.setValue(states, &state);
+        buffer.setValue(samples, &sample);
+        buffer.setValue(text, message);
+        ASSERT_FALSE(buffer.commitRecord());
+    }
+
+    ASSERT_EQ(buffer.getNumRecords(), 3);
+    ASSERT_EQ(buffer.getColumnBytes(states), 3 * sizeof(int16));
+    ASSERT_EQ(buffer.getColumnBytes(samples), 3 * sizeof(int64));
+    ASSERT_EQ(buffer.getColumnBytes(text), 15);
+
+    const int16 expectedStates[] = { 1, 2, 3 };
+    const int64 expectedSamples[] = { 1000, 1001, 1002 };
+    ASSERT_EQ(memcmp(buffer.getColumnData(states), expectedStates, sizeof(expectedStates)), 0);
+    ASSERT_EQ(memcmp(buffer.getColumnData(samples), expectedSamples, sizeof(expectedSamples)), 0);
+    ASSERT_EQ(memcmp(buffer.getColumnData(text), "msg0\0msg1\0msg2\0", 15), 0);
+}
+
+TEST(EventColumnBufferTests, ReportsFullAndRestartsAfterClear) {
+    EventColumnBuffer buffer(4);
+    int column = buffer.addColumn(sizeof(double));
+
+    for (int i = 0; i < 4; i++) {
+        double value = i * 0.5;
+        buffer.setValue(column, &value);
+        ASSERT_EQ(buffer.commitRecord(), i == 3);
+    }
+    ASSERT_TRUE(buffer.isFull());
+
+    buffer.clear();
+    ASSERT_EQ(buffer.getNumRecords(), 0);
+    ASSERT_FALSE(buffer.isFull());
+
+    double value = 42.0;
+    buffer.setValue(column, &value);
+    buffer.commitRecord();
+    ASSERT_EQ(*static_cast<const double*>(buffer.getColumnData(column)), 42.0);
+}
@@ -0,0 +1,73 @@
+#include "gtest/gtest.h"
+
+#include "../Source/EventPacketView.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+    const uint8 TTL_TYPE = 1;
+    const uint8 TEXT_TYPE = 2;
+
+    // Header as written by Event::serialize, starting at an odd offset to exercise unaligned reads
+    std::vector<uint8> MakeHeader(uint8 type, int64 sampleNumber, double timestamp, size_t payload) {
+        std::vector<uint8> packet(1 + EventPacketView::HEADER_SIZE + payload, 0);
+        uint8* data = packet.data() + 1;
+        data[0] = 1;
+        data[1] = type;
+        uint16 ids[3] = { 101, 10001, 3 };
+        memcpy(data + 2, ids, sizeof(ids));
+        memcpy(data + 8, &sampleNumber, sizeof(int64));
+        memcpy(data + 16, &timestamp, sizeof(double));
+        return packet;
+    }
+}
+
+TEST(EventPacketViewTests, DecodesTTLInPlace) {
+    auto packet = MakeHeader(TTL_TYPE, 123456789012LL, 4115.226, 10);
+    uint8* data = packet.data() + 1;
+    data[24] = 5;
+    data[25] = 1;
+    uint64 word = 0x8000000000000020ULL;
+    memcpy(data + 26, &word, sizeof(uint64));
+
+    EventPacketView view;
+    ASSERT_TRUE(view.decode(data, packet.size() - 1, TTL_TYPE, TEXT_TYPE, 0));
+    ASSERT_EQ(view.kind, EventPacketView::TTL);
+    ASSERT_EQ(view.sampleNumber, 123456789012LL);
+    ASSERT_EQ(view.timestamp, 4115.226);
+    ASSERT_EQ(view.line, 5);
+    ASSERT_TRUE(view.state);
+    ASSERT_EQ(view.word, word);
+}
+
+TEST(EventPacketViewTests, DecodesTextInPlace) {
+    const char message[16] = "stimulus on";
+    auto packet = MakeHeader(TEXT_TYPE, 42, 0.5, sizeof(message));
+    uint8* data = packet.data() + 1;
+    memcpy(data + 24, message, sizeof(message));
+
+    EventPacketView view;
+    ASSERT_TRUE(view.decode(data, packet.size() - 1, TTL_TYPE, TEXT_TYPE, sizeof(message)));
+    ASSERT_EQ(view.kind, EventPacketView::TEXT);
+    ASSERT_EQ(view.sampleNumber, 42);
+    ASSERT_EQ(view.timestamp, 0.5);
+    ASSERT_EQ(view.text, reinterpret_cast<const char*>(data + 24));
+    ASSERT_STREQ(view.text, "stimulus on");
+}
+
+TEST(EventPacketViewTests, RejectsOtherTypesAndShortPackets) {
+    EventPacketView view;
+
+    auto binary = MakeHeader(3, 0, 0, 64);
+    ASSERT_FALSE(view.decode(binary.data() + 1, binary.size() - 1, TTL_TYPE, TEXT_TYPE, 16));
+    ASSERT_EQ(view.kind, EventPacketView::UNKNOWN);
+
+    auto shortTTL = MakeHeader(TTL_TYPE, 0, 0, 9);
+    ASSERT_FALSE(view.decode(shortTTL.data() + 1, shortTTL.size() - 1, TTL_TYPE, TEXT_TYPE, 16));
+
+    auto shortText = MakeHeader(TEXT_TYPE, 0, 0, 15);
+    ASSERT_FALSE(view.decode(shortText.data() + 1, shortText.size() - 1, TTL_TYPE, TEXT_TYPE, 16));
+
+    ASSERT_FALSE(view.decode(binary.data() + 1, 10, TTL_TYPE, TEXT_TYPE, 16));
+}
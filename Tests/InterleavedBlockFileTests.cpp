@@ -0,0 +1,168 @@
+#include "gtest/gtest.h"
+
+#include "../Source/InterleavedBlockFile.h"
+#include "../Source/SampleConversion.h"
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+class InterleavedBlockFileTests : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() / "persyst_interleaved_block_file_tests";
+        std::filesystem::remove_all(dir);
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    std::vector<int16_t> ReadFile(const std::filesystem::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::vector<int16_t> values(bytes.size() / sizeof(int16_t));
+        memcpy(values.data(), bytes.data(), values.size() * sizeof(int16_t));
+        return values;
+    }
+
+    // Channel-major test data: channel c, sample s
+    std::vector<int16_t> MakeRows(int num_channels, int num_samples) {
+        std::vector<int16_t> rows(num_channels * num_samples);
+        for (int c = 0; c < num_channels; c++) {
+            for (int s = 0; s < num_samples; s++) {
+                rows[c * num_samples + s] = (int16_t) (c * 1000 + s % 1000);
+            }
+        }
+        return rows;
+    }
+
+    std::filesystem::path dir;
+};
+
+TEST_F(InterleavedBlockFileTests, PerChannelAndWholeStreamWritesMatch) {
+    const int num_channels = 13;
+    const int samples_per_block = 64;
+    const int num_samples = 1000;
+    const int chunk = 150;
+    auto rows = MakeRows(num_channels, num_samples);
+
+    auto per_channel_path = dir / "per_channel.dat";
+    auto whole_stream_path = dir / "whole_stream.dat";
+    {
+        InterleavedBlockFile per_channel(num_channels, samples_per_block);
+        InterleavedBlockFile whole_stream(num_channels, samples_per_block);
+        ASSERT_TRUE(per_channel.openFile(per_channel_path.string()));
+        ASSERT_TRUE(whole_stream.openFile(whole_stream_path.string()));
+
+        for (int start = 0; start < num_samples; start += chunk) {
+            int n = std::min(chunk, num_samples - start);
+            for (int c = 0; c < num_channels; c++) {
+                ASSERT_TRUE(per_channel.writeChannel(start, c, rows.data() + c * num_samples + start, n));
+            }
+            ASSERT_TRUE(whole_stream.writeChannels(start, rows.data() + start, num_samples, n));
+        }
+    }
+
+    auto per_channel_data = ReadFile(per_channel_path);
+    auto whole_stream_data = ReadFile(whole_stream_path);
+    ASSERT_EQ(per_channel_data.size(), num_channels * num_samples);
+    ASSERT_EQ(per_channel_data, whole_stream_data);
+
+    for (int s = 0; s < num_samples; s++) {
+        for (int c = 0; c < num_channels; c++) {
+            ASSERT_EQ(whole_stream_data[s * num_channels + c], rows[c * num_samples + s]);
+        }
+    }
+}
+
+TEST_F(InterleavedBlockFileTests, SkewedChannelsFlushInOrder) {
+    const int num_channels = 3;
+    const int samples_per_block = 16;
+    auto rows = MakeRows(num_channels, 100);
+
+    auto path = dir / "skewed.dat";
+    {
+        InterleavedBlockFile file(num_channels, samples_per_block);
+        ASSERT_TRUE(file.openFile(path.string()));
+
+        // Channel 0 runs several blocks ahead of the others
+        ASSERT_TRUE(file.writeChannel(0, 0, rows.data(), 100));
+        ASSERT_TRUE(file.writeChannel(0, 1, rows.data() + 100, 40));
+        ASSERT_TRUE(file.writeChannel(0, 2, rows.data() + 200, 100));
+        ASSERT_TRUE(file.writeChannel(40, 1, rows.data() + 140, 60));
+    }
+
+    auto data = ReadFile(path);
+    ASSERT_EQ(data.size(), num_channels * 100);
+    for (int s = 0; s < 100; s++) {
+        for (int c = 0; c < num_channels; c++) {
+            ASSERT_EQ(data[s * num_channels + c], rows[c * 100 + s]);
+        }
+    }
+}
+
+TEST_F(InterleavedBlockFileTests, FloatWritesMatchConvertedWrites) {
+    const int samples_per_block = 64;
+    const int num_samples = 500;
+    const int chunk = 90;
+    const float scale = 1 / (float(0x7fff) * 0.195f);
+
+    // A width with its own kernels and one without
+    for (int num_channels : { 16, 13 }) {
+        std::vector<float> rows(num_channels * num_samples);
+        for (size_t i = 0; i < rows.size(); i++) {
+            rows[i] = (float(i % 1999) - 1000.0f) * 9.7f;
+        }
+        std::vector<int16> converted(rows.size());
+        SampleConversion::floatToInt16(rows.data(), converted.data(), scale, (int) rows.size());
+
+        auto float_path = dir / ("float_" + std::to_string(num_channels) + ".dat");
+        auto int_path = dir / ("int_" + std::to_string(num_channels) + ".dat");
+        {
+            InterleavedBlockFile float_file(num_channels, samples_per_block);
+            InterleavedBlockFile int_file(num_channels, samples_per_block);
+            ASSERT_TRUE(float_file.openFile(float_path.string()));
+            ASSERT_TRUE(int_file.openFile(int_path.string()));
+
+            for (int start = 0; start < num_samples; start += chunk) {
+                int n = std::min(chunk, num_samples - start);
+                for (int c = 0; c < num_channels; c++) {
+                    ASSERT_TRUE(float_file.writeChannel(start, c, rows.data() + c * num_samples + start, scale, n));
+                    ASSERT_TRUE(int_file.writeChannel(start, c, converted.data() + c * num_samples + start, n));
+                }
+            }
+        }
+
+        auto float_data = ReadFile(float_path);
+        ASSERT_EQ(float_data.size(), num_channels * num_samples);
+        ASSERT_EQ(float_data, ReadFile(int_path));
+    }
+}
+
+TEST_F(InterleavedBlockFileTests, ListenersSeeEveryWrittenBlock) {
+    struct Recorder : public InterleavedBlockFile::Listener {
+        void blockWritten(uint64 first_sample, const int16* frames, int num_frames) override {
+            EXPECT_EQ(first_sample, frames_seen.size() / 4);
+            frames_seen.insert(frames_seen.end(), frames, frames + num_frames * 4);
+        }
+        std::vector<int16_t> frames_seen;
+    };
+
+    const int num_channels = 4;
+    const int num_samples = 1000;
+    auto rows = MakeRows(num_channels, num_samples);
+    auto path = dir / "listened.dat";
+
+    Recorder recorder;
+    {
+        InterleavedBlockFile file(num_channels, 64);
+        ASSERT_TRUE(file.openFile(path.string()));
+        file.addListener(&recorder);
+        file.writeChannels(0, rows.data(), num_samples, num_samples);
+    }
+
+    // Including the last, partial block written on destruction
+    ASSERT_EQ(recorder.frames_seen, ReadFile(path));
+}
@@ -0,0 +1,305 @@
+#include "gtest/gtest.h"
+
+#include "../Source/LiveTap.h"
+#include "../Source/LiveTapReader.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <spawn.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+static int16 SampleValue(int64 sample, int channel) {
+    return int16((sample * 7 + channel * 1000) % 30000);
+}
+
+class LiveTapTests : public ::testing::Test {
+protected:
+    void SetUp() override {
+        if (!LiveTap::isAvailable()) {
+            GTEST_SKIP() << "POSIX shared memory not available on this platform";
+        }
+#ifndef _WIN32
+        name = LiveTap::getNameFor("LiveTapTests-" + String(int(getpid())));
+#endif
+        for (int ch = 0; ch < num_channels; ch++) {
+            channel_names.add("CH" + String(ch + 1));
+        }
+    }
+
+    // Publishes frames [first_sample, first_sample + num_frames) of the stream, as blocks of a file starting at segment_start
+    void WriteFrames(LiveTap& tap, int64 segment_start, int64 first_sample, int num_frames, int block_frames) {
+        std::vector<int16> block(size_t(block_frames) * num_channels);
+        for (int64 start = first_sample; start < first_sample + num_frames; start += block_frames) {
+            const int count = int(std::min<int64>(block_frames, first_sample + num_frames - start));
+            for (int s = 0; s < count; s++) {
+                for (int ch = 0; ch < num_channels; ch++) {
+                    block[size_t(s) * num_channels + ch] = SampleValue(start + s, ch);
+                }
+            }
+            tap.addSampleTime(start, start / sample_rate);
+            tap.blockWritten(uint64(start - segment_start), block.data(), count);
+        }
+    }
+
+    // Reads everything available and checks it continues the stream after any frames lost
+    int64 ReadAndCheck(LiveTapReader& reader) {
+        std::vector<int16> frames(size_t(reader.getCapacity()) * num_channels);
+        int64 total = 0;
+        for (;;) {
+            const int64 next = reader.getNextFrame();
+            const int64 lost = reader.getFramesLost();
+            int64 first_sample = -1;
+            const int count = reader.read(frames.data(), reader.getCapacity(), first_sample);
+            if (count == 0) {
+                return total;
+            }
+            EXPECT_EQ(first_sample, next + reader.getFramesLost() - lost);
+            for (int s = 0; s < count; s++) {
+                for (int ch = 0; ch < num_channels; ch++) {
+                    if (frames[size_t(s) * num_channels + ch] != SampleValue(first_sample + s, ch)) {
+                        ADD_FAILURE() << "sample " << first_sample + s << " channel " << ch;
+                        return total;
+                    }
+                }
+            }
+            total += count;
+        }
+    }
+
+    const int num_channels = 6;
+    const double sample_rate = 1000.0;
+    Array<String> channel_names;
+    String name;
+};
+
+TEST_F(LiveTapTests, PublishesFramesSampleTimesAndChannelMap) {
+    LiveTap tap(num_channels, sample_rate, 0.195, 1000);
+    ASSERT_TRUE(tap.open(name, "Source-100.Stream", channel_names));
+
+    LiveTapReader reader;
+    ASSERT_TRUE(reader.open(name));
+    ASSERT_EQ(reader.getNumChannels(), num_channels);
+    ASSERT_EQ(reader.getSampleRate(), sample_rate);
+    ASSERT_EQ(reader.getBitVolts(), 0.195);
+    ASSERT_EQ(reader.getCapacity(), 1000);
+    ASSERT_EQ(reader.getStreamName(), String("Source-100.Stream"));
+    ASSERT_EQ(reader.getChannelNames().size(), num_channels);
+    ASSERT_EQ(reader.getChannelNames()[5], String("CH6"));
+
+    WriteFrames(tap, 0, 0, 600, 100);
+    ASSERT_EQ(ReadAndCheck(reader), 600);
+
+    // A new segment continues the stream's sample numbers
+    tap.setSegmentStart(600);
+    WriteFrames(tap, 600, 600, 300, 128);
+    ASSERT_EQ(ReadAndCheck(reader), 300);
+    ASSERT_EQ(reader.getNextFrame(), 900);
+    ASSERT_EQ(reader.getFramesLost(), 0);
+
+    std::vector<LiveTap::SampleTime> times(100);
+    ASSERT_EQ(reader.readSampleTimes(times.data(), 100), 6 + 3);
+    ASSERT_EQ(times[6].sample, 600);
+    ASSERT_EQ(times[6].time, 0.6);
+
+    LiveTapReader::Status status;
+    ASSERT_TRUE(reader.getStatus(status));
+    ASSERT_FALSE(status.stopped);
+    ASSERT_EQ(status.framesWritten, 900);
+
+    tap.close();
+    ASSERT_TRUE(reader.getStatus(status));
+    ASSERT_TRUE(status.stopped);
+
+    // The object is gone for new readers
+    LiveTapReader late;
+    ASSERT_FALSE(late.open(name));
+}
+
+TEST_F(LiveTapTests, PublishesNonAsciiChannelNames) {
+    // Names with multi-byte UTF-8 characters, so bytes and characters differ
+    channel_names.set(0, String::fromUTF8("Fp1 \xc2\xb5V", 8));
+    channel_names.set(5, String::fromUTF8("\xce\xb1-\xce\xb2", 5));
+
+    LiveTap tap(num_channels, sample_rate, 0.195, 1000);
+    ASSERT_TRUE(tap.open(name, "Source-100.Stream", channel_names));
+
+    LiveTapReader reader;
+    ASSERT_TRUE(reader.open(name));
+    ASSERT_EQ(reader.getChannelNames().size(), num_channels);
+    for (int ch = 0; ch < num_channels; ch++) {
+        ASSERT_EQ(reader.getChannelNames()[ch], channel_names[ch]) << ch;
+    }
+
+    WriteFrames(tap, 0, 0, 200, 100);
+    ASSERT_EQ(ReadAndCheck(reader), 200);
+}
+
+TEST_F(LiveTapTests, SlowReaderSkipsAheadWithoutHoldingUpTheWriter) {
+    LiveTap tap(num_channels, sample_rate, 1.0, 256, 16);
+    ASSERT_TRUE(tap.open(name, "stream", channel_names));
+
+    LiveTapReader reader;
+    ASSERT_TRUE(reader.open(name));
+
+    WriteFrames(tap, 0, 0, 1000, 100);
+    ASSERT_EQ(ReadAndCheck(reader), 256);
+    ASSERT_EQ(reader.getFramesLost(), 1000 - 256);
+    ASSERT_EQ(reader.getNextFrame(), 1000);
+
+    // Only the newest anchors are left
+    std::vector<LiveTap::SampleTime> times(16);
+    ASSERT_EQ(reader.readSampleTimes(times.data(), 16), 10);
+    ASSERT_EQ(times[9].sample, 900);
+
+    // Blocks larger than the ring keep their newest frames
+    WriteFrames(tap, 0, 1000, 700, 700);
+    ASSERT_EQ(ReadAndCheck(reader), 256);
+    ASSERT_EQ(reader.getNextFrame(), 1700);
+
+    // A reader that skips to the latest frame only sees what comes next
+    reader.skipToLatest();
+    WriteFrames(tap, 0, 1700, 50, 50);
+    ASSERT_EQ(ReadAndCheck(reader), 50);
+}
+
+TEST_F(LiveTapTests, ConcurrentReaderOnlyGetsIntactFrames) {
+    LiveTap tap(num_channels, sample_rate, 1.0, 512);
+    ASSERT_TRUE(tap.open(name, "stream", channel_names));
+
+    LiveTapReader reader;
+    ASSERT_TRUE(reader.open(name));
+
+    const int total_frames = 2000000;
+    std::atomic<bool> done{ false };
+    std::thread writer([&] {
+        WriteFrames(tap, 0, 0, total_frames, 100);
+        done = true;
+    });
+
+    // Frames overwritten while being copied are dropped, never returned torn
+    int64 frames_read = 0;
+    while (!done && !HasFailure()) {
+        frames_read += ReadAndCheck(reader);
+    }
+    writer.join();
+    frames_read += ReadAndCheck(reader);
+
+    ASSERT_EQ(reader.getNextFrame(), total_frames);
+    ASSERT_EQ(frames_read + reader.getFramesLost(), total_frames);
+}
+
+#ifndef _WIN32
+
+// Runs in the process started by DeliversFramesToAConsumerProcess, and is skipped otherwise
+TEST_F(LiveTapTests, ConsumerProcess) {
+    const char* tap_name = getenv("PERSYST_LIVE_TAP_CONSUMER");
+    const char* frames_env = getenv("PERSYST_LIVE_TAP_FRAMES");
+    const char* result_env = getenv("PERSYST_LIVE_TAP_RESULT");
+    if (tap_name == nullptr || frames_env == nullptr || result_env == nullptr) {
+        GTEST_SKIP() << "only runs as the consumer process of DeliversFramesToAConsumerProcess";
+    }
+    const int64 expected_frames = atoll(frames_env);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+
+    LiveTapReader reader;
+    while (!reader.open(tap_name)) {
+        ASSERT_LT(std::chrono::steady_clock::now(), deadline) << "could not open " << tap_name;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(reader.getNumChannels(), num_channels);
+    ASSERT_EQ(reader.getChannelNames()[0], String("CH1"));
+
+    int64 frames_read = 0;
+    while (frames_read < expected_frames) {
+        ASSERT_LT(std::chrono::steady_clock::now(), deadline) << frames_read << " frames read";
+        const int64 count = ReadAndCheck(reader);
+        if (HasFailure()) {
+            return;
+        }
+        if (count == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        frames_read += count;
+    }
+    ASSERT_EQ(frames_read, expected_frames);
+    ASSERT_EQ(reader.getFramesLost(), 0);
+
+    std::vector<LiveTap::SampleTime> times(4096);
+    const int num_times = reader.readSampleTimes(times.data(), (int) times.size());
+    ASSERT_GT(num_times, 0);
+    for (int i = 0; i < num_times; i++) {
+        ASSERT_EQ(times[i].time, times[i].sample / sample_rate);
+    }
+
+    // Tells the parent that this test ran and passed, rather than being filtered out
+    std::ofstream(result_env) << frames_read;
+}
+
+TEST_F(LiveTapTests, DeliversFramesToAConsumerProcess) {
+    const int total_frames = 20000;
+    LiveTap tap(num_channels, sample_rate, 1.0, total_frames);
+    ASSERT_TRUE(tap.open(name, "stream", channel_names));
+
+    const std::string exe = File::getSpecialLocation(File::currentExecutableFile).getFullPathName().toStdString();
+    std::string filter = "--gtest_filter=LiveTapTests.ConsumerProcess";
+    std::vector<char*> argv = { const_cast<char*>(exe.c_str()), const_cast<char*>(filter.c_str()), nullptr };
+
+    const auto result_path = std::filesystem::temp_directory_path() / ("persyst_live_tap_" + std::to_string(getpid()));
+    std::filesystem::remove(result_path);
+    std::vector<std::string> env_strings = {
+        "PERSYST_LIVE_TAP_CONSUMER=" + name.toStdString(),
+        "PERSYST_LIVE_TAP_FRAMES=" + std::to_string(total_frames),
+        "PERSYST_LIVE_TAP_RESULT=" + result_path.string()
+    };
+    std::vector<char*> envp;
+    for (auto& var : env_strings) {
+        envp.push_back(const_cast<char*>(var.c_str()));
+    }
+    for (char** var = environ; *var != nullptr; var++) {
+        envp.push_back(*var);
+    }
+    envp.push_back(nullptr);
+
+    pid_t pid;
+    ASSERT_EQ(posix_spawn(&pid, exe.c_str(), nullptr, nullptr, argv.data(), envp.data()), 0);
+
+    // Published as the record path would, while the consumer follows
+    for (int64 start = 0; start < total_frames; start += 500) {
+        WriteFrames(tap, 0, start, 500, 125);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+
+    int status = 0;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (waitpid(pid, &status, WNOHANG) == 0) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            FAIL() << "consumer process did not finish";
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    tap.close();
+
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+
+    int64 frames_read = 0;
+    std::ifstream(result_path) >> frames_read;
+    std::filesystem::remove(result_path);
+    ASSERT_EQ(frames_read, total_frames);
+}
+
+#endif
@@ -0,0 +1,88 @@
+#include "gtest/gtest.h"
+
+#include "../Source/NpyWriter.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+class NpyWriterTests : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() / "persyst_npy_writer_tests";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    std::string ReadFile(const std::filesystem::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    // The dictionary of a version 1 header, without its padding
+    std::string Dict(const std::string& bytes) {
+        size_t length = uint8_t(bytes[8]) | uint8_t(bytes[9]) << 8;
+        std::string dict = bytes.substr(10, length);
+        return dict.substr(0, dict.find_last_not_of(" \n") + 1);
+    }
+
+    std::filesystem::path dir;
+};
+
+TEST_F(NpyWriterTests, MatchesNumpy) {
+    auto path = dir / "sample_numbers.npy";
+    {
+        NpyWriter writer(String(path.string()), BaseType::INT64);
+        ASSERT_TRUE(writer.openedOk());
+        int64 value = 1;
+        writer.writeData(&value, sizeof(value));
+        writer.increaseRecordCount();
+    }
+
+    // np.save(b, np.array([1], dtype=np.int64))
+    std::string dict = "{'descr': '<i8', 'fortran_order': False, 'shape': (1,), }";
+    std::string expected = std::string("\x93NUMPY\x01\x00\x76\x00", 10)
+        + dict + std::string(117 - dict.size(), ' ') + "\n"
+        + std::string("\x01\x00\x00\x00\x00\x00\x00\x00", 8);
+    ASSERT_EQ(ReadFile(path), expected);
+}
+
+TEST_F(NpyWriterTests, UpdatesTheCountInPlace) {
+    auto path = dir / "data_array.npy";
+    NpyWriter writer(String(path.string()), BaseType::FLOAT, 3);
+    const std::string empty = ReadFile(path);
+    ASSERT_EQ(empty.size() % 64, 0u);
+    ASSERT_EQ(Dict(empty), "{'descr': '<f4', 'fortran_order': False, 'shape': (0, 3), }");
+
+    float values[3] = { 1, 2, 3 };
+    for (int i = 0; i < 1000; i++) {
+        writer.writeData(values, sizeof(values));
+        writer.increaseRecordCount();
+    }
+    writer.updateHeader();
+    ASSERT_EQ(writer.getRecordCount(), 1000);
+
+    const std::string bytes = ReadFile(path);
+    ASSERT_EQ(bytes.size(), empty.size() + 1000 * sizeof(values));
+    ASSERT_EQ(Dict(bytes), "{'descr': '<f4', 'fortran_order': False, 'shape': (1000, 3), }");
+    float last[3];
+    std::memcpy(last, bytes.data() + bytes.size() - sizeof(last), sizeof(last));
+    ASSERT_EQ(last[2], 3.0f);
+}
+
+TEST_F(NpyWriterTests, WritesTextAsFixedLengthStrings) {
+    auto path = dir / "text.npy";
+    {
+        NpyWriter writer(String(path.string()), BaseType::CHAR, 16);
+        writer.writeData("0123456789abcdef", 16);
+        writer.increaseRecordCount();
+    }
+    ASSERT_EQ(Dict(ReadFile(path)), "{'descr': '|S16', 'fortran_order': False, 'shape': (1,), }");
+    ASSERT_EQ(NpyWriter::getTypeString(BaseType::UINT16, 1), String("<u2"));
+}
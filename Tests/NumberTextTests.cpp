@@ -0,0 +1,73 @@
+#include "gtest/gtest.h"
+
+#include "../Source/NumberText.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+
+static std::string Format(double value) {
+    char text[NumberText::MAX_DOUBLE_LENGTH];
+    char* end = NumberText::format(text, text + sizeof(text), value);
+    return std::string(text, end);
+}
+
+static bool Parse(const std::string& text, double& value) {
+    return NumberText::parse(text.data(), text.data() + text.size(), value);
+}
+
+TEST(NumberTextTests, DoublesRoundTripExactly) {
+    std::mt19937_64 rng(7);
+    std::vector<double> values = { 0.0, 0.5, 1.0 / 3.0, 1e-7, 4096.0 / 30000.0, 123456789.123456789,
+                                    -std::numeric_limits<double>::max(), std::numeric_limits<double>::denorm_min() };
+    for (int i = 0; i < 10000; i++) {
+        uint64_t bits = rng();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        if (std::isfinite(value)) {
+            values.push_back(value);
+        }
+    }
+
+    for (double value : values) {
+        const std::string text = Format(value);
+        ASSERT_LE(text.size(), size_t(NumberText::MAX_DOUBLE_LENGTH));
+        double parsed = 0;
+        ASSERT_TRUE(Parse(text, parsed)) << text;
+        ASSERT_EQ(parsed, value) << text;
+    }
+}
+
+TEST(NumberTextTests, WritesShortText) {
+    ASSERT_EQ(Format(0.5), "0.5");
+    ASSERT_EQ(Format(30000.0), "30000");
+    ASSERT_EQ(Format(0.1), "0.1");
+
+    char text[32];
+    char* end = NumberText::format(text, text + sizeof(text), int64(-1234567890123));
+    ASSERT_EQ(std::string(text, end), "-1234567890123");
+}
+
+TEST(NumberTextTests, ParsesOnlyWholeNumbers) {
+    double value = 0;
+    ASSERT_TRUE(Parse("2.5e-3", value));
+    ASSERT_EQ(value, 2.5e-3);
+    ASSERT_TRUE(Parse("-7", value));
+    ASSERT_EQ(value, -7.0);
+
+    for (const char* text : { "", "1.5x", " 1.5", "+1.5", "0x10", "1e999", "abc" }) {
+        ASSERT_FALSE(Parse(text, value)) << text;
+    }
+
+    float single = 0;
+    const std::string text = "0.195";
+    ASSERT_TRUE(NumberText::parse(text.data(), text.data() + text.size(), single));
+    ASSERT_EQ(single, 0.195f);
+
+    int64 integer = 0;
+    const std::string digits = "9007199254740993";
+    ASSERT_TRUE(NumberText::parse(digits.data(), digits.data() + digits.size(), integer));
+    ASSERT_EQ(integer, int64(9007199254740993));
+}
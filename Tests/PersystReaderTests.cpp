@@ -0,0 +1,240 @@
+#include "gtest/gtest.h"
+
+#include "../Source/EnvelopePyramid.h"
+#include "../Source/PersystReader.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class PersystReaderTests : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() / "persyst_reader_tests";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    // Writes a recording of num_channels x num_samples, where sample s of channel c is s * 10 + c
+    void WriteRecording(int num_channels, int num_samples, const std::string& sample_times, const std::string& extra = "") {
+        data.clear();
+        for (int s = 0; s < num_samples; s++) {
+            for (int c = 0; c < num_channels; c++) {
+                data.push_back(int16_t(s * 10 + c - 20000));
+            }
+        }
+        std::ofstream dat(dir / "recording.dat", std::ios::binary);
+        dat.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(int16_t));
+
+        std::ofstream lay(dir / "recording.lay");
+        lay << "[FileInfo]\nFile=recording.dat\nFileType=Interleaved\nSamplingRate=1000\nHeaderLength=0\n"
+            << "Calibration=0.195\nWaveformCount=" << num_channels << "\nDataType=0\n"
+            << extra
+            << "[ChannelMap]\n";
+        for (int c = 0; c < num_channels; c++) {
+            lay << "CH" << c + 1 << "=" << c + 1 << "\n";
+        }
+        lay << "[SampleTimes]\n" << sample_times;
+    }
+
+    File LayoutFile() {
+        return File(String((dir / "recording.lay").string()));
+    }
+
+    std::filesystem::path dir;
+    std::vector<int16_t> data;
+};
+
+TEST_F(PersystReaderTests, ParsesLayout) {
+    WriteRecording(4, 100, "0=10\n50=10.05\n", "[Segment]\nIndex=3\nFirstSample=123456\n");
+
+    PersystReader reader;
+    ASSERT_TRUE(reader.open(LayoutFile()));
+
+    EXPECT_EQ(reader.getFileInfo().file, String("recording.dat"));
+    EXPECT_EQ(reader.getFileInfo().samplingRate, 1000.0);
+    EXPECT_EQ(reader.getFileInfo().calibration, 0.195);
+    EXPECT_EQ(reader.getNumChannels(), 4);
+    EXPECT_EQ(reader.getNumSamples(), 100);
+    EXPECT_EQ(reader.getSegmentIndex(), 3);
+    EXPECT_EQ(reader.getFirstSample(), 123456);
+
+    EXPECT_EQ(reader.getChannelName(2), String("CH3"));
+    EXPECT_EQ(reader.getChannelIndex("CH4"), 3);
+    EXPECT_EQ(reader.getChannelIndex("CH5"), -1);
+
+    ASSERT_EQ(reader.getSampleTimes().size(), 2);
+    EXPECT_EQ(reader.getSampleTimes()[1].sample, 50);
+    EXPECT_EQ(reader.getSampleTimes()[1].time, 10.05);
+}
+
+TEST_F(PersystReaderTests, FramesAreMappedInPlace) {
+    WriteRecording(3, 1000, "0=0\n");
+
+    PersystReader reader;
+    ASSERT_TRUE(reader.open(LayoutFile()));
+
+    const int16* frames = reader.getFrames(0);
+    ASSERT_NE(frames, nullptr);
+    for (size_t i = 0; i < data.size(); i++) {
+        ASSERT_EQ(frames[i], data[i]) << "index=" << i;
+    }
+    EXPECT_EQ(reader.getFrames(999), frames + 999 * 3);
+    EXPECT_EQ(reader.getFrames(1000), nullptr);
+    EXPECT_EQ(reader.getFrames(-1), nullptr);
+}
+
+TEST_F(PersystReaderTests, ReadsChannelSubsetInMicrovolts) {
+    const int num_channels = 37;
+    const int num_samples = 1500;
+    WriteRecording(num_channels, num_samples, "0=0\n");
+
+    PersystReader reader;
+    ASSERT_TRUE(reader.open(LayoutFile()));
+
+    const int channels[] = { 36, 0, 17, 17 };
+    std::vector<std::vector<float>> output(4, std::vector<float>(num_samples, -1.0f));
+    float* dest[] = { output[0].data(), output[1].data(), output[2].data(), output[3].data() };
+
+    // Runs past the end of the file, which stops the read
+    ASSERT_EQ(reader.readChannels(channels, 4, 123, num_samples, dest), num_samples - 123);
+
+    for (int c = 0; c < 4; c++) {
+        for (int s = 0; s < num_samples - 123; s++) {
+            const float expected = float(data[(s + 123) * num_channels + channels[c]]) * 0.195f;
+            ASSERT_EQ(output[c][s], expected) << "channel=" << channels[c] << " sample=" << s;
+        }
+        ASSERT_EQ(output[c][num_samples - 123], -1.0f);
+    }
+
+    const int invalid[] = { num_channels };
+    EXPECT_EQ(reader.readChannels(invalid, 1, 0, 10, dest), -1);
+    EXPECT_EQ(reader.readChannels(channels, 1, -1, 10, dest), -1);
+    EXPECT_EQ(reader.readChannels(channels, 1, num_samples, 10, dest), 0);
+}
+
+TEST_F(PersystReaderTests, MapsSamplesAndTimes) {
+    // Steady clock, then 2 s of dropped data starting at sample 400
+    WriteRecording(1, 1000, "0=100\n399=100.399\n400=102.4\n999=102.999\n");
+
+    PersystReader reader;
+    ASSERT_TRUE(reader.open(LayoutFile()));
+
+    EXPECT_DOUBLE_EQ(reader.getTimeOfSample(0), 100.0);
+    EXPECT_DOUBLE_EQ(reader.getTimeOfSample(250), 100.25);
+    EXPECT_DOUBLE_EQ(reader.getTimeOfSample(400), 102.4);
+    EXPECT_DOUBLE_EQ(reader.getTimeOfSample(500), 102.5);
+    EXPECT_DOUBLE_EQ(reader.getTimeOfSample(1100), 103.1);
+
+    EXPECT_EQ(reader.getSampleAtTime(100.0), 0);
+    EXPECT_EQ(reader.getSampleAtTime(100.25), 250);
+    EXPECT_EQ(reader.getSampleAtTime(100.2501), 251);
+    EXPECT_EQ(reader.getSampleAtTime(101.0), 400);
+    EXPECT_EQ(reader.getSampleAtTime(102.5), 500);
+    EXPECT_EQ(reader.getSampleAtTime(99.0), -1000);
+
+    for (int64 s = 0; s < 1000; s++) {
+        ASSERT_EQ(reader.getSampleAtTime(reader.getTimeOfSample(s)), s);
+    }
+}
+
+TEST_F(PersystReaderTests, ReadsTimeWindow) {
+    WriteRecording(2, 1000, "0=5\n");
+
+    PersystReader reader;
+    ASSERT_TRUE(reader.open(LayoutFile()));
+
+    const int channels[] = { 1 };
+    std::vector<float> output(1000);
+    float* dest[] = { output.data() };
+
+    ASSERT_EQ(reader.readTimeWindow(channels, 1, 5.1, 5.2, dest, 1000), 100);
+    EXPECT_EQ(output[0], float(data[100 * 2 + 1]) * 0.195f);
+    EXPECT_EQ(output[99], float(data[199 * 2 + 1]) * 0.195f);
+
+    EXPECT_EQ(reader.readTimeWindow(channels, 1, 5.1, 5.2, dest, 10), 10);
+    EXPECT_EQ(reader.readTimeWindow(channels, 1, 4.0, 5.01, dest, 1000), 10);
+    EXPECT_EQ(reader.readTimeWindow(channels, 1, 5.9, 7.0, dest, 1000), 100);
+    EXPECT_EQ(reader.readTimeWindow(channels, 1, 7.0, 8.0, dest, 1000), 0);
+}
+
+TEST_F(PersystReaderTests, EmptyDataFile) {
+    WriteRecording(8, 0, "");
+
+    PersystReader reader;
+    ASSERT_TRUE(reader.open(LayoutFile()));
+    EXPECT_EQ(reader.getNumSamples(), 0);
+    EXPECT_EQ(reader.getFrames(0), nullptr);
+    EXPECT_DOUBLE_EQ(reader.getTimeOfSample(500), 0.5);
+}
+
+TEST_F(PersystReaderTests, RejectsInvalidFiles) {
+    PersystReader reader;
+    EXPECT_FALSE(reader.open(LayoutFile()));
+
+    WriteRecording(2, 10, "0=abc\n");
+    EXPECT_FALSE(reader.open(LayoutFile()));
+
+    WriteRecording(2, 10, "0=0\n");
+    std::filesystem::remove(dir / "recording.dat");
+    EXPECT_FALSE(reader.open(LayoutFile()));
+    EXPECT_FALSE(reader.isOpen());
+
+    std::ofstream(dir / "recording.lay") << "[FileInfo]\nFile=recording.dat\nFileType=Interleaved\n"
+                                         << "SamplingRate=1000\nWaveformCount=2\nDataType=7\n";
+    EXPECT_FALSE(reader.open(LayoutFile()));
+}
+
+TEST_F(PersystReaderTests, ReadsEnvelopeFromPyramidOrData) {
+    const int num_channels = 3;
+    const int num_samples = 3000;
+    WriteRecording(num_channels, num_samples, "0=0\n");
+
+    // Without an envelope file everything comes from the data file
+    PersystReader reader;
+    ASSERT_TRUE(reader.open(LayoutFile()));
+    ASSERT_EQ(reader.getEnvelope(), nullptr);
+    std::vector<float> mins(10), maxs(10), rms(10);
+    ASSERT_TRUE(reader.readEnvelope(1, 0, num_samples, 10, mins.data(), maxs.data(), rms.data()));
+    for (int column = 0; column < 10; column++) {
+        EXPECT_FLOAT_EQ(mins[column], (column * 300 * 10 + 1 - 20000) * 0.195f);
+        EXPECT_FLOAT_EQ(maxs[column], ((column * 300 + 299) * 10 + 1 - 20000) * 0.195f);
+    }
+    std::vector<float> raw_mins(10), raw_maxs(10);
+    std::copy(mins.begin(), mins.end(), raw_mins.begin());
+    std::copy(maxs.begin(), maxs.end(), raw_maxs.begin());
+    reader.close();
+
+    {
+        EnvelopePyramid pyramid(num_channels, true);
+        ASSERT_TRUE(pyramid.openFile(String((dir / "recording.env").string())));
+        pyramid.addFrames(data.data(), num_samples);
+    }
+
+    ASSERT_TRUE(reader.open(LayoutFile()));
+    ASSERT_NE(reader.getEnvelope(), nullptr);
+
+    // 300 samples per column come from the 64x level, whose bins overlap the column edges by less than a bin
+    ASSERT_TRUE(reader.readEnvelope(1, 0, num_samples, 10, mins.data(), maxs.data(), rms.data()));
+    for (int column = 0; column < 10; column++) {
+        EXPECT_LE(mins[column], raw_mins[column]);
+        EXPECT_GE(mins[column], raw_mins[column] - 64 * 10 * 0.195f);
+        EXPECT_GE(maxs[column], raw_maxs[column]);
+        EXPECT_LE(maxs[column], raw_maxs[column] + 64 * 10 * 0.195f);
+        EXPECT_GT(rms[column], 0);
+    }
+
+    // Short columns still read the data file exactly
+    ASSERT_TRUE(reader.readEnvelope(2, 100, 200, 10, mins.data(), maxs.data()));
+    EXPECT_FLOAT_EQ(mins[0], (100 * 10 + 2 - 20000) * 0.195f);
+    EXPECT_FLOAT_EQ(maxs[9], (199 * 10 + 2 - 20000) * 0.195f);
+
+    ASSERT_FALSE(reader.readEnvelope(3, 0, 10, 1, mins.data(), maxs.data()));
+    ASSERT_FALSE(reader.readEnvelope(0, 0, num_samples + 1, 1, mins.data(), maxs.data()));
+}
@@ -4,7 +4,11 @@
 
 #include <Processors/RecordNode/RecordNode.h>
 #include <Processors/PluginManager/OpenEphysPlugin.h>
+#include "../Source/BlockChecksumVerifier.h"
+#include "../Source/EnvelopeReader.h"
+#include "../Source/LiveTapReader.h"
 #include "../Source/PersystRecordEngine.h"
+#include "../Source/PersystReader.h"
 #include <ModelProcessors.h>
 #include <ModelApplication.h>
 #include <TestFixtures.h>
@@ -45,9 +49,13 @@ protected:
         tester->setRecordingParentDirectory(parent_recording_dir.string());
         processor = tester->Create<RecordNode>(Plugin::Processor::RECORD_NODE);
         std::unique_ptr<RecordEngineManager> record_engine_manager = std::unique_ptr<RecordEngineManager>(PersystRecordEngine::getEngineManager());
+        ConfigureEngine(record_engine_manager.get());
         processor -> overrideRecordEngine(record_engine_manager.get());
     }
 
+    // Override to change engine parameters before the engine is created
+    virtual void ConfigureEngine(RecordEngineManager* manager) {}
+
     void TearDown() override {
         // Swallow errors
         std::error_code ec;
@@ -537,6 +545,92 @@ TEST_F(PersystRecordEngineTests, Test_PersistsEvents) {
     CompareBinaryFilesHex("full_words.npy", full_words_bin, expected_full_words_hex);
 }
 
+TEST_F(PersystRecordEngineTests, Test_WritesRecordStats) {
+    processor->setRecordEvents(true);
+    processor->updateSettings();
+
+    tester->startAcquisition(true);
+
+    auto stream_id = processor->getDataStreams()[0]->getStreamId();
+    auto event_channels = tester->GetSourceNodeDataStream(stream_id)->getEventChannels();
+    ASSERT_GE(event_channels.size(), 1);
+    TTLEventPtr event_ptr = TTLEvent::createTTLEvent(event_channels[0], 1, 2, true);
+
+    int num_samples_per_block = 100;
+    int num_blocks = 20;
+    for (int i = 0; i < num_blocks; i++) {
+        auto input_buffer = CreateBuffer(1000.0f, 20.0, num_channels, num_samples_per_block);
+        WriteBlock(input_buffer, i == 0 ? event_ptr.get() : nullptr);
+    }
+    tester->stopAcquisition();
+
+    std::filesystem::path stats_path;
+    ASSERT_TRUE(ContinuousPathFor("persyst_stats.json", &stats_path, DirectorySearchParameters()));
+    var stats = JSON::parse(File(stats_path.string()));
+
+    ASSERT_EQ((int64) stats["samples"], num_samples_per_block * num_blocks);
+    ASSERT_EQ((int64) stats["bytes"], int64(num_samples_per_block) * num_blocks * num_channels * sizeof(int16_t));
+    ASSERT_EQ((int64) stats["events"], 1);
+    ASSERT_GE((int64) stats["blocks"], 1);
+
+    var latency = stats["latency"];
+    ASSERT_EQ((int64) latency["write_call"]["count"], num_blocks * num_channels);
+    ASSERT_EQ((int64) latency["conversion"]["count"], num_blocks * num_channels);
+    ASSERT_EQ((int64) latency["lay_write"]["count"], num_blocks);
+    ASSERT_EQ((int64) latency["event_write"]["count"], 1);
+    ASSERT_EQ((int64) latency["open"]["count"], 1);
+    ASSERT_EQ((int64) latency["close"]["count"], 1);
+    ASSERT_GE((int64) latency["dat_write"]["max_ns"], (int64) latency["dat_write"]["p50_ns"]);
+
+    // The entry for events of streams without continuous data sits next to the event folders
+    std::filesystem::path sample_numbers_path;
+    ASSERT_TRUE(EventsPathFor("sample_numbers.npy", &sample_numbers_path));
+    auto events_stats_path = sample_numbers_path.parent_path().parent_path().parent_path() / "persyst_stats.json";
+    ASSERT_TRUE(std::filesystem::exists(events_stats_path));
+    var events_stats = JSON::parse(File(events_stats_path.string()));
+    ASSERT_EQ((int64) events_stats["events"], 0);
+    ASSERT_EQ((int64) events_stats["latency"]["open"]["count"], 1);
+    ASSERT_EQ((int64) events_stats["latency"]["close"]["count"], 1);
+}
+
+TEST_F(PersystRecordEngineTests, Test_CountsSaturatedSamples) {
+    tester->startAcquisition(true);
+
+    int num_samples_per_block = 100;
+    int num_blocks = 5;
+    for (int i = 0; i < num_blocks; i++) {
+        auto input_buffer = CreateBuffer(-200.0f, 1.0f, num_channels, num_samples_per_block);
+        // Channel 2 rails on both sides for 10 samples of every block; bitVolts is 1, so full scale is 32767 uV
+        for (int sample_idx = 0; sample_idx < 10; sample_idx++) {
+            input_buffer.setSample(2, sample_idx, sample_idx % 2 == 0 ? 40000.0f : -40000.0f);
+        }
+        WriteBlock(input_buffer);
+    }
+    tester->stopAcquisition();
+
+    std::filesystem::path stats_path;
+    ASSERT_TRUE(ContinuousPathFor("persyst_stats.json", &stats_path, DirectorySearchParameters()));
+    var stats = JSON::parse(File(stats_path.string()));
+
+    ASSERT_EQ((int64) stats["saturated_samples"], 10 * num_blocks);
+    ASSERT_EQ((int) stats["saturated_channels"], 1);
+
+    auto channels = stats["channels"].getArray();
+    ASSERT_EQ(channels->size(), num_channels);
+    for (int chidx = 0; chidx < num_channels; chidx++) {
+        const var& channel = (*channels)[chidx];
+        if (chidx == 2) {
+            ASSERT_EQ((int64) channel["saturated"], 10 * num_blocks);
+            ASSERT_EQ((int) channel["min"], -32767);
+            ASSERT_EQ((int) channel["max"], 32767);
+        } else {
+            ASSERT_EQ((int64) channel["saturated"], 0);
+            ASSERT_EQ((int) channel["min"], -200 + chidx * num_samples_per_block);
+            ASSERT_EQ((int) channel["max"], -200 + (chidx + 1) * num_samples_per_block - 1);
+        }
+    }
+}
+
 class CustomBitVolts_PersystRecordEngineTests : public PersystRecordEngineTests {
     void SetUp() override {
         bitVolts_ = 0.195;
@@ -575,6 +669,43 @@ TEST_F(CustomBitVolts_PersystRecordEngineTests, Test_RespectsBitVolts) {
     }
 }
 
+TEST_F(CustomBitVolts_PersystRecordEngineTests, Test_ReaderRoundTrip) {
+    int num_samples = 100;
+    tester->startAcquisition(true);
+    auto input_buffer = CreateBuffer(1000.0, 20.0, num_channels, num_samples);
+    WriteBlock(input_buffer);
+    tester->stopAcquisition();
+
+    std::filesystem::path layout_path;
+    ASSERT_TRUE(ContinuousPathFor("recording.lay", &layout_path, DirectorySearchParameters()));
+
+    PersystReader reader;
+    ASSERT_TRUE(reader.open(File(layout_path.string())));
+    ASSERT_EQ(reader.getNumChannels(), num_channels);
+    ASSERT_EQ(reader.getNumSamples(), num_samples);
+    ASSERT_EQ(reader.getFileInfo().samplingRate, sample_rate_);
+    ASSERT_EQ(reader.getChannelName(0), String("CH0"));
+
+    std::vector<int16_t> persisted_data;
+    LoadContinuousDatFile(&persisted_data);
+
+    std::vector<int> channels(num_channels);
+    std::vector<std::vector<float>> output(num_channels, std::vector<float>(num_samples));
+    std::vector<float*> dest(num_channels);
+    for (int chidx = 0; chidx < num_channels; chidx++) {
+        channels[chidx] = num_channels - 1 - chidx;
+        dest[chidx] = output[chidx].data();
+    }
+    ASSERT_EQ(reader.readChannels(channels.data(), num_channels, 0, num_samples, dest.data()), num_samples);
+
+    const float calibration = float(reader.getFileInfo().calibration);
+    for (int chidx = 0; chidx < num_channels; chidx++) {
+        for (int sample_idx = 0; sample_idx < num_samples; sample_idx++) {
+            ASSERT_EQ(output[chidx][sample_idx], persisted_data[sample_idx * num_channels + channels[chidx]] * calibration);
+        }
+    }
+}
+
 class MultipleStreams_PersystRecordEngineTests : public PersystRecordEngineTests {
     void SetUp() override {
         streams_ = 2;
@@ -651,3 +782,549 @@ TEST_F(MultipleStreams_PersystRecordEngineTests, TestLayoutFormat_MultipleStream
     
 }
 
+
+class WholeStreamWrites_PersystRecordEngineTests : public PersystRecordEngineTests {
+protected:
+    void SetUp() override {
+        streams_ = 2;
+        num_channels = 19;
+        PersystRecordEngineTests::SetUp();
+    }
+
+    void ConfigureEngine(RecordEngineManager* manager) override {
+        manager->getParameter(1).boolParam.value = true;
+    }
+};
+
+TEST_F(WholeStreamWrites_PersystRecordEngineTests, TestInputOutput_WholeStreamWrites) {
+    tester->startAcquisition(true, true);
+
+    // Blocks that don't divide the file block size, so writes straddle block boundaries
+    int num_samples_per_block = 1500;
+    int num_blocks = 7;
+    std::vector<AudioBuffer<float>> input_buffers;
+    for (int i = 0; i < num_blocks; i++) {
+        auto input_buffer = CreateBuffer(-3000.0f + 100.0f * i, 0.5, num_channels * streams_, num_samples_per_block);
+        WriteBlock(input_buffer);
+        input_buffers.push_back(input_buffer);
+    }
+
+    tester->stopAcquisition();
+
+    int stream_idx = 0;
+    for(const auto & stream: processor->getDataStreams()) {
+        std::vector<int16_t> persisted_data;
+        DirectorySearchParameters parameters;
+        parameters.stream_dir_name = BuildStreamFileName(stream);
+        LoadContinuousDatFile(&persisted_data, parameters);
+        ASSERT_EQ(persisted_data.size(), num_channels * num_samples_per_block * num_blocks);
+
+        int persisted_data_idx = 0;
+        for (int block_idx = 0; block_idx < num_blocks; block_idx++) {
+            const auto& input_buffer = input_buffers[block_idx];
+            for (int sample_idx = 0; sample_idx < num_samples_per_block; sample_idx++) {
+                for (int chidx = 0; chidx < num_channels; chidx++) {
+                    auto expected = juce::roundToInt(input_buffer.getSample(chidx + stream_idx * num_channels, sample_idx));
+                    ASSERT_EQ(persisted_data[persisted_data_idx], expected);
+                    persisted_data_idx++;
+                }
+            }
+        }
+        stream_idx++;
+    }
+}
+
+class AsyncWriter_PersystRecordEngineTests : public PersystRecordEngineTests {
+protected:
+    void ConfigureEngine(RecordEngineManager* manager) override {
+        manager->getParameter(2).boolParam.value = true;
+        // Small rings so the writer thread has to keep up with the producer
+        manager->getParameter(3).intParam.value = 1;
+    }
+};
+
+TEST_F(AsyncWriter_PersystRecordEngineTests, TestInputOutput_AsyncWriter) {
+    sample_rate_ = 100;
+    UpdateSourceNodesStreamParams();
+
+    tester->startAcquisition(true);
+
+    int num_samples_per_block = 110;
+    int num_blocks = 20;
+    std::vector<AudioBuffer<float>> input_buffers;
+    for (int i = 0; i < num_blocks; i++) {
+        auto input_buffer = CreateBuffer(1000.0f * i, 20.0, num_channels, num_samples_per_block);
+        WriteBlock(input_buffer);
+        input_buffers.push_back(input_buffer);
+    }
+
+    tester->stopAcquisition();
+
+    std::vector<int16_t> persisted_data;
+    LoadContinuousDatFile(&persisted_data);
+    ASSERT_EQ(persisted_data.size(), num_channels * num_samples_per_block * num_blocks);
+
+    int persisted_data_idx = 0;
+    for (int block_idx = 0; block_idx < num_blocks; block_idx++) {
+        const auto& input_buffer = input_buffers[block_idx];
+        for (int sample_idx = 0; sample_idx < num_samples_per_block; sample_idx++) {
+            for (int chidx = 0; chidx < num_channels; chidx++) {
+                auto expected = std::min<float>(input_buffer.getSample(chidx, sample_idx), max_val_possible());
+                ASSERT_EQ(persisted_data[persisted_data_idx], expected);
+                persisted_data_idx++;
+            }
+        }
+    }
+
+    boost::property_tree::ptree pt;
+    LoadLayoutFile(pt);
+    CheckLayoutFileInfo(pt);
+    CheckLayoutSampleTimes(pt, sample_rate_, num_samples_per_block);
+}
+
+TEST_F(AsyncWriter_PersystRecordEngineTests, Test_PersistsEvents_AsyncWriter) {
+    processor->setRecordEvents(true);
+    processor->updateSettings();
+
+    tester->startAcquisition(true);
+
+    auto stream_id = processor->getDataStreams()[0]->getStreamId();
+    auto event_channels = tester->GetSourceNodeDataStream(stream_id)->getEventChannels();
+    ASSERT_GE(event_channels.size(), 1);
+    TTLEventPtr event_ptr = TTLEvent::createTTLEvent(event_channels[0], 1, 2, true);
+    auto input_buffer = CreateBuffer(1000.0, 20.0, num_channels, 5);
+    WriteBlock(input_buffer, event_ptr.get());
+    tester->stopAcquisition();
+
+    std::filesystem::path sample_numbers_path;
+    ASSERT_TRUE(EventsPathFor("sample_numbers.npy", &sample_numbers_path));
+    auto sample_numbers_bin = LoadNpyFileBinaryFullpath(sample_numbers_path.string());
+    std::string expected_sample_numbers_hex =
+        "934e554d5059010076007b276465736372273a20273c6938272c2027666f727472616e5f6f72646572273a2046616c73652c2027736861"
+        "7065273a2028312c292c207d20202020202020202020202020202020202020202020202020202020202020202020202020202020202020"
+        "20202020202020202020202020202020200a0100000000000000";
+    CompareBinaryFilesHex("sample_numbers.npy", sample_numbers_bin, expected_sample_numbers_hex);
+}
+
+class SegmentRollover_PersystRecordEngineTests : public PersystRecordEngineTests {
+protected:
+    void ConfigureEngine(RecordEngineManager* manager) override {
+        // One-minute segments
+        manager->getParameter(8).intParam.value = 1;
+    }
+
+    void LoadSegment(int index, std::vector<int16_t>* data, boost::property_tree::ptree* pt) {
+        char basename[32];
+        snprintf(basename, sizeof(basename), "recording_%04d", index);
+
+        std::filesystem::path dat_path;
+        ASSERT_TRUE(ContinuousPathFor(std::string(basename) + ".dat", &dat_path, DirectorySearchParameters()));
+        auto bytes = LoadNpyFileBinaryFullpath(dat_path.string());
+        data->resize(bytes.size() / sizeof(int16_t));
+        memcpy(data->data(), bytes.data(), bytes.size());
+
+        std::filesystem::path lay_path;
+        ASSERT_TRUE(ContinuousPathFor(std::string(basename) + ".lay", &lay_path, DirectorySearchParameters()));
+        boost::property_tree::ini_parser::read_ini(lay_path.string(), *pt);
+    }
+};
+
+TEST_F(SegmentRollover_PersystRecordEngineTests, TestSegmentsSplitWithoutLosingSamples) {
+    sample_rate_ = 100;
+    UpdateSourceNodesStreamParams();
+
+    tester->startAcquisition(true);
+
+    // 6000 samples per segment; 14 blocks of 1000 give segments of 6000, 6000 and 2000 samples
+    int num_samples_per_block = 1000;
+    int num_blocks = 14;
+    std::vector<AudioBuffer<float>> input_buffers;
+    for (int i = 0; i < num_blocks; i++) {
+        auto input_buffer = CreateBuffer(-1000.0f + 10.0f * i, 0.25, num_channels, num_samples_per_block);
+        WriteBlock(input_buffer);
+        input_buffers.push_back(input_buffer);
+    }
+
+    tester->stopAcquisition();
+
+    std::filesystem::path single_path;
+    ASSERT_FALSE(ContinuousPathFor("recording.dat", &single_path, DirectorySearchParameters()));
+
+    std::vector<int16_t> all_data;
+    std::vector<int> expected_segment_samples = { 6000, 6000, 2000 };
+    int first_sample = 0;
+    for (int segment = 0; segment < 3; segment++) {
+        std::vector<int16_t> data;
+        boost::property_tree::ptree pt;
+        LoadSegment(segment, &data, &pt);
+        ASSERT_EQ(data.size(), expected_segment_samples[segment] * num_channels);
+        all_data.insert(all_data.end(), data.begin(), data.end());
+
+        char basename[32];
+        snprintf(basename, sizeof(basename), "recording_%04d.dat", segment);
+        ASSERT_EQ(pt.get<std::string>("FileInfo.File"), basename);
+        ASSERT_EQ(pt.get<int>("Segment.Index"), segment);
+        ASSERT_EQ(pt.get<int>("Segment.FirstSample"), first_sample);
+
+        // SampleTimes count from the start of the segment's own data file
+        auto sample_times = pt.get_child("SampleTimes");
+        ASSERT_EQ(sample_times.size(), expected_segment_samples[segment] / num_samples_per_block);
+        ASSERT_EQ(sample_times.begin()->first, "0");
+        ASSERT_NEAR(sample_times.begin()->second.get_value<double>(), first_sample / sample_rate_, .001);
+
+        first_sample += expected_segment_samples[segment];
+    }
+
+    std::filesystem::path extra_path;
+    ASSERT_FALSE(ContinuousPathFor("recording_0003.dat", &extra_path, DirectorySearchParameters()));
+
+    ASSERT_EQ(all_data.size(), num_channels * num_samples_per_block * num_blocks);
+    int persisted_data_idx = 0;
+    for (int block_idx = 0; block_idx < num_blocks; block_idx++) {
+        const auto& input_buffer = input_buffers[block_idx];
+        for (int sample_idx = 0; sample_idx < num_samples_per_block; sample_idx++) {
+            for (int chidx = 0; chidx < num_channels; chidx++) {
+                auto expected = juce::roundToInt(input_buffer.getSample(chidx, sample_idx));
+                ASSERT_EQ(all_data[persisted_data_idx], expected);
+                persisted_data_idx++;
+            }
+        }
+    }
+
+    std::filesystem::path manifest_path;
+    ASSERT_TRUE(ContinuousPathFor("segments.json", &manifest_path, DirectorySearchParameters()));
+    var manifest = JSON::parse(File(manifest_path.string()));
+    ASSERT_EQ((int) manifest["num_channels"], num_channels);
+    auto* segments = manifest["segments"].getArray();
+    ASSERT_NE(segments, nullptr);
+    ASSERT_EQ(segments->size(), 3);
+    first_sample = 0;
+    for (int segment = 0; segment < 3; segment++) {
+        const var& entry = segments->getReference(segment);
+        ASSERT_EQ((int) entry["index"], segment);
+        ASSERT_EQ((int64) entry["first_sample"], first_sample);
+        ASSERT_EQ((int64) entry["num_samples"], expected_segment_samples[segment]);
+        first_sample += expected_segment_samples[segment];
+    }
+}
+
+class ParallelWriters_PersystRecordEngineTests : public PersystRecordEngineTests {
+protected:
+    void SetUp() override {
+        streams_ = 3;
+        PersystRecordEngineTests::SetUp();
+    }
+
+    void ConfigureEngine(RecordEngineManager* manager) override {
+        manager->getParameter(2).boolParam.value = true;
+        manager->getParameter(3).intParam.value = 1;
+        // One writer thread per stream
+        manager->getParameter(10).intParam.value = 3;
+    }
+};
+
+TEST_F(ParallelWriters_PersystRecordEngineTests, TestInputOutput_ParallelWriters) {
+    tester->startAcquisition(true, true);
+
+    int num_samples_per_block = 500;
+    int num_blocks = 12;
+    std::vector<AudioBuffer<float>> input_buffers;
+    for (int i = 0; i < num_blocks; i++) {
+        auto input_buffer = CreateBuffer(-2000.0f + 100.0f * i, 0.5, num_channels * streams_, num_samples_per_block);
+        WriteBlock(input_buffer);
+        input_buffers.push_back(input_buffer);
+    }
+
+    tester->stopAcquisition();
+
+    int stream_idx = 0;
+    for(const auto & stream: processor->getDataStreams()) {
+        std::vector<int16_t> persisted_data;
+        DirectorySearchParameters parameters;
+        parameters.stream_dir_name = BuildStreamFileName(stream);
+        LoadContinuousDatFile(&persisted_data, parameters);
+        ASSERT_EQ(persisted_data.size(), num_channels * num_samples_per_block * num_blocks);
+
+        int persisted_data_idx = 0;
+        for (int block_idx = 0; block_idx < num_blocks; block_idx++) {
+            const auto& input_buffer = input_buffers[block_idx];
+            for (int sample_idx = 0; sample_idx < num_samples_per_block; sample_idx++) {
+                for (int chidx = 0; chidx < num_channels; chidx++) {
+                    auto expected = juce::roundToInt(input_buffer.getSample(chidx + stream_idx * num_channels, sample_idx));
+                    ASSERT_EQ(persisted_data[persisted_data_idx], expected);
+                    persisted_data_idx++;
+                }
+            }
+        }
+
+        boost::property_tree::ptree pt;
+        LoadLayoutFile(pt, parameters);
+        CheckLayoutFileInfo(pt);
+        stream_idx++;
+    }
+}
+
+class Preview_PersystRecordEngineTests : public PersystRecordEngineTests {
+protected:
+    void ConfigureEngine(RecordEngineManager* manager) override {
+        // 100 Hz preview
+        manager->getParameter(12).intParam.value = 100;
+    }
+};
+
+TEST_F(Preview_PersystRecordEngineTests, TestWritesDecimatedPreview) {
+    sample_rate_ = 1000;
+    UpdateSourceNodesStreamParams();
+
+    tester->startAcquisition(true);
+
+    int num_samples_per_block = 500;
+    int num_blocks = 10;
+    for (int i = 0; i < num_blocks; i++) {
+        auto input_buffer = CreateBuffer(500.0f, 0, num_channels, num_samples_per_block);
+        WriteBlock(input_buffer);
+    }
+
+    tester->stopAcquisition();
+
+    // The full-rate file is unchanged
+    std::vector<int16_t> persisted_data;
+    LoadContinuousDatFile(&persisted_data);
+    ASSERT_EQ(persisted_data.size(), num_channels * num_samples_per_block * num_blocks);
+
+    std::filesystem::path preview_path;
+    ASSERT_TRUE(ContinuousPathFor("preview.dat", &preview_path, DirectorySearchParameters()));
+    auto bytes = LoadNpyFileBinaryFullpath(preview_path.string());
+    std::vector<int16_t> preview(bytes.size() / sizeof(int16_t));
+    memcpy(preview.data(), bytes.data(), bytes.size());
+
+    // One preview sample per 10 input samples, centred on the input it is timed at
+    int num_preview_samples = num_samples_per_block * num_blocks / 10;
+    ASSERT_EQ(preview.size(), num_preview_samples * num_channels);
+
+    // Away from the ends the filter passes DC unchanged
+    for (int sample_idx = 20; sample_idx < num_preview_samples - 20; sample_idx++) {
+        for (int chidx = 0; chidx < num_channels; chidx++) {
+            ASSERT_NEAR(preview[sample_idx * num_channels + chidx], 500, 1);
+        }
+    }
+
+    std::filesystem::path lay_path;
+    ASSERT_TRUE(ContinuousPathFor("preview.lay", &lay_path, DirectorySearchParameters()));
+    boost::property_tree::ptree pt;
+    boost::property_tree::ini_parser::read_ini(lay_path.string(), pt);
+    ASSERT_EQ(pt.get<std::string>("FileInfo.File"), "preview.dat");
+    ASSERT_EQ(pt.get<int>("FileInfo.SamplingRate"), 100);
+    ASSERT_EQ(pt.get<int>("FileInfo.WaveformCount"), num_channels);
+    ASSERT_EQ(pt.get_child("ChannelMap").size(), num_channels);
+
+    // One row per block, on the same clock as recording.lay
+    auto sample_times = pt.get_child("SampleTimes");
+    ASSERT_EQ(sample_times.size(), num_blocks);
+    int block_idx = 0;
+    for (const auto& row : sample_times) {
+        ASSERT_EQ(std::stoi(row.first), block_idx * num_samples_per_block / 10);
+        ASSERT_NEAR(row.second.get_value<double>(), block_idx * num_samples_per_block / sample_rate_, .001);
+        block_idx++;
+    }
+}
+
+class Envelope_PersystRecordEngineTests : public PersystRecordEngineTests {
+protected:
+    void ConfigureEngine(RecordEngineManager* manager) override {
+        // Min, max and RMS
+        manager->getParameter(13).intParam.value = 2;
+    }
+};
+
+TEST_F(Envelope_PersystRecordEngineTests, TestWritesEnvelopeOfRecordedData) {
+    tester->startAcquisition(true);
+
+    int num_samples_per_block = 1000;
+    int num_blocks = 5;
+    for (int i = 0; i < num_blocks; i++) {
+        auto input_buffer = CreateBuffer(-3000.0f + 100.0f * i, 0.5, num_channels, num_samples_per_block);
+        WriteBlock(input_buffer);
+    }
+
+    tester->stopAcquisition();
+
+    std::vector<int16_t> persisted_data;
+    LoadContinuousDatFile(&persisted_data);
+    int num_samples = num_samples_per_block * num_blocks;
+    ASSERT_EQ(persisted_data.size(), num_channels * num_samples);
+
+    std::filesystem::path envelope_path;
+    ASSERT_TRUE(ContinuousPathFor("recording.env", &envelope_path, DirectorySearchParameters()));
+    EnvelopeReader envelope;
+    ASSERT_TRUE(envelope.open(File(envelope_path.string())));
+    ASSERT_EQ(envelope.getNumChannels(), num_channels);
+    ASSERT_TRUE(envelope.hasRms());
+
+    // Every level matches the samples in recording.dat
+    for (int level = 0; level < envelope.getNumLevels(); level++) {
+        int factor = envelope.getFactor(level);
+        int num_bins = (num_samples + factor - 1) / factor;
+        ASSERT_EQ(envelope.getNumBins(level), num_bins);
+        for (int chidx = 0; chidx < num_channels; chidx++) {
+            std::vector<int16_t> mins(num_bins), maxs(num_bins);
+            ASSERT_EQ(envelope.readBins(level, chidx, 0, num_bins, mins.data(), maxs.data(), nullptr), num_bins);
+            for (int bin = 0; bin < num_bins; bin++) {
+                int16_t lo = 32767, hi = -32768;
+                for (int s = bin * factor; s < std::min((bin + 1) * factor, num_samples); s++) {
+                    lo = std::min(lo, persisted_data[s * num_channels + chidx]);
+                    hi = std::max(hi, persisted_data[s * num_channels + chidx]);
+                }
+                ASSERT_EQ(mins[bin], lo);
+                ASSERT_EQ(maxs[bin], hi);
+            }
+        }
+    }
+}
+
+class Checksums_PersystRecordEngineTests : public PersystRecordEngineTests {
+protected:
+    void ConfigureEngine(RecordEngineManager* manager) override {
+        manager->getParameter(14).boolParam.value = true;
+    }
+};
+
+TEST_F(Checksums_PersystRecordEngineTests, TestChecksumsMatchRecordedData) {
+    tester->startAcquisition(true);
+
+    int num_samples_per_block = 1000;
+    int num_blocks = 20;
+    for (int i = 0; i < num_blocks; i++) {
+        auto input_buffer = CreateBuffer(100.0f * i, 0.5, num_channels, num_samples_per_block);
+        WriteBlock(input_buffer);
+    }
+
+    tester->stopAcquisition();
+
+    std::filesystem::path checksum_path, data_path;
+    ASSERT_TRUE(ContinuousPathFor("recording.crc", &checksum_path, DirectorySearchParameters()));
+    ASSERT_TRUE(ContinuousPathFor("recording.dat", &data_path, DirectorySearchParameters()));
+
+    BlockChecksumVerifier verifier;
+    ASSERT_TRUE(verifier.open(File(checksum_path.string())));
+    ASSERT_EQ(verifier.getNumChannels(), num_channels);
+
+    // The blocks cover every sample of recording.dat, in order
+    int64 next_sample = 0;
+    for (int64 i = 0; i < verifier.getNumEntries(); i++) {
+        ASSERT_EQ((int64) verifier.getEntry(i).firstSample, next_sample);
+        next_sample += verifier.getEntry(i).numSamples;
+    }
+    ASSERT_EQ(next_sample, num_samples_per_block * num_blocks);
+
+    BlockChecksumVerifier::Report report;
+    ASSERT_TRUE(verifier.verify(File(data_path.string()), 2, report));
+    ASSERT_TRUE(report.isOk());
+    ASSERT_EQ(report.blocksChecked, verifier.getNumEntries());
+    ASSERT_EQ(report.uncheckedBytes, 0);
+}
+
+class Checkpoint_PersystRecordEngineTests : public PersystRecordEngineTests {
+protected:
+    void ConfigureEngine(RecordEngineManager* manager) override {
+        manager->getParameter(15).intParam.value = 1;
+    }
+};
+
+TEST_F(Checkpoint_PersystRecordEngineTests, TestJournalsWrittenSamplesUntilStopped) {
+    tester->startAcquisition(true);
+
+    int num_samples_per_block = 1000;
+    for (int i = 0; i < 10; i++) {
+        auto input_buffer = CreateBuffer(100.0f * i, 0.5, num_channels, num_samples_per_block);
+        WriteBlock(input_buffer);
+    }
+
+    // The writer publishes at its first block after the interval, and the journal follows
+    std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+    WriteBlock(CreateBuffer(0.0f, 0.5, num_channels, num_samples_per_block));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+    std::filesystem::path data_path;
+    ASSERT_TRUE(ContinuousPathFor("recording.dat", &data_path, DirectorySearchParameters()));
+    File recording_folder = File(data_path.string()).getParentDirectory().getParentDirectory().getParentDirectory();
+    File journal = RecordingCheckpointer::getJournalFileFor(recording_folder);
+    ASSERT_TRUE(journal.existsAsFile());
+
+    var entries = JSON::parse(journal)["entries"];
+    ASSERT_TRUE(entries.isArray());
+    bool found = false;
+    for (auto& entry : *entries.getArray()) {
+        if (entry["type"].toString() == "continuous") {
+            found = true;
+            ASSERT_EQ(entry["data_file"].toString(), String("recording.dat"));
+            ASSERT_EQ((int) entry["num_channels"], num_channels);
+            ASSERT_GT((int64) entry["samples"], 0);
+            ASSERT_LE((int64) entry["samples"], 11 * num_samples_per_block);
+        }
+    }
+    ASSERT_TRUE(found);
+
+    tester->stopAcquisition();
+    ASSERT_FALSE(journal.exists());
+}
+
+class LiveTap_PersystRecordEngineTests : public PersystRecordEngineTests {
+protected:
+    void SetUp() override {
+        // One second of buffer then holds the whole recording
+        sample_rate_ = 20000;
+        PersystRecordEngineTests::SetUp();
+    }
+
+    void ConfigureEngine(RecordEngineManager* manager) override {
+        manager->getParameter(16).intParam.value = 1;
+    }
+};
+
+TEST_F(LiveTap_PersystRecordEngineTests, TestTapPublishesRecordedFrames) {
+    if (!LiveTap::isAvailable()) {
+        GTEST_SKIP() << "no POSIX shared memory";
+    }
+    tester->startAcquisition(true);
+
+    int num_samples_per_block = 1000;
+    int num_blocks = 10;
+    WriteBlock(CreateBuffer(0.0f, 0.5, num_channels, num_samples_per_block));
+
+    // The tap is named after the stream's folder and is opened with the files
+    std::filesystem::path data_path;
+    ASSERT_TRUE(ContinuousPathFor("recording.dat", &data_path, DirectorySearchParameters()));
+    String stream_name = File(data_path.string()).getParentDirectory().getFileName();
+    LiveTapReader reader;
+    ASSERT_TRUE(reader.open(LiveTap::getNameFor(stream_name)));
+    ASSERT_EQ(reader.getNumChannels(), num_channels);
+    ASSERT_EQ(reader.getChannelNames().size(), num_channels);
+    ASSERT_EQ(reader.getStreamName(), stream_name);
+
+    for (int i = 1; i < num_blocks; i++) {
+        auto input_buffer = CreateBuffer(100.0f * i, 0.5, num_channels, num_samples_per_block);
+        WriteBlock(input_buffer);
+    }
+    tester->stopAcquisition();
+
+    // The mapping stays readable after recording stops and the name is removed
+    LiveTapReader::Status status;
+    ASSERT_TRUE(reader.getStatus(status));
+    ASSERT_TRUE(status.stopped);
+    ASSERT_EQ(status.framesWritten, num_samples_per_block * num_blocks);
+    ASSERT_GT(status.timesWritten, 0);
+
+    std::vector<int16_t> tapped(size_t(num_samples_per_block) * num_blocks * num_channels);
+    int64 first_sample = -1;
+    ASSERT_EQ(reader.read(tapped.data(), num_samples_per_block * num_blocks, first_sample), num_samples_per_block * num_blocks);
+    ASSERT_EQ(first_sample, 0);
+    ASSERT_EQ(reader.getFramesLost(), 0);
+
+    std::vector<int16_t> persisted_data;
+    LoadContinuousDatFile(&persisted_data);
+    ASSERT_EQ(tapped, persisted_data);
+
+    LiveTapReader after_stop;
+    ASSERT_FALSE(after_stop.open(LiveTap::getNameFor(stream_name)));
+}
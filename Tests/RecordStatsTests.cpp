@@ -0,0 +1,118 @@
+#include "gtest/gtest.h"
+
+#include "../Source/RecordStats.h"
+
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <vector>
+
+TEST(LatencyHistogramTests, EmptyHistogramReportsZero) {
+    LatencyHistogram histogram;
+    auto summary = histogram.getSummary();
+    ASSERT_EQ(summary.count, 0);
+    ASSERT_EQ(summary.meanNs, 0.0);
+    ASSERT_EQ(summary.p50Ns, 0);
+    ASSERT_EQ(summary.maxNs, 0);
+}
+
+TEST(LatencyHistogramTests, SmallValuesAreExact) {
+    LatencyHistogram histogram;
+    for (int v = 0; v < 10; v++) {
+        histogram.record(v);
+    }
+    histogram.record(-5);
+
+    ASSERT_EQ(histogram.getCount(), 11);
+    ASSERT_EQ(histogram.getValueAtPercentile(0), 0);
+    ASSERT_EQ(histogram.getValueAtPercentile(50), 4);
+    ASSERT_EQ(histogram.getValueAtPercentile(100), 9);
+    ASSERT_EQ(histogram.getMax(), 9);
+}
+
+TEST(LatencyHistogramTests, PercentilesWithinBucketResolution) {
+    LatencyHistogram histogram;
+    const int n = 100000;
+    for (int v = 1; v <= n; v++) {
+        histogram.record(int64(v) * 1000);
+    }
+
+    auto summary = histogram.getSummary();
+    ASSERT_EQ(summary.count, n);
+    ASSERT_NEAR(summary.meanNs, (n + 1) / 2.0 * 1000, 1.0);
+    ASSERT_EQ(summary.maxNs, int64(n) * 1000);
+
+    const std::pair<double, int64> expected[] = {
+        { 50.0, 50000000 }, { 90.0, 90000000 }, { 99.0, 99000000 }, { 99.9, 99900000 }
+    };
+    for (auto [percentile, value] : expected) {
+        int64 reported = histogram.getValueAtPercentile(percentile);
+        ASSERT_GE(reported, value) << percentile;
+        ASSERT_LE(reported, value + value / 16) << percentile;
+    }
+}
+
+TEST(LatencyHistogramTests, HugeValuesDoNotOverflow) {
+    LatencyHistogram histogram;
+    histogram.record(std::numeric_limits<int64>::max());
+    histogram.record(1);
+
+    ASSERT_EQ(histogram.getValueAtPercentile(100), std::numeric_limits<int64>::max());
+    ASSERT_EQ(histogram.getValueAtPercentile(50), 1);
+}
+
+TEST(LatencyHistogramTests, ConcurrentRecordsAreAllCounted) {
+    LatencyHistogram histogram;
+    const int threads = 4;
+    const int perThread = 100000;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&histogram, t]() {
+            for (int i = 0; i < perThread; i++) {
+                histogram.record(int64(i) * threads + t);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    ASSERT_EQ(histogram.getCount(), int64(threads) * perThread);
+    ASSERT_EQ(histogram.getMax(), int64(threads) * perThread - 1);
+    ASSERT_EQ(histogram.getValueAtPercentile(100), histogram.getMax());
+}
+
+TEST(RecordStreamStatsTests, SnapshotHasCountersAndPhases) {
+    RecordStreamStats stats;
+    stats.start();
+
+    stats.addSamples(4096, 4096 * 16 * 2);
+    stats.addSamples(0, 4096 * 2);
+    stats.addBlock();
+    stats.addEvent();
+    stats.addEvent();
+    {
+        ScopedLatency timer(&stats.getHistogram(RecordStreamStats::CONVERSION));
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    {
+        ScopedLatency timer(nullptr);
+    }
+    stats.stop();
+
+    auto snapshot = stats.getSnapshot();
+    ASSERT_EQ(snapshot.samples, 4096);
+    ASSERT_EQ(snapshot.bytes, 4096 * 17 * 2);
+    ASSERT_EQ(snapshot.blocks, 1);
+    ASSERT_EQ(snapshot.events, 2);
+    ASSERT_GT(snapshot.elapsedSeconds, 0.0);
+    ASSERT_EQ(snapshot.elapsedSeconds, stats.getSnapshot().elapsedSeconds);
+
+    ASSERT_EQ(snapshot.latency[RecordStreamStats::CONVERSION].count, 1);
+    ASSERT_GE(snapshot.latency[RecordStreamStats::CONVERSION].maxNs, 2000000);
+    ASSERT_EQ(snapshot.latency[RecordStreamStats::DAT_WRITE].count, 0);
+
+    ASSERT_STREQ(RecordStreamStats::getPhaseName(RecordStreamStats::DAT_WRITE), "dat_write");
+    ASSERT_STREQ(RecordStreamStats::getPhaseName(RecordStreamStats::EVENT_WRITE), "event_write");
+}
@@ -0,0 +1,146 @@
+#include "gtest/gtest.h"
+
+#include "../Source/RecordingCheckpointer.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+class RecordingCheckpointerTests : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() / "persyst_checkpointer_tests";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        journal_path = dir / "recovery.json";
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    Array<var> Entries(const String& name, int64 samples) {
+        DynamicObject::Ptr entry = new DynamicObject();
+        entry->setProperty("name", name);
+        entry->setProperty("samples", samples);
+        Array<var> entries;
+        entries.add(var(entry));
+        return entries;
+    }
+
+    var ReadJournal() {
+        var journal;
+        EXPECT_TRUE(JSON::parse(File(String(journal_path.string())).loadFileAsString(), journal).wasOk());
+        return journal;
+    }
+
+    std::filesystem::path dir;
+    std::filesystem::path journal_path;
+};
+
+TEST_F(RecordingCheckpointerTests, JournalsTheLastEntriesOfEveryWriter) {
+    RecordingCheckpointer checkpointer(File(String(journal_path.string())), 2, 1000);
+
+    SyncableFileStream data(File(String((dir / "recording.dat").string())));
+    ASSERT_TRUE(data.write("data", 4));
+    data.flush();
+    Array<FileSyncHandle::Ptr> files;
+    files.add(data.getSyncHandle());
+
+    checkpointer.publish(1, files, Entries("b", 10));
+    checkpointer.publish(0, files, Entries("a", 20));
+    ASSERT_TRUE(checkpointer.writeCheckpoint());
+    ASSERT_EQ(checkpointer.getNumCheckpoints(), 1);
+
+    var journal = ReadJournal();
+    ASSERT_EQ(int(journal["checkpoint"]), 1);
+    Array<var>* entries = journal["entries"].getArray();
+    ASSERT_NE(entries, nullptr);
+    ASSERT_EQ(entries->size(), 2);
+    ASSERT_EQ((*entries)[0]["name"].toString(), String("a"));
+    ASSERT_EQ((*entries)[1]["name"].toString(), String("b"));
+
+    // A new checkpoint replaces only the entries of the writers that published
+    checkpointer.publish(0, Array<FileSyncHandle::Ptr>(), Entries("a", 30));
+    ASSERT_TRUE(checkpointer.writeCheckpoint());
+
+    journal = ReadJournal();
+    ASSERT_EQ(int(journal["checkpoint"]), 2);
+    entries = journal["entries"].getArray();
+    ASSERT_EQ(entries->size(), 2);
+    ASSERT_EQ(int64((*entries)[0]["samples"]), 30);
+    ASSERT_EQ(int64((*entries)[1]["samples"]), 10);
+    ASSERT_FALSE(std::filesystem::exists(dir / "recovery.json.tmp"));
+}
+
+TEST_F(RecordingCheckpointerTests, AsksEachWriterOncePerInterval) {
+    RecordingCheckpointer checkpointer(File(String(journal_path.string())), 2, 50);
+    ASSERT_FALSE(checkpointer.isDue(0));
+    ASSERT_FALSE(checkpointer.isDue(1));
+
+    checkpointer.startThread();
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!checkpointer.isDue(0) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(checkpointer.isDue(0));
+    ASSERT_TRUE(checkpointer.isDue(1));
+
+    checkpointer.publish(0, Array<FileSyncHandle::Ptr>(), Entries("a", 1));
+    ASSERT_FALSE(checkpointer.isDue(0));
+    ASSERT_TRUE(checkpointer.isDue(1));
+    checkpointer.publish(1, Array<FileSyncHandle::Ptr>(), Entries("b", 2));
+    ASSERT_FALSE(checkpointer.isDue(1));
+
+    while (checkpointer.getNumCheckpoints() == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    checkpointer.stopThread(-1);
+
+    ASSERT_GE(checkpointer.getNumCheckpoints(), 1);
+    ASSERT_EQ(ReadJournal()["entries"].getArray()->size(), 2);
+}
+
+TEST_F(RecordingCheckpointerTests, SyncsFilesAndFolders) {
+    std::filesystem::path data_path = dir / "recording.dat";
+    std::ofstream(data_path) << "data";
+
+    ASSERT_TRUE(RecordingCheckpointer::syncFile(File(String(data_path.string()))));
+    ASSERT_TRUE(RecordingCheckpointer::syncFile(File(String(dir.string()))));
+    ASSERT_FALSE(RecordingCheckpointer::syncFile(File(String((dir / "missing.dat").string()))));
+}
+
+#ifndef _WIN32
+TEST_F(RecordingCheckpointerTests, KeepsTheLastJournalWhenAFileCannotBeSynced) {
+    RecordingCheckpointer checkpointer(File(String(journal_path.string())), 1, 1000);
+
+    checkpointer.publish(0, Array<FileSyncHandle::Ptr>(), Entries("a", 10));
+    ASSERT_TRUE(checkpointer.writeCheckpoint());
+
+    // A pipe can't be synced, so the journal must not move on to entries it would cover
+    int pipe_fds[2];
+    ASSERT_EQ(pipe(pipe_fds), 0);
+    Array<FileSyncHandle::Ptr> files;
+    files.add(FileSyncHandle::create(pipe_fds[1], "pipe"));
+    ASSERT_NE(files[0], nullptr);
+    checkpointer.publish(0, files, Entries("a", 20));
+
+    ASSERT_FALSE(checkpointer.writeCheckpoint());
+    ASSERT_EQ(checkpointer.getNumCheckpoints(), 1);
+    ASSERT_EQ(int64((*ReadJournal()["entries"].getArray())[0]["samples"]), 10);
+
+    // The file is tried again at the next checkpoint
+    ASSERT_FALSE(checkpointer.writeCheckpoint());
+    ASSERT_EQ(checkpointer.getNumCheckpoints(), 1);
+
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+}
+#endif
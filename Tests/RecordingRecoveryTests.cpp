@@ -0,0 +1,200 @@
+#include "gtest/gtest.h"
+
+#include "../Source/PersystReader.h"
+#include "../Source/RecordingCheckpointer.h"
+#include "../Source/RecordingRecovery.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class RecordingRecoveryTests : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() / "persyst_recovery_tests";
+        std::filesystem::remove_all(dir);
+        stream_dir = dir / "continuous" / "Source-100.Stream";
+        events_dir = dir / "events" / "Source-100.Stream" / "TTL";
+        std::filesystem::create_directories(stream_dir);
+        std::filesystem::create_directories(events_dir);
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    void WriteFile(const std::filesystem::path& path, const std::string& bytes) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << bytes;
+    }
+
+    // num_samples frames of num_channels, followed by extra_bytes of a partly written frame
+    void WriteData(const std::filesystem::path& path, int num_channels, int num_samples, int extra_bytes = 0) {
+        std::vector<int16_t> frames(size_t(num_channels) * num_samples);
+        for (size_t i = 0; i < frames.size(); i++) {
+            frames[i] = int16_t(i);
+        }
+        std::string bytes(reinterpret_cast<const char*>(frames.data()), frames.size() * sizeof(int16_t));
+        bytes.append(size_t(extra_bytes), '\x7f');
+        WriteFile(path, bytes);
+    }
+
+    // A version 1 .npy file whose header claims header_records, like the GUI writes while recording
+    void WriteNpy(const std::filesystem::path& path, const std::string& descr, int header_records, const std::string& data) {
+        std::string dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (" + std::to_string(header_records) + ",), }";
+        dict.append(117 - dict.size(), ' ');
+        dict += '\n';
+        std::string bytes = "\x93NUMPY";
+        bytes += '\x01';
+        bytes += '\x00';
+        bytes += char(dict.size() & 0xff);
+        bytes += char(dict.size() >> 8);
+        WriteFile(path, bytes + dict + data);
+    }
+
+    std::string ReadFile(const std::filesystem::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    std::string Header(const std::string& data_file) {
+        return "[FileInfo]\nFile=" + data_file + "\nFileType=Interleaved\nSamplingRate=1000\n"
+               "HeaderLength=0\nCalibration=0.195\nWaveformCount=4\nDataType=0\n"
+               "[ChannelMap]\nCH1=1\nCH2=2\nCH3=3\nCH4=4\n";
+    }
+
+    const std::string header = Header("recording.dat");
+
+    std::filesystem::path dir;
+    std::filesystem::path stream_dir;
+    std::filesystem::path events_dir;
+};
+
+TEST_F(RecordingRecoveryTests, CutsDataAndSampleTimesBackToWholeFrames) {
+    WriteData(stream_dir / "recording.dat", 4, 3500, 5);
+    WriteFile(stream_dir / "recording.lay", header + "[SampleTimes]\n0=10\n1000=11\n2000=12\n3000=13\n4000=1");
+
+    RecordingRecovery::Report report;
+    ASSERT_TRUE(RecordingRecovery::recover(File(String(dir.string())), report));
+    ASSERT_EQ(report.layoutFiles, 1);
+    ASSERT_EQ(report.samplesRecovered, 3500);
+    ASSERT_EQ(report.bytesTruncated, 5);
+    ASSERT_EQ(report.sampleTimesDropped, 0);
+    ASSERT_EQ(report.filesRepaired, 2);
+    ASSERT_EQ(ReadFile(stream_dir / "recording.lay"), header + "[SampleTimes]\n0=10\n1000=11\n2000=12\n3000=13\n");
+
+    PersystReader reader;
+    ASSERT_TRUE(reader.open(File(String((stream_dir / "recording.lay").string()))));
+    ASSERT_EQ(reader.getNumSamples(), 3500);
+    ASSERT_EQ(reader.getSampleTimes().size(), 4);
+
+    // Rows past the data, after a partial line, are dropped as well
+    WriteFile(stream_dir / "recording.lay", header + "[SampleTimes]\n0=10\n1000=11\n3600=13.6\n\0\0\0");
+    report = RecordingRecovery::Report();
+    ASSERT_TRUE(RecordingRecovery::recover(File(String(dir.string())), report));
+    ASSERT_EQ(report.sampleTimesDropped, 1);
+    ASSERT_EQ(ReadFile(stream_dir / "recording.lay"), header + "[SampleTimes]\n0=10\n1000=11\n");
+
+    // A consistent recording is left alone
+    report = RecordingRecovery::Report();
+    ASSERT_TRUE(RecordingRecovery::recover(File(String(dir.string())), report));
+    ASSERT_EQ(report.filesRepaired, 0);
+}
+
+TEST_F(RecordingRecoveryTests, RebuildsLayoutFromJournal) {
+    // A memory-mapped data file is preallocated past the 2000 checkpointed samples
+    WriteData(stream_dir / "recording_0001.dat", 4, 2000);
+    std::ofstream(stream_dir / "recording_0001.dat", std::ios::binary | std::ios::app) << std::string(4096, '\0');
+    WriteFile(stream_dir / "recording_0001.lay", "");
+
+    DynamicObject::Ptr entry = new DynamicObject();
+    entry->setProperty("type", "continuous");
+    entry->setProperty("directory", "continuous/Source-100.Stream/");
+    entry->setProperty("data_file", "recording_0001.dat");
+    entry->setProperty("layout_file", "recording_0001.lay");
+    entry->setProperty("sample_rate", 1000.0);
+    entry->setProperty("bit_volts", 0.195);
+    entry->setProperty("num_channels", 4);
+    Array<var> names;
+    for (auto name : { "A", "B", "C", "D" }) {
+        names.add(var(name));
+    }
+    entry->setProperty("channel_names", names);
+    entry->setProperty("segment_index", 1);
+    entry->setProperty("first_sample", int64(60000));
+    entry->setProperty("preallocated", true);
+    entry->setProperty("samples", int64(2000));
+    entry->setProperty("last_sample", int64(1500));
+    entry->setProperty("last_time", 61.5);
+
+    Array<var> entries;
+    entries.add(var(entry));
+    DynamicObject::Ptr journal = new DynamicObject();
+    journal->setProperty("version", 1);
+    journal->setProperty("checkpoint", 3);
+    journal->setProperty("entries", entries);
+    File journal_file = RecordingCheckpointer::getJournalFileFor(File(String(dir.string())));
+    ASSERT_TRUE(journal_file.replaceWithText(JSON::toString(var(journal))));
+
+    RecordingRecovery::Report report;
+    ASSERT_TRUE(RecordingRecovery::recover(File(String(dir.string())), report));
+    ASSERT_EQ(report.samplesRecovered, 2000);
+    ASSERT_EQ(report.bytesTruncated, 4096);
+    ASSERT_FALSE(journal_file.existsAsFile());
+
+    PersystReader reader;
+    ASSERT_TRUE(reader.open(File(String((stream_dir / "recording_0001.lay").string()))));
+    ASSERT_EQ(reader.getNumChannels(), 4);
+    ASSERT_EQ(reader.getNumSamples(), 2000);
+    ASSERT_EQ(reader.getFileInfo().samplingRate, 1000);
+    ASSERT_EQ(reader.getSegmentIndex(), 1);
+    ASSERT_EQ(reader.getFirstSample(), 60000);
+    ASSERT_EQ(reader.getChannelName(2), String("C"));
+    ASSERT_EQ(reader.getSampleTimes().size(), 1);
+    ASSERT_EQ(reader.getSampleTimes()[0].sample, 1500);
+    ASSERT_EQ(reader.getSampleTimes()[0].time, 61.5);
+}
+
+TEST_F(RecordingRecoveryTests, KeepsTheEventsEveryColumnHolds) {
+    std::vector<int16_t> states(10, 3);
+    std::vector<int64_t> samples(9, 42);
+    std::vector<double> timestamps(10, 0.5);
+    WriteNpy(events_dir / "states.npy", "<i2", 0, std::string(reinterpret_cast<const char*>(states.data()), 20) + "\x01");
+    WriteNpy(events_dir / "sample_numbers.npy", "<i8", 0, std::string(reinterpret_cast<const char*>(samples.data()), 72));
+    WriteNpy(events_dir / "timestamps.npy", "<f8", 8, std::string(reinterpret_cast<const char*>(timestamps.data()), 80));
+
+    RecordingRecovery::Report report;
+    ASSERT_TRUE(RecordingRecovery::recover(File(String(dir.string())), report));
+    ASSERT_EQ(report.eventFolders, 1);
+    ASSERT_EQ(report.eventsRecovered, 9);
+    ASSERT_EQ(report.bytesTruncated, 3 + 8);
+
+    for (auto name : { "states.npy", "sample_numbers.npy", "timestamps.npy" }) {
+        std::string bytes = ReadFile(events_dir / name);
+        ASSERT_EQ(bytes.size(), 128u + (std::string(name) == "states.npy" ? 18u : 72u)) << name;
+        ASSERT_NE(bytes.find("'shape': (9,), }"), std::string::npos) << name;
+        ASSERT_EQ(bytes[127], '\n') << name;
+    }
+}
+
+TEST_F(RecordingRecoveryTests, FillsInTheLengthOfTheLastSegment) {
+    WriteData(stream_dir / "recording_0000.dat", 4, 1000);
+    WriteData(stream_dir / "recording_0001.dat", 4, 250);
+    WriteFile(stream_dir / "recording_0000.lay", Header("recording_0000.dat") + "[SampleTimes]\n0=0\n");
+    WriteFile(stream_dir / "recording_0001.lay", Header("recording_0001.dat") + "[SampleTimes]\n0=1\n");
+    WriteFile(stream_dir / "segments.json",
+              "{\"sample_rate\": 1000, \"num_channels\": 4, \"segments\": ["
+              "{\"index\": 0, \"data_file\": \"recording_0000.dat\", \"first_sample\": 0, \"num_samples\": 1000}, "
+              "{\"index\": 1, \"data_file\": \"recording_0001.dat\", \"first_sample\": 1000}]}");
+
+    RecordingRecovery::Report report;
+    ASSERT_TRUE(RecordingRecovery::recover(File(String(dir.string())), report)) << report.errors.joinIntoString("\n");
+    ASSERT_EQ(report.layoutFiles, 2);
+    ASSERT_EQ(report.samplesRecovered, 1250);
+
+    var manifest;
+    ASSERT_TRUE(JSON::parse(File(String((stream_dir / "segments.json").string())).loadFileAsString(), manifest).wasOk());
+    ASSERT_EQ(int64((*manifest["segments"].getArray())[1]["num_samples"]), 250);
+}
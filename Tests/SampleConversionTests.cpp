@@ -0,0 +1,245 @@
+#include "gtest/gtest.h"
+
+#include "../Source/SampleConversion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+class SampleConversionTests : public ::testing::TestWithParam<SampleConversion::InstructionSet> {
+protected:
+    void SetUp() override {
+        if (!SampleConversion::isSupported(GetParam())) {
+            GTEST_SKIP() << SampleConversion::getName(GetParam()) << " not supported on this CPU";
+        }
+
+        // Every quantisation step around zero, including exact rounding ties, plus saturation on both sides
+        for (int i = -70000; i <= 70000; i++) {
+            input.push_back(i / 65536.0f);
+        }
+
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> dist(-40000.0f, 40000.0f);
+        for (int i = 0; i < 100000; i++) {
+            input.push_back(dist(rng));
+        }
+
+        uint32_t nanBits = 0x7fc12345;
+        float payloadNaN;
+        std::memcpy(&payloadNaN, &nanBits, sizeof(float));
+
+        input.push_back(std::numeric_limits<float>::quiet_NaN());
+        input.push_back(payloadNaN);
+        input.push_back(-payloadNaN);
+        input.push_back(std::numeric_limits<float>::infinity());
+        input.push_back(-std::numeric_limits<float>::infinity());
+        input.push_back(std::numeric_limits<float>::denorm_min());
+        input.push_back(std::numeric_limits<float>::max());
+        input.push_back(std::numeric_limits<float>::lowest());
+    }
+
+    // The two-pass path used by writeContinuousData before the fused kernel
+    std::vector<int16> Reference(const float* source, float scale, int size) {
+        std::vector<float> scaled(size);
+        std::vector<int16> converted(size);
+        FloatVectorOperations::copyWithMultiply(scaled.data(), source, scale, size);
+        AudioDataConverters::convertFloatToInt16LE(scaled.data(), converted.data(), size);
+        return converted;
+    }
+
+    void CheckBitIdentical(float scale, int offset) {
+        const int size = (int) input.size() - offset;
+        auto expected = Reference(input.data() + offset, scale, size);
+
+        std::vector<int16> actual(size + 1, 0x5a5a);
+        SampleConversion::floatToInt16(GetParam(), input.data() + offset, actual.data() + 1, scale, size);
+
+        for (int i = 0; i < size; i++) {
+            ASSERT_EQ(actual[i + 1], expected[i])
+                << "input=" << input[i + offset] << " scale=" << scale << " index=" << i;
+        }
+        // Must not write past the end
+        ASSERT_EQ(actual[0], 0x5a5a);
+    }
+
+    std::vector<float> input;
+};
+
+TEST_P(SampleConversionTests, MatchesTwoPassPath_UnitScale) {
+    CheckBitIdentical(1.0f, 0);
+}
+
+TEST_P(SampleConversionTests, MatchesTwoPassPath_BitVoltsScale) {
+    for (float bitVolts : { 1.0f, 0.195f, 0.05f, 2.34f }) {
+        CheckBitIdentical(1 / (float(0x7fff) * bitVolts), 0);
+    }
+}
+
+TEST_P(SampleConversionTests, MatchesTwoPassPath_UnalignedAndTails) {
+    for (int offset = 1; offset < 17; offset++) {
+        CheckBitIdentical(1 / (float(0x7fff) * 0.195f), offset);
+    }
+}
+
+TEST_P(SampleConversionTests, ShortBuffers) {
+    for (int size = 0; size < 40; size++) {
+        auto expected = Reference(input.data() + 100, 1.0f, size);
+        std::vector<int16> actual(size);
+        SampleConversion::floatToInt16(GetParam(), input.data() + 100, actual.data(), 1.0f, size);
+        ASSERT_EQ(actual, expected) << "size=" << size;
+    }
+}
+
+TEST_P(SampleConversionTests, TracksClippingInTheSamePass) {
+    const float scale = 1 / (float(0x7fff) * 0.195f);
+    for (int offset : { 0, 3 }) {
+        const int size = (int) input.size() - offset;
+        std::vector<int16> expected(size), actual(size);
+        SampleConversion::floatToInt16(GetParam(), input.data() + offset, expected.data(), scale, size);
+
+        SampleConversion::ClipStats stats;
+        SampleConversion::floatToInt16(GetParam(), input.data() + offset, actual.data(), scale, size, stats);
+        ASSERT_EQ(actual, expected);
+
+        int64 saturated = 0;
+        for (int16 value : expected) {
+            saturated += (value == 32767 || value == -32767) ? 1 : 0;
+        }
+        ASSERT_GT(saturated, 0);
+        ASSERT_EQ(stats.saturated, saturated);
+        ASSERT_EQ(stats.minimum, *std::min_element(expected.begin(), expected.end()));
+        ASSERT_EQ(stats.maximum, *std::max_element(expected.begin(), expected.end()));
+    }
+
+    // Stats accumulate across calls
+    SampleConversion::ClipStats stats;
+    std::vector<float> quiet = { 0.1f, -0.2f, 0.3f };
+    std::vector<int16> output(quiet.size());
+    SampleConversion::floatToInt16(GetParam(), quiet.data(), output.data(), 1.0f / 0x7fff, (int) quiet.size(), stats);
+    ASSERT_EQ(stats.saturated, 0);
+    ASSERT_EQ(stats.minimum, 0);
+    ASSERT_EQ(stats.maximum, 0);
+
+    std::vector<float> railed(40, 1e6f);
+    output.resize(railed.size());
+    SampleConversion::floatToInt16(GetParam(), railed.data(), output.data(), 1.0f, (int) railed.size(), stats);
+    ASSERT_EQ(stats.saturated, 40);
+    ASSERT_EQ(stats.minimum, 0);
+    ASSERT_EQ(stats.maximum, 32767);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    AllInstructionSets,
+    SampleConversionTests,
+    ::testing::Values(
+        SampleConversion::SCALAR,
+        SampleConversion::SSE2,
+        SampleConversion::AVX2,
+        SampleConversion::AVX512),
+    [](const ::testing::TestParamInfo<SampleConversion::InstructionSet>& info) {
+        switch (info.param) {
+            case SampleConversion::SSE2: return std::string("SSE2");
+            case SampleConversion::AVX2: return std::string("AVX2");
+            case SampleConversion::AVX512: return std::string("AVX512");
+            default: return std::string("Scalar");
+        }
+    });
+
+TEST(SampleConversionDispatchTests, DefaultKernelMatchesBestInstructionSet) {
+    std::vector<float> input(1000);
+    for (int i = 0; i < (int) input.size(); i++) {
+        input[i] = (i - 500) * 71.3f;
+    }
+    std::vector<int16> dispatched(input.size()), best(input.size());
+    SampleConversion::floatToInt16(input.data(), dispatched.data(), 0.01f, (int) input.size());
+    SampleConversion::floatToInt16(SampleConversion::getInstructionSet(), input.data(), best.data(), 0.01f, (int) input.size());
+    ASSERT_EQ(dispatched, best);
+}
+
+TEST_P(SampleConversionTests, Int16ToFloatMatchesScalar) {
+    std::vector<int16> samples;
+    for (int i = -32768; i <= 32767; i++) {
+        samples.push_back(int16(i));
+    }
+
+    for (float scale : { 1.0f, 0.195f, 0.05f, -2.34f }) {
+        for (int offset = 0; offset < 17; offset++) {
+            const int size = (int) samples.size() - offset;
+            std::vector<float> actual(size + 1, 12345.0f);
+            SampleConversion::int16ToFloat(GetParam(), samples.data() + offset, actual.data(), scale, size);
+
+            for (int i = 0; i < size; i++) {
+                ASSERT_EQ(actual[i], float(samples[i + offset]) * scale) << "scale=" << scale << " index=" << i;
+            }
+            // Must not write past the end
+            ASSERT_EQ(actual[size], 12345.0f);
+        }
+    }
+}
+
+class ChannelKernelsTests : public ::testing::TestWithParam<int> {};
+
+TEST_P(ChannelKernelsTests, MatchGenericKernels) {
+    const int channels = GetParam();
+    const int samples = 203;
+    const int stride = samples + 5;
+    auto kernels = SampleConversion::getChannelKernels(channels);
+    auto generic = SampleConversion::getGenericChannelKernels();
+    ASSERT_EQ(SampleConversion::hasFixedChannelKernels(channels),
+              channels == 8 || channels == 16 || channels == 32 || channels == 64 || channels == 128 || channels == 384);
+
+    std::vector<int16> rows(size_t(channels) * stride);
+    for (size_t i = 0; i < rows.size(); i++) {
+        rows[i] = int16(i * 7919);
+    }
+
+    // Whole-stream interleave
+    std::vector<int16> expected(size_t(channels) * samples), actual(expected.size());
+    for (int s = 0; s < samples; s++) {
+        for (int c = 0; c < channels; c++) {
+            expected[size_t(s) * channels + c] = rows[size_t(c) * stride + s];
+        }
+    }
+    kernels.interleave(rows.data(), stride, actual.data(), channels, samples);
+    ASSERT_EQ(actual, expected);
+    std::fill(actual.begin(), actual.end(), 0);
+    generic.interleave(rows.data(), stride, actual.data(), channels, samples);
+    ASSERT_EQ(actual, expected);
+
+    // One channel at a time, as int16 and as float
+    std::vector<float> input(samples);
+    for (int s = 0; s < samples; s++) {
+        input[s] = (s - 100) * 431.7f;
+    }
+    // A NaN inside a vector of samples takes the scalar fallback
+    input[19] = std::numeric_limits<float>::quiet_NaN();
+    std::vector<int16> converted(samples);
+    SampleConversion::floatToInt16(SampleConversion::SCALAR, input.data(), converted.data(), 0.01f, samples);
+
+    const int channel = channels - 1;
+    std::vector<int16> scattered(size_t(channels) * samples, 1), convertScattered(scattered.size(), 1);
+    kernels.scatter(rows.data(), scattered.data() + channel, channels, samples);
+    SampleConversion::ClipStats stats;
+    kernels.convertScatter(input.data(), convertScattered.data() + channel, channels, 0.01f, samples, &stats);
+    ASSERT_EQ(stats.minimum, *std::min_element(converted.begin(), converted.end()));
+    ASSERT_EQ(stats.maximum, *std::max_element(converted.begin(), converted.end()));
+    ASSERT_EQ(stats.saturated, std::count_if(converted.begin(), converted.end(), [](int16 v) { return v == 0x7fff || v == -0x7fff; }));
+    for (size_t i = 0; i < scattered.size(); i++) {
+        if (int(i % channels) == channel) {
+            ASSERT_EQ(scattered[i], rows[i / channels]) << i;
+            ASSERT_EQ(convertScattered[i], converted[i / channels]) << i;
+        } else {
+            // Other channels are left alone
+            ASSERT_EQ(scattered[i], 1) << i;
+            ASSERT_EQ(convertScattered[i], 1) << i;
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Widths,
+    ChannelKernelsTests,
+    ::testing::Values(1, 3, 8, 12, 16, 32, 64, 100, 128, 384, 385));
@@ -0,0 +1,186 @@
+#include "gtest/gtest.h"
+
+#include "../Source/PersystReader.h"
+#include "../Source/SampleTimesWriter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class SampleTimesWriterTests : public ::testing::Test {
+protected:
+    void SetUp() override {
+        path = std::filesystem::temp_directory_path() / "persyst_sample_times_writer_test.lay";
+        std::filesystem::remove(path);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(path);
+    }
+
+    std::string ReadFile() {
+        std::ifstream in(path);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+    }
+
+    std::filesystem::path path;
+};
+
+TEST_F(SampleTimesWriterTests, TimestampsRoundTripExactly) {
+    const double timestamps[] = { 0.0, 4096.0 / 30000.0, 86400.0 * 3 + 1.0 / 3.0, 1e-7, 123456789.123456789 };
+    {
+        SampleTimesWriter writer(new SyncableFileStream(File(String(path.string()))));
+        int64 sample = 0;
+        for (double t : timestamps) {
+            writer.add(sample, t);
+            sample += 4096;
+        }
+    }
+
+    std::istringstream lines(ReadFile());
+    std::string line;
+    int64 sample = 0;
+    for (double t : timestamps) {
+        ASSERT_TRUE(std::getline(lines, line));
+        auto eq = line.find('=');
+        ASSERT_NE(eq, std::string::npos);
+        ASSERT_EQ(std::stoll(line.substr(0, eq)), sample);
+        ASSERT_EQ(std::strtod(line.c_str() + eq + 1, nullptr), t);
+        sample += 4096;
+    }
+    ASSERT_FALSE(std::getline(lines, line));
+}
+
+TEST_F(SampleTimesWriterTests, WritesInBatches) {
+    SampleTimesWriter writer(new SyncableFileStream(File(String(path.string()))), 1024, 3600000);
+
+    writer.add(0, 0.5);
+    writer.add(4096, 1.0);
+    ASSERT_EQ(ReadFile(), "");
+
+    // Fill the arena until it has to be written out
+    for (int i = 2; i < 100; i++) {
+        writer.add(int64(i) * 4096, i * 0.5);
+    }
+    std::string partial = ReadFile();
+    ASSERT_GT(partial.size(), 0);
+    ASSERT_LE(partial.size(), 1024);
+    ASSERT_EQ(partial.back(), '\n');
+
+    writer.flush();
+    std::string all = ReadFile();
+    ASSERT_EQ(all.substr(0, 12), "0=0.5\n4096=1");
+    ASSERT_EQ(std::count(all.begin(), all.end(), '\n'), 100);
+}
+
+TEST_F(SampleTimesWriterTests, CompressionKeepsOnlyDiscontinuitiesAndKeyframes) {
+    const double sampleRate = 30000;
+    const int block = 1000;
+    SampleTimesWriter::Stats stats;
+    {
+        SampleTimesWriter writer(new SyncableFileStream(File(String(path.string()))));
+        writer.setCompression(sampleRate, 100e-6, 10.0);
+
+        // 15 s of uniformly sampled blocks, then a 0.5 s jump and 5 s more
+        double offset = 0;
+        for (int64 sample = 0; sample < 20 * 30000; sample += block) {
+            if (sample == 15 * 30000) {
+                offset = 0.5;
+            }
+            writer.add(sample, sample / sampleRate + offset);
+        }
+        writer.finish();
+        stats = writer.getStats();
+    }
+
+    std::istringstream lines(ReadFile());
+    std::vector<int64> rows;
+    std::string line;
+    while (std::getline(lines, line)) {
+        rows.push_back(std::stoll(line.substr(0, line.find('='))));
+    }
+
+    // First row, 10 s keyframe, the rows on either side of the jump, and the last row
+    std::vector<int64> expected = { 0, 300000, 449000, 450000, 599000 };
+    ASSERT_EQ(rows, expected);
+    ASSERT_EQ(stats.rowsEmitted, 5);
+    ASSERT_EQ(stats.rowsSuppressed, 600 - 5);
+    ASSERT_EQ(stats.discontinuities, 1);
+}
+
+TEST_F(SampleTimesWriterTests, CompressionFollowsDriftWithinTolerance) {
+    const double sampleRate = 30000;
+    const double tolerance = 100e-6;
+    const int block = 1024;
+    auto clock = [&](int64 sample) { return sample / sampleRate * (1.0 + 10e-6); };
+
+    // A layout file around the rows, so they are read back the way Persyst reads them
+    const std::filesystem::path dataPath = std::filesystem::path(path).replace_extension(".dat");
+    std::ofstream(dataPath, std::ios::binary);
+    {
+        std::ofstream lay(path);
+        lay << "[FileInfo]\nFile=" << dataPath.filename().string() << "\nFileType=Interleaved\nSamplingRate=30000\n"
+            << "HeaderLength=0\nCalibration=1\nWaveformCount=1\nDataType=0\n[ChannelMap]\nCH1=1\n[SampleTimes]\n";
+    }
+
+    SampleTimesWriter::Stats stats;
+    {
+        SampleTimesWriter writer(new SyncableFileStream(File(String(path.string()))));
+        writer.setCompression(sampleRate, tolerance, 60.0);
+
+        // A clock running 10 ppm fast strays 100 us from the nominal rate every 10 s
+        for (int64 sample = 0; sample < int64(1000 * sampleRate); sample += block) {
+            writer.add(sample, clock(sample));
+        }
+        writer.finish();
+        stats = writer.getStats();
+    }
+
+    // Drift writes rows but is no discontinuity
+    ASSERT_EQ(stats.discontinuities, 0);
+    ASSERT_LT(stats.rowsEmitted, 1000 / 10 * 2);
+
+    // Every block reads back within the tolerance from the nominal rate
+    PersystReader reader;
+    ASSERT_TRUE(reader.open(File(String(path.string()))));
+    for (int64 sample = 0; sample < int64(1000 * sampleRate); sample += block) {
+        ASSERT_NEAR(reader.getTimeOfSample(sample), clock(sample), tolerance * 1.001) << sample;
+    }
+    reader.close();
+    std::filesystem::remove(dataPath);
+}
+
+TEST_F(SampleTimesWriterTests, CompressionCountsJumpsOnADriftingClock) {
+    const double sampleRate = 30000;
+    const int block = 1000;
+    SampleTimesWriter writer(new SyncableFileStream(File(String(path.string()))));
+    writer.setCompression(sampleRate, 100e-6, 3600.0);
+
+    // A clock running 20 ppm slow, with a 1 ms jump after 500 s
+    double offset = 0;
+    for (int64 sample = 0; sample < int64(1000 * sampleRate); sample += block) {
+        if (sample == int64(500 * sampleRate)) {
+            offset = 1e-3;
+        }
+        writer.add(sample, sample / sampleRate * (1.0 - 20e-6) + offset);
+    }
+    writer.finish();
+
+    auto stats = writer.getStats();
+    ASSERT_EQ(stats.discontinuities, 1);
+
+    std::istringstream lines(ReadFile());
+    std::vector<int64> rows;
+    std::string line;
+    while (std::getline(lines, line)) {
+        rows.push_back(std::stoll(line.substr(0, line.find('='))));
+    }
+    ASSERT_NE(std::find(rows.begin(), rows.end(), int64(500 * sampleRate) - block), rows.end());
+    ASSERT_NE(std::find(rows.begin(), rows.end(), int64(500 * sampleRate)), rows.end());
+}
@@ -0,0 +1,68 @@
+#include "gtest/gtest.h"
+
+#include "../Source/SaturationStats.h"
+
+#include <thread>
+#include <vector>
+
+TEST(SaturationStatsTests, StartsEmpty) {
+    SaturationStats stats(3);
+    ASSERT_EQ(stats.getNumChannels(), 3);
+
+    auto snapshot = stats.getSnapshot();
+    ASSERT_EQ(snapshot.channels.size(), 3);
+    ASSERT_EQ(snapshot.saturated, 0);
+    ASSERT_EQ(snapshot.saturatedChannels, 0);
+    ASSERT_EQ(snapshot.channels[1].samples, 0);
+    ASSERT_GT(snapshot.channels[1].minimum, snapshot.channels[1].maximum);
+}
+
+TEST(SaturationStatsTests, AccumulatesConvertedBlocksPerChannel) {
+    SaturationStats stats(2);
+
+    std::vector<float> block = { 0.5f, 2.0f, -0.25f, -3.0f, 0.0f };
+    std::vector<int16> converted(block.size());
+    for (int i = 0; i < 3; i++) {
+        SampleConversion::ClipStats clip;
+        SampleConversion::floatToInt16(block.data(), converted.data(), 1.0f, (int) block.size(), clip);
+        stats.add(1, (int) block.size(), clip);
+    }
+
+    auto channel = stats.getChannel(1);
+    ASSERT_EQ(channel.samples, 15);
+    ASSERT_EQ(channel.saturated, 6);
+    ASSERT_EQ(channel.minimum, -32767);
+    ASSERT_EQ(channel.maximum, 32767);
+
+    auto snapshot = stats.getSnapshot();
+    ASSERT_EQ(snapshot.saturated, 6);
+    ASSERT_EQ(snapshot.saturatedChannels, 1);
+    ASSERT_EQ(snapshot.channels[0].samples, 0);
+}
+
+TEST(SaturationStatsTests, CanBeReadWhileWriting) {
+    SaturationStats stats(1);
+    std::atomic<bool> done{ false };
+
+    std::thread writer([&] {
+        SampleConversion::ClipStats clip;
+        clip.saturated = 1;
+        clip.minimum = -10;
+        clip.maximum = 10;
+        for (int i = 0; i < 100000; i++) {
+            stats.add(0, 4, clip);
+        }
+        done = true;
+    });
+
+    int64 last = 0;
+    while (!done) {
+        auto channel = stats.getChannel(0);
+        ASSERT_GE(channel.saturated, last);
+        last = channel.saturated;
+    }
+    writer.join();
+
+    ASSERT_EQ(stats.getChannel(0).samples, 400000);
+    ASSERT_EQ(stats.getChannel(0).saturated, 100000);
+}
@@ -0,0 +1,86 @@
+#include "gtest/gtest.h"
+
+#include "../Source/SpscRing.h"
+
+#include <thread>
+#include <vector>
+
+TEST(SpscRingTests, EmptyRingHasNothingToRead) {
+    SpscRing ring(1024);
+    size_t size = 0;
+    ASSERT_EQ(ring.beginRead(size), nullptr);
+    ASSERT_EQ(ring.getUsedBytes(), 0);
+}
+
+TEST(SpscRingTests, RecordsWrapAroundTheBuffer) {
+    SpscRing ring(256);
+
+    // 40-byte records don't divide the capacity, so they must wrap with padding
+    for (int i = 0; i < 100; i++) {
+        uint8* record = ring.beginWrite(40);
+        ASSERT_NE(record, nullptr);
+        memset(record, i, 40);
+        ring.endWrite();
+
+        size_t size = 0;
+        const uint8* read = ring.beginRead(size);
+        ASSERT_NE(read, nullptr);
+        ASSERT_EQ(size, 40);
+        for (int b = 0; b < 40; b++) {
+            ASSERT_EQ(read[b], (uint8) i);
+        }
+        ring.endRead();
+    }
+    ASSERT_EQ(ring.getUsedBytes(), 0);
+}
+
+TEST(SpscRingTests, FullRingRefusesWritesAndTracksHighWaterMark) {
+    SpscRing ring(256);
+
+    int written = 0;
+    while (uint8* record = ring.beginWrite(24)) {
+        memset(record, 0, 24);
+        ring.endWrite();
+        written++;
+    }
+    ASSERT_EQ(written, 256 / 32);
+    ASSERT_EQ(ring.getHighWaterMark(), 256);
+    ASSERT_EQ(ring.beginWrite(ring.getMaxRecordSize() + 1), nullptr);
+}
+
+TEST(SpscRingTests, ConcurrentProducerAndConsumerPreserveOrder) {
+    SpscRing ring(4096);
+    const int num_records = 200000;
+
+    std::thread producer([&]() {
+        for (int i = 0; i < num_records; i++) {
+            size_t size = sizeof(int) * (1 + i % 37);
+            uint8* record;
+            while ((record = ring.beginWrite(size)) == nullptr) {
+                std::this_thread::yield();
+            }
+            int* values = reinterpret_cast<int*>(record);
+            for (size_t v = 0; v < size / sizeof(int); v++) {
+                values[v] = i;
+            }
+            ring.endWrite();
+        }
+    });
+
+    for (int i = 0; i < num_records; i++) {
+        size_t size = 0;
+        const uint8* record;
+        while ((record = ring.beginRead(size)) == nullptr) {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(size, sizeof(int) * (1 + i % 37));
+        const int* values = reinterpret_cast<const int*>(record);
+        for (size_t v = 0; v < size / sizeof(int); v++) {
+            ASSERT_EQ(values[v], i);
+        }
+        ring.endRead();
+    }
+
+    producer.join();
+    ASSERT_LE(ring.getHighWaterMark(), ring.getCapacity());
+}
@@ -0,0 +1,79 @@
+#include "gtest/gtest.h"
+
+#include "../Source/SyncableFileStream.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+class SyncableFileStreamTests : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() / "persyst_syncable_file_stream_tests";
+        std::filesystem::remove_all(dir);
+        path = dir / "sub" / "file.bin";
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    std::string ReadFile() {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    std::filesystem::path dir;
+    std::filesystem::path path;
+};
+
+TEST_F(SyncableFileStreamTests, BuffersWritesAndHandsThemOverOnFlush) {
+    SyncableFileStream stream(File(String(path.string())), 8);
+    ASSERT_TRUE(stream.openedOk());
+    ASSERT_NE(stream.getSyncHandle(), nullptr);
+
+    ASSERT_TRUE(stream.write("abc", 3));
+    ASSERT_EQ(ReadFile(), "");
+    ASSERT_TRUE(stream.write("0123456789", 10));
+    ASSERT_EQ(stream.getPosition(), 13);
+    stream.flush();
+    ASSERT_EQ(ReadFile(), "abc0123456789");
+
+    // Rewriting in place keeps what follows
+    ASSERT_TRUE(stream.setPosition(1));
+    ASSERT_TRUE(stream.write("BC", 2));
+    ASSERT_TRUE(stream.setPosition(13));
+    ASSERT_TRUE(stream.write("!", 1));
+    ASSERT_TRUE(stream.sync());
+    ASSERT_EQ(ReadFile(), "aBC0123456789!");
+
+    ASSERT_TRUE(stream.setPosition(4));
+    ASSERT_TRUE(stream.truncate());
+    ASSERT_EQ(ReadFile(), "aBC0");
+}
+
+TEST_F(SyncableFileStreamTests, AppendsToExistingFiles) {
+    {
+        SyncableFileStream stream(File(String(path.string())));
+        ASSERT_TRUE(stream.writeText("first\n", false, false, nullptr));
+    }
+    SyncableFileStream stream(File(String(path.string())));
+    ASSERT_EQ(stream.getPosition(), 6);
+    ASSERT_TRUE(stream.writeText("second\n", false, false, nullptr));
+    stream.flush();
+    ASSERT_EQ(ReadFile(), "first\nsecond\n");
+}
+
+TEST_F(SyncableFileStreamTests, SyncHandleOutlivesTheStream) {
+    FileSyncHandle::Ptr handle;
+    {
+        SyncableFileStream stream(File(String(path.string())), 0);
+        ASSERT_TRUE(stream.write("data", 4));
+        handle = stream.getSyncHandle();
+        ASSERT_TRUE(handle->sync());
+    }
+    ASSERT_TRUE(handle->sync());
+    ASSERT_EQ(handle->getPath(), String(path.string()));
+    ASSERT_EQ(ReadFile(), "data");
+}
@@ -0,0 +1,107 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <RecordingLib.h>
+
+#include "../Source/BinaryRecordingConverter.h"
+
+/*
+    Converts an Open Ephys Binary recording to the Persyst format.
+
+    persyst_convert [--threads N] [--compress-sample-times] <recording folder> <output folder>
+
+    The recording folder is the one holding structure.oebin. Every continuous stream is
+    written to <output folder>/continuous/<stream>/recording.dat and recording.lay.
+*/
+
+static void printUsage()
+{
+    std::cerr << "Usage: persyst_convert [--threads N] [--compress-sample-times] <recording folder> <output folder>" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    BinaryRecordingConverter::Options options;
+    options.numThreads = jmax(1, SystemStats::getNumCpus());
+
+    StringArray paths;
+    for (int i = 1; i < argc; i++)
+    {
+        const String arg(argv[i]);
+        if (arg == "--threads" && i + 1 < argc)
+            options.numThreads = jmax(1, String(argv[++i]).getIntValue());
+        else if (arg == "--compress-sample-times")
+            options.compressSampleTimes = true;
+        else if (arg.startsWith("--"))
+        {
+            printUsage();
+            return 1;
+        }
+        else
+            paths.add(arg);
+    }
+
+    if (paths.size() != 2)
+    {
+        printUsage();
+        return 1;
+    }
+
+    const File source = File::getCurrentWorkingDirectory().getChildFile(paths[0]);
+    const File output = File::getCurrentWorkingDirectory().getChildFile(paths[1]);
+
+    BinaryRecordingConverter converter(source, output);
+    if (!converter.readStructure())
+    {
+        std::cerr << "[Persyst] " << converter.getLastError() << std::endl;
+        return 1;
+    }
+
+    std::cout << "[Persyst] Converting " << converter.getNumStreams() << " streams with "
+              << options.numThreads << " threads" << std::endl;
+
+    const double startTime = Time::getMillisecondCounterHiRes();
+
+    auto progress = [startTime](int64 bytesDone, int64 bytesTotal)
+    {
+        const double seconds = (Time::getMillisecondCounterHiRes() - startTime) / 1000;
+        const double percent = bytesTotal > 0 ? 100.0 * bytesDone / bytesTotal : 100.0;
+        const double rate = seconds > 0 ? bytesDone / seconds / 1e9 : 0;
+        std::cout << "\r[Persyst] " << String(percent, 1) << "% " << String(rate, 2) << " GB/s" << std::flush;
+    };
+
+    const bool ok = converter.convert(options, progress);
+    std::cout << std::endl;
+
+    if (!ok)
+    {
+        std::cerr << "[Persyst] " << converter.getLastError() << std::endl;
+        return 1;
+    }
+
+    const double seconds = (Time::getMillisecondCounterHiRes() - startTime) / 1000;
+    std::cout << "[Persyst] Converted " << String(converter.getTotalBytes() / 1e9, 2) << " GB in "
+              << String(seconds, 1) << " s" << std::endl;
+    return 0;
+}
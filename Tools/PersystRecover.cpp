@@ -0,0 +1,96 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <RecordingLib.h>
+
+#include "../Source/RecordingRecovery.h"
+
+/*
+    Repairs recordings interrupted by a crash or power loss.
+
+    persyst_recover <recording folder> ...
+
+    Each folder is either a recording folder, holding continuous/ and events/, or any
+    folder above them, in which case every recording folder below it is repaired.
+    Exits with 1 if any recording could not be repaired completely.
+*/
+
+static void printUsage()
+{
+    std::cerr << "Usage: persyst_recover <recording folder> ..." << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    Array<File> recordingFolders;
+    for (int i = 1; i < argc; i++)
+    {
+        const String arg(argv[i]);
+        const File path = File::getCurrentWorkingDirectory().getChildFile(arg);
+        if (arg.startsWith("--") || !path.isDirectory())
+        {
+            printUsage();
+            return 1;
+        }
+
+        if (RecordingRecovery::isRecordingFolder(path))
+            recordingFolders.add(path);
+        else
+        {
+            for (const File& folder : path.findChildFiles(File::findDirectories, true, "recording*"))
+            {
+                if (RecordingRecovery::isRecordingFolder(folder))
+                    recordingFolders.add(folder);
+            }
+        }
+    }
+
+    if (recordingFolders.size() == 0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    int failedFolders = 0;
+    for (const File& folder : recordingFolders)
+    {
+        RecordingRecovery::Report report;
+        const bool ok = RecordingRecovery::recover(folder, report);
+
+        std::cout << "[Persyst] " << folder.getFullPathName() << ": " << report.layoutFiles << " layout files, "
+                  << report.samplesRecovered << " samples, " << report.eventFolders << " event folders, "
+                  << report.eventsRecovered << " events" << std::endl;
+        std::cout << "[Persyst]   " << report.filesRepaired << " files repaired, " << report.bytesTruncated
+                  << " bytes truncated, " << report.sampleTimesDropped << " [SampleTimes] rows dropped" << std::endl;
+
+        for (const String& error : report.errors)
+            std::cerr << "[Persyst]   " << error << std::endl;
+
+        if (!ok)
+            failedFolders++;
+    }
+
+    return failedFolders > 0 ? 1 : 0;
+}
@@ -0,0 +1,135 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include <RecordingLib.h>
+
+#include "../Source/LiveTapReader.h"
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+/*
+    Follows a recording through its live tap and prints what arrives.
+
+    persyst_tap <tap name or stream> [seconds]
+
+    Once a second, prints the frames received and lost, the last sample time and the RMS of
+    each channel in microvolts. Runs for the given number of seconds, or until recording
+    stops and every published frame has been read.
+*/
+
+static void printUsage()
+{
+    std::cerr << "Usage: persyst_tap <tap name or stream> [seconds]" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3 || String(argv[1]).startsWith("--"))
+    {
+        printUsage();
+        return 1;
+    }
+
+    const String arg(argv[1]);
+    const String name = arg.startsWithChar('/') ? arg : LiveTap::getNameFor(arg);
+    const double seconds = argc == 3 ? String(argv[2]).getDoubleValue() : 0.0;
+
+    LiveTapReader reader;
+    if (!reader.open(name))
+    {
+        std::cerr << "No live tap at " << name << "; is the stream recording with a live tap buffer set?" << std::endl;
+        return 1;
+    }
+
+    const int numChannels = reader.getNumChannels();
+    std::cout << "Following " << reader.getStreamName() << " at " << name << ": " << numChannels
+              << " channels at " << reader.getSampleRate() << " Hz, " << reader.getCapacity()
+              << " frames buffered" << std::endl;
+
+    const int maxFrames = 4096;
+    std::vector<int16> frames(size_t(maxFrames) * numChannels);
+    std::vector<LiveTap::SampleTime> times(256);
+    std::vector<double> sumSquares(numChannels, 0.0);
+    int64 framesReceived = 0;
+    int64 framesInSecond = 0;
+    LiveTap::SampleTime lastTime{ -1, 0.0 };
+
+    const auto start = std::chrono::steady_clock::now();
+    auto nextReport = start + std::chrono::seconds(1);
+    while (true)
+    {
+        LiveTapReader::Status status;
+        const bool stopped = reader.getStatus(status) && status.stopped;
+
+        int64 firstSample = 0;
+        const int n = reader.read(frames.data(), maxFrames, firstSample);
+        for (int i = 0; i < n; i++)
+        {
+            const int16* frame = frames.data() + size_t(i) * numChannels;
+            for (int ch = 0; ch < numChannels; ch++)
+                sumSquares[ch] += double(frame[ch]) * double(frame[ch]);
+        }
+        framesReceived += n;
+        framesInSecond += n;
+
+        int numTimes;
+        while ((numTimes = reader.readSampleTimes(times.data(), int(times.size()))) > 0)
+            lastTime = times[numTimes - 1];
+
+        const auto now = std::chrono::steady_clock::now();
+        const bool done = (stopped && n == 0)
+            || (seconds > 0 && now - start >= std::chrono::duration<double>(seconds));
+        if (now >= nextReport || done)
+        {
+            std::cout << "received " << framesReceived << " frames, lost " << reader.getFramesLost();
+            if (lastTime.sample >= 0)
+                std::cout << ", sample " << lastTime.sample << " at " << lastTime.time << " s";
+            std::cout << std::endl << "  RMS (uV):";
+            for (int ch = 0; ch < numChannels; ch++)
+            {
+                const double rms = framesInSecond > 0 ? std::sqrt(sumSquares[ch] / double(framesInSecond)) : 0.0;
+                std::cout << " " << reader.getChannelNames()[ch] << "=" << rms * reader.getBitVolts();
+                sumSquares[ch] = 0.0;
+            }
+            std::cout << std::endl;
+
+            framesInSecond = 0;
+            nextReport = now + std::chrono::seconds(1);
+        }
+
+        if (done)
+            break;
+        if (n < maxFrames)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    if (reader.getFramesLost() > 0)
+        std::cout << reader.getFramesLost() << " frames were overwritten before they were read" << std::endl;
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2022 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <RecordingLib.h>
+
+#include "../Source/BlockChecksumVerifier.h"
+
+/*
+    Checks recordings against the block checksums written with them.
+
+    persyst_verify [--threads N] <recording folder or .crc file> ...
+
+    Every .crc file found in the given folders is checked against the .dat file of the
+    same name next to it. Exits with 1 if any block does not match or is missing.
+*/
+
+static void printUsage()
+{
+    std::cerr << "Usage: persyst_verify [--threads N] <recording folder or .crc file> ..." << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    int numThreads = jmax(1, SystemStats::getNumCpus());
+
+    Array<File> checksumFiles;
+    for (int i = 1; i < argc; i++)
+    {
+        const String arg(argv[i]);
+        if (arg == "--threads" && i + 1 < argc)
+            numThreads = jmax(1, String(argv[++i]).getIntValue());
+        else if (arg.startsWith("--"))
+        {
+            printUsage();
+            return 1;
+        }
+        else
+        {
+            const File path = File::getCurrentWorkingDirectory().getChildFile(arg);
+            if (path.isDirectory())
+                checksumFiles.addArray(path.findChildFiles(File::findFiles, true, "*.crc"));
+            else
+                checksumFiles.add(path);
+        }
+    }
+
+    if (checksumFiles.size() == 0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    int64 totalBytes = 0;
+    int failedFiles = 0;
+    const double startTime = Time::getMillisecondCounterHiRes();
+
+    for (const File& checksumFile : checksumFiles)
+    {
+        const File dataFile = checksumFile.withFileExtension("dat");
+
+        BlockChecksumVerifier verifier;
+        BlockChecksumVerifier::Report report;
+        if (!verifier.open(checksumFile) || !verifier.verify(dataFile, numThreads, report,
+            [&dataFile](int64 bytesDone, int64 bytesTotal)
+            {
+                const double percent = bytesTotal > 0 ? 100.0 * bytesDone / bytesTotal : 100.0;
+                std::cout << "\r[Persyst] " << dataFile.getFullPathName() << " " << String(percent, 1) << "%" << std::flush;
+            }))
+        {
+            std::cout << std::endl;
+            std::cerr << "[Persyst] " << verifier.getLastError() << std::endl;
+            failedFiles++;
+            continue;
+        }
+        std::cout << std::endl;
+
+        totalBytes += report.bytesChecked;
+
+        for (const BlockChecksumVerifier::Failure& failure : report.failures)
+        {
+            const int64 first = int64(failure.entry.firstSample);
+            const int64 last = first + failure.entry.numSamples - 1;
+            if (failure.missing)
+                std::cout << "[Persyst]   samples " << first << "-" << last << ": missing" << std::endl;
+            else
+                std::cout << "[Persyst]   samples " << first << "-" << last << ": CRC32C "
+                          << String::toHexString((int) failure.actualCrc) << ", expected "
+                          << String::toHexString((int) failure.entry.crc) << std::endl;
+        }
+
+        if (report.uncheckedBytes > 0)
+            std::cout << "[Persyst]   " << report.uncheckedBytes << " bytes after the last checksummed block" << std::endl;
+
+        if (report.isOk())
+            std::cout << "[Persyst]   OK, " << report.blocksChecked << " blocks" << std::endl;
+        else
+        {
+            std::cout << "[Persyst]   " << report.failures.size() << " of " << report.blocksChecked << " blocks FAILED" << std::endl;
+            failedFiles++;
+        }
+    }
+
+    const double seconds = (Time::getMillisecondCounterHiRes() - startTime) / 1000;
+    std::cout << "[Persyst] Checked " << String(totalBytes / 1e9, 2) << " GB in " << String(seconds, 1) << " s, "
+              << failedFiles << " of " << checksumFiles.size() << " files failed" << std::endl;
+
+    return failedFiles > 0 ? 1 : 0;
+}